@@ -17,6 +17,7 @@
 #include <osgDB/ReadFile>
 #include <osgDB/WriteFile>
 #include <osgDB/FileUtils>
+#include <osgDB/FileNameUtils>
 
 #include <iostream>
 #include <algorithm>
@@ -62,6 +63,19 @@ int main( int argc, char **argv )
         list = true;
     }
 
+    // copy the files of an existing archive unchanged into a new archive, which is written in the format selected below.
+    std::string convertFilename;
+    while (arguments.read("-c",convertFilename) || arguments.read("--convert",convertFilename))
+    {
+    }
+
+    // create new archives indexed by a hash table, which older versions of the osga plugin can't read.
+    bool hashedIndex = false;
+    while (arguments.read("--hashed-index"))
+    {
+        hashedIndex = true;
+    }
+
     typedef std::vector<std::string> FileNameList;
     FileNameList files;
     for(int pos=1;pos<arguments.argc();++pos)
@@ -110,9 +124,21 @@ int main( int argc, char **argv )
         return 1;
     }
 
-    if (!insert && !extract && !list)
+    if (!insert && !extract && !list && convertFilename.empty())
+    {
+        std::cout<<"Please specify an operation on the archive, either --insert, --extract, --list or --convert"<<std::endl;
+        return 1;
+    }
+
+    if (!convertFilename.empty() && (insert || extract))
     {
-        std::cout<<"Please specify an operation on the archive, either --insert, --extract or --list"<<std::endl;
+        std::cout<<"Cannot convert an archive and insert or extract files at one time."<<std::endl;
+        return 1;
+    }
+
+    if (!convertFilename.empty() && osgDB::getRealPath(convertFilename)==osgDB::getRealPath(archiveFilename))
+    {
+        std::cout<<"Please specify a different archive name to convert "<<convertFilename<<" to."<<std::endl;
         return 1;
     }
 
@@ -122,11 +148,14 @@ int main( int argc, char **argv )
         return 1;
     }
 
+    osg::ref_ptr<osgDB::ReaderWriter::Options> options = new osgDB::ReaderWriter::Options;
+    if (hashedIndex) options->setOptionString("hashedIndex");
+
     osg::ref_ptr<osgDB::Archive> archive;
 
     if (insert)
     {
-        archive = osgDB::openArchive(archiveFilename, osgDB::Archive::WRITE);
+        archive = osgDB::openArchive(archiveFilename, osgDB::Archive::WRITE, 4096, options.get());
 
         if (archive.valid())
         {
@@ -152,6 +181,17 @@ int main( int argc, char **argv )
             }
         }
     }
+    else if (!convertFilename.empty())
+    {
+        // the osga plugin copies the bytes of each file across itself, so files aren't re-encoded by their ReaderWriters.
+        options->setPluginStringData("sourceArchive", convertFilename);
+        archive = osgDB::openArchive(archiveFilename, osgDB::Archive::CREATE, 4096, options.get());
+        if (!archive.valid())
+        {
+            std::cout<<"Unable to convert archive "<<convertFilename<<" to "<<archiveFilename<<std::endl;
+            return 1;
+        }
+    }
     else
     {
         archive = osgDB::openArchive(archiveFilename, osgDB::Archive::READ);
@@ -19,7 +19,9 @@
 #include <osgDB/ReaderWriter>
 #include <osgDB/PluginQuery>
 
+#include <osgUtil/LODGenerator>
 #include <osgUtil/Optimizer>
+#include <osgUtil/MeshOptimizers>
 #include <osgUtil/Simplifier>
 #include <osgUtil/SmoothingVisitor>
 
@@ -32,6 +34,11 @@
 
 typedef std::vector<std::string> FileNameList;
 
+struct SmoothGeometryFunctor : public osgUtil::GeometryCollector::GeometryFunctor
+{
+    virtual void operator () (osg::Geometry& geom) { osgUtil::SmoothingVisitor::smooth(geom); }
+};
+
 class MyGraphicsContext {
     public:
         MyGraphicsContext()
@@ -500,6 +507,19 @@ static void usage( const char *prog, const char *msg )
                             <<"                         Example: --simplify .5" << std::endl
                             <<"                                 will produce a 50% reduced model." << std::endl
                             << std::endl;
+    osg::notify(osg::NOTICE)<<"    --simplify-quadric - Simplify by collapsing the edges of least quadric\n"
+                              "                         error, which is much faster on large models."<< std::endl;
+    osg::notify(osg::NOTICE)<<"    --lod n            - Replace each geode with an LOD of n levels of\n"
+                              "                         progressively simplified geometry, switching levels\n"
+                              "                         by the pixel size on screen."<< std::endl;
+    osg::notify(osg::NOTICE)<<"    --lod-ratio r      - Sample ratio between successive LOD levels,\n"
+                              "                         defaults to 0.5."<< std::endl;
+    osg::notify(osg::NOTICE)<<"    --lod-pixel-error p - Simplification error in pixels on screen at which\n"
+                              "                         the next coarser LOD level is used, defaults to 1."<< std::endl;
+    osg::notify(osg::NOTICE)<<"    --paged-lod        - Create PagedLOD's, writing all but the coarsest level\n"
+                              "                         of each to separate .osgb files next to the output\n"
+                              "                         file, to be loaded by the database pager."<< std::endl
+                            << std::endl;
     osg::notify(osg::NOTICE)<<"    -s scale           - Scale size of model.  Scale argument must be the \n"
                               "                         following :\n"
                               "\n"
@@ -515,6 +535,9 @@ static void usage( const char *prog, const char *msg )
                               "                         (--addMissingColours also accepted)."<< std::endl;
     osg::notify(osg::NOTICE)<<"    --overallNormal    - Replace normals with a single overall normal."<< std::endl;
     osg::notify(osg::NOTICE)<<"    --enable-object-cache - Enable caching of objects, images, etc."<< std::endl;
+    osg::notify(osg::NOTICE)<<"    --threads n        - Spread smoothing, simplification and the per geometry\n"
+                              "                         optimizer passes across n threads, the output is the\n"
+                              "                         same as with the default of 1."<< std::endl;
 
     osg::notify( osg::NOTICE ) << std::endl;
     osg::notify( osg::NOTICE ) <<
@@ -694,6 +717,21 @@ int main( int argc, char **argv )
         do_simplify = true;
     }
 
+    bool simplifyQuadric = false;
+    while (arguments.read("--simplify-quadric")) { simplifyQuadric = true; }
+
+    unsigned int numLODLevels = 0;
+    while (arguments.read("--lod",numLODLevels)) {}
+
+    float lodRatio = 0.5f;
+    while (arguments.read("--lod-ratio",lodRatio)) {}
+
+    float lodPixelError = 1.0f;
+    while (arguments.read("--lod-pixel-error",lodPixelError)) {}
+
+    bool pagedLOD = false;
+    while (arguments.read("--paged-lod")) { pagedLOD = true; }
+
     while (arguments.read("-t",str))
     {
         osg::Vec3 trans(0,0,0);
@@ -739,6 +777,9 @@ int main( int argc, char **argv )
     bool enableObjectCache = false;
     while(arguments.read("--enable-object-cache")) { enableObjectCache = true; }
 
+    unsigned int numThreads = 1;
+    while(arguments.read("--threads",numThreads)) {}
+
     // any option left unread are converted into errors to write out later.
     arguments.reportRemainingOptionsAsUnrecognized();
 
@@ -798,8 +839,20 @@ int main( int argc, char **argv )
 
         if (smooth)
         {
-            osgUtil::SmoothingVisitor sv;
-            root->accept(sv);
+            if (numThreads>1)
+            {
+                osgUtil::GeometryCollector collector(0, osgUtil::Optimizer::ALL_OPTIMIZATIONS);
+                collector.setNumThreads(numThreads);
+                root->accept(collector);
+
+                SmoothGeometryFunctor smoothGeometry;
+                collector.processGeometryList(smoothGeometry);
+            }
+            else
+            {
+                osgUtil::SmoothingVisitor sv;
+                root->accept(sv);
+            }
         }
 
         if (addMissingColours)
@@ -810,6 +863,7 @@ int main( int argc, char **argv )
 
         // optimize the scene graph, remove redundant nodes and state etc.
         osgUtil::Optimizer optimizer;
+        optimizer.setNumThreads(numThreads);
         optimizer.optimize(root.get());
 
         if( do_convert )
@@ -843,13 +897,47 @@ int main( int argc, char **argv )
             simple.setSmoothing( smooth );
             osg::notify( osg::ALWAYS ) << " smoothing: " << smooth << std::endl;
             simple.setSampleRatio( simplifyPercent );
+            if ( simplifyQuadric ) simple.setMethod( osgUtil::Simplifier::QUADRIC_EDGE_COLLAPSE );
+            simple.setNumThreads( numThreads );
             root->accept( simple );
         }
 
+        // generate LOD chains, the root is wrapped in a Group so that a Geode at the root can be replaced too.
+        osgUtil::LODGenerator lodGenerator;
+        if ( numLODLevels>1 )
+        {
+            lodGenerator.setNumLevels( numLODLevels );
+            lodGenerator.setLevelSampleRatio( lodRatio );
+            lodGenerator.setMaximumPixelError( lodPixelError );
+            lodGenerator.setNumThreads( numThreads );
+            if ( pagedLOD )
+            {
+                lodGenerator.setPagedLODFileNamePrefix( osgDB::getStrippedName(fileNameOut) );
+            }
+
+            osg::ref_ptr<osg::Group> group = new osg::Group;
+            group->addChild( root.get() );
+            group->accept( lodGenerator );
+            root = group->getChild(0);
+        }
+
         osgDB::ReaderWriter::WriteResult result = osgDB::Registry::instance()->writeNode(*root,fileNameOut,osgDB::Registry::instance()->getOptions());
         if (result.success())
         {
             osg::notify(osg::NOTICE)<<"Data written to '"<<fileNameOut<<"'."<< std::endl;
+
+            const osgUtil::LODGenerator::PagedLevelList& pagedLevels = lodGenerator.getPagedLevelList();
+            for(osgUtil::LODGenerator::PagedLevelList::const_iterator itr = pagedLevels.begin();
+                itr != pagedLevels.end();
+                ++itr)
+            {
+                std::string levelFileName = osgDB::concatPaths(osgDB::getFilePath(fileNameOut), itr->fileName);
+                osgDB::ReaderWriter::WriteResult levelResult = osgDB::Registry::instance()->writeNode(*(itr->node),levelFileName,osgDB::Registry::instance()->getOptions());
+                if (!levelResult.success())
+                {
+                    osg::notify(osg::NOTICE)<<"Warning: failed to write LOD level to '"<<levelFileName<<"'."<< std::endl;
+                }
+            }
         }
         else if  (result.message().empty())
         {
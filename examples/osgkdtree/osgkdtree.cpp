@@ -51,11 +51,25 @@ int main(int argc, char **argv)
     int maxNumLevels = 16;
     int targetNumIndicesPerLeaf = 16;
 
+    osg::KdTreeBuilder* kdTreeBuilder = osgDB::Registry::instance()->getKdTreeBuilder();
+    osg::KdTree::BuildOptions& buildOptions = kdTreeBuilder->_buildOptions;
+
+    int numThreads = buildOptions._numThreads;
+
     while (arguments.read("--max", maxNumLevels)) {}
     while (arguments.read("--leaf", targetNumIndicesPerLeaf)) {}
+    while (arguments.read("--threads", numThreads)) {}
+    while (arguments.read("--sah")) { buildOptions._splitStrategy = osg::KdTree::BuildOptions::SURFACE_AREA_HEURISTIC; }
+    while (arguments.read("--midpoint")) { buildOptions._splitStrategy = osg::KdTree::BuildOptions::MIDPOINT_SPLIT; }
+
+    buildOptions._maxNumLevels = maxNumLevels;
+    buildOptions._targetNumTrianglesPerLeaf = targetNumIndicesPerLeaf;
+    buildOptions._numThreads = numThreads;
 
     osgDB::Registry::instance()->setBuildKdTreesHint(osgDB::ReaderWriter::Options::BUILD_KDTREES);
 
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+
     osg::ref_ptr<osg::Node> scene = osgDB::readRefNodeFiles(arguments);
 
     if (!scene)
@@ -64,6 +78,8 @@ int main(int argc, char **argv)
         return 0;
     }
 
+    std::cout<<"Load and KdTree build time "<<osg::Timer::instance()->delta_m(startTick, osg::Timer::instance()->tick())<<"ms"<<std::endl;
+
     osgViewer::Viewer viewer;
     viewer.setSceneData(scene);
     return viewer.run();
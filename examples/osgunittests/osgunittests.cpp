@@ -573,6 +573,16 @@ int main( int argc, char** argv )
     arguments.getApplicationUsage()->addCommandLineOption("matrix","Display qualified tests.");
     arguments.getApplicationUsage()->addCommandLineOption("performance","Display qualified tests.");
     arguments.getApplicationUsage()->addCommandLineOption("read-threads <numthreads>","Run multi-thread reading test.");
+    arguments.getApplicationUsage()->addCommandLineOption("renderbin-sort","Run RenderBin std::sort vs radix sort benchmark.");
+    arguments.getApplicationUsage()->addCommandLineOption("pager-queue","Run DatabasePager request queue benchmark.");
+    arguments.getApplicationUsage()->addCommandLineOption("object-cache","Run multi-threaded ObjectCache lookup benchmark.");
+    arguments.getApplicationUsage()->addCommandLineOption("mipmap","Run CPU mipmap generation vs gluScaleImage benchmark.");
+    arguments.getApplicationUsage()->addCommandLineOption("bcn","Run BCn texture compression and dds round trip tests.");
+    arguments.getApplicationUsage()->addCommandLineOption("image-conversion","Run pixel format and data type conversion benchmarks.");
+    arguments.getApplicationUsage()->addCommandLineOption("image-region","Run image region and reduced resolution read benchmarks.");
+    arguments.getApplicationUsage()->addCommandLineOption("obj-read","Run stream vs memory mapped parallel obj read benchmark.");
+    arguments.getApplicationUsage()->addCommandLineOption("osga","Run osga archive write, append and convert round trip tests.");
+    arguments.getApplicationUsage()->addCommandLineOption("compressors","Run lz4 and zlibchunked compressor round trip tests.");
 
 
     if (arguments.argc()<=1)
@@ -611,6 +621,36 @@ int main( int argc, char** argv )
     bool performanceTest = false;
     while (arguments.read("p") || arguments.read("performance")) performanceTest = true;
 
+    bool renderBinSortTest = false;
+    while (arguments.read("renderbin-sort")) renderBinSortTest = true;
+
+    bool pagerQueueTest = false;
+    while (arguments.read("pager-queue")) pagerQueueTest = true;
+
+    bool objectCacheTest = false;
+    while (arguments.read("object-cache")) objectCacheTest = true;
+
+    bool mipmapTest = false;
+    while (arguments.read("mipmap")) mipmapTest = true;
+
+    bool bcnTest = false;
+    while (arguments.read("bcn")) bcnTest = true;
+
+    bool imageConversionTest = false;
+    while (arguments.read("image-conversion")) imageConversionTest = true;
+
+    bool imageRegionTest = false;
+    while (arguments.read("image-region")) imageRegionTest = true;
+
+    bool objReadTest = false;
+    while (arguments.read("obj-read")) objReadTest = true;
+
+    bool osgaTest = false;
+    while (arguments.read("osga")) osgaTest = true;
+
+    bool compressorTest = false;
+    while (arguments.read("compressors")) compressorTest = true;
+
     // if user request help write it out to cout.
     if (arguments.read("-h") || arguments.read("--help"))
     {
@@ -681,6 +721,96 @@ int main( int argc, char** argv )
         runPerformanceTests();
     }
 
+    if (renderBinSortTest)
+    {
+        std::cout<<"**** RenderBin sort tests  ******"<<std::endl;
+
+        runRenderBinSortTests();
+
+        std::cout<<std::endl;
+    }
+
+    if (pagerQueueTest)
+    {
+        std::cout<<"**** DatabasePager request queue tests  ******"<<std::endl;
+
+        runDatabasePagerQueueTests();
+
+        std::cout<<std::endl;
+    }
+
+    if (objectCacheTest)
+    {
+        std::cout<<"**** ObjectCache tests  ******"<<std::endl;
+
+        runObjectCacheTests();
+
+        std::cout<<std::endl;
+    }
+
+    if (mipmapTest)
+    {
+        std::cout<<"**** mipmap tests  ******"<<std::endl;
+
+        runMipmapTests();
+
+        std::cout<<std::endl;
+    }
+
+    if (bcnTest)
+    {
+        std::cout<<"**** BCn compression tests  ******"<<std::endl;
+
+        runBCnCompressionTests();
+
+        std::cout<<std::endl;
+    }
+
+    if (imageConversionTest)
+    {
+        std::cout<<"**** image conversion tests  ******"<<std::endl;
+
+        runImageConversionTests();
+
+        std::cout<<std::endl;
+    }
+
+    if (imageRegionTest)
+    {
+        std::cout<<"**** image region tests  ******"<<std::endl;
+
+        runImageRegionTests();
+
+        std::cout<<std::endl;
+    }
+
+    if (objReadTest)
+    {
+        std::cout<<"**** obj read tests  ******"<<std::endl;
+
+        runObjReadTests();
+
+        std::cout<<std::endl;
+    }
+
+    if (osgaTest)
+    {
+        std::cout<<"**** osga archive tests  ******"<<std::endl;
+
+        runOSGAArchiveTests();
+
+        std::cout<<std::endl;
+    }
+
+    if (compressorTest)
+    {
+        std::cout<<"**** compressor tests  ******"<<std::endl;
+
+        runCompressorTests();
+
+        std::cout<<std::endl;
+    }
+
     if (numReadThreads>0)
     {
         runMultiThreadReadTests(numReadThreads, arguments);
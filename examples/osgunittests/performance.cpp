@@ -25,6 +25,34 @@
 #include <osg/ref_ptr>
 #include <osg/MatrixTransform>
 #include <osg/Group>
+#include <osg/Geometry>
+#include <osg/GLU>
+#include <osg/ImageUtils>
+#include <osg/Math>
+
+#include <osgUtil/RenderBin>
+#include <osgUtil/StateGraph>
+
+#include <osgDB/Archive>
+#include <osgDB/DatabasePager>
+#include <osgDB/ImageRegion>
+#include <osgDB/ObjectCache>
+#include <osgDB/ObjectWrapper>
+#include <osgDB/ReadFile>
+#include <osgDB/Registry>
+#include <osgDB/WriteFile>
+
+#include <OpenThreads/Thread>
+
+#include <stdlib.h>
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <limits>
+#include <map>
 
 struct Benchmark
 {
@@ -221,3 +249,1242 @@ void runPerformanceTests()
     RUN(benchmark, { m->accept(cnv); }, 10000)
     
 }
+
+static const char* sortModeName(osgUtil::RenderBin::SortMode mode)
+{
+    switch(mode)
+    {
+        case(osgUtil::RenderBin::SORT_FRONT_TO_BACK): return "SORT_FRONT_TO_BACK";
+        case(osgUtil::RenderBin::SORT_BACK_TO_FRONT): return "SORT_BACK_TO_FRONT";
+        case(osgUtil::RenderBin::TRAVERSAL_ORDER): return "TRAVERSAL_ORDER";
+        case(osgUtil::RenderBin::SORT_BY_STATE_THEN_FRONT_TO_BACK): return "SORT_BY_STATE_THEN_FRONT_TO_BACK";
+        default: return "SORT_BY_STATE";
+    }
+}
+
+// time sorting of a RenderBin filled with numLeaves leaves spread over numStateGraphs StateGraphs, returning the time per sort
+static double sortRenderBin(osgUtil::RenderBin* bin, std::vector< osg::ref_ptr<osgUtil::StateGraph> >& stateGraphs, unsigned int iterations)
+{
+    osg::Timer timer;
+    double total = 0.0;
+    for(unsigned int i=0; i<iterations; ++i)
+    {
+        bin->reset();
+        for(unsigned int s=0; s<stateGraphs.size(); ++s)
+        {
+            stateGraphs[s]->_minimumDistance = FLT_MAX;
+            bin->addStateGraph(stateGraphs[s].get());
+        }
+
+        osg::Timer_t start = timer.tick();
+        bin->sortImplementation();
+        total += timer.delta_s(start, timer.tick());
+    }
+    return total/(double)iterations;
+}
+
+static bool sameOrder(const osgUtil::RenderBin* lhs, const osgUtil::RenderBin* rhs, osgUtil::RenderBin::SortMode mode)
+{
+    if (mode==osgUtil::RenderBin::SORT_BY_STATE_THEN_FRONT_TO_BACK)
+    {
+        const osgUtil::RenderBin::StateGraphList& l = lhs->getStateGraphList();
+        const osgUtil::RenderBin::StateGraphList& r = rhs->getStateGraphList();
+        if (l.size()!=r.size()) return false;
+        for(unsigned int i=0; i<l.size(); ++i)
+        {
+            if (l[i]->_minimumDistance!=r[i]->_minimumDistance) return false;
+        }
+        return true;
+    }
+
+    const osgUtil::RenderBin::RenderLeafList& l = lhs->getRenderLeafList();
+    const osgUtil::RenderBin::RenderLeafList& r = rhs->getRenderLeafList();
+    if (l.size()!=r.size()) return false;
+    for(unsigned int i=0; i<l.size(); ++i)
+    {
+        // leaves at equal depth may legitimately be in a different order, so only compare the sort keys.
+        if (mode==osgUtil::RenderBin::TRAVERSAL_ORDER ? l[i]!=r[i] : l[i]->_depth!=r[i]->_depth) return false;
+    }
+    return true;
+}
+
+void runRenderBinSortTests()
+{
+    std::cout<<"RenderBin sort std::sort vs radix sort of packed keys"<<std::endl;
+
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    osg::ref_ptr<osg::RefMatrix> matrix = new osg::RefMatrix;
+
+    const unsigned int numStateSets = 64;
+    std::vector< osg::ref_ptr<osg::StateSet> > stateSets;
+    for(unsigned int i=0; i<numStateSets; ++i) stateSets.push_back(new osg::StateSet);
+
+    const osgUtil::RenderBin::SortMode modes[] = { osgUtil::RenderBin::SORT_BACK_TO_FRONT, osgUtil::RenderBin::SORT_FRONT_TO_BACK, osgUtil::RenderBin::TRAVERSAL_ORDER, osgUtil::RenderBin::SORT_BY_STATE_THEN_FRONT_TO_BACK };
+    const unsigned int numLeavesList[] = { 100, 1000, 10000, 50000, 200000 };
+
+    srand(1);
+
+    for(unsigned int n=0; n<sizeof(numLeavesList)/sizeof(unsigned int); ++n)
+    {
+        unsigned int numLeaves = numLeavesList[n];
+
+        osg::ref_ptr<osgUtil::StateGraph> root = new osgUtil::StateGraph;
+        std::vector< osg::ref_ptr<osgUtil::StateGraph> > stateGraphs;
+        for(unsigned int i=0; i<numStateSets; ++i) stateGraphs.push_back(root->find_or_insert(stateSets[i].get()));
+
+        for(unsigned int i=0; i<numLeaves; ++i)
+        {
+            float depth = 1.0f + 1000.0f*(float)rand()/(float)RAND_MAX;
+            stateGraphs[rand()%numStateSets]->addLeaf(new osgUtil::RenderLeaf(geometry.get(), matrix.get(), matrix.get(), depth, i));
+        }
+
+        unsigned int iterations = osg::maximum(1u, 2000000u/numLeaves);
+
+        for(unsigned int m=0; m<sizeof(modes)/sizeof(osgUtil::RenderBin::SortMode); ++m)
+        {
+            osg::ref_ptr<osgUtil::RenderBin> stdBin = new osgUtil::RenderBin(modes[m]);
+            stdBin->setUseRadixSort(false);
+
+            osg::ref_ptr<osgUtil::RenderBin> radixBin = new osgUtil::RenderBin(modes[m]);
+            radixBin->setUseRadixSort(true);
+
+            double stdTime = sortRenderBin(stdBin.get(), stateGraphs, iterations);
+            double radixTime = sortRenderBin(radixBin.get(), stateGraphs, iterations);
+            bool same = sameOrder(stdBin.get(), radixBin.get(), modes[m]);
+
+            std::cout<<"  "<<sortModeName(modes[m])<<" leaves="<<numLeaves
+                     <<"\tstd::sort "<<stdTime*1000.0<<" ms"
+                     <<"\tradix "<<radixTime*1000.0<<" ms"
+                     <<"\tspeed up "<<(radixTime>0.0 ? stdTime/radixTime : 0.0)
+                     <<(same ? "" : "\tERROR: sort orders differ")<<std::endl;
+        }
+    }
+}
+
+// DatabasePager that never starts its threads, giving direct access to its file request queue.
+class QueueBenchmarkDatabasePager : public osgDB::DatabasePager
+{
+    public:
+
+        QueueBenchmarkDatabasePager() { _startThreadCalled = true; }
+
+        void setFrameNumber(unsigned int frameNumber) { _frameNumber.exchange(frameNumber); }
+
+        unsigned int getNumPendingRequests() { return _fileRequestQueue->size(); }
+
+        bool takeFirst()
+        {
+            osg::ref_ptr<DatabaseRequest> databaseRequest;
+            _fileRequestQueue->takeFirst(databaseRequest);
+            return databaseRequest.valid();
+        }
+};
+
+void runDatabasePagerQueueTests()
+{
+    std::cout<<"DatabasePager requestNodeFile/takeFirst throughput"<<std::endl;
+
+    const unsigned int numRequestsList[] = { 100, 1000, 10000 };
+    const unsigned int numFrames = 20;
+
+    srand(1);
+
+    for(unsigned int n=0; n<sizeof(numRequestsList)/sizeof(unsigned int); ++n)
+    {
+        unsigned int numRequests = numRequestsList[n];
+
+        osg::ref_ptr<QueueBenchmarkDatabasePager> pager = new QueueBenchmarkDatabasePager;
+
+        std::vector< osg::ref_ptr<osg::Group> > groups;
+        std::vector< osg::ref_ptr<osg::Referenced> > requests(numRequests);
+        std::vector<std::string> fileNames;
+        for(unsigned int i=0; i<numRequests; ++i)
+        {
+            groups.push_back(new osg::Group);
+            std::ostringstream fileName;
+            fileName<<"tile_"<<i<<".osgb";
+            fileNames.push_back(fileName.str());
+        }
+
+        // take a tenth of the requests each frame, with those taken being re-requested the next frame as orphans,
+        // so the queue stays close to numRequests.
+        unsigned int numTakenPerFrame = osg::maximum(1u, numRequests/10);
+
+        osg::Timer timer;
+        double requestTime = 0.0;
+        double takeTime = 0.0;
+        unsigned int numTaken = 0;
+        unsigned int numPending = 0;
+        for(unsigned int frameNumber=1; frameNumber<=numFrames; ++frameNumber)
+        {
+            pager->setFrameNumber(frameNumber);
+
+            osg::ref_ptr<osg::FrameStamp> frameStamp = new osg::FrameStamp;
+            frameStamp->setFrameNumber(frameNumber);
+            frameStamp->setReferenceTime(frameNumber*0.016);
+
+            osg::Timer_t start = timer.tick();
+            for(unsigned int i=0; i<numRequests; ++i)
+            {
+                osg::NodePath nodePath;
+                nodePath.push_back(groups[i].get());
+                float priority = (float)rand()/(float)RAND_MAX;
+                pager->requestNodeFile(fileNames[i], nodePath, priority, frameStamp.get(), requests[i], 0);
+            }
+            requestTime += timer.delta_s(start, timer.tick());
+
+            numPending += pager->getNumPendingRequests();
+
+            start = timer.tick();
+            for(unsigned int i=0; i<numTakenPerFrame; ++i)
+            {
+                if (pager->takeFirst()) ++numTaken;
+            }
+            takeTime += timer.delta_s(start, timer.tick());
+        }
+
+        std::cout<<"  requests="<<numRequests
+                 <<"\taverage pending "<<numPending/numFrames
+                 <<"\trequestNodeFile "<<requestTime*1e6/(double)(numRequests*numFrames)<<" us"
+                 <<"\ttakeFirst "<<(numTaken>0 ? takeTime*1e6/(double)numTaken : 0.0)<<" us"
+                 <<"\ttaken "<<numTaken<<std::endl;
+
+        pager->clear();
+    }
+}
+
+class ObjectCacheLookupThread : public osg::Referenced, public OpenThreads::Thread
+{
+    public:
+
+        ObjectCacheLookupThread(osgDB::ObjectCache* objectCache, const std::vector<std::string>& fileNames, unsigned int numLookups, unsigned int seed):
+            _objectCache(objectCache),
+            _fileNames(fileNames),
+            _numLookups(numLookups),
+            _seed(seed) {}
+
+        virtual void run()
+        {
+            // a simple LCG so that the threads don't contend on rand().
+            unsigned int value = _seed;
+            for(unsigned int i=0; i<_numLookups; ++i)
+            {
+                value = value*1664525u + 1013904223u;
+                osg::ref_ptr<osg::Object> object = _objectCache->getRefFromObjectCache(_fileNames[(value>>8) % _fileNames.size()]);
+            }
+        }
+
+    protected:
+
+        virtual ~ObjectCacheLookupThread() {}
+
+        osgDB::ObjectCache*                 _objectCache;
+        const std::vector<std::string>&     _fileNames;
+        unsigned int                        _numLookups;
+        unsigned int                        _seed;
+};
+
+void runObjectCacheTests()
+{
+    std::cout<<"ObjectCache::getRefFromObjectCache throughput, 1000 cached images of 1000 file names looked up"<<std::endl;
+
+    const unsigned int numShardsList[] = { 1, 16 };
+    const unsigned int numThreadsList[] = { 1, 4, 16 };
+    const unsigned int numLookups = 1000000;
+
+    std::vector<std::string> fileNames;
+    std::vector< osg::ref_ptr<osg::Image> > images;
+    for(unsigned int i=0; i<1000; ++i)
+    {
+        std::ostringstream fileName;
+        fileName<<"textures/texture_"<<i<<".dds";
+        fileNames.push_back(fileName.str());
+
+        osg::ref_ptr<osg::Image> image = new osg::Image;
+        image->allocateImage(64, 64, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+        images.push_back(image);
+    }
+
+    for(unsigned int s=0; s<sizeof(numShardsList)/sizeof(unsigned int); ++s)
+    {
+        osg::ref_ptr<osgDB::ObjectCache> objectCache = new osgDB::ObjectCache(numShardsList[s]);
+
+        // cache every other image, so half the lookups miss.
+        for(unsigned int i=0; i<fileNames.size(); i+=2)
+        {
+            objectCache->addEntryToObjectCache(fileNames[i], images[i].get());
+        }
+
+        for(unsigned int t=0; t<sizeof(numThreadsList)/sizeof(unsigned int); ++t)
+        {
+            unsigned int numThreads = numThreadsList[t];
+            objectCache->resetStats();
+
+            std::vector< osg::ref_ptr<ObjectCacheLookupThread> > threads;
+            for(unsigned int i=0; i<numThreads; ++i)
+            {
+                threads.push_back(new ObjectCacheLookupThread(objectCache.get(), fileNames, numLookups/numThreads, i+1));
+            }
+
+            osg::Timer timer;
+            osg::Timer_t start = timer.tick();
+            for(unsigned int i=0; i<numThreads; ++i) threads[i]->startThread();
+            for(unsigned int i=0; i<numThreads; ++i) threads[i]->join();
+            double time = timer.delta_s(start, timer.tick());
+
+            std::cout<<"  shards="<<numShardsList[s]
+                     <<"\tthreads="<<numThreads
+                     <<"\t"<<time*1e9/(double)numLookups<<" ns per lookup"
+                     <<"\thits "<<objectCache->getNumHits()
+                     <<"\tmisses "<<objectCache->getNumMisses()<<std::endl;
+        }
+    }
+
+    std::cout<<"ObjectCache LRU eviction, 1000 images of 16KB added with a 4MB maximum size"<<std::endl;
+
+    osg::ref_ptr<osgDB::ObjectCache> objectCache = new osgDB::ObjectCache;
+    objectCache->setMaximumSizeInBytes(4*1024*1024);
+    for(unsigned int i=0; i<fileNames.size(); ++i)
+    {
+        // the images are only referenced by the cache once added, so are free to be evicted.
+        objectCache->addEntryToObjectCache(fileNames[i], new osg::Image(*images[i], osg::CopyOp::DEEP_COPY_ALL));
+    }
+    std::cout<<"  objects "<<objectCache->getNumObjects()
+             <<"\tsize "<<objectCache->getSizeInBytes()
+             <<"\tevictions "<<objectCache->getNumEvictions()<<std::endl;
+}
+
+static double buildMipmapsWithGLU(const osg::Image* image, std::vector< osg::ref_ptr<osg::Image> >& levels)
+{
+    osg::PixelStorageModes psm;
+    psm.pack_alignment = image->getPacking();
+    psm.unpack_alignment = image->getPacking();
+
+    osg::Timer timer;
+    osg::Timer_t start = timer.tick();
+
+    // scale each level down from the one above, as gluBuild2DMipmaps does.
+    const osg::Image* source = image;
+    for(int s=image->s()/2, t=image->t()/2; s>=1 || t>=1; s/=2, t/=2)
+    {
+        osg::ref_ptr<osg::Image> level = new osg::Image;
+        level->allocateImage(osg::maximum(s,1), osg::maximum(t,1), 1, image->getPixelFormat(), image->getDataType(), image->getPacking());
+        osg::gluScaleImage(&psm, image->getPixelFormat(),
+                           source->s(), source->t(), source->getDataType(), source->data(),
+                           level->s(), level->t(), level->getDataType(), level->data());
+        levels.push_back(level);
+        source = level.get();
+    }
+
+    return timer.delta_m(start, timer.tick());
+}
+
+void runMipmapTests()
+{
+    const int size = 2048;
+    std::cout<<"Mipmap chain of a "<<size<<"x"<<size<<" GL_RGBA GL_UNSIGNED_BYTE image"<<std::endl;
+
+    osg::ref_ptr<osg::Image> image = new osg::Image;
+    image->allocateImage(size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+    unsigned char* data = image->data();
+    for(int t=0; t<size; ++t)
+    {
+        for(int s=0; s<size; ++s)
+        {
+            *data++ = static_cast<unsigned char>(s^t);
+            *data++ = static_cast<unsigned char>(s*t);
+            *data++ = static_cast<unsigned char>((s+t)/16);
+            *data++ = static_cast<unsigned char>(rand()%256);
+        }
+    }
+
+    std::vector< osg::ref_ptr<osg::Image> > gluLevels;
+    std::cout<<"  gluScaleImage box filter\t\t"<<buildMipmapsWithGLU(image.get(), gluLevels)<<" ms"<<std::endl;
+
+    struct MipmapTest
+    {
+        const char* name;
+        osg::MipmapFilter filter;
+        bool sRGB;
+        unsigned int numThreads;
+    };
+
+    const MipmapTest tests[] =
+    {
+        { "box filter, 1 thread\t\t", osg::MIPMAP_BOX_FILTER, false, 1 },
+        { "box filter\t\t\t", osg::MIPMAP_BOX_FILTER, false, 0 },
+        { "box filter, sRGB\t\t", osg::MIPMAP_BOX_FILTER, true, 0 },
+        { "Kaiser filter, 1 thread\t\t", osg::MIPMAP_KAISER_FILTER, false, 1 },
+        { "Kaiser filter\t\t\t", osg::MIPMAP_KAISER_FILTER, false, 0 },
+        { "Lanczos filter, sRGB\t\t", osg::MIPMAP_LANCZOS_FILTER, true, 0 }
+    };
+
+    for(unsigned int i=0; i<sizeof(tests)/sizeof(MipmapTest); ++i)
+    {
+        osg::ref_ptr<osg::Image> mipmapped = new osg::Image(*image, osg::CopyOp::DEEP_COPY_ALL);
+
+        osg::Timer timer;
+        osg::Timer_t start = timer.tick();
+        osg::buildMipmaps(mipmapped.get(), tests[i].filter, tests[i].sRGB, tests[i].numThreads);
+        std::cout<<"  buildMipmaps "<<tests[i].name<<timer.delta_m(start, timer.tick())<<" ms";
+
+        if (tests[i].filter==osg::MIPMAP_BOX_FILTER && !tests[i].sRGB)
+        {
+            // the box filter should match the glu box filter, give or take the rounding.
+            int maxDifference = 0;
+            for(unsigned int l=0; l<gluLevels.size(); ++l)
+            {
+                const unsigned char* gluData = gluLevels[l]->data();
+                const unsigned char* mipmapData = mipmapped->getMipmapData(l+1);
+                for(unsigned int b=0; b<gluLevels[l]->getTotalSizeInBytes(); ++b)
+                {
+                    maxDifference = osg::maximum(maxDifference, osg::absolute(static_cast<int>(gluData[b])-static_cast<int>(mipmapData[b])));
+                }
+            }
+            std::cout<<"\tmaximum difference from glu "<<maxDifference;
+        }
+        std::cout<<std::endl;
+    }
+}
+
+struct ImageRangeOperator : public osg::CastAndScaleToFloatOperation
+{
+    ImageRangeOperator(): _min(FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX), _max(-FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX) {}
+
+    osg::Vec4 _min, _max;
+
+    inline void luminance(float l) { rgba(l,l,l,l); }
+    inline void alpha(float a) { rgba(1.0f,1.0f,1.0f,a); }
+    inline void luminance_alpha(float l,float a) { rgba(l,l,l,a); }
+    inline void rgb(float r,float g,float b) { rgba(r,g,b,1.0f); }
+    inline void rgba(float r,float g,float b,float a)
+    {
+        osg::Vec4 v(r,g,b,a);
+        for(unsigned int i=0; i<4; ++i) { _min[i] = osg::minimum(v[i], _min[i]); _max[i] = osg::maximum(v[i], _max[i]); }
+    }
+};
+
+struct ImageOffsetAndScaleOperator
+{
+    ImageOffsetAndScaleOperator(const osg::Vec4& offset, const osg::Vec4& scale): _offset(offset), _scale(scale) {}
+
+    osg::Vec4 _offset, _scale;
+
+    inline void luminance(float& l) const { l = _offset.r() + l*_scale.r(); }
+    inline void alpha(float& a) const { a = _offset.a() + a*_scale.a(); }
+    inline void luminance_alpha(float& l,float& a) const { luminance(l); alpha(a); }
+    inline void rgb(float& r,float& g,float& b) const { r = _offset.r() + r*_scale.r(); g = _offset.g() + g*_scale.g(); b = _offset.b() + b*_scale.b(); }
+    inline void rgba(float& r,float& g,float& b,float& a) const { rgb(r,g,b); alpha(a); }
+};
+
+// the Vec4 per pixel path copyImage() takes for pixel format conversions it has no specialised kernel for.
+struct ImageRecordRowOperator : public osg::CastAndScaleToFloatOperation
+{
+    std::vector<osg::Vec4> _colours;
+
+    inline void luminance(float l) { rgba(l,l,l,1.0f); }
+    inline void alpha(float a) { rgba(1.0f,1.0f,1.0f,a); }
+    inline void luminance_alpha(float l,float a) { rgba(l,l,l,a); }
+    inline void rgb(float r,float g,float b) { rgba(r,g,b,1.0f); }
+    inline void rgba(float r,float g,float b,float a) { _colours.push_back(osg::Vec4(r,g,b,a)); }
+};
+
+struct ImageWriteRowOperator
+{
+    ImageWriteRowOperator(const std::vector<osg::Vec4>& colours): _colours(colours), _pos(0) {}
+
+    const std::vector<osg::Vec4>& _colours;
+    mutable unsigned int _pos;
+
+    inline void luminance(float& l) const { l = _colours[_pos++].r(); }
+    inline void alpha(float& a) const { a = _colours[_pos++].a(); }
+    inline void luminance_alpha(float& l,float& a) const { l = _colours[_pos].r(); a = _colours[_pos++].a(); }
+    inline void rgb(float& r,float& g,float& b) const { r = _colours[_pos].r(); g = _colours[_pos].g(); b = _colours[_pos++].b(); }
+    inline void rgba(float& r,float& g,float& b,float& a) const { r = _colours[_pos].r(); g = _colours[_pos].g(); b = _colours[_pos].b(); a = _colours[_pos++].a(); }
+
+protected:
+
+    ImageWriteRowOperator& operator = (const ImageWriteRowOperator&) { return *this; }
+};
+
+static void convertImageThroughVec4(const osg::Image* src, osg::Image* dest)
+{
+    for(int t=0; t<src->t(); ++t)
+    {
+        ImageRecordRowOperator readOp;
+        osg::readRow(src->s(), src->getPixelFormat(), src->getDataType(), src->data(0,t), readOp);
+        osg::modifyRow(dest->s(), dest->getPixelFormat(), dest->getDataType(), dest->data(0,t), ImageWriteRowOperator(readOp._colours));
+    }
+}
+
+// the largest difference between the components of two images of the same size, format and data type, in units of the data type.
+static double computeMaximumDifference(const osg::Image* lhs, const osg::Image* rhs)
+{
+    double difference = 0.0;
+    unsigned int numValues = lhs->s()*lhs->t()*osg::Image::computeNumComponents(lhs->getPixelFormat());
+    for(unsigned int i=0; i<numValues; ++i)
+    {
+        switch(lhs->getDataType())
+        {
+            case(GL_UNSIGNED_BYTE): difference = osg::maximum(difference, osg::absolute(double(lhs->data()[i])-double(rhs->data()[i]))); break;
+            case(GL_UNSIGNED_SHORT): difference = osg::maximum(difference, osg::absolute(double(reinterpret_cast<const unsigned short*>(lhs->data())[i])-double(reinterpret_cast<const unsigned short*>(rhs->data())[i]))); break;
+            case(GL_FLOAT): difference = osg::maximum(difference, osg::absolute(double(reinterpret_cast<const float*>(lhs->data())[i])-double(reinterpret_cast<const float*>(rhs->data())[i]))); break;
+        }
+    }
+    return difference;
+}
+
+static osg::Image* createConversionImage(int size, GLenum pixelFormat, GLenum dataType)
+{
+    osg::ref_ptr<osg::Image> image = new osg::Image;
+    image->allocateImage(size, size, 1, pixelFormat, dataType);
+    unsigned int numValues = size*size*osg::Image::computeNumComponents(pixelFormat);
+    for(unsigned int i=0; i<numValues; ++i)
+    {
+        switch(dataType)
+        {
+            case(GL_UNSIGNED_BYTE): image->data()[i] = static_cast<unsigned char>(rand()); break;
+            case(GL_UNSIGNED_SHORT): reinterpret_cast<unsigned short*>(image->data())[i] = static_cast<unsigned short>(rand()); break;
+            case(GL_FLOAT): reinterpret_cast<float*>(image->data())[i] = static_cast<float>(rand())/static_cast<float>(RAND_MAX); break;
+        }
+    }
+    return image.release();
+}
+
+// what offsetAndScaleImage() computes for each component, (offset + (x*typeScale)*scale)/typeScale, with the integer results
+// out of the range of T saturating.
+template<typename T>
+static void offsetAndScaleComponents(T* data, unsigned int numValues, unsigned int numComponents, const float* offsets, const float* scales, float typeScale)
+{
+    const float inverseTypeScale = 1.0f/typeScale;
+    for(unsigned int i=0; i<numValues; ++i)
+    {
+        float l = float(data[i])*typeScale;
+        l = offsets[i%numComponents] + l*scales[i%numComponents];
+        float v = l*inverseTypeScale;
+        if (std::numeric_limits<T>::is_integer)
+        {
+            v = osg::clampBetween(v, float(std::numeric_limits<T>::min()), float(std::numeric_limits<T>::max()));
+        }
+        data[i] = T(v);
+    }
+}
+
+static void referenceOffsetAndScaleImage(osg::Image* image, const osg::Vec4& offset, const osg::Vec4& scale)
+{
+    // the components of the offset and scale in the order the pixel format holds them.
+    int order[4] = { 0, 1, 2, 3 };
+    switch(image->getPixelFormat())
+    {
+        case(GL_ALPHA): order[0] = 3; break;
+        case(GL_LUMINANCE_ALPHA): order[1] = 3; break;
+        case(GL_BGR):
+        case(GL_BGRA): order[0] = 2; order[2] = 0; break;
+    }
+
+    unsigned int numComponents = osg::Image::computeNumComponents(image->getPixelFormat());
+    float offsets[4], scales[4];
+    for(unsigned int c=0; c<4; ++c) { offsets[c] = offset[order[c]]; scales[c] = scale[order[c]]; }
+
+    unsigned int numValues = image->s()*image->t()*numComponents;
+    switch(image->getDataType())
+    {
+        case(GL_UNSIGNED_BYTE): offsetAndScaleComponents(image->data(), numValues, numComponents, offsets, scales, 1.0f/255.0f); break;
+        case(GL_UNSIGNED_SHORT): offsetAndScaleComponents(reinterpret_cast<unsigned short*>(image->data()), numValues, numComponents, offsets, scales, 1.0f/65535.0f); break;
+        case(GL_FLOAT): offsetAndScaleComponents(reinterpret_cast<float*>(image->data()), numValues, numComponents, offsets, scales, 1.0f); break;
+    }
+}
+
+void runImageConversionTests()
+{
+    const int size = 4096;
+    std::cout<<"Pixel conversions of "<<size<<"x"<<size<<" images, the specialised kernels vs the generic readRow()/modifyRow() templates"<<std::endl;
+
+    osg::Timer timer;
+
+    const GLenum dataTypes[] = { GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, GL_FLOAT };
+    const char* dataTypeNames[] = { "GL_UNSIGNED_BYTE", "GL_UNSIGNED_SHORT", "GL_FLOAT" };
+    for(unsigned int d=0; d<3; ++d)
+    {
+        osg::ref_ptr<osg::Image> image = createConversionImage(size, GL_RGBA, dataTypes[d]);
+
+        osg::Timer_t start = timer.tick();
+        ImageRangeOperator rangeOp;
+        osg::readImage(image.get(), rangeOp);
+        double genericTime = timer.delta_m(start, timer.tick());
+
+        osg::Vec4 minValue, maxValue;
+        start = timer.tick();
+        osg::computeMinMax(image.get(), minValue, maxValue);
+        double kernelTime = timer.delta_m(start, timer.tick());
+
+        std::cout<<"  computeMinMax GL_RGBA "<<dataTypeNames[d]<<"\t\t"<<genericTime<<" ms generic, "<<kernelTime<<" ms, "
+                 <<((minValue==rangeOp._min && maxValue==rangeOp._max) ? "matches" : "DIFFERS")<<std::endl;
+
+        osg::Vec4 offset(0.1f, 0.05f, 0.0f, 0.0f), scale(0.5f, 0.9f, 0.75f, 1.0f);
+        osg::ref_ptr<osg::Image> generic = new osg::Image(*image, osg::CopyOp::DEEP_COPY_ALL);
+        start = timer.tick();
+        osg::modifyImage(generic.get(), ImageOffsetAndScaleOperator(offset, scale));
+        genericTime = timer.delta_m(start, timer.tick());
+
+        start = timer.tick();
+        osg::offsetAndScaleImage(image.get(), offset, scale);
+        kernelTime = timer.delta_m(start, timer.tick());
+
+        std::cout<<"  offsetAndScaleImage GL_RGBA "<<dataTypeNames[d]<<"\t"<<genericTime<<" ms generic, "<<kernelTime<<" ms, "
+                 <<(memcmp(image->data(), generic->data(), image->getTotalSizeInBytes())==0 ? "matches" : "DIFFERS")<<std::endl;
+    }
+
+    // offsets and scales taking components out of range, on rows 67 pixels wide so the SSE2 kernels finish each row in scalar code,
+    // the integer results having to saturate the same whichever path computes them.
+    {
+        const GLenum pixelFormats[] = { GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB, GL_RGBA, GL_BGRA };
+        osg::Vec4 offset(-0.25f, 0.5f, 0.2f, -0.5f), scale(1.5f, 1.0f, -1.0f, 2.0f);
+        unsigned int numChecked = 0, numDiffering = 0;
+        for(unsigned int d=0; d<3; ++d)
+        {
+            for(unsigned int f=0; f<sizeof(pixelFormats)/sizeof(GLenum); ++f)
+            {
+                osg::ref_ptr<osg::Image> image = createConversionImage(67, pixelFormats[f], dataTypes[d]);
+                osg::ref_ptr<osg::Image> generic = new osg::Image(*image, osg::CopyOp::DEEP_COPY_ALL);
+                referenceOffsetAndScaleImage(generic.get(), offset, scale);
+                osg::offsetAndScaleImage(image.get(), offset, scale);
+
+                ++numChecked;
+                if (memcmp(image->data(), generic->data(), image->getTotalSizeInBytes())!=0)
+                {
+                    ++numDiffering;
+                    std::cout<<"  offsetAndScaleImage out of range "<<dataTypeNames[d]<<" format 0x"<<std::hex<<pixelFormats[f]<<std::dec<<" DIFFERS, maximum difference "
+                             <<computeMaximumDifference(image.get(), generic.get())<<std::endl;
+                }
+            }
+        }
+        std::cout<<"  offsetAndScaleImage out of range check, "<<numChecked<<" images of 67x67, "<<numDiffering<<" differ"<<std::endl;
+    }
+
+    struct ConversionTest
+    {
+        const char* name;
+        GLenum srcPixelFormat;
+        GLenum srcDataType;
+        GLenum destPixelFormat;
+        GLenum destDataType;
+    };
+
+    const ConversionTest tests[] =
+    {
+        { "GL_RGB to GL_RGBA GL_UNSIGNED_BYTE\t", GL_RGB, GL_UNSIGNED_BYTE, GL_RGBA, GL_UNSIGNED_BYTE },
+        { "GL_RGBA to GL_BGRA GL_UNSIGNED_BYTE\t", GL_RGBA, GL_UNSIGNED_BYTE, GL_BGRA, GL_UNSIGNED_BYTE },
+        { "GL_BGRA to GL_RGB GL_UNSIGNED_SHORT\t", GL_BGRA, GL_UNSIGNED_SHORT, GL_RGB, GL_UNSIGNED_SHORT },
+        { "GL_LUMINANCE to GL_RGBA GL_FLOAT\t", GL_LUMINANCE, GL_FLOAT, GL_RGBA, GL_FLOAT },
+        { "GL_RGBA GL_UNSIGNED_BYTE to GL_FLOAT\t", GL_RGBA, GL_UNSIGNED_BYTE, GL_RGBA, GL_FLOAT },
+        { "GL_RGBA GL_FLOAT to GL_UNSIGNED_BYTE\t", GL_RGBA, GL_FLOAT, GL_RGBA, GL_UNSIGNED_BYTE },
+        { "GL_LUMINANCE GL_UNSIGNED_SHORT to GL_FLOAT", GL_LUMINANCE, GL_UNSIGNED_SHORT, GL_LUMINANCE, GL_FLOAT }
+    };
+
+    for(unsigned int i=0; i<sizeof(tests)/sizeof(ConversionTest); ++i)
+    {
+        osg::ref_ptr<osg::Image> image = createConversionImage(size, tests[i].srcPixelFormat, tests[i].srcDataType);
+        osg::ref_ptr<osg::Image> dest = new osg::Image;
+        dest->allocateImage(size, size, 1, tests[i].destPixelFormat, tests[i].destDataType);
+        memset(dest->data(), 0, dest->getTotalSizeInBytes());
+
+        std::cout<<"  copyImage "<<tests[i].name<<"\t";
+        if (tests[i].srcPixelFormat!=tests[i].destPixelFormat)
+        {
+            osg::ref_ptr<osg::Image> generic = new osg::Image(*dest, osg::CopyOp::DEEP_COPY_ALL);
+            osg::Timer_t start = timer.tick();
+            convertImageThroughVec4(image.get(), generic.get());
+            std::cout<<timer.delta_m(start, timer.tick())<<" ms generic, ";
+        }
+
+        osg::Timer_t start = timer.tick();
+        osg::copyImage(image.get(), 0, 0, 0, size, size, 1, dest.get(), 0, 0, 0, true);
+        std::cout<<timer.delta_m(start, timer.tick())<<" ms"<<std::endl;
+    }
+
+    // check every conversion between the pixel formats copyImage() has kernels for against the Vec4 path. The kernels copy the
+    // components exactly, whereas the Vec4 path's float round trip can truncate an integer component one below, 255 to 254.
+    const GLenum pixelFormats[] = { GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB, GL_RGBA, GL_BGR, GL_BGRA };
+    const char* pixelFormatNames[] = { "GL_LUMINANCE", "GL_LUMINANCE_ALPHA", "GL_RGB", "GL_RGBA", "GL_BGR", "GL_BGRA" };
+    const unsigned int numPixelFormats = sizeof(pixelFormats)/sizeof(GLenum);
+    unsigned int numChecked = 0, numDiffering = 0;
+    for(unsigned int d=0; d<3; ++d)
+    {
+        double tolerance = (dataTypes[d]==GL_FLOAT) ? 0.0 : 1.0;
+        for(unsigned int f=0; f<numPixelFormats; ++f)
+        {
+            osg::ref_ptr<osg::Image> image = createConversionImage(67, pixelFormats[f], dataTypes[d]);
+            for(unsigned int g=0; g<numPixelFormats; ++g)
+            {
+                if (f==g) continue;
+
+                osg::ref_ptr<osg::Image> dest = new osg::Image;
+                dest->allocateImage(67, 67, 1, pixelFormats[g], dataTypes[d]);
+                memset(dest->data(), 0, dest->getTotalSizeInBytes());
+                osg::ref_ptr<osg::Image> generic = new osg::Image(*dest, osg::CopyOp::DEEP_COPY_ALL);
+
+                osg::copyImage(image.get(), 0, 0, 0, 67, 67, 1, dest.get(), 0, 0, 0, true);
+                convertImageThroughVec4(image.get(), generic.get());
+
+                ++numChecked;
+                double difference = computeMaximumDifference(dest.get(), generic.get());
+                if (difference>tolerance)
+                {
+                    ++numDiffering;
+                    std::cout<<"  copyImage "<<pixelFormatNames[f]<<" to "<<pixelFormatNames[g]<<" "<<dataTypeNames[d]<<" DIFFERS from the Vec4 path by "<<difference<<std::endl;
+                }
+            }
+        }
+    }
+    std::cout<<"  copyImage per format check, "<<numChecked<<" conversions compared with the Vec4 path, "<<numDiffering<<" differ"<<std::endl;
+}
+
+static void decodeColourBlock(const unsigned char* block, bool fourColourOnly, unsigned char pixels[16][4])
+{
+    unsigned int colours[2] = { static_cast<unsigned int>(block[0] | (block[1]<<8)), static_cast<unsigned int>(block[2] | (block[3]<<8)) };
+
+    int palette[4][4];
+    for(unsigned int c=0; c<2; ++c)
+    {
+        unsigned int r = (colours[c]>>11) & 31, g = (colours[c]>>5) & 63, b = colours[c] & 31;
+        palette[c][0] = (r<<3) | (r>>2);
+        palette[c][1] = (g<<2) | (g>>4);
+        palette[c][2] = (b<<3) | (b>>2);
+        palette[c][3] = 255;
+    }
+
+    for(unsigned int i=0; i<4; ++i)
+    {
+        if (fourColourOnly || colours[0]>colours[1])
+        {
+            palette[2][i] = (2*palette[0][i]+palette[1][i])/3;
+            palette[3][i] = (palette[0][i]+2*palette[1][i])/3;
+        }
+        else
+        {
+            palette[2][i] = (palette[0][i]+palette[1][i])/2;
+            palette[3][i] = 0;
+        }
+    }
+
+    for(unsigned int i=0; i<16; ++i)
+    {
+        unsigned int index = (block[4+i/4]>>((i%4)*2)) & 3;
+        for(unsigned int c=0; c<4; ++c) pixels[i][c] = static_cast<unsigned char>(palette[index][c]);
+    }
+}
+
+static void decodeAlphaBlock(const unsigned char* block, unsigned char pixels[16][4], unsigned int channel)
+{
+    int palette[8];
+    palette[0] = block[0];
+    palette[1] = block[1];
+    if (palette[0]>palette[1])
+    {
+        for(int i=1; i<7; ++i) palette[i+1] = ((7-i)*palette[0] + i*palette[1])/7;
+    }
+    else
+    {
+        for(int i=1; i<5; ++i) palette[i+1] = ((5-i)*palette[0] + i*palette[1])/5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    for(unsigned int i=0; i<16; ++i)
+    {
+        unsigned int bits = block[2+(i/8)*3] | (block[3+(i/8)*3]<<8) | (block[4+(i/8)*3]<<16);
+        pixels[i][channel] = static_cast<unsigned char>(palette[(bits>>((i%8)*3)) & 7]);
+    }
+}
+
+// decode the top level of a compressed image, returning the root mean square error of the channels compressed.
+static double computeBCnError(const osg::Image* original, const osg::Image* compressed)
+{
+    GLenum format = compressed->getPixelFormat();
+    unsigned int blockSize = (format==GL_COMPRESSED_RGB_S3TC_DXT1_EXT || format==GL_COMPRESSED_RGBA_S3TC_DXT1_EXT || format==GL_COMPRESSED_RED_RGTC1_EXT) ? 8 : 16;
+    unsigned int numChannels = format==GL_COMPRESSED_RED_RGTC1_EXT ? 1 : (format==GL_COMPRESSED_RED_GREEN_RGTC2_EXT ? 2 : (format==GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 3 : 4));
+
+    double totalError = 0.0;
+    const unsigned char* block = compressed->data();
+    for(int by=0; by<original->t()/4; ++by)
+    {
+        for(int bx=0; bx<original->s()/4; ++bx, block+=blockSize)
+        {
+            unsigned char pixels[16][4];
+            switch(format)
+            {
+                case(GL_COMPRESSED_RGB_S3TC_DXT1_EXT):
+                case(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT): decodeColourBlock(block, false, pixels); break;
+                case(GL_COMPRESSED_RGBA_S3TC_DXT3_EXT):
+                    decodeColourBlock(block+8, true, pixels);
+                    for(unsigned int i=0; i<16; ++i) pixels[i][3] = static_cast<unsigned char>(((block[i/2]>>((i%2)*4)) & 15)*17);
+                    break;
+                case(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT): decodeColourBlock(block+8, true, pixels); decodeAlphaBlock(block, pixels, 3); break;
+                case(GL_COMPRESSED_RED_RGTC1_EXT): decodeAlphaBlock(block, pixels, 0); break;
+                default: decodeAlphaBlock(block, pixels, 0); decodeAlphaBlock(block+8, pixels, 1); break;
+            }
+
+            for(unsigned int i=0; i<16; ++i)
+            {
+                const unsigned char* pixel = original->data(bx*4+i%4, by*4+i/4);
+                unsigned char expected[4] = { pixel[0], pixel[1], pixel[2], pixel[3] };
+
+                // DXT1a pixels are either opaque or transparent, and the colour of transparent pixels is lost.
+                if (format==GL_COMPRESSED_RGBA_S3TC_DXT1_EXT)
+                {
+                    expected[3] = pixel[3]<128 ? 0 : 255;
+                    if (expected[3]==0) for(unsigned int c=0; c<3; ++c) expected[c] = pixels[i][c];
+                }
+
+                for(unsigned int c=0; c<numChannels; ++c)
+                {
+                    double difference = static_cast<double>(pixels[i][c])-static_cast<double>(expected[c]);
+                    totalError += difference*difference;
+                }
+            }
+        }
+    }
+
+    return sqrt(totalError/static_cast<double>(original->s()*original->t()*numChannels));
+}
+
+void runBCnCompressionTests()
+{
+    osgDB::ImageProcessor* imageProcessor = osgDB::Registry::instance()->getImageProcessorForExtension("bcn");
+    if (!imageProcessor)
+    {
+        std::cout<<"No ImageProcessor available"<<std::endl;
+        return;
+    }
+
+    const int size = 512;
+    std::cout<<imageProcessor->className()<<" compression of a "<<size<<"x"<<size<<" GL_RGBA image with mipmaps, root mean square error of the top level"<<std::endl;
+
+    osg::ref_ptr<osg::Image> image = new osg::Image;
+    image->allocateImage(size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+    for(int t=0; t<size; ++t)
+    {
+        unsigned char* data = image->data(0, t);
+        for(int s=0; s<size; ++s)
+        {
+            double x = static_cast<double>(s)/static_cast<double>(size);
+            double y = static_cast<double>(t)/static_cast<double>(size);
+            *data++ = static_cast<unsigned char>(127.5+127.5*sin(x*20.0));
+            *data++ = static_cast<unsigned char>(255.0*y);
+            *data++ = static_cast<unsigned char>(osg::clampBetween(127.5+127.5*cos((x+y)*30.0)+static_cast<double>(rand()%32-16), 0.0, 255.0));
+            *data++ = static_cast<unsigned char>(x<0.25 ? 0 : (x<0.5 ? 255 : 255.0*y));
+        }
+    }
+
+    struct CompressionTest
+    {
+        const char* name;
+        osg::Texture::InternalFormatMode format;
+    };
+
+    const CompressionTest formats[] =
+    {
+        { "DXT1 ", osg::Texture::USE_S3TC_DXT1c_COMPRESSION },
+        { "DXT1a", osg::Texture::USE_S3TC_DXT1a_COMPRESSION },
+        { "DXT3 ", osg::Texture::USE_S3TC_DXT3_COMPRESSION },
+        { "DXT5 ", osg::Texture::USE_S3TC_DXT5_COMPRESSION },
+        { "BC4  ", osg::Texture::USE_RGTC1_COMPRESSION },
+        { "BC5  ", osg::Texture::USE_RGTC2_COMPRESSION }
+    };
+
+    const char* qualityNames[] = { "FASTEST", "NORMAL", "PRODUCTION", "HIGHEST" };
+
+    const std::string fileName = "osgunittests_bcn.dds";
+
+    for(unsigned int f=0; f<sizeof(formats)/sizeof(CompressionTest); ++f)
+    {
+        for(unsigned int q=osgDB::ImageProcessor::FASTEST; q<=osgDB::ImageProcessor::HIGHEST; ++q)
+        {
+            osg::ref_ptr<osg::Image> compressed = new osg::Image(*image, osg::CopyOp::DEEP_COPY_ALL);
+
+            osg::Timer timer;
+            osg::Timer_t start = timer.tick();
+            imageProcessor->compress(*compressed, formats[f].format, true, false, osgDB::ImageProcessor::USE_CPU, static_cast<osgDB::ImageProcessor::CompressionQuality>(q));
+            double time = timer.delta_m(start, timer.tick());
+
+            std::cout<<"  "<<formats[f].name<<" "<<qualityNames[q]<<"\t"<<time<<" ms\terror "<<computeBCnError(image.get(), compressed.get());
+
+            // write out and read back the compressed image using the dds plugin, without it flipping the image.
+            if (q==osgDB::ImageProcessor::NORMAL)
+            {
+                bool roundTrip = false;
+                if (osgDB::writeImageFile(*compressed, fileName, new osgDB::Options("ddsNoAutoFlipWrite")))
+                {
+                    osg::ref_ptr<osg::Image> read = osgDB::readRefImageFile(fileName);
+                    roundTrip = read.valid() &&
+                                read->s()==compressed->s() && read->t()==compressed->t() &&
+                                read->getPixelFormat()==compressed->getPixelFormat() &&
+                                read->getNumMipmapLevels()==compressed->getNumMipmapLevels() &&
+                                read->getTotalSizeInBytesIncludingMipmaps()==compressed->getTotalSizeInBytesIncludingMipmaps() &&
+                                memcmp(read->data(), compressed->data(), compressed->getTotalSizeInBytesIncludingMipmaps())==0;
+                    remove(fileName.c_str());
+                }
+                std::cout<<"\tdds round trip "<<(roundTrip ? "passed" : "FAILED");
+            }
+            std::cout<<std::endl;
+        }
+    }
+}
+
+static int computeMaxDifference(const osg::Image* lhs, const osg::Image* rhs)
+{
+    if (!lhs || !rhs || lhs->s()!=rhs->s() || lhs->t()!=rhs->t() || lhs->getTotalSizeInBytes()!=rhs->getTotalSizeInBytes()) return 256;
+
+    int maxDifference = 0;
+    for(unsigned int i=0; i<lhs->getTotalSizeInBytes(); ++i)
+    {
+        maxDifference = osg::maximum(maxDifference, abs(static_cast<int>(lhs->data()[i])-static_cast<int>(rhs->data()[i])));
+    }
+    return maxDifference;
+}
+
+void runImageRegionTests()
+{
+    const int size = 4096;
+    osg::ref_ptr<osg::Image> image = new osg::Image;
+    image->allocateImage(size, size, 1, GL_RGB, GL_UNSIGNED_BYTE);
+    for(int t=0; t<size; ++t)
+    {
+        unsigned char* data = image->data(0, t);
+        for(int s=0; s<size; ++s)
+        {
+            double x = static_cast<double>(s)/static_cast<double>(size);
+            double y = static_cast<double>(t)/static_cast<double>(size);
+            *data++ = static_cast<unsigned char>(127.5+127.5*sin(x*40.0));
+            *data++ = static_cast<unsigned char>(255.0*y);
+            *data++ = static_cast<unsigned char>(127.5+127.5*cos((x+y)*30.0));
+        }
+    }
+
+    struct RegionTest
+    {
+        const char* name;
+        int x, y, width, height;
+        unsigned int reductionLevel;
+    };
+
+    const RegionTest regions[] =
+    {
+        { "256x256 tile        ", 1024, 2048, 256, 256, 0 },
+        { "odd region          ", 1001, 1503, 777, 333, 0 },
+        { "whole image level 3 ", 0, 0, size, size, 3 },
+        { "1024x1024 level 2   ", 2048, 0, 1024, 1024, 2 }
+    };
+
+    const char* extensions[] = { "jpg", "tif" };
+
+    for(unsigned int e=0; e<sizeof(extensions)/sizeof(const char*); ++e)
+    {
+        std::string fileName = std::string("osgunittests_region.")+extensions[e];
+        if (!osgDB::writeImageFile(*image, fileName))
+        {
+            std::cout<<"No plugin available to write "<<fileName<<std::endl;
+            continue;
+        }
+
+        std::cout<<"Reading regions of a "<<size<<"x"<<size<<" GL_RGB "<<extensions[e]<<", whole image read and cropped vs readRefImageRegionFile"<<std::endl;
+
+        for(unsigned int r=0; r<sizeof(regions)/sizeof(RegionTest); ++r)
+        {
+            const RegionTest& region = regions[r];
+
+            osg::Timer timer;
+            osg::Timer_t start = timer.tick();
+            osg::ref_ptr<osg::Image> whole = osgDB::readRefImageFile(fileName);
+            osg::ref_ptr<osg::Image> cropped = osgDB::createImageRegion(whole.get(), region.x, region.y, region.width, region.height, region.reductionLevel);
+            double wholeTime = timer.delta_m(start, timer.tick());
+
+            start = timer.tick();
+            osg::ref_ptr<osg::Image> read = osgDB::readRefImageRegionFile(fileName, region.x, region.y, region.width, region.height, region.reductionLevel);
+            double regionTime = timer.delta_m(start, timer.tick());
+
+            std::cout<<"  "<<region.name<<wholeTime<<" ms\t"<<regionTime<<" ms\tmax difference "<<computeMaxDifference(cropped.get(), read.get())<<std::endl;
+        }
+
+        remove(fileName.c_str());
+    }
+}
+
+class GeometryCollector : public osg::NodeVisitor
+{
+public:
+    GeometryCollector() : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN) {}
+
+    virtual void apply(osg::Geometry& geometry)
+    {
+        const osg::Vec3Array* vertices = dynamic_cast<const osg::Vec3Array*>(geometry.getVertexArray());
+        if (vertices) _vertices.insert(_vertices.end(), vertices->begin(), vertices->end());
+        ++_numGeometries;
+    }
+
+    std::vector<osg::Vec3> _vertices;
+    unsigned int _numGeometries;
+};
+
+static bool compareGeometry(osg::Node* lhs, osg::Node* rhs)
+{
+    if (!lhs || !rhs) return false;
+
+    GeometryCollector lhsCollector, rhsCollector;
+    lhsCollector._numGeometries = rhsCollector._numGeometries = 0;
+    lhs->accept(lhsCollector);
+    rhs->accept(rhsCollector);
+    return lhsCollector._numGeometries==rhsCollector._numGeometries && lhsCollector._vertices==rhsCollector._vertices;
+}
+
+void runObjReadTests()
+{
+    const int size = 600;
+    std::string fileName("osgunittests_read.obj");
+    {
+        std::ofstream fout(fileName.c_str());
+        fout.imbue(std::locale::classic());
+        fout.precision(9);
+        for(int j=0; j<size; ++j)
+        {
+            if ((j%100)==0) fout<<"g strip"<<j/100<<"\nusemtl material"<<(j/100)%3<<"\n";
+            for(int i=0; i<size; ++i)
+            {
+                double x = static_cast<double>(i)/static_cast<double>(size);
+                double y = static_cast<double>(j)/static_cast<double>(size);
+                fout<<"v "<<x*100.0<<" "<<y*100.0<<" "<<sin(x*20.0)*cos(y*20.0)<<"\n";
+                fout<<"vn "<<-cos(x*20.0)<<" "<<sin(y*20.0)<<" 1\n";
+                fout<<"vt "<<x<<" "<<y<<"\n";
+                if (i>0 && j>0)
+                {
+                    int v = j*size+i+1;
+                    fout<<"f "<<v<<"/"<<v<<"/"<<v<<" "<<v-1<<"/"<<v-1<<"/"<<v-1<<" "<<v-size-1<<"/"<<v-size-1<<"/"<<v-size-1
+                        <<" "<<v-size<<"/"<<v-size<<"/"<<v-size<<"\n";
+                }
+            }
+        }
+    }
+
+    std::cout<<"Reading a "<<size<<"x"<<size<<" grid obj, with normals and texture coordinates, without tri stripping"<<std::endl;
+
+    const char* optionStrings[] = { "noTriStripPolygons noMapping", "noTriStripPolygons readThreads=1", "noTriStripPolygons" };
+    const char* names[] = { "stream              ", "mapped, 1 thread    ", "mapped, all threads " };
+
+    osg::ref_ptr<osg::Node> reference;
+    for(unsigned int o=0; o<sizeof(optionStrings)/sizeof(const char*); ++o)
+    {
+        osg::ref_ptr<osgDB::Options> options = new osgDB::Options(optionStrings[o]);
+        options->setObjectCacheHint(osgDB::Options::CACHE_NONE);
+
+        osg::Timer timer;
+        osg::Timer_t start = timer.tick();
+        osg::ref_ptr<osg::Node> node = osgDB::readRefNodeFile(fileName, options.get());
+        double time = timer.delta_m(start, timer.tick());
+
+        if (!node)
+        {
+            std::cout<<"No plugin available to read "<<fileName<<std::endl;
+            break;
+        }
+
+        if (!reference) reference = node;
+        std::cout<<"  "<<names[o]<<time<<" ms\t"<<(compareGeometry(reference.get(), node.get()) ? "same geometry" : "DIFFERENT geometry")<<std::endl;
+    }
+
+    remove(fileName.c_str());
+}
+
+static std::string serializeNode(const osg::Node& node)
+{
+    std::ostringstream sstream;
+    osgDB::ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension("osgt");
+    if (rw) rw->writeNode(node, sstream);
+    return sstream.str();
+}
+
+static float readArchiveVersion(const std::string& fileName)
+{
+    char header[12];
+    float version = -1.0f;
+    std::ifstream fin(fileName.c_str(), std::ios::in | std::ios::binary);
+    if (fin.read(header, sizeof(header))) memcpy(&version, header+8, sizeof(float));
+    return version;
+}
+
+static bool compareArchive(const std::string& fileName, const std::map<std::string, std::string>& files, const std::string& masterFileName)
+{
+    osg::ref_ptr<osgDB::Options> options = new osgDB::Options;
+    options->setObjectCacheHint(osgDB::Options::CACHE_NONE);
+    osg::ref_ptr<osgDB::Archive> archive = osgDB::openArchive(fileName, osgDB::Archive::READ, 4096, options.get());
+    if (!archive) return false;
+
+    osgDB::Archive::FileNameList fileNames;
+    archive->getFileNames(fileNames);
+    std::sort(fileNames.begin(), fileNames.end());
+    if (fileNames.size()!=files.size() || archive->getMasterFileName()!=masterFileName) return false;
+
+    std::map<std::string, std::string>::const_iterator fitr = files.begin();
+    for(osgDB::Archive::FileNameList::const_iterator itr=fileNames.begin(); itr!=fileNames.end(); ++itr, ++fitr)
+    {
+        if (*itr!=fitr->first) return false;
+
+        osg::ref_ptr<osg::Node> node = archive->readNode(*itr).getNode();
+        if (!node || serializeNode(*node)!=fitr->second) return false;
+    }
+    return true;
+}
+
+void runOSGAArchiveTests()
+{
+    if (!osgDB::Registry::instance()->getReaderWriterForExtension("osga") || !osgDB::Registry::instance()->getReaderWriterForExtension("osgt"))
+    {
+        std::cout<<"No osga or osgt plugin available"<<std::endl;
+        return;
+    }
+
+    const char* optionStrings[] = { "", "hashedIndex" };
+    const char* names[] = { "version 0 ", "version 1 " };
+    const char* archiveNames[] = { "osgunittests_v0.osga", "osgunittests_v1.osga" };
+
+    for(unsigned int o=0; o<2; ++o)
+    {
+        // don't cache the archives so that each open reads the archive file afresh.
+        osg::ref_ptr<osgDB::Options> options = new osgDB::Options(optionStrings[o]);
+        options->setObjectCacheHint(osgDB::Options::CACHE_NONE);
+        std::map<std::string, std::string> files;
+
+        osg::ref_ptr<osgDB::Archive> archive = osgDB::openArchive(archiveNames[o], osgDB::Archive::CREATE, 4096, options.get());
+        if (!archive)
+        {
+            std::cout<<"Unable to create "<<archiveNames[o]<<std::endl;
+            return;
+        }
+
+        for(unsigned int i=0; i<3; ++i)
+        {
+            std::ostringstream name;
+            name<<"dir/file"<<i<<".osgt";
+            osg::ref_ptr<osg::Group> group = new osg::Group;
+            group->setName(name.str());
+            for(unsigned int c=0; c<i*50; ++c) group->addChild(new osg::Group);
+
+            archive->writeNode(*group, name.str());
+            files[name.str()] = serializeNode(*group);
+        }
+        archive->close();
+        archive = 0;
+
+        std::cout<<"  "<<names[o]<<"write and read   version "<<readArchiveVersion(archiveNames[o])<<"\t"
+                 <<(compareArchive(archiveNames[o], files, "dir/file0.osgt") ? "same files" : "DIFFERENT files")<<std::endl;
+
+        // append a file to the archive then check the original files are still there.
+        archive = osgDB::openArchive(archiveNames[o], osgDB::Archive::WRITE, 4096, options.get());
+        if (archive.valid())
+        {
+            osg::ref_ptr<osg::Group> group = new osg::Group;
+            group->setName("appended");
+            archive->writeNode(*group, "appended.osgt");
+            files["appended.osgt"] = serializeNode(*group);
+            archive->close();
+            archive = 0;
+        }
+
+        std::cout<<"  "<<names[o]<<"append           version "<<readArchiveVersion(archiveNames[o])<<"\t"
+                 <<(compareArchive(archiveNames[o], files, "dir/file0.osgt") ? "same files" : "DIFFERENT files")<<std::endl;
+
+        // convert the archive to the other version, copying the files unchanged.
+        std::string convertedName("osgunittests_converted.osga");
+        osg::ref_ptr<osgDB::Options> convertOptions = new osgDB::Options(optionStrings[1-o]);
+        convertOptions->setObjectCacheHint(osgDB::Options::CACHE_NONE);
+        convertOptions->setPluginStringData("sourceArchive", archiveNames[o]);
+        archive = osgDB::openArchive(convertedName, osgDB::Archive::CREATE, 4096, convertOptions.get());
+        if (archive.valid())
+        {
+            archive->close();
+            archive = 0;
+        }
+
+        std::cout<<"  "<<names[o]<<"convert          version "<<readArchiveVersion(convertedName)<<"\t"
+                 <<(compareArchive(convertedName, files, "dir/file0.osgt") ? "same files" : "DIFFERENT files")<<std::endl;
+
+        remove(convertedName.c_str());
+        remove(archiveNames[o]);
+    }
+}
+
+static bool compressAndDecompress(osgDB::BaseCompressor* compressor, const std::string& data, std::string& compressed, std::string& decompressed)
+{
+    std::ostringstream out(std::ios::out | std::ios::binary);
+    if (!compressor->compress(out, data)) return false;
+    compressed = out.str();
+
+    std::istringstream in(compressed, std::ios::in | std::ios::binary);
+    decompressed.clear();
+    return compressor->decompress(in, decompressed);
+}
+
+static bool decompressCorrupted(osgDB::BaseCompressor* compressor, const std::string& compressed, const std::string& data)
+{
+    std::istringstream in(compressed, std::ios::in | std::ios::binary);
+    std::string decompressed;
+    return !compressor->decompress(in, decompressed) || decompressed!=data;
+}
+
+void runCompressorTests()
+{
+    const unsigned int chunkSize = 262144;
+    const unsigned int sizes[] = { 0, 1, 12, 13, chunkSize-1, chunkSize, chunkSize+1, 4*chunkSize+7 };
+    const char* compressorNames[] = { "lz4", "zlibchunked" };
+
+    for(unsigned int c=0; c<sizeof(compressorNames)/sizeof(const char*); ++c)
+    {
+        osgDB::BaseCompressor* compressor = osgDB::Registry::instance()->getObjectWrapperManager()->findCompressor(compressorNames[c]);
+        if (!compressor)
+        {
+            std::cout<<"No "<<compressorNames[c]<<" compressor available"<<std::endl;
+            continue;
+        }
+
+        for(unsigned int compressible=0; compressible<2; ++compressible)
+        {
+            for(unsigned int s=0; s<sizeof(sizes)/sizeof(unsigned int); ++s)
+            {
+                // repeated text compresses well, random bytes not at all so are stored as literals.
+                std::string data(sizes[s], '\0');
+                unsigned int seed = 1;
+                for(unsigned int i=0; i<data.size(); ++i)
+                {
+                    seed = seed*1103515245u + 12345u;
+                    data[i] = compressible ? "the quick brown fox jumps over the lazy dog "[(i*7/5)%44] : static_cast<char>(seed>>24);
+                }
+
+                osg::Timer timer;
+                osg::Timer_t start = timer.tick();
+                std::string compressed, decompressed;
+                bool result = compressAndDecompress(compressor, data, compressed, decompressed);
+                double time = timer.delta_m(start, timer.tick());
+
+                std::cout<<"  "<<compressorNames[c]<<(compressible ? " text   " : " random ")<<sizes[s]<<" bytes -> "<<compressed.size()
+                         <<"\t"<<time<<" ms\t"<<(result && decompressed==data ? "same" : "DIFFERENT")<<std::endl;
+
+                if (data.empty() || !result) continue;
+
+                // truncating the stream, claiming more chunks than there are or damaging the compressed data must be
+                // reported as a failure, or at worst give different data, rather than crash.
+                std::string truncated(compressed, 0, compressed.size()-1);
+                std::string badHeader(compressed);
+                int numChunks = 0x7fffffff;
+                memcpy(&badHeader[4], &numChunks, sizeof(int));
+                std::string damaged(compressed);
+                for(unsigned int i=8+8*((data.size()+chunkSize-1)/chunkSize); i<damaged.size(); i+=97) damaged[i] = ~damaged[i];
+
+                bool truncatedFailed = decompressCorrupted(compressor, truncated, data);
+                bool badHeaderFailed = decompressCorrupted(compressor, badHeader, data);
+                bool damagedFailed = decompressCorrupted(compressor, damaged, data);
+                std::cout<<"    corrupted input\t"<<(truncatedFailed && badHeaderFailed ? "rejected" : "NOT REJECTED")
+                         <<", damaged chunks "<<(damagedFailed ? "rejected" : "decoded")<<std::endl;
+            }
+        }
+    }
+}
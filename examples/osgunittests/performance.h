@@ -23,4 +23,24 @@
 
 extern void runPerformanceTests();
 
+extern void runRenderBinSortTests();
+
+extern void runDatabasePagerQueueTests();
+
+extern void runObjectCacheTests();
+
+extern void runMipmapTests();
+
+extern void runBCnCompressionTests();
+
+extern void runImageConversionTests();
+
+extern void runImageRegionTests();
+
+extern void runObjReadTests();
+
+extern void runOSGAArchiveTests();
+
+extern void runCompressorTests();
+
 #endif
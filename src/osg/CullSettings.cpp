@@ -43,6 +43,7 @@ void CullSettings::setDefaults()
     _cullMask = 0xffffffff;
     _cullMaskLeft = 0xffffffff;
     _cullMaskRight = 0xffffffff;
+    _numCullThreads = 1;
 
     // override during testing
     //_computeNearFar = COMPUTE_NEAR_FAR_USING_PRIMITIVES;
@@ -69,6 +70,8 @@ void CullSettings::setCullSettings(const CullSettings& rhs)
     _cullMask = rhs._cullMask;
     _cullMaskLeft = rhs._cullMaskLeft;
     _cullMaskRight =  rhs._cullMaskRight;
+
+    _numCullThreads = rhs._numCullThreads;
 }
 
 
@@ -87,11 +90,13 @@ void CullSettings::inheritCullSettings(const CullSettings& settings, unsigned in
     if (inheritanceMask & LOD_SCALE) _LODScale = settings._LODScale;
     if (inheritanceMask & SMALL_FEATURE_CULLING_PIXEL_SIZE) _smallFeatureCullingPixelSize = settings._smallFeatureCullingPixelSize;
     if (inheritanceMask & CLAMP_PROJECTION_MATRIX_CALLBACK) _clampProjectionMatrixCallback = settings._clampProjectionMatrixCallback;
+    if (inheritanceMask & NUM_CULL_THREADS) _numCullThreads = settings._numCullThreads;
 }
 
 
 static ApplicationUsageProxy ApplicationUsageProxyCullSettings_e0(ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_COMPUTE_NEAR_FAR_MODE <mode>","DO_NOT_COMPUTE_NEAR_FAR | COMPUTE_NEAR_FAR_USING_BOUNDING_VOLUMES | COMPUTE_NEAR_FAR_USING_PRIMITIVES");
 static ApplicationUsageProxy ApplicationUsageProxyCullSettings_e1(ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_NEAR_FAR_RATIO <float>","Set the ratio between near and far planes - must greater than 0.0 but less than 1.0.");
+static ApplicationUsageProxy ApplicationUsageProxyCullSettings_e2(ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_NUM_CULL_THREADS <int>","Set the number of threads used to cull the scene graph, values above 1 enable the parallel cull.");
 
 void CullSettings::readEnvironmentalVariables()
 {
@@ -116,6 +121,14 @@ void CullSettings::readEnvironmentalVariables()
         OSG_INFO<<"Set near/far ratio to "<<_nearFarRatio<<std::endl;
     }
 
+    if ((ptr = getenv("OSG_NUM_CULL_THREADS")) != 0)
+    {
+        int numThreads = atoi(ptr);
+        _numCullThreads = numThreads>1 ? static_cast<unsigned int>(numThreads) : 1;
+
+        OSG_INFO<<"Set number of cull threads to "<<_numCullThreads<<std::endl;
+    }
+
 }
 
 void CullSettings::readCommandLine(ArgumentParser& arguments)
@@ -125,6 +138,7 @@ void CullSettings::readCommandLine(ArgumentParser& arguments)
     {
         arguments.getApplicationUsage()->addCommandLineOption("--COMPUTE_NEAR_FAR_MODE <mode>","DO_NOT_COMPUTE_NEAR_FAR | COMPUTE_NEAR_FAR_USING_BOUNDING_VOLUMES | COMPUTE_NEAR_FAR_USING_PRIMITIVES");
         arguments.getApplicationUsage()->addCommandLineOption("--NEAR_FAR_RATIO <float>","Set the ratio between near and far planes - must greater than 0.0 but less than 1.0.");
+        arguments.getApplicationUsage()->addCommandLineOption("--NUM_CULL_THREADS <int>","Set the number of threads used to cull the scene graph, values above 1 enable the parallel cull.");
     }
 
     std::string str;
@@ -145,6 +159,14 @@ void CullSettings::readCommandLine(ArgumentParser& arguments)
         OSG_INFO<<"Set near/far ratio to "<<_nearFarRatio<<std::endl;
     }
 
+    unsigned int numThreads;
+    while(arguments.read("--NUM_CULL_THREADS",numThreads))
+    {
+        _numCullThreads = numThreads>1 ? numThreads : 1;
+
+        OSG_INFO<<"Set number of cull threads to "<<_numCullThreads<<std::endl;
+    }
+
 }
 
 void CullSettings::write(std::ostream& out)
@@ -166,6 +188,7 @@ void CullSettings::write(std::ostream& out)
     out<<"    _cullMask = "<<_cullMask<<std::endl;
     out<<"    _cullMaskLeft = "<<_cullMaskLeft<<std::endl;
     out<<"    _cullMaskRight = "<<_cullMaskRight<<std::endl;
+    out<<"    _numCullThreads = "<<_numCullThreads<<std::endl;
 
     out<<"{"<<std::endl;
 }
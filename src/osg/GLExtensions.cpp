@@ -1080,6 +1080,9 @@ GLExtensions::GLExtensions(unsigned int contextID)
 
     // MultiDrawArrays
     setGLExtensionFuncPtr(glMultiDrawArrays, "glMultiDrawArrays", "glMultiDrawArraysEXT");
+
+    // MultiDrawElements
+    setGLExtensionFuncPtr(glMultiDrawElements, "glMultiDrawElements", "glMultiDrawElementsEXT");
 }
 
 
@@ -21,6 +21,16 @@
 #include <osg/Notify>
 #include <osg/io_utils>
 
+#include <OpenThreads/Thread>
+
+#include <limits>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+    #define OSG_IMAGEUTILS_USE_SSE2 1
+    #include <emmintrin.h>
+#endif
+
 namespace osg
 {
 
@@ -89,10 +99,572 @@ struct OffsetAndScaleOperator
     }
 };
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Row kernels specialised for the common pixel formats and data types, with the readRow()/modifyRow() templates
+// used for the rest.
+//
+namespace
+{
+
+// images with less data than this per thread aren't worth the cost of starting threads to process them.
+const unsigned long long IMAGE_MIN_BYTES_PER_THREAD = 1024*1024;
+
+unsigned int computeNumRowBands(unsigned int numRows, unsigned long long numBytes)
+{
+    unsigned long long numBands = osg::minimum(static_cast<unsigned long long>(osg::maximum(OpenThreads::GetNumberOfProcessors(), 1)), numBytes/IMAGE_MIN_BYTES_PER_THREAD);
+    numBands = osg::minimum(numBands, static_cast<unsigned long long>(numRows));
+    return numBands>1 ? static_cast<unsigned int>(numBands) : 1;
+}
+
+template<class Operation>
+class RowBandThread : public osg::Referenced, public OpenThreads::Thread
+{
+public:
+
+    RowBandThread(Operation& operation, unsigned int band, unsigned int beginRow, unsigned int endRow):
+        _operation(operation),
+        _band(band),
+        _beginRow(beginRow),
+        _endRow(endRow) {}
+
+    virtual void run()
+    {
+        _operation(_band, _beginRow, _endRow);
+    }
+
+protected:
+
+    virtual ~RowBandThread() {}
+
+    Operation&      _operation;
+    unsigned int    _band;
+    unsigned int    _beginRow;
+    unsigned int    _endRow;
+};
+
+/** Call operation(band, beginRow, endRow) for each of numBands bands of the rows, this thread processing the first band
+  * while the others are processed by threads of their own.*/
+template<class Operation>
+void processRowBands(unsigned int numRows, unsigned int numBands, Operation& operation)
+{
+    if (numBands<=1)
+    {
+        operation(0, 0, numRows);
+        return;
+    }
+
+    std::vector< osg::ref_ptr< RowBandThread<Operation> > > threads;
+    for(unsigned int band=1; band<numBands; ++band)
+    {
+        threads.push_back(new RowBandThread<Operation>(operation, band, numRows*band/numBands, numRows*(band+1)/numBands));
+        threads.back()->startThread();
+    }
+
+    operation(0, 0, numRows/numBands);
+
+    for(unsigned int i=0; i<threads.size(); ++i)
+    {
+        threads[i]->join();
+    }
+}
+
+// rows are numbered through all the slices of an image.
+inline const unsigned char* rowData(const osg::Image* image, unsigned int row) { return image->data(0, row%image->t(), row/image->t()); }
+inline unsigned char* rowData(osg::Image* image, unsigned int row) { return image->data(0, row%image->t(), row/image->t()); }
+
+bool isReadableRowFormat(GLenum pixelFormat)
+{
+    switch(pixelFormat)
+    {
+        case(GL_INTENSITY):
+        case(GL_LUMINANCE):
+        case(GL_ALPHA):
+        case(GL_LUMINANCE_ALPHA):
+        case(GL_RGB):
+        case(GL_RGBA):
+        case(GL_BGR):
+        case(GL_BGRA): return true;
+        default: return false;
+    }
+}
+
+/** Update the minimum and maximum of each component of a row of numValues values, the components of a pixel being interleaved.*/
+template<typename T>
+void rowMinMax(const T* data, unsigned int numValues, unsigned int numComponents, T* minimum, T* maximum)
+{
+    for(unsigned int i=0; i<numValues; i+=numComponents)
+    {
+        for(unsigned int c=0; c<numComponents; ++c)
+        {
+            minimum[c] = osg::minimum(data[i+c], minimum[c]);
+            maximum[c] = osg::maximum(data[i+c], maximum[c]);
+        }
+    }
+}
+
+#ifdef OSG_IMAGEUTILS_USE_SSE2
+// The SSE2 versions hold a vector of minimums and maximums for each of numComponents vectors, so that each lane always sees the same
+// component, reducing the lanes to components at the end of the row.
+void rowMinMax(const unsigned char* data, unsigned int numValues, unsigned int numComponents, unsigned char* minimum, unsigned char* maximum)
+{
+    const unsigned int chunk = 16*numComponents;
+    unsigned int i = 0;
+    if (numValues>=chunk)
+    {
+        __m128i vmin[4], vmax[4];
+        for(unsigned int v=0; v<numComponents; ++v)
+        {
+            vmin[v] = _mm_set1_epi8(static_cast<char>(0xff));
+            vmax[v] = _mm_setzero_si128();
+        }
+
+        for(; i+chunk<=numValues; i+=chunk)
+        {
+            for(unsigned int v=0; v<numComponents; ++v)
+            {
+                __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data+i+16*v));
+                vmin[v] = _mm_min_epu8(vmin[v], x);
+                vmax[v] = _mm_max_epu8(vmax[v], x);
+            }
+        }
+
+        for(unsigned int v=0; v<numComponents; ++v)
+        {
+            unsigned char mins[16], maxs[16];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(mins), vmin[v]);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(maxs), vmax[v]);
+            for(unsigned int j=0; j<16; ++j)
+            {
+                unsigned int c = (16*v+j)%numComponents;
+                minimum[c] = osg::minimum(mins[j], minimum[c]);
+                maximum[c] = osg::maximum(maxs[j], maximum[c]);
+            }
+        }
+    }
+
+    rowMinMax<unsigned char>(data+i, numValues-i, numComponents, minimum, maximum);
+}
+
+void rowMinMax(const unsigned short* data, unsigned int numValues, unsigned int numComponents, unsigned short* minimum, unsigned short* maximum)
+{
+    const unsigned int chunk = 8*numComponents;
+    unsigned int i = 0;
+    if (numValues>=chunk)
+    {
+        // SSE2 only has signed 16 bit min/max, so flip the sign bit to order unsigned values as signed ones.
+        const __m128i bias = _mm_set1_epi16(static_cast<short>(0x8000));
+        __m128i vmin[4], vmax[4];
+        for(unsigned int v=0; v<numComponents; ++v)
+        {
+            vmin[v] = _mm_set1_epi16(0x7fff);
+            vmax[v] = bias;
+        }
+
+        for(; i+chunk<=numValues; i+=chunk)
+        {
+            for(unsigned int v=0; v<numComponents; ++v)
+            {
+                __m128i x = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data+i+8*v)), bias);
+                vmin[v] = _mm_min_epi16(vmin[v], x);
+                vmax[v] = _mm_max_epi16(vmax[v], x);
+            }
+        }
+
+        for(unsigned int v=0; v<numComponents; ++v)
+        {
+            unsigned short mins[8], maxs[8];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(mins), _mm_xor_si128(vmin[v], bias));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(maxs), _mm_xor_si128(vmax[v], bias));
+            for(unsigned int j=0; j<8; ++j)
+            {
+                unsigned int c = (8*v+j)%numComponents;
+                minimum[c] = osg::minimum(mins[j], minimum[c]);
+                maximum[c] = osg::maximum(maxs[j], maximum[c]);
+            }
+        }
+    }
+
+    rowMinMax<unsigned short>(data+i, numValues-i, numComponents, minimum, maximum);
+}
+
+void rowMinMax(const float* data, unsigned int numValues, unsigned int numComponents, float* minimum, float* maximum)
+{
+    const unsigned int chunk = 4*numComponents;
+    unsigned int i = 0;
+    if (numValues>=chunk)
+    {
+        __m128 vmin[4], vmax[4];
+        for(unsigned int v=0; v<numComponents; ++v)
+        {
+            vmin[v] = _mm_set1_ps(FLT_MAX);
+            vmax[v] = _mm_set1_ps(-FLT_MAX);
+        }
+
+        for(; i+chunk<=numValues; i+=chunk)
+        {
+            for(unsigned int v=0; v<numComponents; ++v)
+            {
+                __m128 x = _mm_loadu_ps(data+i+4*v);
+                vmin[v] = _mm_min_ps(vmin[v], x);
+                vmax[v] = _mm_max_ps(vmax[v], x);
+            }
+        }
+
+        for(unsigned int v=0; v<numComponents; ++v)
+        {
+            float mins[4], maxs[4];
+            _mm_storeu_ps(mins, vmin[v]);
+            _mm_storeu_ps(maxs, vmax[v]);
+            for(unsigned int j=0; j<4; ++j)
+            {
+                unsigned int c = (4*v+j)%numComponents;
+                minimum[c] = osg::minimum(mins[j], minimum[c]);
+                maximum[c] = osg::maximum(maxs[j], maximum[c]);
+            }
+        }
+    }
+
+    rowMinMax<float>(data+i, numValues-i, numComponents, minimum, maximum);
+}
+#endif
+
+template<typename T>
+struct MinMaxRows
+{
+    MinMaxRows(const osg::Image* image, unsigned int numBands):
+        _image(image),
+        _numComponents(osg::Image::computeNumComponents(image->getPixelFormat())),
+        _minimums(numBands*4),
+        _maximums(numBands*4) {}
+
+    void operator() (unsigned int band, unsigned int beginRow, unsigned int endRow)
+    {
+        T* minimum = &_minimums[band*4];
+        T* maximum = &_maximums[band*4];
+
+        const T* first = reinterpret_cast<const T*>(rowData(_image, beginRow));
+        for(unsigned int c=0; c<_numComponents; ++c)
+        {
+            minimum[c] = maximum[c] = first[c];
+        }
+
+        for(unsigned int row=beginRow; row<endRow; ++row)
+        {
+            rowMinMax(reinterpret_cast<const T*>(rowData(_image, row)), _image->s()*_numComponents, _numComponents, minimum, maximum);
+        }
+    }
+
+    const osg::Image*   _image;
+    unsigned int        _numComponents;
+    std::vector<T>      _minimums;
+    std::vector<T>      _maximums;
+};
+
+/** Compute the range of the image's components in their own type, only casting the results to floats as FindRangeOperator would.*/
+template<typename T>
+void computeComponentMinMax(const osg::Image* image, osg::Vec4& minValue, osg::Vec4& maxValue)
+{
+    unsigned int numRows = image->t()*image->r();
+    unsigned int numBands = computeNumRowBands(numRows, static_cast<unsigned long long>(image->getRowSizeInBytes())*numRows);
+
+    MinMaxRows<T> minMaxRows(image, numBands);
+    processRowBands(numRows, numBands, minMaxRows);
+
+    osg::CastAndScaleToFloatOperation operation;
+    float mins[4], maxs[4];
+    for(unsigned int c=0; c<minMaxRows._numComponents; ++c)
+    {
+        T minimum = minMaxRows._minimums[c];
+        T maximum = minMaxRows._maximums[c];
+        for(unsigned int band=1; band<numBands; ++band)
+        {
+            minimum = osg::minimum(minMaxRows._minimums[band*4+c], minimum);
+            maximum = osg::maximum(minMaxRows._maximums[band*4+c], maximum);
+        }
+        mins[c] = operation.cast(minimum);
+        maxs[c] = operation.cast(maximum);
+    }
+
+    switch(image->getPixelFormat())
+    {
+        case(GL_INTENSITY):
+        case(GL_LUMINANCE):         minValue.set(mins[0], mins[0], mins[0], mins[0]); maxValue.set(maxs[0], maxs[0], maxs[0], maxs[0]); break;
+        case(GL_ALPHA):             minValue.set(1.0f, 1.0f, 1.0f, mins[0]); maxValue.set(1.0f, 1.0f, 1.0f, maxs[0]); break;
+        case(GL_LUMINANCE_ALPHA):   minValue.set(mins[0], mins[0], mins[0], mins[1]); maxValue.set(maxs[0], maxs[0], maxs[0], maxs[1]); break;
+        case(GL_RGB):               minValue.set(mins[0], mins[1], mins[2], 1.0f); maxValue.set(maxs[0], maxs[1], maxs[2], 1.0f); break;
+        case(GL_RGBA):              minValue.set(mins[0], mins[1], mins[2], mins[3]); maxValue.set(maxs[0], maxs[1], maxs[2], maxs[3]); break;
+        case(GL_BGR):               minValue.set(mins[2], mins[1], mins[0], 1.0f); maxValue.set(maxs[2], maxs[1], maxs[0], 1.0f); break;
+        case(GL_BGRA):              minValue.set(mins[2], mins[1], mins[0], mins[3]); maxValue.set(maxs[2], maxs[1], maxs[0], maxs[3]); break;
+    }
+}
+
+/** Convert a float to the component type T, integer values out of the range of T saturating rather than being undefined.*/
+template<typename T>
+inline T saturateComponent(float v)
+{
+    const float minValue = static_cast<float>(std::numeric_limits<T>::min());
+    const float maxValue = static_cast<float>(std::numeric_limits<T>::max());
+    return v>minValue ? (v<maxValue ? T(v) : std::numeric_limits<T>::max()) : std::numeric_limits<T>::min();
+}
+
+template<>
+inline float saturateComponent<float>(float v) { return v; }
+
+/** Applies offsetAndScaleImage()'s offset and scale to each component of the rows of an image, computing exactly what
+  * OffsetAndScaleOperator does through modifyRow(): x = T((offset + (float(x)*scale)*componentScale)*(1/scale)), except
+  * that integer results out of the range of T saturate, in the SSE2 lanes and the scalar code alike.*/
+struct OffsetAndScaleRows
+{
+    OffsetAndScaleRows(osg::Image* image, const osg::Vec4& offset, const osg::Vec4& scale):
+        _image(image),
+        _numComponents(osg::Image::computeNumComponents(image->getPixelFormat())),
+        _scale(1.0f)
+    {
+        // the offset and scale of each component in the order they are held in memory.
+        switch(image->getPixelFormat())
+        {
+            case(GL_LUMINANCE):         setComponents(offset.r(), scale.r()); break;
+            case(GL_ALPHA):             setComponents(offset.a(), scale.a()); break;
+            case(GL_LUMINANCE_ALPHA):   setComponents(offset.r(), scale.r(), offset.a(), scale.a()); break;
+            case(GL_RGB):
+            case(GL_RGBA):              setComponents(offset.r(), scale.r(), offset.g(), scale.g(), offset.b(), scale.b(), offset.a(), scale.a()); break;
+            case(GL_BGR):
+            case(GL_BGRA):              setComponents(offset.b(), scale.b(), offset.g(), scale.g(), offset.r(), scale.r(), offset.a(), scale.a()); break;
+        }
+
+        switch(image->getDataType())
+        {
+            case(GL_BYTE):              _scale = 1.0f/128.0f; buildLookUpTable<char>(); break;
+            case(GL_UNSIGNED_BYTE):     _scale = 1.0f/255.0f; buildLookUpTable<unsigned char>(); break;
+            case(GL_UNSIGNED_SHORT):    _scale = 1.0f/65535.0f; break;
+        }
+        _inverseScale = 1.0f/_scale;
+    }
+
+    static bool supported(const osg::Image* image)
+    {
+        switch(image->getPixelFormat())
+        {
+            case(GL_LUMINANCE):
+            case(GL_ALPHA):
+            case(GL_LUMINANCE_ALPHA):
+            case(GL_RGB):
+            case(GL_RGBA):
+            case(GL_BGR):
+            case(GL_BGRA): break;
+            default: return false;
+        }
+
+        switch(image->getDataType())
+        {
+            case(GL_BYTE):
+            case(GL_UNSIGNED_BYTE):
+            case(GL_UNSIGNED_SHORT):
+            case(GL_FLOAT): return true;
+            default: return false;
+        }
+    }
+
+    void setComponents(float o0, float s0, float o1=0.0f, float s1=1.0f, float o2=0.0f, float s2=1.0f, float o3=0.0f, float s3=1.0f)
+    {
+        _offsets[0] = o0; _offsets[1] = o1; _offsets[2] = o2; _offsets[3] = o3;
+        _scales[0] = s0; _scales[1] = s1; _scales[2] = s2; _scales[3] = s3;
+    }
+
+    // 8 bit components have few enough values to compute them all up front, indexed by their bit pattern.
+    template<typename T>
+    void buildLookUpTable()
+    {
+        float inverseScale = 1.0f/_scale;
+        _lookUpTable.resize(256*_numComponents);
+        for(unsigned int c=0; c<_numComponents; ++c)
+        {
+            for(unsigned int i=0; i<256; ++i)
+            {
+                T x = static_cast<T>(i);
+                float l = float(x)*_scale;
+                l = _offsets[c] + l*_scales[c];
+                x = saturateComponent<T>(l*inverseScale);
+                _lookUpTable[c*256+i] = static_cast<unsigned char>(x);
+            }
+        }
+    }
+
+    // the members are copied to locals as writes through data could otherwise alias them.
+    template<typename T>
+    void modifyRow(T* data, unsigned int numValues) const
+    {
+        const unsigned int numComponents = _numComponents;
+        const float scale = _scale;
+        const float inverseScale = _inverseScale;
+        for(unsigned int i=0; i<numValues; i+=numComponents)
+        {
+            for(unsigned int c=0; c<numComponents; ++c)
+            {
+                float l = float(data[i+c])*scale;
+                l = _offsets[c] + l*_scales[c];
+                data[i+c] = saturateComponent<T>(l*inverseScale);
+            }
+        }
+    }
+
+    void modifyRow(unsigned char* data, unsigned int numValues) const
+    {
+        const unsigned char* table = &_lookUpTable.front();
+        const unsigned int numComponents = _numComponents;
+        if (numComponents==4)
+        {
+            for(unsigned int i=0; i<numValues; i+=4)
+            {
+                unsigned char r = table[data[i]], g = table[256+data[i+1]], b = table[512+data[i+2]], a = table[768+data[i+3]];
+                data[i] = r; data[i+1] = g; data[i+2] = b; data[i+3] = a;
+            }
+            return;
+        }
+
+        for(unsigned int i=0; i<numValues; i+=numComponents)
+        {
+            for(unsigned int c=0; c<numComponents; ++c)
+            {
+                data[i+c] = table[c*256+data[i+c]];
+            }
+        }
+    }
+
+#ifdef OSG_IMAGEUTILS_USE_SSE2
+    static inline __m128 load4(const unsigned short* data) { return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(data)), _mm_setzero_si128())); }
+    static inline __m128 load4(const float* data) { return _mm_loadu_ps(data); }
+
+    static inline void store4(unsigned short* data, __m128 v)
+    {
+        // no unsigned 32 to 16 bit pack in SSE2, so shift into the signed range and back.
+        __m128i x = _mm_sub_epi32(_mm_cvttps_epi32(v), _mm_set1_epi32(32768));
+        x = _mm_xor_si128(_mm_packs_epi32(x, x), _mm_set1_epi16(static_cast<short>(0x8000)));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(data), x);
+    }
+    static inline void store4(float* data, __m128 v) { _mm_storeu_ps(data, v); }
+
+    template<typename T>
+    void modifyRowSSE2(T* data, unsigned int numValues) const
+    {
+        // the components cycle through the lanes of numComponents vectors of 4 values, 3 for RGB, otherwise 1.
+        const unsigned int numVectors = (_numComponents==3) ? 3 : 1;
+        const unsigned int chunk = 4*numVectors;
+
+        __m128 offsets[3], scales[3];
+        for(unsigned int v=0; v<numVectors; ++v)
+        {
+            offsets[v] = _mm_setr_ps(_offsets[(4*v)%_numComponents], _offsets[(4*v+1)%_numComponents], _offsets[(4*v+2)%_numComponents], _offsets[(4*v+3)%_numComponents]);
+            scales[v] = _mm_setr_ps(_scales[(4*v)%_numComponents], _scales[(4*v+1)%_numComponents], _scales[(4*v+2)%_numComponents], _scales[(4*v+3)%_numComponents]);
+        }
+
+        const __m128 scale = _mm_set1_ps(_scale);
+        const __m128 inverseScale = _mm_set1_ps(_inverseScale);
+
+        unsigned int i = 0;
+        for(; i+chunk<=numValues; i+=chunk)
+        {
+            for(unsigned int v=0; v<numVectors; ++v)
+            {
+                __m128 l = _mm_mul_ps(load4(data+i+4*v), scale);
+                l = _mm_add_ps(offsets[v], _mm_mul_ps(l, scales[v]));
+                store4(data+i+4*v, _mm_mul_ps(l, inverseScale));
+            }
+        }
+
+        modifyRow<T>(data+i, numValues-i);
+    }
+
+    void modifyRow(unsigned short* data, unsigned int numValues) const { modifyRowSSE2(data, numValues); }
+    void modifyRow(float* data, unsigned int numValues) const { modifyRowSSE2(data, numValues); }
+#endif
+
+    void operator() (unsigned int, unsigned int beginRow, unsigned int endRow)
+    {
+        unsigned int numValues = _image->s()*_numComponents;
+        for(unsigned int row=beginRow; row<endRow; ++row)
+        {
+            unsigned char* data = rowData(_image, row);
+            switch(_image->getDataType())
+            {
+                case(GL_BYTE):              modifyRow(data, numValues); break;
+                case(GL_UNSIGNED_BYTE):     modifyRow(data, numValues); break;
+                case(GL_UNSIGNED_SHORT):    modifyRow(reinterpret_cast<unsigned short*>(data), numValues); break;
+                case(GL_FLOAT):             modifyRow(reinterpret_cast<float*>(data), numValues); break;
+            }
+        }
+    }
+
+    osg::Image*                 _image;
+    unsigned int                _numComponents;
+    float                       _scale;
+    float                       _inverseScale;
+    float                       _offsets[4];
+    float                       _scales[4];
+    std::vector<unsigned char>  _lookUpTable;
+};
+
+/** Applies a modifyImage() operator to the rows of an image a band at a time, through the same modifyRow() so that the results
+  * are unchanged, for operators whose work is too little per pixel to gain from a specialised kernel of their own.*/
+template<class M>
+struct ModifyRows
+{
+    ModifyRows(osg::Image* image, const M& operation):
+        _image(image),
+        _operation(operation) {}
+
+    void operator() (unsigned int, unsigned int beginRow, unsigned int endRow)
+    {
+        for(unsigned int row=beginRow; row<endRow; ++row)
+        {
+            modifyRow(_image->s(), _image->getPixelFormat(), _image->getDataType(), rowData(_image, row), _operation);
+        }
+    }
+
+    osg::Image* _image;
+    const M&    _operation;
+
+protected:
+
+    ModifyRows& operator = (const ModifyRows&) { return *this; }
+};
+
+template<class M>
+void modifyImageRows(osg::Image* image, const M& operation)
+{
+    unsigned int numRows = image->t()*image->r();
+    ModifyRows<M> modifyRows(image, operation);
+    processRowBands(numRows, computeNumRowBands(numRows, static_cast<unsigned long long>(image->getRowSizeInBytes())*numRows), modifyRows);
+}
+
+}
+
 bool computeMinMax(const osg::Image* image, osg::Vec4& minValue, osg::Vec4& maxValue)
 {
     if (!image) return false;
 
+    if (image->s()>0 && image->t()>0 && image->r()>0 && isReadableRowFormat(image->getPixelFormat()))
+    {
+        switch(image->getDataType())
+        {
+            case(GL_BYTE):              computeComponentMinMax<char>(image, minValue, maxValue); break;
+            case(GL_UNSIGNED_BYTE):     computeComponentMinMax<unsigned char>(image, minValue, maxValue); break;
+            case(GL_SHORT):             computeComponentMinMax<short>(image, minValue, maxValue); break;
+            case(GL_UNSIGNED_SHORT):    computeComponentMinMax<unsigned short>(image, minValue, maxValue); break;
+            case(GL_INT):               computeComponentMinMax<int>(image, minValue, maxValue); break;
+            case(GL_UNSIGNED_INT):      computeComponentMinMax<unsigned int>(image, minValue, maxValue); break;
+            case(GL_FLOAT):             computeComponentMinMax<float>(image, minValue, maxValue); break;
+            case(GL_DOUBLE):            computeComponentMinMax<double>(image, minValue, maxValue); break;
+            default: return false;
+        }
+
+        return minValue.r()<=maxValue.r() &&
+               minValue.g()<=maxValue.g() &&
+               minValue.b()<=maxValue.b() &&
+               minValue.a()<=maxValue.a();
+    }
+
     osg::FindRangeOperator rangeOp;
     readImage(image, rangeOp);
     minValue.r() = rangeOp._rmin;
@@ -115,6 +687,14 @@ bool offsetAndScaleImage(osg::Image* image, const osg::Vec4& offset, const osg::
 {
     if (!image) return false;
 
+    if (OffsetAndScaleRows::supported(image))
+    {
+        unsigned int numRows = image->t()*image->r();
+        OffsetAndScaleRows offsetAndScaleRows(image, offset, scale);
+        processRowBands(numRows, computeNumRowBands(numRows, static_cast<unsigned long long>(image->getRowSizeInBytes())*numRows), offsetAndScaleRows);
+        return true;
+    }
+
     modifyImage(image,OffsetAndScaleOperator(offset, scale));
 
     return true;
@@ -141,6 +721,60 @@ void _copyRowAndScale(const SRC* src, DEST* dest, int num, float scale)
     }
 }
 
+#ifdef OSG_IMAGEUTILS_USE_SSE2
+inline __m128 _load4(const unsigned char* src)
+{
+    int bytes;
+    memcpy(&bytes, src, 4);
+    __m128i x = _mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), _mm_setzero_si128());
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(x, _mm_setzero_si128()));
+}
+
+inline __m128 _load4(const unsigned short* src) { return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src)), _mm_setzero_si128())); }
+
+inline __m128 _load4(const float* src) { return _mm_loadu_ps(src); }
+
+inline void _store4(unsigned char* dest, __m128 v)
+{
+    __m128i x = _mm_cvttps_epi32(v);
+    x = _mm_packus_epi16(_mm_packs_epi32(x, x), x);
+    int bytes = _mm_cvtsi128_si32(x);
+    memcpy(dest, &bytes, 4);
+}
+
+inline void _store4(unsigned short* dest, __m128 v)
+{
+    // no unsigned 32 to 16 bit pack in SSE2, so shift into the signed range and back.
+    __m128i x = _mm_sub_epi32(_mm_cvttps_epi32(v), _mm_set1_epi32(32768));
+    x = _mm_xor_si128(_mm_packs_epi32(x, x), _mm_set1_epi16(static_cast<short>(0x8000)));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dest), x);
+}
+
+inline void _store4(float* dest, __m128 v) { _mm_storeu_ps(dest, v); }
+
+// multiplying by a scale of 1.0 is exact, so a single loop gives the same results as both the loops above.
+template<typename SRC, typename DEST>
+void _copyRowAndScaleSSE2(const SRC* src, DEST* dest, int num, float scale)
+{
+    const __m128 s = _mm_set1_ps(scale);
+    int i = 0;
+    for(; i+4<=num; i+=4)
+    {
+        _store4(dest+i, _mm_mul_ps(_load4(src+i), s));
+    }
+    for(; i<num; ++i)
+    {
+        dest[i] = DEST(float(src[i])*scale);
+    }
+}
+
+template<> void _copyRowAndScale<unsigned char, float>(const unsigned char* src, float* dest, int num, float scale) { _copyRowAndScaleSSE2(src, dest, num, scale); }
+template<> void _copyRowAndScale<unsigned short, float>(const unsigned short* src, float* dest, int num, float scale) { _copyRowAndScaleSSE2(src, dest, num, scale); }
+template<> void _copyRowAndScale<float, unsigned char>(const float* src, unsigned char* dest, int num, float scale) { _copyRowAndScaleSSE2(src, dest, num, scale); }
+template<> void _copyRowAndScale<float, unsigned short>(const float* src, unsigned short* dest, int num, float scale) { _copyRowAndScaleSSE2(src, dest, num, scale); }
+template<> void _copyRowAndScale<unsigned char, unsigned short>(const unsigned char* src, unsigned short* dest, int num, float scale) { _copyRowAndScaleSSE2(src, dest, num, scale); }
+#endif
+
 template<typename DEST>
 void _copyRowAndScale(const unsigned char* src, GLenum srcDataType, DEST* dest, int num, float scale)
 {
@@ -195,10 +829,163 @@ struct WriteRowOperator
     inline void luminance(float& l) const { l = _colours[_pos++].r(); }
     inline void alpha(float& a) const { a = _colours[_pos++].a(); }
     inline void luminance_alpha(float& l,float& a) const { l = _colours[_pos].r(); a = _colours[_pos++].a(); }
-    inline void rgb(float& r,float& g,float& b) const { r = _colours[_pos].r(); g = _colours[_pos].g(); b = _colours[_pos].b(); }
+    inline void rgb(float& r,float& g,float& b) const { r = _colours[_pos].r(); g = _colours[_pos].g(); b = _colours[_pos++].b(); }
     inline void rgba(float& r,float& g,float& b,float& a) const {  r = _colours[_pos].r(); g = _colours[_pos].g(); b = _colours[_pos].b(); a = _colours[_pos++].a(); }
 };
 
+namespace
+{
+
+template<typename T> inline T channelMaximum() { return T(~0); }
+template<> inline float channelMaximum<float>() { return 1.0f; }
+
+/** Copy a row of num pixels between pixel formats of the same data type, each destination component being the source
+  * component given by C0 to C3, or the maximum of the data type where -1, as the alpha of 1.0 copyImage() writes.*/
+template<typename T, unsigned int SRC_COMPONENTS, unsigned int DEST_COMPONENTS, int C0, int C1, int C2, int C3>
+void swizzleRow(const unsigned char* srcData, unsigned char* destData, unsigned int num)
+{
+    const T* src = reinterpret_cast<const T*>(srcData);
+    T* dest = reinterpret_cast<T*>(destData);
+    const T one = channelMaximum<T>();
+    for(unsigned int i=0; i<num; ++i, src+=SRC_COMPONENTS, dest+=DEST_COMPONENTS)
+    {
+        dest[0] = (C0<0) ? one : src[C0<0 ? 0 : C0];
+        if (DEST_COMPONENTS>1) dest[1] = (C1<0) ? one : src[C1<0 ? 0 : C1];
+        if (DEST_COMPONENTS>2) dest[2] = (C2<0) ? one : src[C2<0 ? 0 : C2];
+        if (DEST_COMPONENTS>3) dest[3] = (C3<0) ? one : src[C3<0 ? 0 : C3];
+    }
+}
+
+#ifdef OSG_IMAGEUTILS_USE_SSE2
+// swap the red and blue bytes of RGBA<->BGRA 4 pixels at a time, the byte order of each 32 bit pixel being fixed by the format.
+void swapRedBlueRowUByte(const unsigned char* src, unsigned char* dest, unsigned int num)
+{
+    const __m128i greenAlpha = _mm_set1_epi32(static_cast<int>(0xff00ff00));
+    const __m128i lowByte = _mm_set1_epi32(0xff);
+    unsigned int i = 0;
+    for(; i+4<=num; i+=4)
+    {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src+i*4));
+        __m128i redBlue = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(x, 16), lowByte), _mm_slli_epi32(_mm_and_si128(x, lowByte), 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest+i*4), _mm_or_si128(_mm_and_si128(x, greenAlpha), redBlue));
+    }
+    swizzleRow<unsigned char,4,4,2,1,0,3>(src+i*4, dest+i*4, num-i);
+}
+#endif
+
+typedef void (*ConvertRowFunction)(const unsigned char* src, unsigned char* dest, unsigned int num);
+
+struct ConvertRowKernel
+{
+    GLenum              srcPixelFormat;
+    GLenum              destPixelFormat;
+    GLenum              dataType;
+    ConvertRowFunction  function;
+};
+
+#define OSG_CONVERT_ROW_KERNELS(DATA_TYPE, T) \
+    { GL_RGB,   GL_RGBA,  DATA_TYPE, &swizzleRow<T,3,4,0,1,2,-1> }, \
+    { GL_RGB,   GL_BGRA,  DATA_TYPE, &swizzleRow<T,3,4,2,1,0,-1> }, \
+    { GL_RGB,   GL_BGR,   DATA_TYPE, &swizzleRow<T,3,3,2,1,0,0> }, \
+    { GL_RGB,   GL_LUMINANCE, DATA_TYPE, &swizzleRow<T,3,1,0,0,0,0> }, \
+    { GL_BGR,   GL_RGBA,  DATA_TYPE, &swizzleRow<T,3,4,2,1,0,-1> }, \
+    { GL_BGR,   GL_BGRA,  DATA_TYPE, &swizzleRow<T,3,4,0,1,2,-1> }, \
+    { GL_BGR,   GL_RGB,   DATA_TYPE, &swizzleRow<T,3,3,2,1,0,0> }, \
+    { GL_BGR,   GL_LUMINANCE, DATA_TYPE, &swizzleRow<T,3,1,2,0,0,0> }, \
+    { GL_RGBA,  GL_RGB,   DATA_TYPE, &swizzleRow<T,4,3,0,1,2,0> }, \
+    { GL_RGBA,  GL_BGR,   DATA_TYPE, &swizzleRow<T,4,3,2,1,0,0> }, \
+    { GL_RGBA,  GL_LUMINANCE, DATA_TYPE, &swizzleRow<T,4,1,0,0,0,0> }, \
+    { GL_RGBA,  GL_LUMINANCE_ALPHA, DATA_TYPE, &swizzleRow<T,4,2,0,3,0,0> }, \
+    { GL_BGRA,  GL_RGB,   DATA_TYPE, &swizzleRow<T,4,3,2,1,0,0> }, \
+    { GL_BGRA,  GL_BGR,   DATA_TYPE, &swizzleRow<T,4,3,0,1,2,0> }, \
+    { GL_BGRA,  GL_LUMINANCE, DATA_TYPE, &swizzleRow<T,4,1,2,0,0,0> }, \
+    { GL_LUMINANCE, GL_RGB,  DATA_TYPE, &swizzleRow<T,1,3,0,0,0,0> }, \
+    { GL_LUMINANCE, GL_BGR,  DATA_TYPE, &swizzleRow<T,1,3,0,0,0,0> }, \
+    { GL_LUMINANCE, GL_RGBA, DATA_TYPE, &swizzleRow<T,1,4,0,0,0,-1> }, \
+    { GL_LUMINANCE, GL_BGRA, DATA_TYPE, &swizzleRow<T,1,4,0,0,0,-1> }, \
+    { GL_LUMINANCE_ALPHA, GL_RGBA, DATA_TYPE, &swizzleRow<T,2,4,0,0,0,1> }, \
+    { GL_LUMINANCE_ALPHA, GL_BGRA, DATA_TYPE, &swizzleRow<T,2,4,0,0,0,1> }
+
+// the kernels for converting rows between pixel formats, copyImage() falling back to converting through osg::Vec4 for the rest.
+const ConvertRowKernel s_convertRowKernels[] =
+{
+#ifdef OSG_IMAGEUTILS_USE_SSE2
+    { GL_RGBA,  GL_BGRA,  GL_UNSIGNED_BYTE, &swapRedBlueRowUByte },
+    { GL_BGRA,  GL_RGBA,  GL_UNSIGNED_BYTE, &swapRedBlueRowUByte },
+#else
+    { GL_RGBA,  GL_BGRA,  GL_UNSIGNED_BYTE, &swizzleRow<unsigned char,4,4,2,1,0,3> },
+    { GL_BGRA,  GL_RGBA,  GL_UNSIGNED_BYTE, &swizzleRow<unsigned char,4,4,2,1,0,3> },
+#endif
+    { GL_RGBA,  GL_BGRA,  GL_UNSIGNED_SHORT, &swizzleRow<unsigned short,4,4,2,1,0,3> },
+    { GL_BGRA,  GL_RGBA,  GL_UNSIGNED_SHORT, &swizzleRow<unsigned short,4,4,2,1,0,3> },
+    { GL_RGBA,  GL_BGRA,  GL_FLOAT, &swizzleRow<float,4,4,2,1,0,3> },
+    { GL_BGRA,  GL_RGBA,  GL_FLOAT, &swizzleRow<float,4,4,2,1,0,3> },
+    OSG_CONVERT_ROW_KERNELS(GL_UNSIGNED_BYTE, unsigned char),
+    OSG_CONVERT_ROW_KERNELS(GL_UNSIGNED_SHORT, unsigned short),
+    OSG_CONVERT_ROW_KERNELS(GL_FLOAT, float)
+};
+
+#undef OSG_CONVERT_ROW_KERNELS
+
+ConvertRowFunction findConvertRowFunction(GLenum srcPixelFormat, GLenum destPixelFormat, GLenum dataType)
+{
+    for(unsigned int i=0; i<sizeof(s_convertRowKernels)/sizeof(ConvertRowKernel); ++i)
+    {
+        const ConvertRowKernel& kernel = s_convertRowKernels[i];
+        if (kernel.srcPixelFormat==srcPixelFormat && kernel.destPixelFormat==destPixelFormat && kernel.dataType==dataType) return kernel.function;
+    }
+    return 0;
+}
+
+/** Copies the rows of a region of an image, numbered through the slices, by one of the three ways copyImage() has of copying them.*/
+struct CopyRows
+{
+    enum Mode
+    {
+        COPY_BYTES,
+        COPY_AND_SCALE,
+        CONVERT
+    };
+
+    CopyRows(Mode mode, const osg::Image* srcImage, int src_s, int src_t, int src_r, int width, int height,
+             osg::Image* destImage, int dest_s, int dest_t, int dest_r):
+        _mode(mode),
+        _srcImage(srcImage), _src_s(src_s), _src_t(src_t), _src_r(src_r),
+        _width(width), _height(height),
+        _destImage(destImage), _dest_s(dest_s), _dest_t(dest_t), _dest_r(dest_r),
+        _scale(1.0f),
+        _convertRow(0) {}
+
+    void operator() (unsigned int, unsigned int beginRow, unsigned int endRow)
+    {
+        unsigned int numComponents = osg::Image::computeNumComponents(_destImage->getPixelFormat());
+        for(unsigned int i=beginRow; i<endRow; ++i)
+        {
+            int slice = i/_height;
+            int row = i%_height;
+            const unsigned char* srcData = _srcImage->data(_src_s, _src_t+row, _src_r+slice);
+            unsigned char* destData = _destImage->data(_dest_s, _dest_t+row, _dest_r+slice);
+            switch(_mode)
+            {
+                case(COPY_BYTES):       memcpy(destData, srcData, (_width*_destImage->getPixelSizeInBits())/8); break;
+                case(COPY_AND_SCALE):   osg::_copyRowAndScale(srcData, _srcImage->getDataType(), destData, _destImage->getDataType(), (_width*numComponents), _scale); break;
+                case(CONVERT):          _convertRow(srcData, destData, _width); break;
+            }
+        }
+    }
+
+    Mode                _mode;
+    const osg::Image*   _srcImage;
+    int                 _src_s, _src_t, _src_r;
+    int                 _width, _height;
+    osg::Image*         _destImage;
+    int                 _dest_s, _dest_t, _dest_r;
+    float               _scale;
+    ConvertRowFunction  _convertRow;
+};
+
+}
+
 bool copyImage(const osg::Image* srcImage, int src_s, int src_t, int src_r, int width, int height, int depth,
                osg::Image* destImage, int dest_s, int dest_t, int dest_r, bool doRescale)
 {
@@ -256,43 +1043,35 @@ bool copyImage(const osg::Image* srcImage, int src_s, int src_t, int src_r, int
         //OSG_NOTICE<<"copyImage("<<srcImage<<", "<<src_s<<", "<< src_t<<", "<<src_r<<", "<<width<<", "<<height<<", "<<depth<<std::endl;
         //OSG_NOTICE<<"          "<<destImage<<", "<<dest_s<<", "<< dest_t<<", "<<dest_r<<", "<<doRescale<<")"<<std::endl;
 
-        if (srcImage->getDataType() == destImage->getDataType() && !doRescale)
-        {
-            //OSG_NOTICE<<"   Compatible pixelFormat and dataType."<<std::endl;
-            for(int slice = 0; slice<depth; ++slice)
-            {
-                for(int row = 0; row<height; ++row)
-                {
-                    const unsigned char* srcData = srcImage->data(src_s, src_t+row, src_r+slice);
-                    unsigned char* destData = destImage->data(dest_s, dest_t+row, dest_r+slice);
-                    memcpy(destData, srcData, (width*destImage->getPixelSizeInBits())/8);
-                }
-            }
-            return true;
-        }
-        else
-        {
-            //OSG_NOTICE<<"   Compatible pixelFormat and incompatible dataType."<<std::endl;
-            for(int slice = 0; slice<depth; ++slice)
-            {
-                for(int row = 0; row<height; ++row)
-                {
-                    const unsigned char* srcData = srcImage->data(src_s, src_t+row, src_r+slice);
-                    unsigned char* destData = destImage->data(dest_s, dest_t+row, dest_r+slice);
-                    unsigned int numComponents = osg::Image::computeNumComponents(destImage->getPixelFormat());
+        CopyRows::Mode mode = (srcImage->getDataType() == destImage->getDataType() && !doRescale) ? CopyRows::COPY_BYTES : CopyRows::COPY_AND_SCALE;
+        CopyRows copyRows(mode, srcImage, src_s, src_t, src_r, width, height, destImage, dest_s, dest_t, dest_r);
+        copyRows._scale = scale;
 
-                    _copyRowAndScale(srcData, srcImage->getDataType(), destData, destImage->getDataType(), (width*numComponents), scale);
-                }
-            }
+        unsigned int numRows = height*depth;
+        unsigned long long numBytes = static_cast<unsigned long long>(osg::Image::computeRowWidthInBytes(width, destImage->getPixelFormat(), destImage->getDataType(), 1))*numRows;
+        processRowBands(numRows, computeNumRowBands(numRows, numBytes), copyRows);
 
-            return true;
-        }
+        return true;
     }
     else
     {
         //OSG_NOTICE<<"copyImage("<<srcImage<<", "<<src_s<<", "<< src_t<<", "<<src_r<<", "<<width<<", "<<height<<", "<<depth<<std::endl;
         //OSG_NOTICE<<"          "<<destImage<<", "<<dest_s<<", "<< dest_t<<", "<<dest_r<<", "<<doRescale<<")"<<std::endl;
 
+        ConvertRowFunction convertRow = (srcImage->getDataType() == destImage->getDataType()) ?
+            findConvertRowFunction(srcImage->getPixelFormat(), destImage->getPixelFormat(), srcImage->getDataType()) : 0;
+        if (convertRow)
+        {
+            CopyRows copyRows(CopyRows::CONVERT, srcImage, src_s, src_t, src_r, width, height, destImage, dest_s, dest_t, dest_r);
+            copyRows._convertRow = convertRow;
+
+            unsigned int numRows = height*depth;
+            unsigned long long numBytes = static_cast<unsigned long long>(osg::Image::computeRowWidthInBytes(width, destImage->getPixelFormat(), destImage->getDataType(), 1))*numRows;
+            processRowBands(numRows, computeNumRowBands(numRows, numBytes), copyRows);
+
+            return true;
+        }
+
         RecordRowOperator readOp(width);
         WriteRowOperator writeOp;
 
@@ -675,19 +1454,19 @@ osg::Image* colorSpaceConversion(ColorSpaceOperation op, osg::Image* image, cons
         case (MODULATE_ALPHA_BY_LUMINANCE):
         {
             OSG_NOTICE<<"doing conversion MODULATE_ALPHA_BY_LUMINANCE"<<std::endl;
-            osg::modifyImage(image, ModulateAlphaByLuminanceOperator());
+            modifyImageRows(image, ModulateAlphaByLuminanceOperator());
             return image;
         }
         case (MODULATE_ALPHA_BY_COLOR):
         {
             OSG_NOTICE<<"doing conversion MODULATE_ALPHA_BY_COLOUR"<<std::endl;
-            osg::modifyImage(image, ModulateAlphaByColorOperator(colour));
+            modifyImageRows(image, ModulateAlphaByColorOperator(colour));
             return image;
         }
         case (REPLACE_ALPHA_WITH_LUMINANCE):
         {
             OSG_NOTICE<<"doing conversion REPLACE_ALPHA_WITH_LUMINANCE"<<std::endl;
-            osg::modifyImage(image, ReplaceAlphaWithLuminanceOperator());
+            modifyImageRows(image, ReplaceAlphaWithLuminanceOperator());
             return image;
         }
         case (REPLACE_RGB_WITH_LUMINANCE):
@@ -753,5 +1532,427 @@ OSG_EXPORT osg::Image* createImageWithOrientationConversion(const osg::Image* sr
     return dstImage.release();
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// CPU mipmap generation
+//
+namespace
+{
+
+// levels with fewer pixels per thread than this aren't worth the cost of starting threads for.
+const unsigned int MIPMAP_MIN_PIXELS_PER_THREAD = 128*128;
+
+double sRGBToLinear(double c)
+{
+    return c<=0.04045 ? c/12.92 : pow((c+0.055)/1.055, 2.4);
+}
+
+struct MipmapConversionTables
+{
+    MipmapConversionTables()
+    {
+        for(unsigned int i=0; i<256; ++i)
+        {
+            unitFromByte[i] = static_cast<float>(i)/255.0f;
+            linearFromSRGB[i] = static_cast<float>(sRGBToLinear(static_cast<double>(i)/255.0));
+        }
+
+        for(unsigned int i=0; i<255; ++i)
+        {
+            linearBetweenSRGB[i] = static_cast<float>(sRGBToLinear((static_cast<double>(i)+0.5)/255.0));
+        }
+
+        unsigned int code = 0;
+        for(unsigned int i=0; i<4096; ++i)
+        {
+            while(code<255 && static_cast<float>(i)/4096.0f>=linearBetweenSRGB[code]) ++code;
+            sRGBAtLeast[i] = static_cast<unsigned char>(code);
+        }
+    }
+
+    /** Return the sRGB byte nearest a linear value, looking up the sRGB byte at the start of the linear value's 1/4096th
+      * then stepping up past the linear values halfway between the sRGB bytes that are still below it.*/
+    unsigned char sRGBFromLinear(float v) const
+    {
+        if (!(v>0.0f)) return 0;
+        if (v>=1.0f) return 255;
+
+        unsigned int code = sRGBAtLeast[static_cast<unsigned int>(v*4096.0f)];
+        while(code<255 && v>=linearBetweenSRGB[code]) ++code;
+        return static_cast<unsigned char>(code);
+    }
+
+    float unitFromByte[256];
+    float linearFromSRGB[256];
+    float linearBetweenSRGB[255];
+    unsigned char sRGBAtLeast[4096];
+};
+
+const MipmapConversionTables s_mipmapConversionTables;
+
+double sinc(double x)
+{
+    if (fabs(x)<1e-6) return 1.0;
+    x *= osg::PI;
+    return sin(x)/x;
+}
+
+// zeroth order modified Bessel function of the first kind, used by the Kaiser window.
+double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for(unsigned int k=1; k<64 && term>sum*1e-12; ++k)
+    {
+        double f = x/(2.0*static_cast<double>(k));
+        term *= f*f;
+        sum += term;
+    }
+    return sum;
+}
+
+struct MipmapKernel
+{
+    MipmapKernel(MipmapFilter f):
+        filter(f),
+        radius(f==MIPMAP_BOX_FILTER ? 0.5 : 3.0),
+        kaiserAlpha(4.0),
+        kaiserScale(1.0/besselI0(4.0)) {}
+
+    /** Return the weight of a source pixel x pixels from the centre of the destination pixel, in source pixels at unit scale.*/
+    double operator() (double x) const
+    {
+        x = fabs(x);
+        switch(filter)
+        {
+            case(MIPMAP_KAISER_FILTER):
+                return x<radius ? sinc(x)*besselI0(kaiserAlpha*sqrt(1.0-(x*x)/(radius*radius)))*kaiserScale : 0.0;
+            case(MIPMAP_LANCZOS_FILTER):
+                return x<radius ? sinc(x)*sinc(x/radius) : 0.0;
+            default:
+                return x<0.5 ? 1.0 : (x==0.5 ? 0.5 : 0.0);
+        }
+    }
+
+    MipmapFilter    filter;
+    double          radius;
+    double          kaiserAlpha;
+    double          kaiserScale;
+};
+
+/** The source pixels, and their weights, that each destination pixel of a row or column is filtered from,
+  * the taps of destination pixel i being from first[i] to first[i+1].*/
+struct MipmapTaps
+{
+    void build(const MipmapKernel& kernel, unsigned int srcSize, unsigned int dstSize)
+    {
+        double scale = static_cast<double>(srcSize)/static_cast<double>(dstSize);
+        double support = kernel.radius*scale;
+
+        first.resize(dstSize+1);
+        index.clear();
+        weight.clear();
+        maxSpan = 1;
+
+        for(unsigned int i=0; i<dstSize; ++i)
+        {
+            first[i] = static_cast<unsigned int>(index.size());
+
+            double center = (static_cast<double>(i)+0.5)*scale;
+            int begin = static_cast<int>(floor(center-support));
+            int end = static_cast<int>(ceil(center+support));
+
+            double sum = 0.0;
+            for(int j=begin; j<=end; ++j)
+            {
+                double w = kernel((static_cast<double>(j)+0.5-center)/scale);
+                if (w==0.0) continue;
+
+                // clamp to the edge of the image.
+                index.push_back(static_cast<unsigned int>(osg::clampBetween(j, 0, static_cast<int>(srcSize)-1)));
+                weight.push_back(static_cast<float>(w));
+                sum += w;
+            }
+
+            if (sum==0.0)
+            {
+                index.resize(first[i]);
+                weight.resize(first[i]);
+                index.push_back(osg::minimum(static_cast<unsigned int>(center), srcSize-1));
+                weight.push_back(1.0f);
+            }
+            else
+            {
+                for(unsigned int t=first[i]; t<weight.size(); ++t) weight[t] = static_cast<float>(weight[t]/sum);
+            }
+
+            unsigned int span = index.back()-index[first[i]]+1;
+            if (span>maxSpan) maxSpan = span;
+        }
+
+        first[dstSize] = static_cast<unsigned int>(index.size());
+    }
+
+    std::vector<unsigned int>   first;
+    std::vector<unsigned int>   index;
+    std::vector<float>          weight;
+    unsigned int                maxSpan;
+};
+
+struct MipmapFormat
+{
+    unsigned int    numComponents;
+    GLenum          dataType;
+    const float*    unitFromByte[4];
+    bool            encodeSRGB[4];
+};
+
+struct MipmapLevel
+{
+    const unsigned char*    srcData;
+    unsigned int            srcWidth;
+    unsigned int            srcRowStep;
+    unsigned char*          dstData;
+    unsigned int            dstWidth;
+    unsigned int            dstHeight;
+    unsigned int            dstRowStep;
+    MipmapTaps              columns;
+    MipmapTaps              rows;
+};
+
+// rows are filtered as 4 floats per pixel, whatever the number of components, so that a pixel is filtered at a time.
+void readMipmapRow(const MipmapFormat& format, const unsigned char* src, unsigned int width, float* row)
+{
+    const unsigned int numComponents = format.numComponents;
+    if (format.dataType==GL_FLOAT)
+    {
+        const float* data = reinterpret_cast<const float*>(src);
+        for(unsigned int x=0; x<width; ++x, row+=4, data+=numComponents)
+        {
+            for(unsigned int c=0; c<numComponents; ++c) row[c] = data[c];
+        }
+    }
+    else
+    {
+        for(unsigned int x=0; x<width; ++x, row+=4, src+=numComponents)
+        {
+            for(unsigned int c=0; c<numComponents; ++c) row[c] = format.unitFromByte[c][src[c]];
+        }
+    }
+}
+
+void writeMipmapRow(const MipmapFormat& format, const float* row, unsigned int width, unsigned char* dst)
+{
+    const unsigned int numComponents = format.numComponents;
+    if (format.dataType==GL_FLOAT)
+    {
+        float* data = reinterpret_cast<float*>(dst);
+        for(unsigned int x=0; x<width; ++x, row+=4, data+=numComponents)
+        {
+            for(unsigned int c=0; c<numComponents; ++c) data[c] = row[c];
+        }
+    }
+    else
+    {
+        for(unsigned int x=0; x<width; ++x, row+=4, dst+=numComponents)
+        {
+            for(unsigned int c=0; c<numComponents; ++c)
+            {
+                if (format.encodeSRGB[c])
+                {
+                    dst[c] = s_mipmapConversionTables.sRGBFromLinear(row[c]);
+                }
+                else
+                {
+                    float v = row[c]*255.0f+0.5f;
+                    dst[c] = v<=0.0f ? 0 : (v>=255.0f ? 255 : static_cast<unsigned char>(v));
+                }
+            }
+        }
+    }
+}
+
+void filterMipmapRow(const MipmapTaps& columns, const float* src, unsigned int dstWidth, float* dst)
+{
+    const unsigned int* first = &columns.first.front();
+    const unsigned int* index = &columns.index.front();
+    const float* weight = &columns.weight.front();
+
+    for(unsigned int x=0; x<dstWidth; ++x, dst+=4)
+    {
+#ifdef OSG_IMAGEUTILS_USE_SSE2
+        __m128 sum = _mm_setzero_ps();
+        for(unsigned int t=first[x]; t<first[x+1]; ++t)
+        {
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weight[t]), _mm_loadu_ps(src+index[t]*4)));
+        }
+        _mm_storeu_ps(dst, sum);
+#else
+        dst[0] = dst[1] = dst[2] = dst[3] = 0.0f;
+        for(unsigned int t=first[x]; t<first[x+1]; ++t)
+        {
+            const float* pixel = src+index[t]*4;
+            dst[0] += weight[t]*pixel[0];
+            dst[1] += weight[t]*pixel[1];
+            dst[2] += weight[t]*pixel[2];
+            dst[3] += weight[t]*pixel[3];
+        }
+#endif
+    }
 }
 
+void accumulateMipmapRow(float weight, const float* src, unsigned int size, float* dst)
+{
+    unsigned int i = 0;
+#ifdef OSG_IMAGEUTILS_USE_SSE2
+    __m128 w = _mm_set1_ps(weight);
+    for(; i+4<=size; i+=4)
+    {
+        _mm_storeu_ps(dst+i, _mm_add_ps(_mm_loadu_ps(dst+i), _mm_mul_ps(w, _mm_loadu_ps(src+i))));
+    }
+#endif
+    for(; i<size; ++i) dst[i] += weight*src[i];
+}
+
+/** Filter the destination rows from beginRow up to endRow of a level. The source rows are filtered horizontally into a ring
+  * of as many rows as a destination row is filtered from, so that each is only filtered once.*/
+void filterMipmapRows(const MipmapFormat& format, const MipmapLevel& level, unsigned int beginRow, unsigned int endRow)
+{
+    const unsigned int rowSize = level.dstWidth*4;
+    const unsigned int ringSize = level.rows.maxSpan;
+
+    std::vector<float> srcRow(level.srcWidth*4, 0.0f);
+    std::vector<float> ring(ringSize*rowSize);
+    std::vector<unsigned int> ringRows(ringSize, ~0u);
+    std::vector<float> dstRow(rowSize);
+
+    for(unsigned int y=beginRow; y<endRow; ++y)
+    {
+        std::fill(dstRow.begin(), dstRow.end(), 0.0f);
+
+        for(unsigned int t=level.rows.first[y]; t<level.rows.first[y+1]; ++t)
+        {
+            unsigned int sy = level.rows.index[t];
+            unsigned int slot = sy%ringSize;
+            float* filteredRow = &ring[slot*rowSize];
+            if (ringRows[slot]!=sy)
+            {
+                readMipmapRow(format, level.srcData+sy*level.srcRowStep, level.srcWidth, &srcRow.front());
+                filterMipmapRow(level.columns, &srcRow.front(), level.dstWidth, filteredRow);
+                ringRows[slot] = sy;
+            }
+
+            accumulateMipmapRow(level.rows.weight[t], filteredRow, rowSize, &dstRow.front());
+        }
+
+        writeMipmapRow(format, &dstRow.front(), level.dstWidth, level.dstData+y*level.dstRowStep);
+    }
+}
+
+/** Filters the rows of a level a band at a time for processRowBands().*/
+struct MipmapRows
+{
+    MipmapRows(const MipmapFormat& format, const MipmapLevel& level):
+        _format(format),
+        _level(level) {}
+
+    void operator() (unsigned int, unsigned int beginRow, unsigned int endRow)
+    {
+        filterMipmapRows(_format, _level, beginRow, endRow);
+    }
+
+    const MipmapFormat& _format;
+    const MipmapLevel&  _level;
+
+protected:
+
+    MipmapRows& operator = (const MipmapRows&) { return *this; }
+};
+
+}
+
+bool buildMipmaps(osg::Image* image, MipmapFilter filter, bool sRGB, unsigned int numThreads)
+{
+    if (!image || !image->data() || image->r()!=1) return false;
+
+    GLenum pixelFormat = image->getPixelFormat();
+    GLenum dataType = image->getDataType();
+    unsigned int numComponents = osg::Image::computeNumComponents(pixelFormat);
+    if (image->isCompressed() || numComponents<1 || numComponents>4 || (dataType!=GL_UNSIGNED_BYTE && dataType!=GL_FLOAT))
+    {
+        OSG_NOTICE<<"Warning: buildMipmaps(..) only supports uncompressed GL_UNSIGNED_BYTE and GL_FLOAT images of up to 4 components."<<std::endl;
+        return false;
+    }
+
+    int alphaComponent = -1;
+    switch(pixelFormat)
+    {
+        case(GL_ALPHA): alphaComponent = 0; break;
+        case(GL_LUMINANCE_ALPHA): alphaComponent = 1; break;
+        case(GL_RGBA):
+        case(GL_BGRA): alphaComponent = 3; break;
+        default: break;
+    }
+
+    MipmapFormat format;
+    format.numComponents = numComponents;
+    format.dataType = dataType;
+    for(unsigned int c=0; c<4; ++c)
+    {
+        format.encodeSRGB[c] = sRGB && dataType==GL_UNSIGNED_BYTE && static_cast<int>(c)!=alphaComponent;
+        format.unitFromByte[c] = format.encodeSRGB[c] ? s_mipmapConversionTables.linearFromSRGB : s_mipmapConversionTables.unitFromByte;
+    }
+
+    // lay out the levels the way Image::getTotalSizeInBytesIncludingMipmaps() expects.
+    int packing = image->getPacking();
+    std::vector<unsigned int> offsets;
+    std::vector<int> widths;
+    std::vector<int> heights;
+    unsigned int totalSize = 0;
+    for(int s=image->s(), t=image->t(); ; s=osg::maximum(s>>1, 1), t=osg::maximum(t>>1, 1))
+    {
+        offsets.push_back(totalSize);
+        widths.push_back(s);
+        heights.push_back(t);
+        totalSize += osg::Image::computeImageSizeInBytes(s, t, 1, pixelFormat, dataType, packing);
+        if (s==1 && t==1) break;
+    }
+
+    unsigned char* data = new unsigned char[totalSize];
+
+    // copy across the top level a row at a time as the image may have a row length.
+    unsigned int rowSize = image->getRowSizeInBytes();
+    for(int t=0; t<image->t(); ++t)
+    {
+        memcpy(data+t*rowSize, image->data(0, t), rowSize);
+    }
+
+    if (numThreads==0) numThreads = osg::maximum(OpenThreads::GetNumberOfProcessors(), 1);
+
+    MipmapKernel kernel(filter);
+    for(unsigned int i=1; i<offsets.size(); ++i)
+    {
+        MipmapLevel level;
+        level.srcData = data+offsets[i-1];
+        level.srcWidth = widths[i-1];
+        level.srcRowStep = osg::Image::computeRowWidthInBytes(widths[i-1], pixelFormat, dataType, packing);
+        level.dstData = data+offsets[i];
+        level.dstWidth = widths[i];
+        level.dstHeight = heights[i];
+        level.dstRowStep = osg::Image::computeRowWidthInBytes(widths[i], pixelFormat, dataType, packing);
+        level.columns.build(kernel, widths[i-1], widths[i]);
+        level.rows.build(kernel, heights[i-1], heights[i]);
+
+        unsigned int numLevelThreads = osg::minimum(numThreads, osg::minimum(level.dstWidth*level.dstHeight/MIPMAP_MIN_PIXELS_PER_THREAD, level.dstHeight));
+
+        MipmapRows mipmapRows(format, level);
+        processRowBands(level.dstHeight, numLevelThreads, mipmapRows);
+    }
+
+    image->setImage(image->s(), image->t(), 1, image->getInternalTextureFormat(), pixelFormat, dataType, data, osg::Image::USE_NEW_DELETE, packing);
+    image->setMipmapLevels(osg::Image::MipmapDataType(offsets.begin()+1, offsets.end()));
+
+    return true;
+}
+
+}
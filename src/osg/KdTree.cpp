@@ -18,6 +18,12 @@
 
 #include <osg/io_utils>
 
+#include <OpenThreads/Thread>
+#include <OpenThreads/Atomic>
+
+#include <float.h>
+#include <algorithm>
+
 using namespace osg;
 
 //#define VERBOSE_OUTPUT
@@ -29,24 +35,79 @@ using namespace osg;
 struct BuildKdTree
 {
     BuildKdTree(KdTree& kdTree):
-        _kdTree(kdTree) {}
+        _kdTree(kdTree),
+        _collectTriangleBounds(false),
+        _maxNumTrianglesPerDeferredSubtree(0) {}
 
     typedef std::vector< osg::Vec3 >            CenterList;
+    typedef std::vector< osg::BoundingBox >     BoundList;
     typedef std::vector< unsigned int >           Indices;
     typedef std::vector< unsigned int >         AxisStack;
 
+    struct Subtree
+    {
+        Subtree():
+            nodeIndex(0),
+            level(0) {}
+
+        Subtree(int ni, unsigned int l):
+            nodeIndex(ni),
+            level(l) {}
+
+        int                 nodeIndex;
+        unsigned int        level;
+        KdTree::KdNodeList  nodes;
+    };
+
+    typedef std::vector< Subtree >              SubtreeList;
+
+    struct SAHSplit
+    {
+        SAHSplit():
+            axis(0),
+            binMin(0.0f),
+            binScale(0.0f),
+            bin(0) {}
+
+        unsigned int binOf(const osg::Vec3& center, unsigned int numBins) const
+        {
+            return osg::minimum(static_cast<unsigned int>((center[axis]-binMin)*binScale), numBins-1);
+        }
+
+        int             axis;
+        float           binMin;
+        float           binScale;
+        unsigned int    bin;
+    };
+
     bool build(KdTree::BuildOptions& options, osg::Geometry* geometry);
 
     void computeDivisions(KdTree::BuildOptions& options);
 
     int divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int nodeIndex, unsigned int level);
 
+    void buildSAH(const KdTree::BuildOptions& options);
+
+    void divideSAH(const KdTree::BuildOptions& options, KdTree::KdNodeList& nodes, int nodeIndex, unsigned int level, SubtreeList* deferred);
+
+    bool findSAHSplit(const KdTree::BuildOptions& options, int istart, int iend, SAHSplit& split) const;
+
+    void computeLeafBound(KdTree::KdNode& node) const;
+
+    void buildDeferredSubtrees(const KdTree::BuildOptions& options);
+
     KdTree&             _kdTree;
 
     osg::BoundingBox    _bb;
     AxisStack           _axisStack;
     Indices             _primitiveIndices;
     CenterList          _centers;
+    BoundList           _triangleBounds;
+    bool                _collectTriangleBounds;
+
+    SubtreeList         _subtrees;
+    unsigned int        _maxNumTrianglesPerDeferredSubtree;
+    OpenThreads::Atomic _nextSubtree;
 
 protected:
 
@@ -87,6 +148,8 @@ struct TriangleIndicesCollector
         _buildKdTree->_centers.push_back(bb.center());
         _buildKdTree->_primitiveIndices.push_back(i);
 
+        if (_buildKdTree->_collectTriangleBounds) _buildKdTree->_triangleBounds.push_back(bb);
+
     }
 
     BuildKdTree* _buildKdTree;
@@ -121,13 +184,16 @@ bool BuildKdTree::build(KdTree::BuildOptions& options, osg::Geometry* geometry)
 
     _kdTree.getNodes().reserve(estimatedSize*5);
 
-    computeDivisions(options);
+    if (options._splitStrategy==KdTree::BuildOptions::MIDPOINT_SPLIT) computeDivisions(options);
+
+    _collectTriangleBounds = (options._splitStrategy==KdTree::BuildOptions::SURFACE_AREA_HEURISTIC);
 
     options._numVerticesProcessed += vertices->size();
 
     unsigned int estimatedNumTriangles = vertices->size()*2;
     _primitiveIndices.reserve(estimatedNumTriangles);
     _centers.reserve(estimatedNumTriangles);
+    if (_collectTriangleBounds) _triangleBounds.reserve(estimatedNumTriangles);
 
     _kdTree.getTriangles().reserve(estimatedNumTriangles);
 
@@ -142,8 +208,15 @@ bool BuildKdTree::build(KdTree::BuildOptions& options, osg::Geometry* geometry)
 
     int nodeNum = _kdTree.addNode(node);
 
-    osg::BoundingBox bb = _bb;
-    nodeNum = divide(options, bb, nodeNum, 0);
+    if (options._splitStrategy==KdTree::BuildOptions::SURFACE_AREA_HEURISTIC)
+    {
+        buildSAH(options);
+    }
+    else
+    {
+        osg::BoundingBox bb = _bb;
+        nodeNum = divide(options, bb, nodeNum, 0);
+    }
 
     // now reorder the triangle list so that it's in order as per the primitiveIndex list.
     KdTree::TriangleList triangleList(_kdTree.getTriangles().size());
@@ -421,6 +494,344 @@ int BuildKdTree::divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int
 
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// Surface area heuristic build
+
+namespace
+{
+
+const unsigned int MAXIMUM_NUM_SAH_BINS = 64;
+
+// relative cost of traversing an internal node vs intersecting a triangle.
+const float SAH_TRAVERSAL_COST = 1.0f;
+const float SAH_INTERSECTION_COST = 1.0f;
+
+inline unsigned int getNumSAHBins(const KdTree::BuildOptions& options)
+{
+    return osg::clampBetween(options._numSAHBins, 2u, MAXIMUM_NUM_SAH_BINS);
+}
+
+inline float surfaceArea(const osg::BoundingBox& bb)
+{
+    if (!bb.valid()) return 0.0f;
+    float dx = bb.xMax()-bb.xMin();
+    float dy = bb.yMax()-bb.yMin();
+    float dz = bb.zMax()-bb.zMin();
+    return 2.0f*(dx*dy + dy*dz + dz*dx);
+}
+
+struct SubtreeBuildThread : public OpenThreads::Thread
+{
+    SubtreeBuildThread(BuildKdTree& buildKdTree, const KdTree::BuildOptions& options):
+        _buildKdTree(buildKdTree),
+        _options(options) {}
+
+    virtual void run()
+    {
+        _buildKdTree.buildDeferredSubtrees(_options);
+    }
+
+    BuildKdTree&                    _buildKdTree;
+    const KdTree::BuildOptions&     _options;
+
+protected:
+
+    SubtreeBuildThread& operator = (const SubtreeBuildThread&) { return *this; }
+};
+
+}
+
+void BuildKdTree::buildSAH(const KdTree::BuildOptions& options)
+{
+    KdTree::KdNodeList& nodes = _kdTree.getNodes();
+
+    unsigned int numTriangles = _primitiveIndices.size();
+    bool useThreads = options._numThreads>1 && numTriangles>=options._minNumTrianglesForThreading;
+
+    if (!useThreads)
+    {
+        divideSAH(options, nodes, 0, 0, 0);
+        return;
+    }
+
+    // build the top of the tree on this thread, deferring subtrees small enough to give
+    // each thread several tasks so that an uneven split doesn't leave threads idle.
+    _maxNumTrianglesPerDeferredSubtree = osg::maximum(numTriangles/(options._numThreads*4), options._targetNumTrianglesPerLeaf+1);
+    _subtrees.clear();
+
+    divideSAH(options, nodes, 0, 0, &_subtrees);
+
+    unsigned int numTopNodes = nodes.size();
+
+    if (!_subtrees.empty())
+    {
+        _nextSubtree.exchange(0);
+
+        typedef std::vector< SubtreeBuildThread* > Threads;
+        Threads threads;
+        unsigned int numThreads = osg::minimum(options._numThreads, static_cast<unsigned int>(_subtrees.size()));
+        for(unsigned int i=1; i<numThreads; ++i)
+        {
+            threads.push_back(new SubtreeBuildThread(*this, options));
+            threads.back()->start();
+        }
+
+        // the calling thread takes its share of the subtrees too.
+        buildDeferredSubtrees(options);
+
+        for(Threads::iterator itr = threads.begin();
+            itr != threads.end();
+            ++itr)
+        {
+            (*itr)->join();
+            delete *itr;
+        }
+
+        // append each subtree as a contiguous block, its root replacing the placeholder leaf
+        // that the top level build left behind.
+        for(SubtreeList::iterator itr = _subtrees.begin();
+            itr != _subtrees.end();
+            ++itr)
+        {
+            KdTree::KdNodeList& subtreeNodes = itr->nodes;
+            int offset = static_cast<int>(nodes.size())-1;
+            for(KdTree::KdNodeList::iterator nitr = subtreeNodes.begin();
+                nitr != subtreeNodes.end();
+                ++nitr)
+            {
+                if (nitr->first>0) nitr->first += offset;
+                if (nitr->first>=0 && nitr->second>0) nitr->second += offset;
+            }
+
+            nodes[itr->nodeIndex] = subtreeNodes.front();
+            nodes.insert(nodes.end(), subtreeNodes.begin()+1, subtreeNodes.end());
+
+            KdTree::KdNodeList().swap(subtreeNodes);
+        }
+
+        _subtrees.clear();
+    }
+
+    // children of the top level nodes are always allocated after their parents, so walking backwards
+    // updates the bounds of the children before they are required by the parents.
+    for(int i=static_cast<int>(numTopNodes)-1; i>=0; --i)
+    {
+        KdTree::KdNode& node = nodes[i];
+        if (node.first<0) continue;
+
+        node.bb.init();
+        if (node.first>0) node.bb.expandBy(nodes[node.first].bb);
+        if (node.second>0) node.bb.expandBy(nodes[node.second].bb);
+    }
+}
+
+void BuildKdTree::buildDeferredSubtrees(const KdTree::BuildOptions& options)
+{
+    const KdTree::KdNodeList& nodes = _kdTree.getNodes();
+    for(;;)
+    {
+        unsigned int i = (++_nextSubtree)-1;
+        if (i>=_subtrees.size()) break;
+
+        Subtree& subtree = _subtrees[i];
+        subtree.nodes.reserve(2*nodes[subtree.nodeIndex].second/osg::maximum(options._targetNumTrianglesPerLeaf, 1u)+1);
+        subtree.nodes.push_back(nodes[subtree.nodeIndex]);
+        divideSAH(options, subtree.nodes, 0, subtree.level, 0);
+    }
+}
+
+void BuildKdTree::computeLeafBound(KdTree::KdNode& node) const
+{
+    int istart = -node.first-1;
+    int iend = istart+node.second;
+
+    node.bb.init();
+    for(int i=istart; i<iend; ++i)
+    {
+        node.bb.expandBy(_triangleBounds[_primitiveIndices[i]]);
+    }
+
+    if (node.bb.valid())
+    {
+        float epsilon = 1e-6f;
+        node.bb._min.x() -= epsilon;
+        node.bb._min.y() -= epsilon;
+        node.bb._min.z() -= epsilon;
+        node.bb._max.x() += epsilon;
+        node.bb._max.y() += epsilon;
+        node.bb._max.z() += epsilon;
+    }
+}
+
+bool BuildKdTree::findSAHSplit(const KdTree::BuildOptions& options, int istart, int iend, SAHSplit& split) const
+{
+    osg::BoundingBox centerBound;
+    for(int i=istart; i<iend; ++i)
+    {
+        centerBound.expandBy(_centers[_primitiveIndices[i]]);
+    }
+
+    unsigned int numBins = getNumSAHBins(options);
+
+    unsigned int        binCounts[3][MAXIMUM_NUM_SAH_BINS];
+    osg::BoundingBox    binBounds[3][MAXIMUM_NUM_SAH_BINS];
+    float               rightAreas[MAXIMUM_NUM_SAH_BINS];
+    unsigned int        rightCounts[MAXIMUM_NUM_SAH_BINS];
+
+    SAHSplit candidates[3];
+    bool validAxis[3];
+    for(int axis=0; axis<3; ++axis)
+    {
+        float extent = centerBound._max[axis]-centerBound._min[axis];
+        validAxis[axis] = extent>0.0f;
+
+        candidates[axis].axis = axis;
+        candidates[axis].binMin = centerBound._min[axis];
+        candidates[axis].binScale = validAxis[axis] ? float(numBins)/extent : 0.0f;
+
+        for(unsigned int b=0; b<numBins; ++b)
+        {
+            binCounts[axis][b] = 0;
+            binBounds[axis][b].init();
+        }
+    }
+
+    if (!validAxis[0] && !validAxis[1] && !validAxis[2]) return false;
+
+    if (!options._evaluateAllAxes)
+    {
+        // only consider the axis along which the triangle centers are most spread out.
+        int longestAxis = 0;
+        for(int axis=1; axis<3; ++axis)
+        {
+            if (centerBound._max[axis]-centerBound._min[axis] > centerBound._max[longestAxis]-centerBound._min[longestAxis]) longestAxis = axis;
+        }
+        for(int axis=0; axis<3; ++axis) validAxis[axis] = (axis==longestAxis);
+    }
+
+    // bin all three axes in a single pass over the triangles.
+    osg::BoundingBox parentBound;
+    for(int i=istart; i<iend; ++i)
+    {
+        unsigned int primitiveIndex = _primitiveIndices[i];
+        const osg::Vec3& center = _centers[primitiveIndex];
+        const osg::BoundingBox& bb = _triangleBounds[primitiveIndex];
+
+        parentBound.expandBy(bb);
+
+        for(int axis=0; axis<3; ++axis)
+        {
+            if (!validAxis[axis]) continue;
+
+            unsigned int b = candidates[axis].binOf(center, numBins);
+            ++binCounts[axis][b];
+            binBounds[axis][b].expandBy(bb);
+        }
+    }
+
+    int count = iend-istart;
+    float bestCost = FLT_MAX;
+
+    for(int axis=0; axis<3; ++axis)
+    {
+        if (!validAxis[axis]) continue;
+
+        // sweep from the right to accumulate the cost of everything above each candidate plane
+        osg::BoundingBox accumulated;
+        unsigned int accumulatedCount = 0;
+        for(int b=static_cast<int>(numBins)-1; b>0; --b)
+        {
+            accumulated.expandBy(binBounds[axis][b]);
+            accumulatedCount += binCounts[axis][b];
+            rightAreas[b] = surfaceArea(accumulated);
+            rightCounts[b] = accumulatedCount;
+        }
+
+        // then sweep from the left evaluating the cost of each plane
+        accumulated.init();
+        accumulatedCount = 0;
+        for(unsigned int b=0; b<numBins-1; ++b)
+        {
+            accumulated.expandBy(binBounds[axis][b]);
+            accumulatedCount += binCounts[axis][b];
+
+            if (accumulatedCount==0 || rightCounts[b+1]==0) continue;
+
+            float cost = surfaceArea(accumulated)*float(accumulatedCount) + rightAreas[b+1]*float(rightCounts[b+1]);
+            if (cost<bestCost)
+            {
+                bestCost = cost;
+                split = candidates[axis];
+                split.bin = b;
+            }
+        }
+    }
+
+    if (bestCost==FLT_MAX) return false;
+
+    // large leaves are still split even when the heuristic prefers not to, to keep within the target leaf size.
+    float parentArea = surfaceArea(parentBound);
+    if (count>static_cast<int>(options._targetNumTrianglesPerLeaf*4) || parentArea<=0.0f) return true;
+
+    float splitCost = SAH_TRAVERSAL_COST + SAH_INTERSECTION_COST*bestCost/parentArea;
+    float leafCost = SAH_INTERSECTION_COST*float(count);
+    return splitCost<leafCost;
+}
+
+void BuildKdTree::divideSAH(const KdTree::BuildOptions& options, KdTree::KdNodeList& nodes, int nodeIndex, unsigned int level, SubtreeList* deferred)
+{
+    int istart = -nodes[nodeIndex].first-1;
+    int count = nodes[nodeIndex].second;
+    int iend = istart+count;
+
+    SAHSplit split;
+
+    bool needToDivide = level<options._maxNumLevels &&
+                        count>static_cast<int>(options._targetNumTrianglesPerLeaf) &&
+                        findSAHSplit(options, istart, iend, split);
+
+    if (!needToDivide)
+    {
+        computeLeafBound(nodes[nodeIndex]);
+        return;
+    }
+
+    if (deferred && count<=static_cast<int>(_maxNumTrianglesPerDeferredSubtree))
+    {
+        deferred->push_back(Subtree(nodeIndex, level));
+        return;
+    }
+
+    // partition using the same binning as the cost evaluation so neither side can end up empty.
+    unsigned int numBins = getNumSAHBins(options);
+    int left = istart;
+    int right = iend-1;
+    while(left<=right)
+    {
+        if (split.binOf(_centers[_primitiveIndices[left]], numBins)<=split.bin) ++left;
+        else std::swap(_primitiveIndices[left], _primitiveIndices[right--]);
+    }
+
+    // allocate both children together so that siblings sit next to each other in the node list.
+    int leftChildIndex = static_cast<int>(nodes.size());
+    int rightChildIndex = leftChildIndex+1;
+    nodes.push_back(KdTree::KdNode(-istart-1, left-istart));
+    nodes.push_back(KdTree::KdNode(-left-1, iend-left));
+
+    divideSAH(options, nodes, leftChildIndex, level+1, deferred);
+    divideSAH(options, nodes, rightChildIndex, level+1, deferred);
+
+    // take a fresh reference as the node list may have been reallocated by the children.
+    KdTree::KdNode& node = nodes[nodeIndex];
+    node.first = leftChildIndex;
+    node.second = rightChildIndex;
+
+    node.bb.init();
+    node.bb.expandBy(nodes[leftChildIndex].bb);
+    node.bb.expandBy(nodes[rightChildIndex].bb);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // IntersectKdTree
@@ -450,6 +861,7 @@ struct IntersectKdTree
     }
 
     void intersect(const KdTree::KdNode& node, const osg::Vec3& s, const osg::Vec3& e) const;
+    void intersectTriangles(int istart, int iend) const;
     bool intersectAndClip(osg::Vec3& s, osg::Vec3& e, const osg::BoundingBox& bb) const;
 
     const osg::Vec3Array&               _vertices;
@@ -475,112 +887,117 @@ protected:
 };
 
 
-void IntersectKdTree::intersect(const KdTree::KdNode& node, const osg::Vec3& ls, const osg::Vec3& le) const
+void IntersectKdTree::intersectTriangles(int istart, int iend) const
 {
-    if (node.first<0)
+    for(int i=istart; i<iend; ++i)
     {
-        // treat as a leaf
+        //const Triangle& tri = _triangles[_primitiveIndices[i]];
+        const KdTree::Triangle& tri = _triangles[i];
+        // OSG_NOTICE<<"   tri("<<tri.p1<<","<<tri.p2<<","<<tri.p3<<")"<<std::endl;
 
-        //OSG_NOTICE<<"KdTree::intersect("<<&leaf<<")"<<std::endl;
-        int istart = -node.first-1;
-        int iend = istart + node.second;
-
-        for(int i=istart; i<iend; ++i)
-        {
-            //const Triangle& tri = _triangles[_primitiveIndices[i]];
-            const KdTree::Triangle& tri = _triangles[i];
-            // OSG_NOTICE<<"   tri("<<tri.p1<<","<<tri.p2<<","<<tri.p3<<")"<<std::endl;
+        const osg::Vec3& v0 = _vertices[tri.p0];
+        const osg::Vec3& v1 = _vertices[tri.p1];
+        const osg::Vec3& v2 = _vertices[tri.p2];
 
-            const osg::Vec3& v0 = _vertices[tri.p0];
-            const osg::Vec3& v1 = _vertices[tri.p1];
-            const osg::Vec3& v2 = _vertices[tri.p2];
+        osg::Vec3 T = _s - v0;
+        osg::Vec3 E2 = v2 - v0;
+        osg::Vec3 E1 = v1 - v0;
 
-            osg::Vec3 T = _s - v0;
-            osg::Vec3 E2 = v2 - v0;
-            osg::Vec3 E1 = v1 - v0;
+        osg::Vec3 P =  _d ^ E2;
 
-            osg::Vec3 P =  _d ^ E2;
+        float det = P * E1;
 
-            float det = P * E1;
+        float r,r0,r1,r2;
 
-            float r,r0,r1,r2;
-
-            const float esplison = 1e-10f;
-            if (det>esplison)
-            {
-                float u = (P*T);
-                if (u<0.0 || u>det) continue;
+        const float esplison = 1e-10f;
+        if (det>esplison)
+        {
+            float u = (P*T);
+            if (u<0.0 || u>det) continue;
 
-                osg::Vec3 Q = T ^ E1;
-                float v = (Q*_d);
-                if (v<0.0 || v>det) continue;
+            osg::Vec3 Q = T ^ E1;
+            float v = (Q*_d);
+            if (v<0.0 || v>det) continue;
 
-                if ((u+v)> det) continue;
+            if ((u+v)> det) continue;
 
-                float inv_det = 1.0f/det;
-                float t = (Q*E2)*inv_det;
-                if (t<0.0 || t>_length) continue;
+            float inv_det = 1.0f/det;
+            float t = (Q*E2)*inv_det;
+            if (t<0.0 || t>_length) continue;
 
-                u *= inv_det;
-                v *= inv_det;
+            u *= inv_det;
+            v *= inv_det;
 
-                r0 = 1.0f-u-v;
-                r1 = u;
-                r2 = v;
-                r = t * _inverse_length;
-            }
-            else if (det<-esplison)
-            {
+            r0 = 1.0f-u-v;
+            r1 = u;
+            r2 = v;
+            r = t * _inverse_length;
+        }
+        else if (det<-esplison)
+        {
 
-                float u = (P*T);
-                if (u>0.0 || u<det) continue;
+            float u = (P*T);
+            if (u>0.0 || u<det) continue;
 
-                osg::Vec3 Q = T ^ E1;
-                float v = (Q*_d);
-                if (v>0.0 || v<det) continue;
+            osg::Vec3 Q = T ^ E1;
+            float v = (Q*_d);
+            if (v>0.0 || v<det) continue;
 
-                if ((u+v) < det) continue;
+            if ((u+v) < det) continue;
 
-                float inv_det = 1.0f/det;
-                float t = (Q*E2)*inv_det;
-                if (t<0.0 || t>_length) continue;
+            float inv_det = 1.0f/det;
+            float t = (Q*E2)*inv_det;
+            if (t<0.0 || t>_length) continue;
 
-                u *= inv_det;
-                v *= inv_det;
+            u *= inv_det;
+            v *= inv_det;
 
-                r0 = 1.0f-u-v;
-                r1 = u;
-                r2 = v;
-                r = t * _inverse_length;
-            }
-            else
-            {
-                continue;
-            }
+            r0 = 1.0f-u-v;
+            r1 = u;
+            r2 = v;
+            r = t * _inverse_length;
+        }
+        else
+        {
+            continue;
+        }
 
-            osg::Vec3 in = v0*r0 + v1*r1 + v2*r2;
-            osg::Vec3 normal = E1^E2;
-            normal.normalize();
+        osg::Vec3 in = v0*r0 + v1*r1 + v2*r2;
+        osg::Vec3 normal = E1^E2;
+        normal.normalize();
 
 #if 1
-            _intersections.push_back(KdTree::LineSegmentIntersection());
-            KdTree::LineSegmentIntersection& intersection = _intersections.back();
+        _intersections.push_back(KdTree::LineSegmentIntersection());
+        KdTree::LineSegmentIntersection& intersection = _intersections.back();
 
-            intersection.ratio = r;
-            intersection.primitiveIndex = i;
-            intersection.intersectionPoint = in;
-            intersection.intersectionNormal = normal;
+        intersection.ratio = r;
+        intersection.primitiveIndex = i;
+        intersection.intersectionPoint = in;
+        intersection.intersectionNormal = normal;
 
-            intersection.p0 = tri.p0;
-            intersection.p1 = tri.p1;
-            intersection.p2 = tri.p2;
-            intersection.r0 = r0;
-            intersection.r1 = r1;
-            intersection.r2 = r2;
+        intersection.p0 = tri.p0;
+        intersection.p1 = tri.p1;
+        intersection.p2 = tri.p2;
+        intersection.r0 = r0;
+        intersection.r1 = r1;
+        intersection.r2 = r2;
 
 #endif
-            // OSG_NOTICE<<"  got intersection ("<<in<<") ratio="<<r<<std::endl;
-        }
+        // OSG_NOTICE<<"  got intersection ("<<in<<") ratio="<<r<<std::endl;
+    }
+}
+
+void IntersectKdTree::intersect(const KdTree::KdNode& node, const osg::Vec3& ls, const osg::Vec3& le) const
+{
+    if (node.first<0)
+    {
+        // treat as a leaf
+
+        //OSG_NOTICE<<"KdTree::intersect("<<&leaf<<")"<<std::endl;
+        int istart = -node.first-1;
+        int iend = istart + node.second;
+
+        intersectTriangles(istart, iend);
     }
     else
     {
@@ -731,6 +1148,127 @@ bool IntersectKdTree::intersectAndClip(osg::Vec3& s, osg::Vec3& e, const osg::Bo
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// IntersectKdTreePacket - walks the kdtree once for a packet of line segments,
+// testing each node's bounding box against all the segments of the packet together.
+//
+struct IntersectKdTreePacket
+{
+    enum { PACKET_SIZE = 8 };
+
+    IntersectKdTreePacket(const KdTree::KdNodeList& nodes, IntersectKdTree* const* segments, unsigned int numSegments):
+        _kdNodes(nodes),
+        _segments(segments)
+    {
+        for(unsigned int i=0; i<PACKET_SIZE; ++i)
+        {
+            if (i<numSegments)
+            {
+                const IntersectKdTree& segment = *segments[i];
+                _sx[i] = segment._s.x();
+                _sy[i] = segment._s.y();
+                _sz[i] = segment._s.z();
+                // a segment parallel to an axis gets a huge reciprocal, so that the slab test
+                // yields an unbounded range when inside the slab and an empty range when outside it.
+                _inv_dx[i] = segment._d.x()!=0.0f ? 1.0f/segment._d.x() : 1e30f;
+                _inv_dy[i] = segment._d.y()!=0.0f ? 1.0f/segment._d.y() : 1e30f;
+                _inv_dz[i] = segment._d.z()!=0.0f ? 1.0f/segment._d.z() : 1e30f;
+                _length[i] = segment._length;
+                _epsilon[i] = segment._length*1e-5f + 1e-6f;
+                _pad[i] = (fabsf(_sx[i])+fabsf(_sy[i])+fabsf(_sz[i])+segment._length)*1e-6f + 1e-6f;
+            }
+            else
+            {
+                // unused lanes are given an empty range so they can never pass the bounding box test.
+                _sx[i] = _sy[i] = _sz[i] = 0.0f;
+                _inv_dx[i] = _inv_dy[i] = _inv_dz[i] = 1.0f;
+                _length[i] = -1.0f;
+                _epsilon[i] = 0.0f;
+                _pad[i] = 0.0f;
+            }
+        }
+    }
+
+    void intersect(int nodeIndex, unsigned int mask) const;
+    unsigned int intersectBounds(const osg::BoundingBox& bb) const;
+
+    const KdTree::KdNodeList&   _kdNodes;
+    IntersectKdTree* const*     _segments;
+
+    // per segment values are kept in separate arrays, so that the bounding box tests
+    // are done for all the segments of the packet in straight loops over the lanes.
+    float _sx[PACKET_SIZE];
+    float _sy[PACKET_SIZE];
+    float _sz[PACKET_SIZE];
+    float _inv_dx[PACKET_SIZE];
+    float _inv_dy[PACKET_SIZE];
+    float _inv_dz[PACKET_SIZE];
+    float _length[PACKET_SIZE];
+    float _epsilon[PACKET_SIZE];
+    float _pad[PACKET_SIZE];
+
+protected:
+
+    IntersectKdTreePacket& operator = (const IntersectKdTreePacket&) { return *this; }
+};
+
+unsigned int IntersectKdTreePacket::intersectBounds(const osg::BoundingBox& bb) const
+{
+    float t_near[PACKET_SIZE];
+    float t_far[PACKET_SIZE];
+
+    for(unsigned int i=0; i<PACKET_SIZE; ++i)
+    {
+        // the box is padded slightly so that segments parallel to an axis and lying exactly on
+        // one of its faces still pass, matching the inclusive tests of IntersectKdTree::intersectAndClip().
+        float tx0 = (bb.xMin()-_pad[i]-_sx[i])*_inv_dx[i];
+        float tx1 = (bb.xMax()+_pad[i]-_sx[i])*_inv_dx[i];
+        float ty0 = (bb.yMin()-_pad[i]-_sy[i])*_inv_dy[i];
+        float ty1 = (bb.yMax()+_pad[i]-_sy[i])*_inv_dy[i];
+        float tz0 = (bb.zMin()-_pad[i]-_sz[i])*_inv_dz[i];
+        float tz1 = (bb.zMax()+_pad[i]-_sz[i])*_inv_dz[i];
+
+        t_near[i] = osg::maximum(osg::maximum(osg::minimum(tx0,tx1), osg::minimum(ty0,ty1)), osg::maximum(osg::minimum(tz0,tz1), 0.0f));
+        t_far[i] = osg::minimum(osg::minimum(osg::maximum(tx0,tx1), osg::maximum(ty0,ty1)), osg::minimum(osg::maximum(tz0,tz1), _length[i]));
+    }
+
+    unsigned int mask = 0;
+    for(unsigned int i=0; i<PACKET_SIZE; ++i)
+    {
+        if (t_near[i]<=t_far[i]+_epsilon[i]) mask |= (1u<<i);
+    }
+    return mask;
+}
+
+void IntersectKdTreePacket::intersect(int nodeIndex, unsigned int mask) const
+{
+    const KdTree::KdNode& node = _kdNodes[nodeIndex];
+    if (node.first<0)
+    {
+        int istart = -node.first-1;
+        int iend = istart + node.second;
+
+        for(unsigned int i=0; i<PACKET_SIZE; ++i)
+        {
+            if (mask & (1u<<i)) _segments[i]->intersectTriangles(istart, iend);
+        }
+    }
+    else
+    {
+        if (node.first>0)
+        {
+            unsigned int childMask = mask & intersectBounds(_kdNodes[node.first].bb);
+            if (childMask) intersect(node.first, childMask);
+        }
+        if (node.second>0)
+        {
+            unsigned int childMask = mask & intersectBounds(_kdNodes[node.second].bb);
+            if (childMask) intersect(node.second, childMask);
+        }
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // KdTree::BuildOptions
@@ -738,7 +1276,12 @@ bool IntersectKdTree::intersectAndClip(osg::Vec3& s, osg::Vec3& e, const osg::Bo
 KdTree::BuildOptions::BuildOptions():
         _numVerticesProcessed(0),
         _targetNumTrianglesPerLeaf(4),
-        _maxNumLevels(32)
+        _maxNumLevels(32),
+        _splitStrategy(MIDPOINT_SPLIT),
+        _numSAHBins(16),
+        _evaluateAllAxes(false),
+        _numThreads(1),
+        _minNumTrianglesForThreading(65536)
 {
 }
 
@@ -785,6 +1328,78 @@ bool KdTree::intersect(const osg::Vec3d& start, const osg::Vec3d& end, LineSegme
     return numIntersectionsBefore != intersections.size();
 }
 
+bool KdTree::intersect(const SegmentList& segments, LineSegmentIntersectionsList& intersections) const
+{
+    if (_kdNodes.empty())
+    {
+        OSG_NOTICE<<"Warning: _kdTree is empty"<<std::endl;
+        return false;
+    }
+
+    if (intersections.size()<segments.size()) intersections.resize(segments.size());
+
+    // group segments that start close together into the same packets, so that packets share as much
+    // of their traversal as possible even when the segments are supplied in no particular order.
+    const osg::BoundingBox& bb = _kdNodes[0].bb;
+    osg::Vec3 scale(bb.xMax()>bb.xMin() ? 1023.0f/(bb.xMax()-bb.xMin()) : 0.0f,
+                    bb.yMax()>bb.yMin() ? 1023.0f/(bb.yMax()-bb.yMin()) : 0.0f,
+                    bb.zMax()>bb.zMin() ? 1023.0f/(bb.zMax()-bb.zMin()) : 0.0f);
+
+    typedef std::pair<unsigned int, unsigned int> KeyIndex;
+    std::vector<KeyIndex> order(segments.size());
+    for(unsigned int i=0; i<segments.size(); ++i)
+    {
+        osg::Vec3 midpoint = (segments[i].start+segments[i].end)*0.5;
+        unsigned int x = static_cast<unsigned int>(osg::clampBetween((midpoint.x()-bb.xMin())*scale.x(), 0.0f, 1023.0f));
+        unsigned int y = static_cast<unsigned int>(osg::clampBetween((midpoint.y()-bb.yMin())*scale.y(), 0.0f, 1023.0f));
+        unsigned int z = static_cast<unsigned int>(osg::clampBetween((midpoint.z()-bb.zMin())*scale.z(), 0.0f, 1023.0f));
+
+        // interleave the bits of the quantized coordinates to give a morton order key.
+        unsigned int key = 0;
+        for(unsigned int bit=0; bit<10; ++bit)
+        {
+            key |= ((x>>bit)&1u)<<(3*bit) | ((y>>bit)&1u)<<(3*bit+1) | ((z>>bit)&1u)<<(3*bit+2);
+        }
+        order[i] = KeyIndex(key, i);
+    }
+    std::sort(order.begin(), order.end());
+
+    bool intersectionsFound = false;
+
+    IntersectKdTree* packetSegments[IntersectKdTreePacket::PACKET_SIZE];
+    for(unsigned int first=0; first<segments.size(); first+=IntersectKdTreePacket::PACKET_SIZE)
+    {
+        unsigned int numSegments = osg::minimum(static_cast<unsigned int>(segments.size())-first, static_cast<unsigned int>(IntersectKdTreePacket::PACKET_SIZE));
+
+        unsigned int numIntersectionsBefore = 0;
+        for(unsigned int i=0; i<numSegments; ++i)
+        {
+            unsigned int index = order[first+i].second;
+            numIntersectionsBefore += intersections[index].size();
+            packetSegments[i] = new IntersectKdTree(*_vertices,
+                                                    _kdNodes,
+                                                    _triangles,
+                                                    intersections[index],
+                                                    segments[index].start, segments[index].end);
+        }
+
+        // the root node is always traversed, as with the single segment intersect().
+        IntersectKdTreePacket packet(_kdNodes, packetSegments, numSegments);
+        packet.intersect(0, (1u<<numSegments)-1);
+
+        unsigned int numIntersectionsAfter = 0;
+        for(unsigned int i=0; i<numSegments; ++i)
+        {
+            numIntersectionsAfter += intersections[order[first+i].second].size();
+            delete packetSegments[i];
+        }
+
+        if (numIntersectionsAfter!=numIntersectionsBefore) intersectionsFound = true;
+    }
+
+    return intersectionsFound;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // KdTreeBuilder
@@ -49,6 +49,16 @@ ReaderWriter::ReadResult ReadFileCallback::readImage(const std::string& filename
     return osgDB::Registry::instance()->readImageImplementation(filename,options);
 }
 
+ReaderWriter::ReadResult ReadFileCallback::readImageInfo(const std::string& filename, const Options* options)
+{
+    return osgDB::Registry::instance()->readImageInfoImplementation(filename,options);
+}
+
+ReaderWriter::ReadResult ReadFileCallback::readImageRegion(const std::string& filename, int x, int y, int width, int height, unsigned int reductionLevel, const Options* options)
+{
+    return osgDB::Registry::instance()->readImageRegionImplementation(filename,x,y,width,height,reductionLevel,options);
+}
+
 ReaderWriter::ReadResult ReadFileCallback::readHeightField(const std::string& filename, const Options* options)
 {
     return osgDB::Registry::instance()->readHeightFieldImplementation(filename,options);
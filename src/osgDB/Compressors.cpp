@@ -13,10 +13,16 @@
 // Written by Wang Rui, (C) 2010
 
 #include <osg/Notify>
+#include <osg/ApplicationUsage>
 #include <osgDB/Registry>
 #include <osgDB/Registry>
 #include <osgDB/ObjectWrapper>
+#include <OpenThreads/Condition>
+#include <OpenThreads/ScopedLock>
+#include <OpenThreads/Thread>
+#include <deque>
 #include <sstream>
+#include <string.h>
 
 using namespace osgDB;
 
@@ -48,6 +54,585 @@ public:
 
 REGISTER_COMPRESSOR( "null", NullCompressor )
 
+static osg::ApplicationUsageProxy Compressors_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_NUM_DECOMPRESSION_THREADS <int>","Set the number of threads, shared by all chunked streams being read, used to decompress chunks ahead of the reading threads.");
+
+// Base class for compressors writing the data as independently compressed chunks, preceded by an index of their sizes,
+// so that the chunks can be decompressed in parallel and the data read as soon as its chunk is decompressed.
+//
+// Stream layout: chunk size, number of chunks, the uncompressed and compressed size of each chunk, then the chunks.
+class ChunkedCompressor : public BaseCompressor
+{
+public:
+    ChunkedCompressor( unsigned int chunkSize=262144 ) : _chunkSize(chunkSize) {}
+
+    virtual bool compressChunk( const char* src, unsigned int size, std::string& target ) const = 0;
+    virtual bool decompressChunk( const char* src, unsigned int size, char* target, unsigned int targetSize ) const = 0;
+
+    virtual bool compress( std::ostream& fout, const std::string& src )
+    {
+        int chunkSize = _chunkSize;
+        int numChunks = (src.size()+_chunkSize-1)/_chunkSize;
+
+        std::vector<std::string> chunks(numChunks);
+        for ( int i=0; i<numChunks; ++i )
+        {
+            unsigned int offset = i*_chunkSize;
+            unsigned int size = osg::minimum(_chunkSize, static_cast<unsigned int>(src.size())-offset);
+            if ( !compressChunk(src.data()+offset, size, chunks[i]) ) return false;
+        }
+
+        fout.write( (char*)&chunkSize, INT_SIZE );
+        fout.write( (char*)&numChunks, INT_SIZE );
+        for ( int i=0; i<numChunks; ++i )
+        {
+            int size = osg::minimum(_chunkSize, static_cast<unsigned int>(src.size())-i*_chunkSize);
+            int compressedSize = chunks[i].size();
+            fout.write( (char*)&size, INT_SIZE );
+            fout.write( (char*)&compressedSize, INT_SIZE );
+        }
+        for ( int i=0; i<numChunks; ++i )
+        {
+            fout.write( chunks[i].data(), chunks[i].size() );
+        }
+        return !fout.fail();
+    }
+
+    virtual bool decompress( std::istream& fin, std::string& target )
+    {
+        std::istream* stream = createDecompressionStream( fin );
+        bool result = !stream->fail();
+        if ( result )
+        {
+            std::ostringstream oss;
+            oss << stream->rdbuf();
+            target = oss.str();
+            result = !stream->bad();
+        }
+        delete stream;
+        return result;
+    }
+
+    virtual std::istream* createDecompressionStream( std::istream& fin );
+
+    static unsigned int getMaxNumThreads()
+    {
+        static unsigned int s_maxNumThreads = computeMaxNumThreads();
+        return s_maxNumThreads;
+    }
+
+protected:
+    static unsigned int computeMaxNumThreads()
+    {
+        const char* ptr = getenv("OSG_NUM_DECOMPRESSION_THREADS");
+        if ( ptr ) return atoi(ptr);
+        int numProcessors = OpenThreads::GetNumberOfProcessors();
+        return numProcessors>1 ? numProcessors-1 : 0;
+    }
+
+    unsigned int _chunkSize;
+};
+
+// The compressed chunks read from a stream and their decompressed data, shared by the stream buffer reading them and
+// the DecompressionThreadPool threads decompressing them ahead of it, so that either may release it last.
+class DecompressionChunks : public osg::Referenced
+{
+public:
+    DecompressionChunks( const ChunkedCompressor* compressor )
+    :   _compressor(compressor), _chunkSize(0), _nextChunk(0), _cancelled(false) {}
+
+    bool read( std::istream& fin )
+    {
+        int chunkSize = 0, numChunks = 0;
+        fin.read( (char*)&chunkSize, INT_SIZE );
+        fin.read( (char*)&numChunks, INT_SIZE );
+        if ( fin.fail() || chunkSize<=0 || numChunks<0 ) return false;
+
+        // when the stream can tell, check the sizes in the index against the bytes remaining before allocating them,
+        // so that a corrupted index fails to read rather than exhausting memory.
+        double remaining = -1.0;
+        std::streampos start = fin.tellg();
+        if ( start!=std::streampos(-1) )
+        {
+            fin.seekg( 0, std::ios_base::end );
+            remaining = static_cast<double>(fin.tellg()-start);
+            fin.seekg( start );
+            if ( remaining<static_cast<double>(numChunks)*2*INT_SIZE ) return false;
+        }
+
+        _chunks.resize( numChunks );
+
+        unsigned int compressedOffset = 0;
+        for ( int i=0; i<numChunks; ++i )
+        {
+            int size = 0, compressedSize = 0;
+            fin.read( (char*)&size, INT_SIZE );
+            fin.read( (char*)&compressedSize, INT_SIZE );
+            if ( fin.fail() || size<0 || size>chunkSize || compressedSize<0 ||
+                 (remaining>=0.0 && static_cast<double>(compressedOffset)+compressedSize>remaining) ) { _chunks.clear(); return false; }
+
+            _chunks[i].size = size;
+            _chunks[i].compressedOffset = compressedOffset;
+            _chunks[i].compressedSize = compressedSize;
+            compressedOffset += compressedSize;
+        }
+
+        _compressed.resize( compressedOffset );
+        if ( compressedOffset>0 ) fin.read( &_compressed[0], compressedOffset );
+        if ( fin.fail() ) { _chunks.clear(); return false; }
+
+        _chunkSize = chunkSize;
+        return true;
+    }
+
+    bool valid() const { return _chunkSize>0; }
+
+    unsigned int getChunkSize() const { return _chunkSize; }
+    unsigned int getNumChunks() const { return _chunks.size(); }
+
+    // the decompressed size of a chunk, and its data once acquireChunk() has returned true.
+    unsigned int getSize( int index ) const { return _chunks[index].size; }
+    char* getData( int index ) { return _chunks[index].size>0 ? &_chunks[index].data[0] : 0; }
+
+    // stop further chunks being claimed for decompression once the stream has finished with them.
+    void cancel()
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        _cancelled = true;
+    }
+
+    // claim the next chunk not yet decompressed, returning -1 once there are none left.
+    int claimNextChunk()
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        while ( !_cancelled && _nextChunk<static_cast<int>(_chunks.size()) )
+        {
+            int index = _nextChunk++;
+            if ( _chunks[index].state==PENDING )
+            {
+                _chunks[index].state = DECOMPRESSING;
+                return index;
+            }
+        }
+        return -1;
+    }
+
+    void decompressChunk( int index )
+    {
+        Chunk& chunk = _chunks[index];
+        std::string data( chunk.size, '\0' );
+        bool result = chunk.size==0 ||
+                      _compressor->decompressChunk(_compressed.data()+chunk.compressedOffset, chunk.compressedSize, &data[0], chunk.size);
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        chunk.data.swap( data );
+        chunk.state = result ? DECOMPRESSED : FAILED;
+        _condition.broadcast();
+    }
+
+    // wait for the chunk to be decompressed, decompressing it in the calling thread if no pool thread has started it.
+    bool acquireChunk( int index )
+    {
+        bool decompressHere = false;
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+            if ( _chunks[index].state==PENDING )
+            {
+                _chunks[index].state = DECOMPRESSING;
+                decompressHere = true;
+            }
+        }
+        if ( decompressHere ) decompressChunk( index );
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        while ( _chunks[index].state==DECOMPRESSING ) _condition.wait( &_mutex );
+
+        if ( _chunks[index].state==FAILED )
+        {
+            OSG_WARN << "ChunkedDecompressionBuffer: failed to decompress chunk " << index << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+protected:
+    virtual ~DecompressionChunks() {}
+
+    enum ChunkState
+    {
+        PENDING,
+        DECOMPRESSING,
+        DECOMPRESSED,
+        FAILED
+    };
+
+    struct Chunk
+    {
+        Chunk() : size(0), compressedOffset(0), compressedSize(0), state(PENDING) {}
+
+        unsigned int size;
+        unsigned int compressedOffset;
+        unsigned int compressedSize;
+        std::string data;
+        ChunkState state;
+    };
+
+    osg::ref_ptr<const ChunkedCompressor> _compressor;
+    unsigned int _chunkSize;
+    std::string _compressed;
+    std::vector<Chunk> _chunks;
+
+    OpenThreads::Mutex _mutex;
+    OpenThreads::Condition _condition;
+    int _nextChunk;
+    bool _cancelled;
+};
+
+// Threads shared by all the chunked streams being read, decompressing the chunks of the streams in the order they were
+// opened, so that reading many streams at once, as the DatabasePager threads do, doesn't start threads for each.
+class DecompressionThreadPool : public osg::Referenced
+{
+public:
+    static DecompressionThreadPool* instance()
+    {
+        static osg::ref_ptr<DecompressionThreadPool> s_threadPool = new DecompressionThreadPool( ChunkedCompressor::getMaxNumThreads() );
+        return s_threadPool.get();
+    }
+
+    void add( DecompressionChunks* chunks )
+    {
+        if ( _numThreads==0 ) return;
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+        // start the threads when first needed so that applications not reading chunked streams don't have them.
+        for ( unsigned int i=_threads.size(); i<_numThreads; ++i )
+        {
+            _threads.push_back( new DecompressionThread(this) );
+            _threads.back()->start();
+        }
+
+        _queue.push_back( chunks );
+        _condition.broadcast();
+    }
+
+protected:
+    DecompressionThreadPool( unsigned int numThreads ) : _numThreads(numThreads), _done(false) {}
+
+    virtual ~DecompressionThreadPool()
+    {
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+            _done = true;
+            _condition.broadcast();
+        }
+        for ( unsigned int i=0; i<_threads.size(); ++i )
+        {
+            _threads[i]->join();
+        }
+    }
+
+    class DecompressionThread : public osg::Referenced, public OpenThreads::Thread
+    {
+    public:
+        DecompressionThread( DecompressionThreadPool* pool ) : _pool(pool) {}
+
+        virtual void run()
+        {
+            while ( _pool->decompressNextChunk() ) {}
+        }
+
+    protected:
+        virtual ~DecompressionThread() {}
+
+        DecompressionThreadPool* _pool;
+    };
+
+    // wait for a chunk to decompress and decompress it, returning false once the pool is being destroyed.
+    bool decompressNextChunk()
+    {
+        osg::ref_ptr<DecompressionChunks> chunks;
+        int index = -1;
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+            while ( index<0 )
+            {
+                while ( _queue.empty() && !_done ) _condition.wait( &_mutex );
+                if ( _done ) return false;
+
+                index = _queue.front()->claimNextChunk();
+                if ( index<0 ) _queue.pop_front();
+                else chunks = _queue.front();
+            }
+        }
+        chunks->decompressChunk( index );
+        return true;
+    }
+
+    unsigned int _numThreads;
+    OpenThreads::Mutex _mutex;
+    OpenThreads::Condition _condition;
+    std::deque< osg::ref_ptr<DecompressionChunks> > _queue;
+    std::vector< osg::ref_ptr<DecompressionThread> > _threads;
+    bool _done;
+};
+
+// Stream buffer reading the decompressed chunks in turn, each decompressed either by a DecompressionThreadPool thread
+// or, if no pool thread has started it by the time it's needed, in the reading thread.
+class ChunkedDecompressionBuffer : public std::streambuf
+{
+public:
+    ChunkedDecompressionBuffer( const ChunkedCompressor* compressor, std::istream& fin )
+    :   _chunks(new DecompressionChunks(compressor)), _currentChunk(-1)
+    {
+        if ( !_chunks->read(fin) ) return;
+
+        // a single chunk is decompressed by the reading thread as soon as it's read from, so gains nothing from the pool.
+        if ( _chunks->getNumChunks()>1 ) DecompressionThreadPool::instance()->add( _chunks.get() );
+    }
+
+    virtual ~ChunkedDecompressionBuffer()
+    {
+        _chunks->cancel();
+    }
+
+    bool valid() const { return _chunks->valid(); }
+
+protected:
+    bool setChunk( int index, unsigned int offset )
+    {
+        if ( index<0 || index>=static_cast<int>(_chunks->getNumChunks()) || !_chunks->acquireChunk(index) ) return false;
+        if ( offset>_chunks->getSize(index) ) return false;
+
+        char* data = _chunks->getData( index );
+        setg( data, data+offset, data+_chunks->getSize(index) );
+        _currentChunk = index;
+        return true;
+    }
+
+    virtual int_type underflow()
+    {
+        if ( gptr()<egptr() ) return traits_type::to_int_type(*gptr());
+
+        // move on to the next non empty chunk.
+        for ( int index=_currentChunk+1; index<static_cast<int>(_chunks->getNumChunks()); ++index )
+        {
+            if ( !setChunk(index, 0) ) return traits_type::eof();
+            if ( gptr()<egptr() ) return traits_type::to_int_type(*gptr());
+        }
+        return traits_type::eof();
+    }
+
+    virtual pos_type seekoff( off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which )
+    {
+        if ( (which & std::ios_base::in)==0 ) return pos_type(off_type(-1));
+
+        off_type position = off;
+        if ( dir==std::ios_base::cur ) position += currentPosition();
+        else if ( dir==std::ios_base::end ) position += totalSize();
+        return seekpos( pos_type(position), which );
+    }
+
+    virtual pos_type seekpos( pos_type pos, std::ios_base::openmode which )
+    {
+        off_type position = pos;
+        if ( (which & std::ios_base::in)==0 || position<0 || position>totalSize() ) return pos_type(off_type(-1));
+
+        int numChunks = _chunks->getNumChunks();
+        int index = static_cast<int>(position/_chunks->getChunkSize());
+        unsigned int offset = static_cast<unsigned int>(position%_chunks->getChunkSize());
+
+        // seeking to the end positions at the end of the last chunk.
+        if ( index==numChunks && index>0 ) { --index; offset = _chunks->getSize(index); }
+
+        if ( index<numChunks && !setChunk(index, offset) ) return pos_type(off_type(-1));
+        return pos;
+    }
+
+    off_type currentPosition() const
+    {
+        if ( _currentChunk<0 ) return 0;
+        return static_cast<off_type>(_currentChunk)*_chunks->getChunkSize() + (gptr()-eback());
+    }
+
+    off_type totalSize() const
+    {
+        unsigned int numChunks = _chunks->getNumChunks();
+        if ( numChunks==0 ) return 0;
+        return static_cast<off_type>(numChunks-1)*_chunks->getChunkSize() + _chunks->getSize(numChunks-1);
+    }
+
+    osg::ref_ptr<DecompressionChunks> _chunks;
+    int _currentChunk;
+};
+
+class ChunkedDecompressionStream : public std::istream
+{
+public:
+    ChunkedDecompressionStream( ChunkedDecompressionBuffer* buffer ) : std::istream(buffer), _buffer(buffer)
+    {
+        if ( !_buffer->valid() ) setstate( std::ios_base::failbit );
+    }
+
+    virtual ~ChunkedDecompressionStream() { delete _buffer; }
+
+protected:
+    ChunkedDecompressionBuffer* _buffer;
+};
+
+std::istream* ChunkedCompressor::createDecompressionStream( std::istream& fin )
+{
+    return new ChunkedDecompressionStream( new ChunkedDecompressionBuffer(this, fin) );
+}
+
+// Fast compressor writing chunks in the LZ4 block format, trading compression ratio for decompression speed.
+class LZ4Compressor : public ChunkedCompressor
+{
+public:
+    LZ4Compressor() {}
+
+    virtual bool compressChunk( const char* src, unsigned int size, std::string& target ) const
+    {
+        const unsigned char* in = reinterpret_cast<const unsigned char*>(src);
+        std::vector<unsigned int> hashTable( 1<<HASH_BITS, static_cast<unsigned int>(NO_POSITION) );
+
+        target.clear();
+        target.reserve( size + size/255 + 16 );
+
+        unsigned int anchor = 0, position = 0;
+        if ( size>=MIN_INPUT_SIZE )
+        {
+            // matches must start before the last 12 bytes and end before the last 5, which are always literals.
+            unsigned int matchStartLimit = size - MIN_INPUT_SIZE + 1;
+            unsigned int matchEndLimit = size - LAST_LITERALS;
+            while ( position<matchStartLimit )
+            {
+                unsigned int sequence = read32( in+position );
+                unsigned int& entry = hashTable[hash(sequence)];
+                unsigned int reference = entry;
+                entry = position;
+
+                if ( reference==NO_POSITION || position-reference>MAX_OFFSET || read32(in+reference)!=sequence )
+                {
+                    // skip ahead faster through data that isn't matching.
+                    position += 1 + ((position-anchor)>>6);
+                    continue;
+                }
+
+                while ( position>anchor && reference>0 && in[position-1]==in[reference-1] ) { --position; --reference; }
+
+                unsigned int length = MIN_MATCH;
+                while ( position+length<matchEndLimit && in[position+length]==in[reference+length] ) ++length;
+
+                writeSequence( target, in+anchor, position-anchor, position-reference, length );
+                position += length;
+                anchor = position;
+            }
+        }
+
+        writeLastLiterals( target, in+anchor, size-anchor );
+        return true;
+    }
+
+    virtual bool decompressChunk( const char* src, unsigned int size, char* target, unsigned int targetSize ) const
+    {
+        const unsigned char* in = reinterpret_cast<const unsigned char*>(src);
+        unsigned char* out = reinterpret_cast<unsigned char*>(target);
+        unsigned int ip = 0, op = 0;
+        while ( ip<size )
+        {
+            unsigned int token = in[ip++];
+
+            unsigned int literals = token>>4;
+            if ( literals==15 && !readLength(in, size, ip, literals) ) return false;
+            if ( literals>size-ip || literals>targetSize-op ) return false;
+            memcpy( out+op, in+ip, literals );
+            ip += literals; op += literals;
+
+            // the last sequence has no match.
+            if ( ip==size ) break;
+
+            if ( size-ip<2 ) return false;
+            unsigned int offset = in[ip] | (in[ip+1]<<8);
+            ip += 2;
+            if ( offset==0 || offset>op ) return false;
+
+            unsigned int length = token&15;
+            if ( length==15 && !readLength(in, size, ip, length) ) return false;
+            length += MIN_MATCH;
+            if ( length>targetSize-op ) return false;
+
+            // the match may overlap the data it's copying, so copy forward a byte at a time when it does.
+            const unsigned char* match = out+op-offset;
+            if ( offset>=length ) memcpy( out+op, match, length );
+            else for ( unsigned int i=0; i<length; ++i ) out[op+i] = match[i];
+            op += length;
+        }
+        return op==targetSize;
+    }
+
+protected:
+    enum
+    {
+        MIN_MATCH = 4,
+        LAST_LITERALS = 5,
+        MIN_INPUT_SIZE = 13,
+        MAX_OFFSET = 65535,
+        HASH_BITS = 16
+    };
+
+    static const unsigned int NO_POSITION = 0xffffffff;
+
+    static unsigned int read32( const unsigned char* ptr )
+    {
+        unsigned int value; memcpy( &value, ptr, 4 );
+        return value;
+    }
+
+    static unsigned int hash( unsigned int sequence )
+    {
+        return (sequence*2654435761u) >> (32-HASH_BITS);
+    }
+
+    static void writeLength( std::string& target, unsigned int length )
+    {
+        for ( ; length>=255; length-=255 ) target.push_back( (char)255 );
+        target.push_back( (char)length );
+    }
+
+    static bool readLength( const unsigned char* in, unsigned int size, unsigned int& ip, unsigned int& length )
+    {
+        unsigned int byte;
+        do
+        {
+            if ( ip>=size ) return false;
+            byte = in[ip++];
+            length += byte;
+        } while ( byte==255 );
+        return true;
+    }
+
+    static void writeSequence( std::string& target, const unsigned char* literals, unsigned int numLiterals,
+                               unsigned int offset, unsigned int length )
+    {
+        unsigned int matchLength = length-MIN_MATCH;
+        target.push_back( (char)((osg::minimum(numLiterals, 15u)<<4) | osg::minimum(matchLength, 15u)) );
+        if ( numLiterals>=15 ) writeLength( target, numLiterals-15 );
+        target.append( reinterpret_cast<const char*>(literals), numLiterals );
+        target.push_back( (char)(offset&0xff) );
+        target.push_back( (char)(offset>>8) );
+        if ( matchLength>=15 ) writeLength( target, matchLength-15 );
+    }
+
+    static void writeLastLiterals( std::string& target, const unsigned char* literals, unsigned int numLiterals )
+    {
+        target.push_back( (char)(osg::minimum(numLiterals, 15u)<<4) );
+        if ( numLiterals>=15 ) writeLength( target, numLiterals-15 );
+        target.append( reinterpret_cast<const char*>(literals), numLiterals );
+    }
+};
+
+REGISTER_COMPRESSOR( "lz4", LZ4Compressor )
+
 #ifdef USE_ZLIB
 
 #include <zlib.h>
@@ -173,4 +758,28 @@ public:
 
 REGISTER_COMPRESSOR( "zlib", ZLibCompressor )
 
+// ZLib compressor writing independently compressed chunks, so that they can be decompressed in parallel.
+class ZLibChunkedCompressor : public ChunkedCompressor
+{
+public:
+    ZLibChunkedCompressor() {}
+
+    virtual bool compressChunk( const char* src, unsigned int size, std::string& target ) const
+    {
+        uLongf compressedSize = compressBound( size );
+        target.resize( compressedSize );
+        if ( compress2((Bytef*)&target[0], &compressedSize, (const Bytef*)src, size, 6)!=Z_OK ) return false;
+        target.resize( compressedSize );
+        return true;
+    }
+
+    virtual bool decompressChunk( const char* src, unsigned int size, char* target, unsigned int targetSize ) const
+    {
+        uLongf decompressedSize = targetSize;
+        return uncompress((Bytef*)target, &decompressedSize, (const Bytef*)src, size)==Z_OK && decompressedSize==targetSize;
+    }
+};
+
+REGISTER_COMPRESSOR( "zlibchunked", ZLibChunkedCompressor )
+
 #endif
@@ -0,0 +1,115 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgDB/ComputeMemoryUsageVisitor>
+
+#include <osg/Image>
+
+using namespace osgDB;
+
+ComputeMemoryUsageVisitor::ComputeMemoryUsageVisitor():
+    osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+    _totalDataSize(0),
+    _cpuMemoryUsage(0),
+    _gpuMemoryUsage(0)
+{
+}
+
+void ComputeMemoryUsageVisitor::reset()
+{
+    _totalDataSize = 0;
+    _cpuMemoryUsage = 0;
+    _gpuMemoryUsage = 0;
+    _counted.clear();
+    _retainedImages.clear();
+    _textures.clear();
+}
+
+void ComputeMemoryUsageVisitor::apply(osg::Node& node)
+{
+    apply(node.getStateSet());
+    traverse(node);
+}
+
+void ComputeMemoryUsageVisitor::apply(osg::Geometry& geometry)
+{
+    apply(geometry.getStateSet());
+
+    bool onGPU = geometry.getUseVertexBufferObjects() || geometry.getUseDisplayList();
+
+    osg::Geometry::ArrayList arrays;
+    geometry.getArrayList(arrays);
+    for(osg::Geometry::ArrayList::iterator itr = arrays.begin(); itr != arrays.end(); ++itr)
+    {
+        addBufferData(itr->get(), onGPU);
+    }
+
+    for(unsigned int i=0; i<geometry.getNumPrimitiveSets(); ++i)
+    {
+        addBufferData(geometry.getPrimitiveSet(i), onGPU);
+    }
+}
+
+void ComputeMemoryUsageVisitor::apply(osg::StateSet* stateset)
+{
+    if (!stateset) return;
+
+    for(unsigned int unit=0; unit<stateset->getTextureAttributeList().size(); ++unit)
+    {
+        osg::Texture* texture = dynamic_cast<osg::Texture*>(stateset->getTextureAttribute(unit, osg::StateAttribute::TEXTURE));
+        if (texture && _textures.insert(texture).second) apply(*texture);
+    }
+}
+
+void ComputeMemoryUsageVisitor::apply(osg::Texture& texture)
+{
+    bool mipmapped = texture.getFilter(osg::Texture::MIN_FILTER)!=osg::Texture::LINEAR &&
+                     texture.getFilter(osg::Texture::MIN_FILTER)!=osg::Texture::NEAREST;
+
+    for(unsigned int i=0; i<texture.getNumImages(); ++i)
+    {
+        const osg::Image* image = texture.getImage(i);
+        if (!image) continue;
+
+        unsigned int size = image->getTotalSizeInBytesIncludingMipmaps();
+
+        // mipmaps generated on the GPU add a third to the size of the base image.
+        _gpuMemoryUsage += (mipmapped && !image->isMipmap()) ? size + size/3 : size;
+
+        if (_counted.insert(image).second) _totalDataSize += size;
+
+        // an image stays on the CPU if any texture using it keeps it.
+        if (!texture.getUnRefImageDataAfterApply() && _retainedImages.insert(image).second) _cpuMemoryUsage += size;
+    }
+}
+
+void ComputeMemoryUsageVisitor::addBufferData(const osg::BufferData* data, bool onGPU)
+{
+    if (!data || !_counted.insert(data).second) return;
+
+    _totalDataSize += data->getTotalDataSize();
+    _cpuMemoryUsage += data->getTotalDataSize();
+    if (onGPU) _gpuMemoryUsage += data->getTotalDataSize();
+}
+
+void ComputeMemoryUsageVisitor::addObject(const osg::Object* object)
+{
+    if (const osg::BufferData* data = dynamic_cast<const osg::BufferData*>(object))
+    {
+        addBufferData(data, false);
+    }
+    else if (const osg::Node* node = dynamic_cast<const osg::Node*>(object))
+    {
+        const_cast<osg::Node*>(node)->accept(*this);
+    }
+}
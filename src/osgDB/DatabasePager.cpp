@@ -12,10 +12,13 @@
 */
 
 #include <osgDB/DatabasePager>
+#include <osgDB/ComputeMemoryUsageVisitor>
 #include <osgDB/WriteFile>
 #include <osgDB/FileNameUtils>
 #include <osgDB/FileUtils>
 #include <osgDB/Registry>
+#include <osgDB/fstream>
+#include <osgDB/MappedFile>
 
 #include <osg/Geode>
 #include <osg/Timer>
@@ -23,6 +26,7 @@
 #include <osg/Notify>
 #include <osg/ProxyNode>
 #include <osg/ApplicationUsage>
+#include <osg/Transform>
 
 #include <OpenThreads/ScopedLock>
 
@@ -47,6 +51,9 @@ static osg::ApplicationUsageProxy DatabasePager_e0(osg::ApplicationUsage::ENVIRO
 static osg::ApplicationUsageProxy DatabasePager_e3(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_DRAWABLE <mode>","Set the drawable policy for setting of loaded drawable to specified type.  mode can be one of DoNotModify, DisplayList, VBO or VertexArrays>.");
 static osg::ApplicationUsageProxy DatabasePager_e4(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_PRIORITY <mode>", "Set the thread priority to DEFAULT, MIN, LOW, NOMINAL, HIGH or MAX.");
 static osg::ApplicationUsageProxy DatabasePager_e11(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_MAX_PAGEDLOD <num>","Set the target maximum number of PagedLOD to maintain.");
+static osg::ApplicationUsageProxy DatabasePager_e15(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_MAX_PAGEDLOD_MEMORY <MB>","Set the target maximum memory, in megabytes, the loaded subgraphs should use on the CPU and GPU, expiring the least recently visible subgraphs in place of limiting the number of PagedLOD.");
+static osg::ApplicationUsageProxy DatabasePager_e14(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_NUM_DATABASE_PROCESSING_THREADS <num>","Set the number of threads parsing the files read by the database threads, the default of 0 leaving each database thread to parse the files it reads.");
+static osg::ApplicationUsageProxy DatabasePager_e13(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_SCHEDULER <mode>","Set the scheduler used to prioritize requests, mode can be one of Default or ScreenSpaceError.");
 static osg::ApplicationUsageProxy DatabasePager_e12(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_ASSIGN_PBO_TO_IMAGES <ON/OFF>","Set whether PixelBufferObjects should be assigned to Images to aid download to the GPU.");
 
 // Convert function objects that take pointer args into functions that a
@@ -101,6 +108,30 @@ RefPtrAdapter<FuncObj> refPtrAdapt(const FuncObj& func)
 }
 
 
+namespace
+{
+
+// Collect the nodes of a subgraph.
+class CollectNodesVisitor : public osg::NodeVisitor
+{
+public:
+
+    CollectNodesVisitor():
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN)
+    {
+    }
+
+    virtual void apply(osg::Node& node)
+    {
+        _nodes.push_back(&node);
+        traverse(node);
+    }
+
+    std::vector<const osg::Node*> _nodes;
+};
+
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
 //  CountPagedLODList
@@ -401,11 +432,13 @@ protected:
 //
 struct DatabasePager::SortFileRequestFunctor
 {
-    bool operator() (const osg::ref_ptr<DatabasePager::DatabaseRequest>& lhs,const osg::ref_ptr<DatabasePager::DatabaseRequest>& rhs) const
+    // compares the timestamp and priority the requests were queued with, so the queue's heap order only
+    // changes under its _requestMutex.
+    bool operator() (const DatabasePager::DatabaseRequest* lhs, const DatabasePager::DatabaseRequest* rhs) const
     {
-        if (lhs->_timestampLastRequest>rhs->_timestampLastRequest) return true;
-        else if (lhs->_timestampLastRequest<rhs->_timestampLastRequest) return false;
-        else return (lhs->_priorityLastRequest>rhs->_priorityLastRequest);
+        if (lhs->_requestQueueTimestamp>rhs->_requestQueueTimestamp) return true;
+        else if (lhs->_requestQueueTimestamp<rhs->_requestQueueTimestamp) return false;
+        else return (lhs->_requestQueuePriority>rhs->_requestQueuePriority);
     }
 };
 
@@ -422,6 +455,8 @@ void DatabasePager::DatabaseRequest::invalidate()
     _loadedModel = 0;
     _compileSet = 0;
     _objectCache = 0;
+    std::string().swap(_fileData);
+    _readOptions = 0;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -437,10 +472,11 @@ DatabasePager::RequestQueue::RequestQueue(DatabasePager* pager):
 DatabasePager::RequestQueue::~RequestQueue()
 {
     OSG_INFO<<"DatabasePager::RequestQueue::~RequestQueue() Destructing queue."<<std::endl;
-    for(RequestList::iterator itr = _requestList.begin();
-        itr != _requestList.end();
+    for(RequestHeap::iterator itr = _requestHeap.begin();
+        itr != _requestHeap.end();
         ++itr)
     {
+        (*itr)->_requestQueue = 0;
         invalidate(itr->get());
     }
 }
@@ -459,65 +495,161 @@ void DatabasePager::RequestQueue::invalidate(DatabaseRequest* dr)
     dr->invalidate();
 }
 
+void DatabasePager::RequestQueue::place(DatabaseRequest* databaseRequest, unsigned int index)
+{
+    databaseRequest->_requestQueueIndex = index;
+    _requestHeap[index] = databaseRequest;
+}
 
-bool DatabasePager::RequestQueue::pruneOldRequestsAndCheckIfEmpty()
+void DatabasePager::RequestQueue::moveUp(unsigned int index)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+    DatabasePager::SortFileRequestFunctor highPriority;
 
-    unsigned int frameNumber = _pager->_frameNumber;
-    if (_frameNumberLastPruned != frameNumber)
+    osg::ref_ptr<DatabaseRequest> databaseRequest = _requestHeap[index];
+    while (index>0)
     {
-        for(RequestQueue::RequestList::iterator citr = _requestList.begin();
-            citr != _requestList.end();
-            )
+        unsigned int parent = (index-1)/2;
+        if (!highPriority(databaseRequest.get(), _requestHeap[parent].get())) break;
+
+        place(_requestHeap[parent].get(), index);
+        index = parent;
+    }
+    place(databaseRequest.get(), index);
+}
+
+void DatabasePager::RequestQueue::moveDown(unsigned int index)
+{
+    DatabasePager::SortFileRequestFunctor highPriority;
+
+    osg::ref_ptr<DatabaseRequest> databaseRequest = _requestHeap[index];
+    unsigned int size = _requestHeap.size();
+    for(;;)
+    {
+        unsigned int child = index*2+1;
+        if (child>=size) break;
+        if (child+1<size && highPriority(_requestHeap[child+1].get(), _requestHeap[child].get())) ++child;
+        if (!highPriority(_requestHeap[child].get(), databaseRequest.get())) break;
+
+        place(_requestHeap[child].get(), index);
+        index = child;
+    }
+    place(databaseRequest.get(), index);
+}
+
+unsigned int DatabasePager::RequestQueue::findNoLock(DatabaseRequest* databaseRequest) const
+{
+    unsigned int index = databaseRequest->_requestQueueIndex;
+    if (index<_requestHeap.size() && _requestHeap[index]==databaseRequest) return index;
+
+    // the index is only out of step if the request was added to another queue without being removed from this one.
+    for(index=0; index<_requestHeap.size(); ++index)
+    {
+        if (_requestHeap[index]==databaseRequest) break;
+    }
+    return index;
+}
+
+void DatabasePager::RequestQueue::pushNoLock(DatabaseRequest* databaseRequest)
+{
+    _requestHeap.push_back(databaseRequest);
+    databaseRequest->_requestQueueIndex = _requestHeap.size()-1;
+    moveUp(databaseRequest->_requestQueueIndex);
+}
+
+void DatabasePager::RequestQueue::eraseNoLock(unsigned int index)
+{
+    osg::ref_ptr<DatabaseRequest> last = _requestHeap.back();
+    _requestHeap.pop_back();
+    if (index<_requestHeap.size())
+    {
+        place(last.get(), index);
+
+        // the last request may need to move either way to replace the one erased.
+        moveUp(index);
+        moveDown(last->_requestQueueIndex);
+    }
+}
+
+void DatabasePager::RequestQueue::pruneNoLock(unsigned int frameNumber)
+{
+    RequestHeap current;
+    current.reserve(_requestHeap.size());
+
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+        for(RequestHeap::iterator citr = _requestHeap.begin();
+            citr != _requestHeap.end();
+            ++citr)
         {
-            OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
             if ((*citr)->isRequestCurrent(frameNumber))
             {
-                ++citr;
+                current.push_back(*citr);
             }
             else
             {
+                (*citr)->_requestQueue = 0;
                 invalidate(citr->get());
 
-                OSG_INFO<<"DatabasePager::RequestQueue::pruneOldRequestsAndCheckIfEmpty(): Pruning "<<(*citr)<<std::endl;
-                citr = _requestList.erase(citr);
+                OSG_INFO<<"DatabasePager::RequestQueue::pruneNoLock(): Pruning "<<(*citr)<<std::endl;
             }
         }
+    }
+
+    // removing requests from the middle of the heap breaks its order, so rebuild it.
+    if (current.size()!=_requestHeap.size())
+    {
+        _requestHeap.swap(current);
+        for(unsigned int i=0; i<_requestHeap.size(); ++i) _requestHeap[i]->_requestQueueIndex = i;
+        for(unsigned int i=_requestHeap.size()/2; i>0; --i) moveDown(i-1);
+    }
+
+    _frameNumberLastPruned = frameNumber;
+}
+
 
-        _frameNumberLastPruned = frameNumber;
+bool DatabasePager::RequestQueue::pruneOldRequestsAndCheckIfEmpty()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+
+    unsigned int frameNumber = _pager->_frameNumber;
+    if (_frameNumberLastPruned != frameNumber)
+    {
+        pruneNoLock(frameNumber);
 
         updateBlock();
     }
 
-    return _requestList.empty();
+    return _requestHeap.empty();
 }
 
 bool DatabasePager::RequestQueue::empty()
 {
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
-    return _requestList.empty();
+    return _requestHeap.empty();
 }
 
 unsigned int DatabasePager::RequestQueue::size()
 {
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
-    return _requestList.size();
+    return _requestHeap.size();
 }
 
 void DatabasePager::RequestQueue::clear()
 {
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
 
-    for(RequestList::iterator citr = _requestList.begin();
-        citr != _requestList.end();
-        ++citr)
     {
         OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
-        invalidate(citr->get());
+        for(RequestHeap::iterator citr = _requestHeap.begin();
+            citr != _requestHeap.end();
+            ++citr)
+        {
+            (*citr)->_requestQueue = 0;
+            invalidate(citr->get());
+        }
     }
 
-    _requestList.clear();
+    _requestHeap.clear();
 
     _frameNumberLastPruned = _pager->_frameNumber;
 
@@ -536,79 +668,131 @@ void DatabasePager::RequestQueue::remove(DatabasePager::DatabaseRequest* databas
 {
     // OSG_NOTICE<<"DatabasePager::RequestQueue::remove(DatabaseRequest* databaseRequest)"<<std::endl;
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
-    for(RequestList::iterator citr = _requestList.begin();
-        citr != _requestList.end();
-        ++citr)
     {
-        if (citr->get()==databaseRequest)
-        {
-            // OSG_NOTICE<<"  done remove(DatabaseRequest* databaseRequest)"<<std::endl;
-            _requestList.erase(citr);
-            return;
-        }
+        OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+        if (databaseRequest->_requestQueue!=this) return;
+        databaseRequest->_requestQueue = 0;
+    }
+
+    unsigned int index = findNoLock(databaseRequest);
+    if (index<_requestHeap.size())
+    {
+        // OSG_NOTICE<<"  done remove(DatabaseRequest* databaseRequest)"<<std::endl;
+        eraseNoLock(index);
     }
 }
 
 
 void DatabasePager::RequestQueue::addNoLock(DatabasePager::DatabaseRequest* databaseRequest)
 {
-    _requestList.push_back(databaseRequest);
+    bool queued = false;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+        queued = (databaseRequest->_requestQueue==this);
+        databaseRequest->_requestQueue = this;
+        databaseRequest->_requestQueueTimestamp = databaseRequest->_timestampLastRequest;
+        databaseRequest->_requestQueuePriority = databaseRequest->_priorityLastRequest;
+    }
+
+    unsigned int index = queued ? findNoLock(databaseRequest) : _requestHeap.size();
+    if (index<_requestHeap.size())
+    {
+        moveUp(index);
+        moveDown(databaseRequest->_requestQueueIndex);
+    }
+    else
+    {
+        pushNoLock(databaseRequest);
+    }
+
     updateBlock();
 }
 
-void DatabasePager::RequestQueue::swap(RequestList& requestList)
+void DatabasePager::RequestQueue::update(DatabasePager::DatabaseRequest* databaseRequest)
 {
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
-    _requestList.swap(requestList);
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+        if (databaseRequest->_requestQueue!=this) return;
+        databaseRequest->_requestQueueTimestamp = databaseRequest->_timestampLastRequest;
+        databaseRequest->_requestQueuePriority = databaseRequest->_priorityLastRequest;
+    }
+
+    // a new request only ever raises its timestamp, but its priority may drop.
+    unsigned int index = findNoLock(databaseRequest);
+    if (index<_requestHeap.size())
+    {
+        moveUp(index);
+        moveDown(databaseRequest->_requestQueueIndex);
+    }
 }
 
-void DatabasePager::RequestQueue::takeFirst(osg::ref_ptr<DatabaseRequest>& databaseRequest)
+void DatabasePager::RequestQueue::swap(RequestList& requestList)
 {
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
 
-    if (!_requestList.empty())
+    RequestHeap requestHeap;
+    requestHeap.swap(_requestHeap);
+
+    for(RequestList::iterator itr = requestList.begin();
+        itr != requestList.end();
+        ++itr)
     {
-        DatabasePager::SortFileRequestFunctor highPriority;
+        addNoLock(itr->get());
+    }
 
-        RequestQueue::RequestList::iterator selected_itr = _requestList.end();
+    requestList.clear();
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+        for(RequestHeap::iterator itr = requestHeap.begin();
+            itr != requestHeap.end();
+            ++itr)
+        {
+            (*itr)->_requestQueue = 0;
+            requestList.push_back(*itr);
+        }
+    }
+}
 
+void DatabasePager::RequestQueue::takeFirst(osg::ref_ptr<DatabaseRequest>& databaseRequest)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+
+    if (!_requestHeap.empty())
+    {
         int frameNumber = _pager->_frameNumber;
 
-        for(RequestQueue::RequestList::iterator citr = _requestList.begin();
-            citr != _requestList.end();
-            )
+        // requests that haven't been renewed sink to the bottom of the heap, so only sweep them out once a frame.
+        if (_frameNumberLastPruned != static_cast<unsigned int>(frameNumber))
         {
+            pruneNoLock(frameNumber);
+        }
+
+        while (!_requestHeap.empty())
+        {
+            osg::ref_ptr<DatabaseRequest> first = _requestHeap.front();
+            eraseNoLock(0);
+
             OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
-            if ((*citr)->isRequestCurrent(frameNumber))
+            first->_requestQueue = 0;
+            if (first->isRequestCurrent(frameNumber))
             {
-                if (selected_itr==_requestList.end() || highPriority(*citr, *selected_itr))
-                {
-                    selected_itr = citr;
-                }
-
-                ++citr;
+                databaseRequest = first;
+                break;
             }
-            else
-            {
-                invalidate(citr->get());
 
-                OSG_INFO<<"DatabasePager::RequestQueue::takeFirst(): Pruning "<<(*citr)<<std::endl;
-                citr = _requestList.erase(citr);
-            }
+            invalidate(first.get());
 
+            OSG_INFO<<"DatabasePager::RequestQueue::takeFirst(): Pruning "<<first<<std::endl;
         }
 
-        _frameNumberLastPruned = frameNumber;
-
-        if (selected_itr != _requestList.end())
+        if (databaseRequest.valid())
         {
-            databaseRequest = *selected_itr;
-            _requestList.erase(selected_itr);
-            OSG_INFO<<" DatabasePager::RequestQueue::takeFirst() Found DatabaseRequest size()="<<_requestList.size()<<std::endl;
+            OSG_INFO<<" DatabasePager::RequestQueue::takeFirst() Found DatabaseRequest size()="<<_requestHeap.size()<<std::endl;
         }
         else
         {
-            OSG_INFO<<" DatabasePager::RequestQueue::takeFirst() No suitable DatabaseRequest found size()="<<_requestList.size()<<std::endl;
+            OSG_INFO<<" DatabasePager::RequestQueue::takeFirst() No suitable DatabaseRequest found size()="<<_requestHeap.size()<<std::endl;
         }
 
         updateBlock();
@@ -628,10 +812,30 @@ DatabasePager::ReadQueue::ReadQueue(DatabasePager* pager, const std::string& nam
 
 void DatabasePager::ReadQueue::updateBlock()
 {
-    _block->set((!_requestList.empty() || !_childrenToDeleteList.empty()) &&
+    _block->set((!_requestHeap.empty() || !_childrenToDeleteList.empty() || !_prefetchRequestList.empty()) &&
                 !_pager->_databasePagerThreadPaused);
 }
 
+void DatabasePager::ReadQueue::addPrefetchRequest(const PrefetchRequest& prefetchRequest)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+    _prefetchRequestList.push_back(prefetchRequest);
+    updateBlock();
+}
+
+bool DatabasePager::ReadQueue::takePrefetchRequest(PrefetchRequest& prefetchRequest)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+
+    // prefetching gives way to any requests from the cull traversal.
+    if (_prefetchRequestList.empty() || !_requestHeap.empty()) return false;
+
+    prefetchRequest = _prefetchRequestList.front();
+    _prefetchRequestList.pop_front();
+    updateBlock();
+    return true;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
 //  DatabaseThread
@@ -678,6 +882,9 @@ int DatabasePager::DatabaseThread::cancel()
             case(HANDLE_ONLY_HTTP):
                 _pager->_httpRequestQueue->release();
                 break;
+            case(HANDLE_PROCESSING):
+                _pager->_processRequestQueue->release();
+                break;
         }
 
         join();
@@ -712,6 +919,9 @@ void DatabasePager::DatabaseThread::run()
         case(HANDLE_ONLY_HTTP):
             read_queue = _pager->_httpRequestQueue;
             break;
+        case(HANDLE_PROCESSING):
+            read_queue = _pager->_processRequestQueue;
+            break;
     }
 
 
@@ -755,6 +965,21 @@ void DatabasePager::DatabaseThread::run()
         osg::ref_ptr<DatabaseRequest> databaseRequest;
         read_queue->takeFirst(databaseRequest);
 
+        if (_mode==HANDLE_PROCESSING)
+        {
+            if (databaseRequest.valid()) _pager->processRequest(databaseRequest);
+            else OpenThreads::Thread::YieldCurrentThread();
+            continue;
+        }
+
+        // with no requests outstanding get on with prefetching.
+        PrefetchRequest prefetchRequest;
+        if (!databaseRequest.valid() && read_queue->takePrefetchRequest(prefetchRequest))
+        {
+            _pager->loadPrefetchRequest(prefetchRequest);
+            continue;
+        }
+
         bool readFromFileCache = false;
 
         osg::ref_ptr<FileCache> fileCache = osgDB::Registry::instance()->getFileCache();
@@ -887,6 +1112,11 @@ void DatabasePager::DatabaseThread::run()
                         // accept all requests, as we'll assume only high latency requests will have got here.
                         break;
                     }
+                    case(HANDLE_PROCESSING):
+                    {
+                        // processing threads never read requests themselves.
+                        break;
+                    }
                 }
             }
             else
@@ -898,6 +1128,29 @@ void DatabasePager::DatabaseThread::run()
 
         if (databaseRequest.valid())
         {
+            osg::Timer_t readStartTick = osg::Timer::instance()->tick();
+
+            // use the tile if it's already been prefetched.
+            osg::ref_ptr<osg::Node> prefetchedTile;
+            if (_pager->takePrefetchedTile(fileName, prefetchedTile))
+            {
+                OSG_INFO<<_name<<": Using prefetched tile "<<fileName<<std::endl;
+            }
+
+            // with processing threads to parse the file leave this thread free to get on with reading the next one.
+            if (_pager->_numProcessingThreads>0 && !readFromFileCache && !prefetchedTile.valid() &&
+                _pager->readFileData(databaseRequest.get(), fileName, dr_loadOptions.get()))
+            {
+                _pager->recordStageTime(false, readStartTick);
+                {
+                    OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+                    databaseRequest->_readOptions = dr_loadOptions;
+                    databaseRequest->_stageStartTick = osg::Timer::instance()->tick();
+                }
+                _pager->_processRequestQueue->add(databaseRequest.get());
+                databaseRequest = 0;
+                continue;
+            }
 
             // load the data, note safe to write to the databaseRequest since once
             // it is created this thread is the only one to write to the _loadedModel pointer.
@@ -906,7 +1159,8 @@ void DatabasePager::DatabaseThread::run()
 
 
             // assume that readNode is thread safe...
-            ReaderWriter::ReadResult rr = readFromFileCache ?
+            ReaderWriter::ReadResult rr = prefetchedTile.valid() ? ReaderWriter::ReadResult(prefetchedTile.get()) :
+                        readFromFileCache ?
                         fileCache->readNode(fileName, dr_loadOptions.get(), false) :
                         Registry::instance()->readNode(fileName, dr_loadOptions.get(), false);
 
@@ -917,7 +1171,7 @@ void DatabasePager::DatabaseThread::run()
             if (loadedModel.valid() &&
                 fileCache.valid() &&
                 fileCache->isFileAppropriateForFileCache(fileName) &&
-                !readFromFileCache)
+                !readFromFileCache && !prefetchedTile.valid())
             {
                 fileCache->writeNode(*(loadedModel), fileName, dr_loadOptions.get());
             }
@@ -933,64 +1187,26 @@ void DatabasePager::DatabaseThread::run()
 
             //OSG_NOTICE<<"     node read in "<<osg::Timer::instance()->delta_m(before,osg::Timer::instance()->tick())<<" ms"<<std::endl;
 
+            _pager->recordStageTime(false, readStartTick);
+
             if (loadedModel.valid())
             {
-                loadedModel->getBound();
-
-                bool loadedObjectsNeedToBeCompiled = false;
-                osg::ref_ptr<osgUtil::IncrementalCompileOperation::CompileSet> compileSet = 0;
-                if (!rr.loadedFromCache())
+                if (_pager->_numProcessingThreads>0)
                 {
-                    // find all the compileable rendering objects
-                    DatabasePager::FindCompileableGLObjectsVisitor stateToCompile(_pager, _pager->getMarkerObject());
-                    loadedModel->accept(stateToCompile);
-
-                    loadedObjectsNeedToBeCompiled = _pager->_doPreCompile &&
-                                                    _pager->_incrementalCompileOperation.valid() &&
-                                                    _pager->_incrementalCompileOperation->requiresCompile(stateToCompile);
-
-                    // move the databaseRequest from the front of the fileRequest to the end of
-                    // dataToCompile or dataToMerge lists.
-                    if (loadedObjectsNeedToBeCompiled)
+                    // leave the processing threads to prepare the model for compiling and merging.
                     {
-                        // OSG_NOTICE<<"Using IncrementalCompileOperation"<<std::endl;
-
-                        compileSet = new osgUtil::IncrementalCompileOperation::CompileSet(loadedModel.get());
-                        compileSet->buildCompileMap(_pager->_incrementalCompileOperation->getContextSet(), stateToCompile);
-                        compileSet->_compileCompletedCallback = new DatabasePagerCompileCompletedCallback(_pager, databaseRequest.get());
-                        _pager->_incrementalCompileOperation->add(compileSet.get(), false);
+                        OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+                        databaseRequest->_loadedModel = loadedModel;
+                        databaseRequest->_loadedFromCache = rr.loadedFromCache();
+                        databaseRequest->_stageStartTick = osg::Timer::instance()->tick();
                     }
-                }
-                else
-                {
-                    OSG_NOTICE<<"Loaded from ObjectCache"<<std::endl;
-                }
-
-
-                {
-                    OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
-                    databaseRequest->_loadedModel = loadedModel;
-                    databaseRequest->_compileSet = compileSet;
-                }
-                // Dereference the databaseRequest while the queue is
-                // locked. This prevents the request from being
-                // deleted at an unpredictable time within
-                // addLoadedDataToSceneGraph.
-                if (loadedObjectsNeedToBeCompiled)
-                {
-                    OpenThreads::ScopedLock<OpenThreads::Mutex> listLock(
-                        _pager->_dataToCompileList->_requestMutex);
-                    _pager->_dataToCompileList->addNoLock(databaseRequest.get());
+                    _pager->_processRequestQueue->add(databaseRequest.get());
                     databaseRequest = 0;
                 }
                 else
                 {
-                    OpenThreads::ScopedLock<OpenThreads::Mutex> listLock(
-                        _pager->_dataToMergeList->_requestMutex);
-                    _pager->_dataToMergeList->addNoLock(databaseRequest.get());
-                    databaseRequest = 0;
+                    _pager->addLoadedModel(databaseRequest, loadedModel.get(), rr.loadedFromCache());
                 }
-
             }
 
             // _pager->_dataToCompileList->pruneOldRequestsAndCheckIfEmpty();
@@ -1014,6 +1230,215 @@ void DatabasePager::DatabaseThread::run()
     } while (!testCancel() && !_done);
 }
 
+bool DatabasePager::readFileData(DatabaseRequest* databaseRequest, const std::string& fileName, const Options* options)
+{
+    // remote files, archives and reads intercepted by a ReadFileCallback need the Registry to read them.
+    if (containsServerAddress(fileName)) return false;
+    if (Registry::instance()->getReadFileCallback() || (options && options->getReadFileCallback())) return false;
+
+    std::string ext = getLowerCaseFileExtension(fileName);
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_streamExtensionsMutex);
+        if (_unsupportedStreamExtensions.count(ext)!=0) return false;
+    }
+
+    if (!Registry::instance()->getReaderWriterForExtension(ext)) return false;
+
+    std::string foundFileName = findDataFile(fileName, options);
+    if (foundFileName.empty() || fileType(foundFileName)!=REGULAR_FILE) return false;
+
+    osgDB::ifstream fin(foundFileName.c_str(), std::ios::in | std::ios::binary);
+    if (!fin) return false;
+
+    fin.seekg(0, std::ios::end);
+    std::streamoff size = fin.tellg();
+    fin.seekg(0, std::ios::beg);
+    if (size<=0) return false;
+
+    std::string fileData(static_cast<size_t>(size), '\0');
+    fin.read(&fileData[0], size);
+    if (fin.gcount()!=size) return false;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_dr_mutex);
+    databaseRequest->_fileData.swap(fileData);
+    databaseRequest->_foundFileName = foundFileName;
+    return true;
+}
+
+void DatabasePager::processRequest(osg::ref_ptr<DatabaseRequest>& databaseRequest)
+{
+    std::string fileData;
+    std::string fileName;
+    std::string foundFileName;
+    osg::ref_ptr<Options> readOptions;
+    osg::ref_ptr<osg::Node> loadedModel;
+    bool loadedFromCache = false;
+    osg::Timer_t startTick;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_dr_mutex);
+        fileData.swap(databaseRequest->_fileData);
+        fileName = databaseRequest->_fileName;
+        foundFileName = databaseRequest->_foundFileName;
+        readOptions = databaseRequest->_readOptions;
+        loadedModel = databaseRequest->_loadedModel;
+        loadedFromCache = databaseRequest->_loadedFromCache;
+        startTick = databaseRequest->_stageStartTick;
+
+        databaseRequest->_readOptions = 0;
+        databaseRequest->_loadedModel = 0;
+    }
+
+    if (!readOptions) readOptions = new Options;
+
+    if (!loadedModel && !fileData.empty())
+    {
+        std::string ext = getLowerCaseFileExtension(foundFileName);
+        ReaderWriter* rw = Registry::instance()->getReaderWriterForExtension(ext);
+
+        ReaderWriter::ReadResult rr;
+        if (rw)
+        {
+            // files referenced by the file being parsed are found relative to it, as they would be when reading it directly.
+            osg::ref_ptr<Options> localOptions = readOptions->cloneOptions();
+            localOptions->getDatabasePathList().push_front(getFilePath(foundFileName));
+
+            {
+                // read the file data in place rather than copying it into a stream.
+                MemoryStreamBuffer buffer(fileData.data(), fileData.size());
+                std::istream istream(&buffer);
+                rr = rw->readNode(istream, localOptions.get());
+            }
+            std::string().swap(fileData);
+        }
+
+        if (rr.validNode())
+        {
+            loadedModel = rr.getNode();
+
+            if (readOptions->getObjectCache()) readOptions->getObjectCache()->addEntryToObjectCache(fileName, loadedModel.get());
+        }
+        else
+        {
+            // the plugin can't parse the file from memory so read it again, and let the reading threads do so from now on.
+            OSG_INFO<<"DatabasePager::processRequest() unable to read "<<fileName<<" from a stream, reading file instead."<<std::endl;
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_streamExtensionsMutex);
+                _unsupportedStreamExtensions.insert(ext);
+            }
+
+            rr = Registry::instance()->readNode(fileName, readOptions.get(), false);
+            if (rr.validNode()) loadedModel = rr.getNode();
+            if (!rr.success()) OSG_WARN<<"Error in reading file "<<fileName<<" : "<<rr.statusMessage() << std::endl;
+            loadedFromCache = rr.loadedFromCache();
+        }
+    }
+
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_dr_mutex);
+        if ((_frameNumber-databaseRequest->_frameNumberLastRequest)>1)
+        {
+            OSG_INFO<<"DatabasePager::processRequest(): Warning DatabaseRquest no longer required."<<std::endl;
+            loadedModel = 0;
+        }
+    }
+
+    if (loadedModel.valid()) addLoadedModel(databaseRequest, loadedModel.get(), loadedFromCache);
+
+    recordStageTime(true, startTick);
+}
+
+void DatabasePager::addLoadedModel(osg::ref_ptr<DatabaseRequest>& databaseRequest, osg::Node* loadedModel, bool loadedFromCache)
+{
+    loadedModel->getBound();
+
+    bool loadedObjectsNeedToBeCompiled = false;
+    osg::ref_ptr<osgUtil::IncrementalCompileOperation::CompileSet> compileSet = 0;
+    if (!loadedFromCache)
+    {
+        // share the images, arrays and textures duplicated by previously loaded subgraphs before they are compiled.
+        SharedDataManager* sharedDataManager = Registry::instance()->getSharedDataManager();
+        if (sharedDataManager) sharedDataManager->share(loadedModel);
+
+        // find all the compileable rendering objects
+        DatabasePager::FindCompileableGLObjectsVisitor stateToCompile(this, getMarkerObject());
+        loadedModel->accept(stateToCompile);
+
+        loadedObjectsNeedToBeCompiled = _doPreCompile &&
+                                        _incrementalCompileOperation.valid() &&
+                                        _incrementalCompileOperation->requiresCompile(stateToCompile);
+
+        // move the databaseRequest from the front of the fileRequest to the end of
+        // dataToCompile or dataToMerge lists.
+        if (loadedObjectsNeedToBeCompiled)
+        {
+            // OSG_NOTICE<<"Using IncrementalCompileOperation"<<std::endl;
+
+            compileSet = new osgUtil::IncrementalCompileOperation::CompileSet(loadedModel);
+            compileSet->buildCompileMap(_incrementalCompileOperation->getContextSet(), stateToCompile);
+            compileSet->_compileCompletedCallback = new DatabasePagerCompileCompletedCallback(this, databaseRequest.get());
+            _incrementalCompileOperation->add(compileSet.get(), false);
+        }
+    }
+    else
+    {
+        OSG_NOTICE<<"Loaded from ObjectCache"<<std::endl;
+    }
+
+    unsigned int cpuMemoryUsage = 0;
+    unsigned int gpuMemoryUsage = 0;
+    if (_targetMaximumMemoryUsage>0)
+    {
+        ComputeMemoryUsageVisitor cmuv;
+        loadedModel->accept(cmuv);
+        cpuMemoryUsage = cmuv.getCPUMemoryUsage();
+        gpuMemoryUsage = cmuv.getGPUMemoryUsage();
+    }
+
+
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_dr_mutex);
+        databaseRequest->_loadedModel = loadedModel;
+        databaseRequest->_compileSet = compileSet;
+        databaseRequest->_cpuMemoryUsage = cpuMemoryUsage;
+        databaseRequest->_gpuMemoryUsage = gpuMemoryUsage;
+    }
+    // Dereference the databaseRequest while the queue is
+    // locked. This prevents the request from being
+    // deleted at an unpredictable time within
+    // addLoadedDataToSceneGraph.
+    if (loadedObjectsNeedToBeCompiled)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> listLock(
+            _dataToCompileList->_requestMutex);
+        _dataToCompileList->addNoLock(databaseRequest.get());
+        databaseRequest = 0;
+    }
+    else
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> listLock(
+            _dataToMergeList->_requestMutex);
+        _dataToMergeList->addNoLock(databaseRequest.get());
+        databaseRequest = 0;
+    }
+}
+
+void DatabasePager::recordStageTime(bool processing, osg::Timer_t startTick)
+{
+    double time = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_stageTimesMutex);
+    if (processing)
+    {
+        _totalProcessingTime += time;
+        ++_numProcessed;
+    }
+    else
+    {
+        _totalReadTime += time;
+        ++_numReads;
+    }
+}
+
 
 DatabasePager::DatabasePager()
 {
@@ -1090,6 +1515,15 @@ DatabasePager::DatabasePager()
         OSG_NOTICE<<"_targetMaximumNumberOfPageLOD = "<<_targetMaximumNumberOfPageLOD<<std::endl;
     }
 
+    _targetMaximumMemoryUsage = 0;
+    _cpuMemoryUsage = 0;
+    _gpuMemoryUsage = 0;
+    if( (str = getenv("OSG_MAX_PAGEDLOD_MEMORY")) != 0)
+    {
+        _targetMaximumMemoryUsage = static_cast<unsigned long long>(atof(str)*1024.0*1024.0);
+        OSG_NOTICE<<"_targetMaximumMemoryUsage = "<<_targetMaximumMemoryUsage<<std::endl;
+    }
+
 
     _doPreCompile = true;
     if( (str = getenv("OSG_DO_PRE_COMPILE")) != 0)
@@ -1098,18 +1532,43 @@ DatabasePager::DatabasePager()
                         strcmp(str,"on")==0 || strcmp(str,"ON")==0;
     }
 
+    if( (str = getenv("OSG_DATABASE_PAGER_SCHEDULER")) != 0)
+    {
+        if (strcmp(str,"ScreenSpaceError")==0 || strcmp(str,"SSE")==0)
+        {
+            _requestScheduler = new ScreenSpaceErrorRequestScheduler;
+        }
+        else if (strcmp(str,"Default")==0)
+        {
+            _requestScheduler = new RequestScheduler;
+        }
+    }
+
+    _prefetchMemoryUsed = 0;
+    _prefetchMemoryLimit = 256*1024*1024;
+    _prefetchExpiryDelay = 60.0;
+
     // initialize the stats variables
     resetStats();
 
     _fileRequestQueue = new ReadQueue(this,"fileRequestQueue");
     _httpRequestQueue = new ReadQueue(this,"httpRequestQueue");
+    _processRequestQueue = new ReadQueue(this,"processRequestQueue");
+    _numProcessingThreads = 0;
 
     _dataToCompileList = new RequestQueue(this);
     _dataToMergeList = new RequestQueue(this);
 
+    unsigned int numProcessingThreads = 0;
+    if( (str = getenv("OSG_NUM_DATABASE_PROCESSING_THREADS")) != 0)
+    {
+        numProcessingThreads = atoi(str);
+    }
+
     setUpThreads(
         osg::DisplaySettings::instance()->getNumOfDatabaseThreadsHint(),
-        osg::DisplaySettings::instance()->getNumOfHttpDatabaseThreadsHint());
+        osg::DisplaySettings::instance()->getNumOfHttpDatabaseThreadsHint(),
+        numProcessingThreads);
 
     str = getenv("OSG_DATABASE_PAGER_PRIORITY");
     if (str)
@@ -1172,10 +1631,23 @@ DatabasePager::DatabasePager(const DatabasePager& rhs)
 
     _targetMaximumNumberOfPageLOD = rhs._targetMaximumNumberOfPageLOD;
 
+    _targetMaximumMemoryUsage = rhs._targetMaximumMemoryUsage;
+    _cpuMemoryUsage = 0;
+    _gpuMemoryUsage = 0;
+
     _doPreCompile = rhs._doPreCompile;
 
+    // each pager tracks its own view and tile stats, so gets its own copy of the scheduler.
+    if (rhs._requestScheduler.valid()) _requestScheduler = rhs._requestScheduler->clone();
+
+    _prefetchMemoryUsed = 0;
+    _prefetchMemoryLimit = rhs._prefetchMemoryLimit;
+    _prefetchExpiryDelay = rhs._prefetchExpiryDelay;
+
     _fileRequestQueue = new ReadQueue(this,"fileRequestQueue");
     _httpRequestQueue = new ReadQueue(this,"httpRequestQueue");
+    _processRequestQueue = new ReadQueue(this,"processRequestQueue");
+    _numProcessingThreads = rhs._numProcessingThreads;
 
     _dataToCompileList = new RequestQueue(this);
     _dataToMergeList = new RequestQueue(this);
@@ -1187,6 +1659,8 @@ DatabasePager::DatabasePager(const DatabasePager& rhs)
         _databaseThreads.push_back(new DatabaseThread(**dt_itr,this));
     }
 
+    _stats = rhs._stats;
+
     _activePagedLODList = rhs._activePagedLODList->clone();
 
 #if 1
@@ -1219,6 +1693,7 @@ DatabasePager::~DatabasePager()
     // destruct all the queues
     _fileRequestQueue = 0;
     _httpRequestQueue = 0;
+    _processRequestQueue = 0;
     _dataToCompileList = 0;
     _dataToMergeList = 0;
 
@@ -1244,9 +1719,10 @@ DatabasePager* DatabasePager::create()
            new DatabasePager;
 }
 
-void DatabasePager::setUpThreads(unsigned int totalNumThreads, unsigned int numHttpThreads)
+void DatabasePager::setUpThreads(unsigned int totalNumThreads, unsigned int numHttpThreads, unsigned int numProcessingThreads)
 {
     _databaseThreads.clear();
+    _numProcessingThreads = 0;
 
     unsigned int numGeneralThreads = numHttpThreads < totalNumThreads ?
         totalNumThreads - numHttpThreads :
@@ -1271,6 +1747,11 @@ void DatabasePager::setUpThreads(unsigned int totalNumThreads, unsigned int numH
             addDatabaseThread(DatabaseThread::HANDLE_ONLY_HTTP, "HANDLE_ONLY_HTTP");
         }
     }
+
+    for(unsigned int i=0; i<numProcessingThreads; ++i)
+    {
+        addDatabaseThread(DatabaseThread::HANDLE_PROCESSING, "HANDLE_PROCESSING");
+    }
 }
 
 unsigned int DatabasePager::addDatabaseThread(DatabaseThread::Mode mode, const std::string& name)
@@ -1282,6 +1763,8 @@ unsigned int DatabasePager::addDatabaseThread(DatabaseThread::Mode mode, const s
     DatabaseThread* thread = new DatabaseThread(this, mode,name);
     _databaseThreads.push_back(thread);
 
+    if (mode==DatabaseThread::HANDLE_PROCESSING) ++_numProcessingThreads;
+
     if (_startThreadCalled)
     {
         OSG_INFO<<"DatabasePager::startThread()"<<std::endl;
@@ -1329,6 +1812,7 @@ int DatabasePager::cancel()
     // release the queue blocks in case they are holding up thread cancellation.
     _fileRequestQueue->release();
     _httpRequestQueue->release();
+    _processRequestQueue->release();
 
     for(DatabaseThreadList::iterator dt_itr = _databaseThreads.begin();
         dt_itr != _databaseThreads.end();
@@ -1347,13 +1831,36 @@ void DatabasePager::clear()
 {
     _fileRequestQueue->clear();
     _httpRequestQueue->clear();
+    _processRequestQueue->clear();
 
     _dataToCompileList->clear();
     _dataToMergeList->clear();
 
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_fileRequestQueue->_requestMutex);
+        _fileRequestQueue->_prefetchRequestList.clear();
+        _fileRequestQueue->updateBlock();
+    }
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_httpRequestQueue->_requestMutex);
+        _httpRequestQueue->_prefetchRequestList.clear();
+        _httpRequestQueue->updateBlock();
+    }
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_prefetchMutex);
+        _prefetchedTiles.clear();
+        _pendingPrefetches.clear();
+        _deferredPrefetches.clear();
+        _prefetchMemoryUsed = 0;
+    }
+
     // note, no need to use a mutex as the list is only accessed from the update thread.
     _activePagedLODList->clear();
 
+    _loadedSubgraphs.clear();
+    _cpuMemoryUsage = 0;
+    _gpuMemoryUsage = 0;
+
     // ??
     // _activeGraphicsContexts
 }
@@ -1365,12 +1872,20 @@ void DatabasePager::resetStats()
     _maximumTimeToMergeTile = -DBL_MAX;
     _totalTimeToMergeTiles = 0.0;
     _numTilesMerges = 0;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_stageTimesMutex);
+    _totalReadTime = 0.0;
+    _numReads = 0;
+    _totalProcessingTime = 0.0;
+    _numProcessed = 0;
 }
 
 bool DatabasePager::getRequestsInProgress() const
 {
     if (getFileRequestListSize()>0) return true;
 
+    if (getProcessRequestListSize()>0) return true;
+
     if (getDataToCompileListSize()>0)
     {
         return true;
@@ -1431,6 +1946,8 @@ void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath&
     double timestamp = framestamp?framestamp->getReferenceTime():0.0;
     unsigned int frameNumber = framestamp?framestamp->getFrameNumber():static_cast<unsigned int>(_frameNumber);
 
+    if (_requestScheduler.valid()) priority = _requestScheduler->computePriority(fileName, nodePath, priority, framestamp);
+
 // #define WITH_REQUESTNODEFILE_TIMING
 #ifdef WITH_REQUESTNODEFILE_TIMING
     osg::Timer_t start_tick = osg::Timer::instance()->tick();
@@ -1453,6 +1970,7 @@ void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath&
     {
         DatabaseRequest* databaseRequest = dynamic_cast<DatabaseRequest*>(databaseRequestRef.get());
         bool requeue = false;
+        RequestQueue* requestQueue = 0;
         if (databaseRequest)
         {
             OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_dr_mutex);
@@ -1472,6 +1990,8 @@ void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath&
                 databaseRequest->_priorityLastRequest = priority;
                 ++(databaseRequest->_numOfRequests);
 
+                requestQueue = databaseRequest->_requestQueue;
+
                 foundEntry = true;
 
                 if (databaseRequestRef->referenceCount()==1)
@@ -1492,6 +2012,12 @@ void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath&
         }
         if (requeue)
             _fileRequestQueue->add(databaseRequest);
+        else if (requestQueue && requestQueue==_fileRequestQueue.get())
+            _fileRequestQueue->update(databaseRequest);
+        else if (requestQueue && requestQueue==_httpRequestQueue.get())
+            _httpRequestQueue->update(databaseRequest);
+        else if (requestQueue && requestQueue==_processRequestQueue.get())
+            _processRequestQueue->update(databaseRequest);
     }
 
     if (!foundEntry)
@@ -1523,6 +2049,15 @@ void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath&
         }
     }
 
+    startThreads();
+
+#ifdef WITH_REQUESTNODEFILE_TIMING
+    totalTime += osg::Timer::instance()->delta_m(start_tick, osg::Timer::instance()->tick());
+#endif
+}
+
+void DatabasePager::startThreads()
+{
     if (!_startThreadCalled)
     {
         OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_run_mutex);
@@ -1548,10 +2083,6 @@ void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath&
             }
         }
     }
-
-#ifdef WITH_REQUESTNODEFILE_TIMING
-    totalTime += osg::Timer::instance()->delta_m(start_tick, osg::Timer::instance()->tick());
-#endif
 }
 
 void DatabasePager::signalBeginFrame(const osg::FrameStamp* framestamp)
@@ -1590,6 +2121,10 @@ void DatabasePager::setDatabasePagerThreadPause(bool pause)
         OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_httpRequestQueue->_requestMutex);
         _httpRequestQueue->updateBlock();
     }
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_processRequestQueue->_requestMutex);
+        _processRequestQueue->updateBlock();
+    }
 }
 
 
@@ -1620,6 +2155,44 @@ void DatabasePager::updateSceneGraph(const osg::FrameStamp& frameStamp)
         timeFor_addLoadedDataToSceneGraph = timer.elapsedTime_m() - timeFor_removeExpiredSubgraphs;
 #endif
 
+        removeExpiredPrefetchedTiles();
+
+    }
+
+    if (_stats.valid() && _stats->collectStats("pager"))
+    {
+        unsigned int frameNumber = frameStamp.getFrameNumber();
+        _stats->setAttribute(frameNumber, "Pager file request queue", static_cast<double>(getFileRequestListSize()));
+        _stats->setAttribute(frameNumber, "Pager processing queue", static_cast<double>(getProcessRequestListSize()));
+        _stats->setAttribute(frameNumber, "Pager compile queue", static_cast<double>(getDataToCompileListSize()));
+        _stats->setAttribute(frameNumber, "Pager merge queue", static_cast<double>(getDataToMergeListSize()));
+        _stats->setAttribute(frameNumber, "Pager prefetched tiles", static_cast<double>(getNumPrefetchedTiles()));
+        if (_targetMaximumMemoryUsage>0)
+        {
+            _stats->setAttribute(frameNumber, "Pager CPU memory", static_cast<double>(_cpuMemoryUsage)/(1024.0*1024.0));
+            _stats->setAttribute(frameNumber, "Pager GPU memory", static_cast<double>(_gpuMemoryUsage)/(1024.0*1024.0));
+        }
+        if (SharedDataManager* sharedDataManager = Registry::instance()->getSharedDataManager())
+        {
+            _stats->setAttribute(frameNumber, "Pager shared data saved", static_cast<double>(sharedDataManager->getBytesSaved())/(1024.0*1024.0));
+        }
+
+        // the average times, in milliseconds, of the reads and processing completed since the last frame.
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_stageTimesMutex);
+        if (_numReads>0)
+        {
+            _stats->setAttribute(frameNumber, "Pager reads", static_cast<double>(_numReads));
+            _stats->setAttribute(frameNumber, "Pager read latency", _totalReadTime*1000.0/static_cast<double>(_numReads));
+        }
+        if (_numProcessed>0)
+        {
+            _stats->setAttribute(frameNumber, "Pager processed", static_cast<double>(_numProcessed));
+            _stats->setAttribute(frameNumber, "Pager processing latency", _totalProcessingTime*1000.0/static_cast<double>(_numProcessed));
+        }
+        _totalReadTime = 0.0;
+        _numReads = 0;
+        _totalProcessingTime = 0.0;
+        _numProcessed = 0;
     }
 
 #if UPDATE_TIMING
@@ -1685,6 +2258,22 @@ void DatabasePager::addLoadedDataToSceneGraph(const osg::FrameStamp &frameStamp)
 
             group->addChild(databaseRequest->_loadedModel.get());
 
+            if (_targetMaximumMemoryUsage>0)
+            {
+                LoadedSubgraph& loadedSubgraph = _loadedSubgraphs[databaseRequest->_loadedModel.get()];
+
+                // the entry may be left over from a subgraph deleted outside of the pager.
+                _cpuMemoryUsage -= loadedSubgraph.cpuMemoryUsage;
+                _gpuMemoryUsage -= loadedSubgraph.gpuMemoryUsage;
+
+                loadedSubgraph.parent = group.get();
+                loadedSubgraph.node = databaseRequest->_loadedModel.get();
+                loadedSubgraph.cpuMemoryUsage = databaseRequest->_cpuMemoryUsage;
+                loadedSubgraph.gpuMemoryUsage = databaseRequest->_gpuMemoryUsage;
+                _cpuMemoryUsage += loadedSubgraph.cpuMemoryUsage;
+                _gpuMemoryUsage += loadedSubgraph.gpuMemoryUsage;
+            }
+
             // Check if parent plod was already registered if not start visitor from parent
             if( plod &&
                 !_activePagedLODList->containsPagedLOD( plod ) )
@@ -1711,6 +2300,8 @@ void DatabasePager::addLoadedDataToSceneGraph(const osg::FrameStamp &frameStamp)
 
             _totalTimeToMergeTiles += timeToMerge;
             ++_numTilesMerges;
+
+            if (_requestScheduler.valid()) _requestScheduler->tileMerged(databaseRequest->_fileName, timeToMerge, frameNumber-databaseRequest->_frameNumberFirstRequest);
         }
         else
         {
@@ -1773,30 +2364,38 @@ void DatabasePager::removeExpiredSubgraphs(const osg::FrameStamp& frameStamp)
     if (s_total_max_stage_a<time_a) s_total_max_stage_a = time_a;
 
 
-    if (numPagedLODs <= _targetMaximumNumberOfPageLOD)
+    if (_targetMaximumMemoryUsage>0 ? getMemoryUsage() <= _targetMaximumMemoryUsage :
+                                      numPagedLODs <= _targetMaximumNumberOfPageLOD)
     {
         // nothing to do
         return;
     }
 
-    int numToPrune = numPagedLODs - _targetMaximumNumberOfPageLOD;
-
     ObjectList childrenRemoved;
 
     double expiryTime = frameStamp.getReferenceTime() - 0.1;
     unsigned int expiryFrame = frameStamp.getFrameNumber() - 1;
 
-    // First traverse inactive PagedLODs, as their children will
-    // certainly have expired. Then traverse active nodes if we still
-    // need to prune.
-    //OSG_NOTICE<<"numToPrune "<<numToPrune;
-    if (numToPrune>0)
-        _activePagedLODList->removeExpiredChildren(
-            numToPrune, expiryTime, expiryFrame, childrenRemoved, false);
-    numToPrune = _activePagedLODList->size() - _targetMaximumNumberOfPageLOD;
-    if (numToPrune>0)
-        _activePagedLODList->removeExpiredChildren(
-            numToPrune, expiryTime, expiryFrame, childrenRemoved, true);
+    if (_targetMaximumMemoryUsage>0)
+    {
+        removeLeastRecentlyVisibleSubgraphs(expiryTime, expiryFrame, childrenRemoved);
+    }
+    else
+    {
+        int numToPrune = numPagedLODs - _targetMaximumNumberOfPageLOD;
+
+        // First traverse inactive PagedLODs, as their children will
+        // certainly have expired. Then traverse active nodes if we still
+        // need to prune.
+        //OSG_NOTICE<<"numToPrune "<<numToPrune;
+        if (numToPrune>0)
+            _activePagedLODList->removeExpiredChildren(
+                numToPrune, expiryTime, expiryFrame, childrenRemoved, false);
+        numToPrune = _activePagedLODList->size() - _targetMaximumNumberOfPageLOD;
+        if (numToPrune>0)
+            _activePagedLODList->removeExpiredChildren(
+                numToPrune, expiryTime, expiryFrame, childrenRemoved, true);
+    }
 
     osg::Timer_t end_b_Tick = osg::Timer::instance()->tick();
     double time_b = osg::Timer::instance()->delta_m(end_a_Tick,end_b_Tick);
@@ -1836,6 +2435,84 @@ void DatabasePager::removeExpiredSubgraphs(const osg::FrameStamp& frameStamp)
                               " C="<<time_c<<" avg="<<s_total_time_stage_c/s_total_iter_stage_c<<" max = "<<s_total_max_stage_c<<std::endl;
 }
 
+void DatabasePager::removeLeastRecentlyVisibleSubgraphs(double expiryTime, unsigned int expiryFrame, ObjectList& childrenRemoved)
+{
+    // PagedLOD can only expire their last child, so the candidates are the loaded subgraphs that are last children,
+    // ordered by the frame in which they were last visible.
+    typedef std::multimap< unsigned int, osg::ref_ptr<osg::PagedLOD> > CandidateMap;
+    CandidateMap candidates;
+    for(LoadedSubgraphMap::iterator itr = _loadedSubgraphs.begin();
+        itr != _loadedSubgraphs.end();
+        )
+    {
+        osg::ref_ptr<osg::Node> node;
+        osg::ref_ptr<osg::Group> parent;
+        if (!itr->second.node.lock(node) || !itr->second.parent.lock(parent) || !parent->containsNode(node.get()))
+        {
+            // the subgraph has been removed outside of the pager.
+            _cpuMemoryUsage -= itr->second.cpuMemoryUsage;
+            _gpuMemoryUsage -= itr->second.gpuMemoryUsage;
+            _loadedSubgraphs.erase(itr++);
+            continue;
+        }
+
+        osg::PagedLOD* plod = dynamic_cast<osg::PagedLOD*>(parent.get());
+        if (plod && plod->getChild(plod->getNumChildren()-1)==node.get())
+        {
+            candidates.insert(CandidateMap::value_type(plod->getFrameNumber(plod->getNumChildren()-1), plod));
+        }
+        ++itr;
+    }
+
+    for(CandidateMap::iterator itr = candidates.begin();
+        itr != candidates.end() && getMemoryUsage() > _targetMaximumMemoryUsage;
+        ++itr)
+    {
+        osg::PagedLOD* plod = itr->second.get();
+
+        // subgraphs visible in the last frame aren't expired, however far over the target.
+        ExpirePagedLODsVisitor expirePagedLODsVisitor;
+        osg::NodeList expiredChildren;
+        if (!expirePagedLODsVisitor.removeExpiredChildrenAndFindPagedLODs(plod, expiryTime, expiryFrame, expiredChildren)) continue;
+
+        osg::NodeList expiredPagedLODs;
+        for(ExpirePagedLODsVisitor::PagedLODset::iterator citr = expirePagedLODsVisitor._childPagedLODs.begin();
+            citr != expirePagedLODsVisitor._childPagedLODs.end();
+            ++citr)
+        {
+            expiredPagedLODs.push_back(citr->get());
+        }
+        _activePagedLODList->removeNodes(expiredPagedLODs);
+
+        for(osg::NodeList::iterator citr = expiredChildren.begin();
+            citr != expiredChildren.end();
+            ++citr)
+        {
+            removeLoadedSubgraphs(citr->get());
+            childrenRemoved.push_back(citr->get());
+        }
+    }
+}
+
+void DatabasePager::removeLoadedSubgraphs(osg::Node* subgraph)
+{
+    CollectNodesVisitor cnv;
+    subgraph->accept(cnv);
+
+    for(std::vector<const osg::Node*>::iterator itr = cnv._nodes.begin();
+        itr != cnv._nodes.end();
+        ++itr)
+    {
+        LoadedSubgraphMap::iterator litr = _loadedSubgraphs.find(*itr);
+        if (litr != _loadedSubgraphs.end())
+        {
+            _cpuMemoryUsage -= litr->second.cpuMemoryUsage;
+            _gpuMemoryUsage -= litr->second.gpuMemoryUsage;
+            _loadedSubgraphs.erase(litr);
+        }
+    }
+}
+
 class DatabasePager::FindPagedLODsVisitor : public osg::NodeVisitor
 {
 public:
@@ -1875,3 +2552,275 @@ void DatabasePager::registerPagedLODs(osg::Node* subgraph, unsigned int frameNum
     FindPagedLODsVisitor fplv(*_activePagedLODList, frameNumber);
     subgraph->accept(fplv);
 }
+
+class DatabasePager::FindPrefetchRequestsVisitor : public osg::NodeVisitor
+{
+public:
+
+    FindPrefetchRequestsVisitor(DatabasePager* pager, const osg::Matrixd& localToWorld, PrefetchViewpoints* viewpoints):
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+        _pager(pager),
+        _localToWorld(localToWorld),
+        _viewpoints(viewpoints)
+    {
+    }
+
+    META_NodeVisitor("osgDB","FindPrefetchRequestsVisitor")
+
+    virtual void apply(osg::Transform& transform)
+    {
+        osg::Matrixd previous = _localToWorld;
+        transform.computeLocalToWorldMatrix(_localToWorld, this);
+        traverse(transform);
+        _localToWorld = previous;
+    }
+
+    virtual void apply(osg::PagedLOD& plod)
+    {
+        osg::Matrixd worldToLocal = osg::Matrixd::inverse(_localToWorld);
+        osg::Vec3d center = osg::Vec3d(plod.getBound().center())*_localToWorld;
+        double scale = osg::maximum(_localToWorld.getScale().x(), osg::maximum(_localToWorld.getScale().y(), _localToWorld.getScale().z()));
+        double radius = plod.getBound().radius()*scale;
+
+        // find the children the viewpoints select, as PagedLOD::traverse() would select them in the cull traversal.
+        std::vector<bool> selected(plod.getNumRanges(), false);
+        int lastSelected = -1;
+        const PrefetchViewpointList& viewpoints = _viewpoints->viewpoints;
+        for(PrefetchViewpointList::const_iterator itr = viewpoints.begin();
+            itr != viewpoints.end();
+            ++itr)
+        {
+            float requiredRange = 0.0f;
+            if (plod.getRangeMode()==osg::LOD::DISTANCE_FROM_EYE_POINT)
+            {
+                requiredRange = (osg::Vec3d(plod.getCenter())-itr->eyePoint*worldToLocal).length();
+            }
+            else
+            {
+                double distance = (center-itr->eyePoint).length();
+                requiredRange = distance>0.0 ? radius*itr->pixelScale/distance : FLT_MAX;
+            }
+
+            for(unsigned int i=0; i<plod.getNumRanges(); ++i)
+            {
+                if (plod.getMinRange(i)<=requiredRange && requiredRange<plod.getMaxRange(i))
+                {
+                    selected[i] = true;
+                    lastSelected = osg::maximum(lastSelected, static_cast<int>(i));
+                }
+            }
+        }
+
+        for(unsigned int i=0; i<plod.getNumChildren() && i<selected.size(); ++i)
+        {
+            if (selected[i]) plod.getChild(i)->accept(*this);
+        }
+
+        // PagedLOD load their children in turn, so prefetch every child up to the finest selected.
+        if (plod.getDisableExternalChildrenPaging()) return;
+
+        const Options* plodOptions = dynamic_cast<const Options*>(plod.getDatabaseOptions());
+        for(int i=plod.getNumChildren(); i<=lastSelected && i<static_cast<int>(plod.getNumFileNames()); ++i)
+        {
+            if (plod.getFileName(i).empty()) continue;
+
+            PrefetchRequest prefetchRequest;
+            prefetchRequest._fileName = plod.getDatabasePath() + plod.getFileName(i);
+            prefetchRequest._loadOptions = plodOptions ? plodOptions->cloneOptions() : Registry::instance()->getOptions() ? Registry::instance()->getOptions()->cloneOptions() : new Options;
+            prefetchRequest._localToWorld = _localToWorld;
+            prefetchRequest._viewpoints = _viewpoints;
+            _pager->addPrefetchRequest(prefetchRequest);
+        }
+    }
+
+    DatabasePager*                      _pager;
+    osg::Matrixd                        _localToWorld;
+    osg::ref_ptr<PrefetchViewpoints>    _viewpoints;
+
+protected:
+
+    FindPrefetchRequestsVisitor& operator = (const FindPrefetchRequestsVisitor&) { return *this; }
+};
+
+void DatabasePager::prefetch(osg::Node* subgraph, const PrefetchViewpointList& viewpoints)
+{
+    if (!subgraph || viewpoints.empty()) return;
+
+    osg::ref_ptr<PrefetchViewpoints> prefetchViewpoints = new PrefetchViewpoints;
+    prefetchViewpoints->viewpoints = viewpoints;
+
+    osg::Matrixd localToWorld;
+    osg::NodePathList nodePaths = subgraph->getParentalNodePaths();
+    if (!nodePaths.empty()) localToWorld = osg::computeLocalToWorld(nodePaths.front());
+
+    addPrefetchRequests(subgraph, localToWorld, prefetchViewpoints.get());
+
+    startThreads();
+}
+
+void DatabasePager::prefetch(osg::Node* subgraph, const osg::AnimationPath& animationPath, double startTime, double endTime, double timeInterval, const osg::Camera* camera)
+{
+    if (timeInterval<=0.0) return;
+
+    double pixelScale = 0.5*1024.0/tan(osg::DegreesToRadians(15.0));
+    if (camera)
+    {
+        double height = camera->getViewport() ? camera->getViewport()->height() : 1024.0;
+        pixelScale = 0.5*height*osg::absolute(camera->getProjectionMatrix()(1,1));
+    }
+
+    PrefetchViewpointList viewpoints;
+    for(double time = startTime; time<=endTime; time += timeInterval)
+    {
+        osg::AnimationPath::ControlPoint controlPoint;
+        if (animationPath.getInterpolatedControlPoint(time, controlPoint))
+        {
+            viewpoints.push_back(PrefetchViewpoint(controlPoint.getPosition(), pixelScale));
+        }
+    }
+
+    prefetch(subgraph, viewpoints);
+}
+
+unsigned int DatabasePager::getPrefetchMemoryUsed() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_prefetchMutex);
+    return _prefetchMemoryUsed;
+}
+
+unsigned int DatabasePager::getNumPrefetchedTiles() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_prefetchMutex);
+    return static_cast<unsigned int>(_prefetchedTiles.size());
+}
+
+void DatabasePager::addPrefetchRequests(osg::Node* subgraph, const osg::Matrixd& localToWorld, PrefetchViewpoints* viewpoints)
+{
+    FindPrefetchRequestsVisitor fprv(this, localToWorld, viewpoints);
+    subgraph->accept(fprv);
+}
+
+void DatabasePager::addPrefetchRequest(const PrefetchRequest& prefetchRequest)
+{
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_prefetchMutex);
+        if (_prefetchedTiles.count(prefetchRequest._fileName)!=0 ||
+            !_pendingPrefetches.insert(prefetchRequest._fileName).second) return;
+    }
+
+    queuePrefetchRequest(prefetchRequest);
+}
+
+void DatabasePager::queuePrefetchRequest(const PrefetchRequest& prefetchRequest)
+{
+    // pass remote files straight to the http threads when there are any.
+    bool hasHttpThreads = false;
+    for(DatabaseThreadList::const_iterator dt_itr = _databaseThreads.begin();
+        dt_itr != _databaseThreads.end() && !hasHttpThreads;
+        ++dt_itr)
+    {
+        hasHttpThreads = (*dt_itr)->getMode()==DatabaseThread::HANDLE_ONLY_HTTP;
+    }
+
+    if (hasHttpThreads && containsServerAddress(prefetchRequest._fileName)) _httpRequestQueue->addPrefetchRequest(prefetchRequest);
+    else _fileRequestQueue->addPrefetchRequest(prefetchRequest);
+}
+
+void DatabasePager::loadPrefetchRequest(const PrefetchRequest& prefetchRequest)
+{
+    {
+        // leave the request pending while over budget, removeExpiredPrefetchedTiles() requeues it once there is room.
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_prefetchMutex);
+        if (_prefetchMemoryUsed>=_prefetchMemoryLimit)
+        {
+            _deferredPrefetches.push_back(prefetchRequest);
+            return;
+        }
+    }
+
+    osg::ref_ptr<osg::Node> tile;
+    unsigned int size = 0;
+    ReaderWriter::ReadResult rr = Registry::instance()->readNode(prefetchRequest._fileName, prefetchRequest._loadOptions.get(), false);
+    if (rr.validNode()) tile = rr.getNode();
+    else OSG_INFO<<"DatabasePager: unable to prefetch "<<prefetchRequest._fileName<<" : "<<rr.statusMessage()<<std::endl;
+
+    if (tile.valid())
+    {
+        // the tile isn't compiled until it's requested, so all of its data, including the images its textures would
+        // release once applied, is held in CPU memory.
+        ComputeMemoryUsageVisitor cmuv;
+        tile->accept(cmuv);
+        size = static_cast<unsigned int>(cmuv.getTotalDataSize());
+
+        // walk the tile before it's handed over, as once requested it may be modified by the update thread.
+        addPrefetchRequests(tile.get(), prefetchRequest._localToWorld, prefetchRequest._viewpoints.get());
+    }
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_prefetchMutex);
+    _pendingPrefetches.erase(prefetchRequest._fileName);
+    if (tile.valid())
+    {
+        PrefetchedTile& prefetchedTile = _prefetchedTiles[prefetchRequest._fileName];
+        _prefetchMemoryUsed -= prefetchedTile.size;
+        prefetchedTile.node = tile;
+        prefetchedTile.size = size;
+        prefetchedTile.timeStamp = osg::Timer::instance()->time_s();
+        _prefetchMemoryUsed += size;
+    }
+}
+
+bool DatabasePager::takePrefetchedTile(const std::string& fileName, osg::ref_ptr<osg::Node>& tile)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_prefetchMutex);
+
+    PrefetchedTileMap::iterator itr = _prefetchedTiles.find(fileName);
+    if (itr==_prefetchedTiles.end()) return false;
+
+    tile = itr->second.node;
+    _prefetchMemoryUsed -= itr->second.size;
+    _prefetchedTiles.erase(itr);
+    return true;
+}
+
+void DatabasePager::removeExpiredPrefetchedTiles()
+{
+    ObjectList expiredTiles;
+    PrefetchRequestList deferredPrefetches;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_prefetchMutex);
+
+        double expiryTime = osg::Timer::instance()->time_s() - _prefetchExpiryDelay;
+        for(PrefetchedTileMap::iterator itr = _prefetchedTiles.begin();
+            itr != _prefetchedTiles.end();
+            )
+        {
+            if (itr->second.timeStamp<expiryTime)
+            {
+                expiredTiles.push_back(itr->second.node.get());
+                _prefetchMemoryUsed -= itr->second.size;
+                _prefetchedTiles.erase(itr++);
+            }
+            else
+            {
+                ++itr;
+            }
+        }
+
+        // retry the requests deferred while over budget, those that still don't fit will be deferred again.
+        if (_prefetchMemoryUsed<_prefetchMemoryLimit) deferredPrefetches.swap(_deferredPrefetches);
+    }
+
+    for(PrefetchRequestList::iterator itr = deferredPrefetches.begin();
+        itr != deferredPrefetches.end();
+        ++itr)
+    {
+        queuePrefetchRequest(*itr);
+    }
+
+    if (!expiredTiles.empty() && _deleteRemovedSubgraphsInDatabaseThread)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_fileRequestQueue->_requestMutex);
+        _fileRequestQueue->_childrenToDeleteList.splice(_fileRequestQueue->_childrenToDeleteList.end(), expiredTiles);
+        _fileRequestQueue->updateBlock();
+    }
+}
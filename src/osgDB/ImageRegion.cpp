@@ -0,0 +1,245 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgDB/ImageRegion>
+
+#include <osg/Math>
+
+#include <math.h>
+#include <string.h>
+
+using namespace osgDB;
+
+ImageRegionBuilder::ImageRegionBuilder():
+    _imageWidth(0),
+    _imageHeight(0),
+    _x(0),
+    _y(0),
+    _width(0),
+    _height(0),
+    _factor(1),
+    _sourceScale(1),
+    _beginColumn(0),
+    _endColumn(0),
+    _beginRow(0),
+    _endRow(0),
+    _numComponents(0),
+    _nextRow(0)
+{
+}
+
+ImageRegionBuilder::ImageRegionBuilder(int imageWidth, int imageHeight, int x, int y, int width, int height, unsigned int reductionLevel):
+    _sourceScale(1),
+    _beginColumn(0),
+    _endColumn(0),
+    _beginRow(0),
+    _endRow(0),
+    _numComponents(0),
+    _nextRow(0)
+{
+    setRegion(imageWidth, imageHeight, x, y, width, height, reductionLevel);
+}
+
+bool ImageRegionBuilder::setRegion(int imageWidth, int imageHeight, int x, int y, int width, int height, unsigned int reductionLevel)
+{
+    _imageWidth = imageWidth;
+    _imageHeight = imageHeight;
+    _factor = 1<<osg::minimum(reductionLevel, 30u);
+    _x = osg::maximum(x, 0);
+    _y = osg::maximum(y, 0);
+    _width = osg::minimum(x+width, imageWidth)-_x;
+    _height = osg::minimum(y+height, imageHeight)-_y;
+    _image = 0;
+    return valid();
+}
+
+unsigned int ImageRegionBuilder::getAlignedSourceScale(unsigned int maxScale) const
+{
+    // the image's columns start at the left of the region and its rows at the bottom, so those edges have to lie on multiples
+    // of the scale even where they're on the edges of the image, the source's pixels being counted from the top left.
+    int right = _x+_width;
+    int top = _imageHeight-(_y+_height);
+    int bottom = _imageHeight-_y;
+
+    int s = 1;
+    while(s*2<=_factor && static_cast<unsigned int>(s*2)<=maxScale)
+    {
+        int next = s*2;
+        if ((_x%next)!=0 || (bottom%next)!=0 || (top%next)!=0) break;
+        if (right<_imageWidth && (right%next)!=0) break;
+        s = next;
+    }
+    return s;
+}
+
+osg::Image* ImageRegionBuilder::allocateImage(unsigned int sourceScale, int sourceWidth, int sourceHeight, GLenum pixelFormat, GLenum dataType)
+{
+    if (!valid() || sourceWidth<=0 || sourceHeight<=0) return 0;
+
+    _sourceScale = osg::clampBetween(static_cast<int>(sourceScale), 1, _factor);
+
+    int s = _sourceScale;
+    int outWidth = (_width+_factor-1)/_factor;
+    int outHeight = (_height+_factor-1)/_factor;
+
+    // each column of the image averages a square of _factor pixels of the full resolution image, those of the source covering it.
+    _columnRanges.resize(outWidth*2);
+    _beginColumn = osg::minimum(_x/s, sourceWidth-1);
+    _endColumn = osg::minimum((_x+_width-1)/s, sourceWidth-1)+1;
+    for(int i=0; i<outWidth; ++i)
+    {
+        int begin = _x+i*_factor;
+        int end = osg::minimum(begin+_factor, _x+_width);
+        _columnRanges[i*2] = osg::minimum(begin/s, sourceWidth-1)-_beginColumn;
+        _columnRanges[i*2+1] = osg::minimum((end-1)/s, sourceWidth-1)+1-_beginColumn;
+    }
+
+    // rows of the image are counted from the bottom, those of the file from the top.
+    _rowRanges.resize(outHeight*2);
+    _beginRow = osg::minimum((_imageHeight-(_y+_height))/s, sourceHeight-1);
+    _endRow = osg::minimum((_imageHeight-_y-1)/s, sourceHeight-1)+1;
+    for(int k=0; k<outHeight; ++k)
+    {
+        int j = outHeight-1-k;
+        int begin = _y+j*_factor;
+        int end = osg::minimum(begin+_factor, _y+_height);
+        _rowRanges[k*2] = osg::minimum((_imageHeight-end)/s, sourceHeight-1);
+        _rowRanges[k*2+1] = osg::minimum((_imageHeight-begin-1)/s, sourceHeight-1)+1;
+    }
+
+    _image = new osg::Image;
+    _image->allocateImage(outWidth, outHeight, 1, pixelFormat, dataType, 1);
+    if (!_image->data())
+    {
+        _image = 0;
+        return 0;
+    }
+
+    _numComponents = osg::Image::computeNumComponents(pixelFormat);
+    _nextRow = 0;
+    _sums[0].assign(outWidth*_numComponents, 0.0);
+    _sums[1].assign(outWidth*_numComponents, 0.0);
+
+    return _image.get();
+}
+
+template<typename T>
+void ImageRegionBuilder::accumulateRow(const T* data, std::vector<double>& sums) const
+{
+    double* sum = &sums.front();
+    for(int i=0; i<_image->s(); ++i, sum+=_numComponents)
+    {
+        for(int c=_columnRanges[i*2]; c<_columnRanges[i*2+1]; ++c)
+        {
+            const T* pixel = data+c*_numComponents;
+            for(unsigned int n=0; n<_numComponents; ++n) sum[n] += pixel[n];
+        }
+    }
+}
+
+template<typename T>
+void ImageRegionBuilder::writeRow(const std::vector<double>& sums, int k, T* data) const
+{
+    // integer types are rounded to nearest, floating point ones kept as they are.
+    const bool roundToNearest = (T(0.5)==T(0));
+    const double* sum = &sums.front();
+    double numRows = _rowRanges[k*2+1]-_rowRanges[k*2];
+    for(int i=0; i<_image->s(); ++i, sum+=_numComponents)
+    {
+        double scale = 1.0/(numRows*(_columnRanges[i*2+1]-_columnRanges[i*2]));
+        for(unsigned int n=0; n<_numComponents; ++n)
+        {
+            double value = sum[n]*scale;
+            *data++ = static_cast<T>(roundToNearest ? floor(value+0.5) : value);
+        }
+    }
+}
+
+void ImageRegionBuilder::accumulateRow(const unsigned char* data, std::vector<double>& sums) const
+{
+    switch(_image->getDataType())
+    {
+        case(GL_BYTE):              accumulateRow(reinterpret_cast<const char*>(data), sums); break;
+        case(GL_UNSIGNED_BYTE):     accumulateRow<unsigned char>(data, sums); break;
+        case(GL_SHORT):             accumulateRow(reinterpret_cast<const short*>(data), sums); break;
+        case(GL_UNSIGNED_SHORT):    accumulateRow(reinterpret_cast<const unsigned short*>(data), sums); break;
+        case(GL_INT):               accumulateRow(reinterpret_cast<const int*>(data), sums); break;
+        case(GL_UNSIGNED_INT):      accumulateRow(reinterpret_cast<const unsigned int*>(data), sums); break;
+        case(GL_FLOAT):             accumulateRow(reinterpret_cast<const float*>(data), sums); break;
+        case(GL_DOUBLE):            accumulateRow(reinterpret_cast<const double*>(data), sums); break;
+    }
+}
+
+void ImageRegionBuilder::writeRow(int k)
+{
+    std::vector<double>& sums = _sums[k%2];
+    unsigned char* data = _image->data(0, _image->t()-1-k);
+    switch(_image->getDataType())
+    {
+        case(GL_BYTE):              writeRow(sums, k, reinterpret_cast<char*>(data)); break;
+        case(GL_UNSIGNED_BYTE):     writeRow<unsigned char>(sums, k, data); break;
+        case(GL_SHORT):             writeRow(sums, k, reinterpret_cast<short*>(data)); break;
+        case(GL_UNSIGNED_SHORT):    writeRow(sums, k, reinterpret_cast<unsigned short*>(data)); break;
+        case(GL_INT):               writeRow(sums, k, reinterpret_cast<int*>(data)); break;
+        case(GL_UNSIGNED_INT):      writeRow(sums, k, reinterpret_cast<unsigned int*>(data)); break;
+        case(GL_FLOAT):             writeRow(sums, k, reinterpret_cast<float*>(data)); break;
+        case(GL_DOUBLE):            writeRow(sums, k, reinterpret_cast<double*>(data)); break;
+    }
+    sums.assign(sums.size(), 0.0);
+}
+
+void ImageRegionBuilder::addRow(int row, const unsigned char* data)
+{
+    if (!_image || row<_beginRow || row>=_endRow) return;
+
+    // full resolution rows are copied straight into the image.
+    if (_factor==1)
+    {
+        memcpy(_image->data(0, _image->t()-1-(row-_beginRow)), data, _image->getRowSizeInBytes());
+        return;
+    }
+
+    int numRows = _image->t();
+
+    // finish any rows that were wholly above this one, as when rows have been skipped.
+    while(_nextRow<numRows && _rowRanges[_nextRow*2+1]<=row) writeRow(_nextRow++);
+
+    // neighbouring image rows may share a source row where the source's rows don't line up with the region's.
+    for(int k=_nextRow; k<numRows && k<_nextRow+2 && _rowRanges[k*2]<=row; ++k)
+    {
+        accumulateRow(data, _sums[k%2]);
+    }
+
+    while(_nextRow<numRows && _rowRanges[_nextRow*2+1]<=row+1) writeRow(_nextRow++);
+}
+
+osg::Image* osgDB::createImageRegion(const osg::Image* image, int x, int y, int width, int height, unsigned int reductionLevel)
+{
+    if (!image || !image->data() || image->r()!=1 || image->isCompressed()) return 0;
+
+    osg::ref_ptr<osg::Image> region;
+    {
+        ImageRegionBuilder builder(image->s(), image->t(), x, y, width, height, reductionLevel);
+        region = builder.allocateImage(1, image->s(), image->t(), image->getPixelFormat(), image->getDataType());
+        if (!region) return 0;
+
+        for(int row=builder.getBeginRow(); row<builder.getEndRow(); ++row)
+        {
+            builder.addRow(row, image->data(builder.getBeginColumn(), image->t()-1-row));
+        }
+    }
+
+    region->setInternalTextureFormat(image->getInternalTextureFormat());
+    region->setFileName(image->getFileName());
+    return region.release();
+}
@@ -14,19 +14,36 @@
 
 #include <osg/Notify>
 #include <osg/ImageSequence>
+#include <osg/Observer>
 #include <osgDB/ReadFile>
 #include <osgDB/WriteFile>
 #include <osgDB/XmlParser>
 #include <osgDB/FileNameUtils>
 #include <osgDB/ObjectWrapper>
 #include <osgDB/ConvertBase64>
+#include <string.h>
 
 using namespace osgDB;
 
 static std::string s_lastSchema;
 
+// the alignment image data must have to be referenced directly from a memory mapped file
+static const size_t MAPPED_IMAGE_DATA_ALIGNMENT = 16;
+
+// holds a reference to a memory mapping for as long as the object observed, referencing data in it, exists
+class KeepMappingObserver : public osg::Observer
+{
+public:
+    KeepMappingObserver( osg::Referenced* mapping ) : _mapping(mapping) {}
+
+    virtual void objectDeleted( void* ) { delete this; }
+
+protected:
+    osg::ref_ptr<osg::Referenced> _mapping;
+};
+
 InputStream::InputStream( const osgDB::Options* options )
-    :   _fileVersion(0), _useSchemaData(false), _forceReadingImage(false), _dataDecompress(0)
+    :   _fileVersion(0), _useSchemaData(false), _forceReadingImage(false), _useDataAlignment(false), _dataDecompress(0)
 {
     BEGIN_BRACKET.set( "{", +INDENT_VALUE );
     END_BRACKET.set( "}", -INDENT_VALUE );
@@ -600,15 +617,10 @@ osg::ref_ptr<osg::PrimitiveSet> InputStream::readPrimitiveSet()
         break;
     case ID_DRAWARRAY_LENGTH:
         {
-            int first = 0, value = 0; unsigned int size = 0;
-            *this >> first >> size >> BEGIN_BRACKET;
+            int first = 0;
+            *this >> first;
             osg::DrawArrayLengths* dl = new osg::DrawArrayLengths( mode.get(), first );
-            for ( unsigned int i=0; i<size; ++i )
-            {
-                *this >> value;
-                dl->push_back( value );
-            }
-            *this >> END_BRACKET;
+            readArrayImplementation( dl, 1, INT_SIZE );
             primitive = dl;
             primitive->setNumInstances( numInstances );
         }
@@ -616,14 +628,7 @@ osg::ref_ptr<osg::PrimitiveSet> InputStream::readPrimitiveSet()
     case ID_DRAWELEMENTS_UBYTE:
         {
             osg::DrawElementsUByte* de = new osg::DrawElementsUByte( mode.get() );
-            unsigned int size = 0; unsigned char value = 0;
-            *this >> size >> BEGIN_BRACKET;
-            for ( unsigned int i=0; i<size; ++i )
-            {
-                *this >> value;
-                de->push_back( value );
-            }
-            *this >> END_BRACKET;
+            readArrayImplementation( de, 1, CHAR_SIZE );
             primitive = de;
             primitive->setNumInstances( numInstances );
         }
@@ -631,14 +636,7 @@ osg::ref_ptr<osg::PrimitiveSet> InputStream::readPrimitiveSet()
     case ID_DRAWELEMENTS_USHORT:
         {
             osg::DrawElementsUShort* de = new osg::DrawElementsUShort( mode.get() );
-            unsigned int size = 0; unsigned short value = 0;
-            *this >> size >> BEGIN_BRACKET;
-            for ( unsigned int i=0; i<size; ++i )
-            {
-                *this >> value;
-                de->push_back( value );
-            }
-            *this >> END_BRACKET;
+            readArrayImplementation( de, 1, SHORT_SIZE );
             primitive = de;
             primitive->setNumInstances( numInstances );
         }
@@ -646,14 +644,7 @@ osg::ref_ptr<osg::PrimitiveSet> InputStream::readPrimitiveSet()
     case ID_DRAWELEMENTS_UINT:
         {
             osg::DrawElementsUInt* de = new osg::DrawElementsUInt( mode.get() );
-            unsigned int size = 0, value = 0;
-            *this >> size >> BEGIN_BRACKET;
-            for ( unsigned int i=0; i<size; ++i )
-            {
-                *this >> value;
-                de->push_back( value );
-            }
-            *this >> END_BRACKET;
+            readArrayImplementation( de, 1, INT_SIZE );
             primitive = de;
             primitive->setNumInstances( numInstances );
         }
@@ -706,16 +697,33 @@ osg::ref_ptr<osg::Image> InputStream::readImage(bool readFromExternal)
             unsigned int size = 0; *this >> size;
             if ( size )
             {
-                char* data = new char[size];
-                if ( !data )
-                    throwException( "InputStream::readImage() Out of memory." );
-                if ( getException() ) return NULL;
+                readDataAlignment();
 
-                readCharArray( data, size );
-                image = new osg::Image;
-                image->setOrigin( (osg::Image::Origin)origin );
-                image->setImage( s, t, r, internalFormat, pixelFormat, dataType,
-                    (unsigned char*)data, osg::Image::USE_NEW_DELETE, packing );
+                // reference the data straight from a memory mapped file, rather than copying it, when it's aligned
+                osg::ref_ptr<osg::Referenced> mapping;
+                char* mappedData = _in->readMappedCharArray( size, mapping );
+                if ( mappedData && (reinterpret_cast<size_t>(mappedData)%MAPPED_IMAGE_DATA_ALIGNMENT)==0 )
+                {
+                    image = new osg::Image;
+                    image->setOrigin( (osg::Image::Origin)origin );
+                    image->setImage( s, t, r, internalFormat, pixelFormat, dataType,
+                        (unsigned char*)mappedData, osg::Image::NO_DELETE, packing );
+                    image->addObserver( new KeepMappingObserver(mapping.get()) );
+                }
+                else
+                {
+                    char* data = new char[size];
+                    if ( !data )
+                        throwException( "InputStream::readImage() Out of memory." );
+                    if ( getException() ) return NULL;
+
+                    if ( mappedData ) memcpy( data, mappedData, size );
+                    else readCharArray( data, size );
+                    image = new osg::Image;
+                    image->setOrigin( (osg::Image::Origin)origin );
+                    image->setImage( s, t, r, internalFormat, pixelFormat, dataType,
+                        (unsigned char*)data, osg::Image::USE_NEW_DELETE, packing );
+                }
             }
 
             // _mipmapData
@@ -930,6 +938,18 @@ osg::ref_ptr<osg::Object> InputStream::readObjectFields( const std::string& clas
     return obj;
 }
 
+void InputStream::readDataAlignment()
+{
+    if ( !_useDataAlignment ) return;
+
+    unsigned int padding = 0; *this >> padding;
+    if ( padding>0 )
+    {
+        std::vector<char> skipped( padding );
+        readCharArray( &skipped.front(), padding );
+    }
+}
+
 void InputStream::readSchema( std::istream& fin )
 {
     // Read from external ascii stream
@@ -971,6 +991,7 @@ InputStream::ReadType InputStream::start( InputIterator* inIterator )
         unsigned int attributes; *this >> attributes;
         if ( attributes&0x4 ) inIterator->setSupportBinaryBrackets( true );
         if ( attributes&0x2 ) _useSchemaData = true;
+        if ( attributes&0x8 ) _useDataAlignment = true;
 
         // Record custom domains
         if ( attributes&0x1 )
@@ -1027,11 +1048,22 @@ void InputStream::decompress()
                                    << compressorName << std::endl;
         }
 
-        if ( !compressor->decompress(*(_in->getStream()), data) )
+        // use a stream decompressing the data as it's read if the compressor supports it.
+        _dataDecompress = compressor->createDecompressionStream(*(_in->getStream()));
+        if ( !_dataDecompress )
+        {
+            if ( !compressor->decompress(*(_in->getStream()), data) )
+                throwException( "InputStream: Failed to decompress stream." );
+            if ( getException() ) return;
+
+            _dataDecompress = new std::stringstream(data);
+        }
+        else if ( _dataDecompress->fail() )
+        {
             throwException( "InputStream: Failed to decompress stream." );
-        if ( getException() ) return;
+            return;
+        }
 
-        _dataDecompress = new std::stringstream(data);
         _in->setStream( _dataDecompress );
         _fields.pop_back();
     }
@@ -1100,6 +1132,7 @@ void InputStream::readArrayImplementation( T* a, unsigned int numComponentsPerEl
         a->resize( size );
         if ( isBinary() )
         {
+            readDataAlignment();
             readComponentArray( (char*)&((*a)[0]), size, numComponentsPerElements, componentSizeInBytes );
             checkStream();
         }
@@ -0,0 +1,162 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgDB/MappedFile>
+#include <osgDB/ConvertUTF>
+
+#include <osg/Config>
+#include <osg/Notify>
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <windows.h>
+#else
+    #include <sys/types.h>
+    #include <sys/stat.h>
+    #include <sys/mman.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+using namespace osgDB;
+
+MappedFile::MappedFile():
+    _data(0),
+    _size(0)
+{
+}
+
+MappedFile::MappedFile(const std::string& fileName):
+    _data(0),
+    _size(0)
+{
+    open(fileName);
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+
+bool MappedFile::open(const std::string& fileName)
+{
+    close();
+
+#ifdef OSG_USE_UTF8_FILENAME
+    HANDLE file = CreateFileW(convertUTF8toUTF16(fileName).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+#else
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+#endif
+    if (file==INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart==0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    // the view keeps the file open, so the handles can be closed straight away.
+    HANDLE mapping = CreateFileMapping(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) return false;
+
+    _data = static_cast<char*>(MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0));
+    CloseHandle(mapping);
+    if (!_data) return false;
+
+    _size = static_cast<size_t>(fileSize.QuadPart);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (_data) UnmapViewOfFile(_data);
+    _data = 0;
+    _size = 0;
+}
+
+#else
+
+bool MappedFile::open(const std::string& fileName)
+{
+    close();
+
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd<0) return false;
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat)!=0 || fileStat.st_size==0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    // the mapping keeps the file open, so the descriptor can be closed straight away.
+    void* data = mmap(0, fileStat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data==MAP_FAILED)
+    {
+        OSG_INFO<<"MappedFile::open("<<fileName<<") unable to map file."<<std::endl;
+        return false;
+    }
+
+    _data = static_cast<char*>(data);
+    _size = fileStat.st_size;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (_data) munmap(_data, _size);
+    _data = 0;
+    _size = 0;
+}
+
+#endif
+
+MemoryStreamBuffer::MemoryStreamBuffer(const char* data, size_t size)
+{
+    // the buffer is only ever read from, std::streambuf just doesn't have a const get area.
+    char* begin = const_cast<char*>(data);
+    setg(begin, begin, begin+size);
+}
+
+MemoryStreamBuffer::pos_type MemoryStreamBuffer::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+{
+    if (!(which & std::ios_base::in)) return pos_type(off_type(-1));
+
+    off_type position = off;
+    if (dir==std::ios_base::cur) position += gptr()-eback();
+    else if (dir==std::ios_base::end) position += egptr()-eback();
+
+    if (position<0 || position>egptr()-eback()) return pos_type(off_type(-1));
+
+    setg(eback(), eback()+position, egptr());
+    return pos_type(position);
+}
+
+MemoryStreamBuffer::pos_type MemoryStreamBuffer::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+MappedStreamBuffer::MappedStreamBuffer(MappedFile* file):
+    MemoryStreamBuffer(file->data(), file->size()),
+    _file(file)
+{
+}
@@ -12,6 +12,7 @@
 */
 
 #include <osgDB/ObjectCache>
+#include <osgDB/ComputeMemoryUsageVisitor>
 
 using namespace osgDB;
 
@@ -19,10 +20,17 @@ using namespace osgDB;
 //
 // ObjectCache
 //
-ObjectCache::ObjectCache():
-    osg::Referenced(true)
+ObjectCache::ObjectCache(unsigned int numShards):
+    osg::Referenced(true),
+    _maximumSizeInBytes(0)
 {
 //    OSG_NOTICE<<"Constructed ObjectCache"<<std::endl;
+
+    if (numShards==0) numShards = 1;
+    for(unsigned int i=0; i<numShards; ++i)
+    {
+        _shards.push_back(new Shard);
+    }
 }
 
 ObjectCache::~ObjectCache()
@@ -30,106 +38,300 @@ ObjectCache::~ObjectCache()
 //    OSG_NOTICE<<"Destructed ObjectCache"<<std::endl;
 }
 
+ObjectCache::Shard& ObjectCache::getShard(const std::string& fileName)
+{
+    // FNV-1a hash of the file name.
+    unsigned int hash = 2166136261u;
+    for(std::string::const_iterator itr = fileName.begin(); itr != fileName.end(); ++itr)
+    {
+        hash = (hash ^ static_cast<unsigned char>(*itr)) * 16777619u;
+    }
+    return *_shards[hash % _shards.size()];
+}
+
+unsigned int ObjectCache::computeSizeInBytes(const osg::Object* object) const
+{
+    ComputeMemoryUsageVisitor cmuv;
+    cmuv.addObject(object);
+    return static_cast<unsigned int>(cmuv.getTotalDataSize());
+}
+
+void ObjectCache::addEntryNoLock(Shard& shard, const std::string& fileName, osg::Object* object, double timestamp, unsigned int sizeInBytes)
+{
+    CacheEntryMap::iterator itr = shard.objectCache.find(fileName);
+    if (itr==shard.objectCache.end())
+    {
+        itr = shard.objectCache.insert(CacheEntryMap::value_type(fileName, CacheEntry())).first;
+        shard.lruList.push_front(fileName);
+    }
+    else
+    {
+        shard.sizeInBytes -= itr->second.sizeInBytes;
+        shard.lruList.erase(itr->second.lruPosition);
+        shard.lruList.push_front(fileName);
+    }
+
+    CacheEntry& entry = itr->second;
+    entry.object = object;
+    entry.timeStamp = timestamp;
+    entry.sizeInBytes = sizeInBytes;
+    entry.lruPosition = shard.lruList.begin();
+    shard.sizeInBytes += sizeInBytes;
+}
+
+void ObjectCache::removeEntryNoLock(Shard& shard, CacheEntryMap::iterator itr)
+{
+    shard.sizeInBytes -= itr->second.sizeInBytes;
+    shard.lruList.erase(itr->second.lruPosition);
+    shard.objectCache.erase(itr);
+}
+
+void ObjectCache::evictNoLock(Shard& shard)
+{
+    if (_maximumSizeInBytes==0) return;
+
+    unsigned long long maximumSizeInBytes = _maximumSizeInBytes/_shards.size();
+
+    FileNameList::iterator litr = shard.lruList.end();
+    while(shard.sizeInBytes>maximumSizeInBytes && litr!=shard.lruList.begin())
+    {
+        --litr;
+
+        CacheEntryMap::iterator itr = shard.objectCache.find(*litr);
+
+        // objects referenced elsewhere would just be loaded again if removed, so keep them.
+        if (itr->second.object.valid() && itr->second.object->referenceCount()>1) continue;
+
+        // step back to the more recently used neighbour before the entry's list position is erased.
+        FileNameList::iterator next = litr;
+        ++next;
+        removeEntryNoLock(shard, itr);
+        litr = next;
+        ++shard.numEvictions;
+    }
+}
+
+void ObjectCache::setMaximumSizeInBytes(unsigned long long size)
+{
+    _maximumSizeInBytes = size;
+
+    for(Shards::iterator itr = _shards.begin(); itr != _shards.end(); ++itr)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock((*itr)->mutex);
+        evictNoLock(**itr);
+    }
+}
+
+unsigned long long ObjectCache::getSizeInBytes() const
+{
+    unsigned long long sizeInBytes = 0;
+    for(Shards::const_iterator itr = _shards.begin(); itr != _shards.end(); ++itr)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock((*itr)->mutex);
+        sizeInBytes += (*itr)->sizeInBytes;
+    }
+    return sizeInBytes;
+}
+
+unsigned int ObjectCache::getNumObjects() const
+{
+    unsigned int numObjects = 0;
+    for(Shards::const_iterator itr = _shards.begin(); itr != _shards.end(); ++itr)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock((*itr)->mutex);
+        numObjects += static_cast<unsigned int>((*itr)->objectCache.size());
+    }
+    return numObjects;
+}
+
+unsigned int ObjectCache::getNumHits() const
+{
+    unsigned int numHits = 0;
+    for(Shards::const_iterator itr = _shards.begin(); itr != _shards.end(); ++itr)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock((*itr)->mutex);
+        numHits += (*itr)->numHits;
+    }
+    return numHits;
+}
+
+unsigned int ObjectCache::getNumMisses() const
+{
+    unsigned int numMisses = 0;
+    for(Shards::const_iterator itr = _shards.begin(); itr != _shards.end(); ++itr)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock((*itr)->mutex);
+        numMisses += (*itr)->numMisses;
+    }
+    return numMisses;
+}
+
+unsigned int ObjectCache::getNumEvictions() const
+{
+    unsigned int numEvictions = 0;
+    for(Shards::const_iterator itr = _shards.begin(); itr != _shards.end(); ++itr)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock((*itr)->mutex);
+        numEvictions += (*itr)->numEvictions;
+    }
+    return numEvictions;
+}
+
+void ObjectCache::resetStats()
+{
+    for(Shards::iterator itr = _shards.begin(); itr != _shards.end(); ++itr)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock((*itr)->mutex);
+        (*itr)->numHits = 0;
+        (*itr)->numMisses = 0;
+        (*itr)->numEvictions = 0;
+    }
+}
+
 void ObjectCache::addObjectCache(ObjectCache* objectCache)
 {
     // don't allow a cache to be added to itself.
     if (objectCache==this) return;
 
-    // lock both ObjectCache to prevent their contents from being modified by other threads while we merge.
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock1(_objectCacheMutex);
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock2(objectCache->_objectCacheMutex);
+    // copy the entries out a shard at a time so that only one cache is locked at once.
+    for(Shards::iterator sitr = objectCache->_shards.begin(); sitr != objectCache->_shards.end(); ++sitr)
+    {
+        CacheEntryMap entries;
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock((*sitr)->mutex);
+            entries = (*sitr)->objectCache;
+        }
 
-    // OSG_NOTICE<<"Inserting objects to main ObjectCache "<<objectCache->_objectCache.size()<<std::endl;
+        // OSG_NOTICE<<"Inserting objects to main ObjectCache "<<entries.size()<<std::endl;
 
-    _objectCache.insert(objectCache->_objectCache.begin(), objectCache->_objectCache.end());
+        for(CacheEntryMap::iterator itr = entries.begin(); itr != entries.end(); ++itr)
+        {
+            Shard& shard = getShard(itr->first);
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard.mutex);
+
+            // existing entries are kept in preference to those being added.
+            if (shard.objectCache.count(itr->first)==0)
+            {
+                addEntryNoLock(shard, itr->first, itr->second.object.get(), itr->second.timeStamp, itr->second.sizeInBytes);
+                evictNoLock(shard);
+            }
+        }
+    }
 }
 
 
 void ObjectCache::addEntryToObjectCache(const std::string& filename, osg::Object* object, double timestamp)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    _objectCache[filename]=ObjectTimeStampPair(object,timestamp);
+    unsigned int sizeInBytes = object ? computeSizeInBytes(object) : 0;
+
+    Shard& shard = getShard(filename);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard.mutex);
+    addEntryNoLock(shard, filename, object, timestamp, sizeInBytes);
+    evictNoLock(shard);
 }
 
 osg::Object* ObjectCache::getFromObjectCache(const std::string& fileName)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    ObjectCacheMap::iterator itr = _objectCache.find(fileName);
-    if (itr!=_objectCache.end()) return itr->second.first.get();
-    else return 0;
+    return getRefFromObjectCache(fileName).get();
 }
 
 osg::ref_ptr<osg::Object> ObjectCache::getRefFromObjectCache(const std::string& fileName)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    ObjectCacheMap::iterator itr = _objectCache.find(fileName);
-    if (itr!=_objectCache.end())
+    Shard& shard = getShard(fileName);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard.mutex);
+    CacheEntryMap::iterator itr = shard.objectCache.find(fileName);
+    if (itr!=shard.objectCache.end())
     {
         // OSG_NOTICE<<"Found "<<fileName<<" in ObjectCache "<<this<<std::endl;
-        return itr->second.first;
+        ++shard.numHits;
+        shard.lruList.splice(shard.lruList.begin(), shard.lruList, itr->second.lruPosition);
+        return itr->second.object;
+    }
+    else
+    {
+        ++shard.numMisses;
+        return 0;
     }
-    else return 0;
 }
 
 void ObjectCache::updateTimeStampOfObjectsInCacheWithExternalReferences(double referenceTime)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-
-    // look for objects with external references and update their time stamp.
-    for(ObjectCacheMap::iterator itr=_objectCache.begin();
-        itr!=_objectCache.end();
-        ++itr)
+    for(Shards::iterator sitr = _shards.begin(); sitr != _shards.end(); ++sitr)
     {
-        // if ref count is greater the 1 the object has an external reference.
-        if (itr->second.first->referenceCount()>1)
+        Shard& shard = **sitr;
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard.mutex);
+
+        // look for objects with external references and update their time stamp.
+        for(CacheEntryMap::iterator itr=shard.objectCache.begin();
+            itr!=shard.objectCache.end();
+            ++itr)
         {
-            // so update it time stamp.
-            itr->second.second = referenceTime;
+            // if ref count is greater the 1 the object has an external reference.
+            if (itr->second.object->referenceCount()>1)
+            {
+                // so update it time stamp.
+                itr->second.timeStamp = referenceTime;
+            }
         }
     }
 }
 
 void ObjectCache::removeExpiredObjectsInCache(double expiryTime)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-
-    // Remove expired entries from object cache
-    ObjectCacheMap::iterator oitr = _objectCache.begin();
-    while(oitr != _objectCache.end())
+    for(Shards::iterator sitr = _shards.begin(); sitr != _shards.end(); ++sitr)
     {
-        if (oitr->second.second<=expiryTime)
-        {
-            _objectCache.erase(oitr++);
-        }
-        else
+        Shard& shard = **sitr;
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard.mutex);
+
+        // Remove expired entries from object cache
+        CacheEntryMap::iterator oitr = shard.objectCache.begin();
+        while(oitr != shard.objectCache.end())
         {
-            ++oitr;
+            if (oitr->second.timeStamp<=expiryTime)
+            {
+                removeEntryNoLock(shard, oitr++);
+            }
+            else
+            {
+                ++oitr;
+            }
         }
     }
 }
 
 void ObjectCache::removeFromObjectCache(const std::string& fileName)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    ObjectCacheMap::iterator itr = _objectCache.find(fileName);
-    if (itr!=_objectCache.end()) _objectCache.erase(itr);
+    Shard& shard = getShard(fileName);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard.mutex);
+    CacheEntryMap::iterator itr = shard.objectCache.find(fileName);
+    if (itr!=shard.objectCache.end()) removeEntryNoLock(shard, itr);
 }
 
 void ObjectCache::clear()
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    _objectCache.clear();
+    for(Shards::iterator sitr = _shards.begin(); sitr != _shards.end(); ++sitr)
+    {
+        Shard& shard = **sitr;
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard.mutex);
+        shard.objectCache.clear();
+        shard.lruList.clear();
+        shard.sizeInBytes = 0;
+    }
 }
 
 void ObjectCache::releaseGLObjects(osg::State* state)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-
-    for(ObjectCacheMap::iterator itr = _objectCache.begin();
-        itr != _objectCache.end();
-        ++itr)
+    for(Shards::iterator sitr = _shards.begin(); sitr != _shards.end(); ++sitr)
     {
-        osg::Object* object = itr->second.first.get();
-        object->releaseGLObjects(state);
+        Shard& shard = **sitr;
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard.mutex);
+
+        for(CacheEntryMap::iterator itr = shard.objectCache.begin();
+            itr != shard.objectCache.end();
+            ++itr)
+        {
+            osg::Object* object = itr->second.object.get();
+            object->releaseGLObjects(state);
+        }
     }
 }
@@ -25,7 +25,7 @@
 using namespace osgDB;
 
 OutputStream::OutputStream( const osgDB::Options* options )
-:   _writeImageHint(WRITE_USE_IMAGE_HINT), _useSchemaData(false), _useRobustBinaryFormat(true)
+:   _writeImageHint(WRITE_USE_IMAGE_HINT), _useSchemaData(false), _useRobustBinaryFormat(true), _dataAlignment(0)
 {
     BEGIN_BRACKET.set( "{", +INDENT_VALUE );
     END_BRACKET.set( "}", -INDENT_VALUE );
@@ -501,6 +501,7 @@ void OutputStream::writeImage( const osg::Image* img )
                 // _data
                 unsigned int size = img->getTotalSizeInBytesIncludingMipmaps();
                 writeSize(size);
+                if ( size>0 ) writeDataAlignment(size);
 
                 for(osg::Image::DataIterator img_itr(img); img_itr.valid(); ++img_itr)
                 {
@@ -720,6 +721,18 @@ void OutputStream::start( OutputIterator* outIterator, OutputStream::WriteType t
             outIterator->setSupportBinaryBrackets( true );
             attributes |= 0x4;
         }
+
+        // Align large blocks of data so they can be referenced directly from a memory mapping, positions in
+        // the stream are only file offsets when the data isn't compressed.
+        if ( _options.valid() && !useCompressSource && _compressorName.empty() )
+        {
+            int alignment = atoi( _options->getPluginStringData("DataAlignment").c_str() );
+            if ( alignment>0 )
+            {
+                _dataAlignment = alignment;
+                attributes |= 0x8;
+            }
+        }
         *this << attributes;
 
         // Record all custom versions
@@ -865,7 +878,17 @@ template<typename T>
 void OutputStream::writeArrayImplementation( const T* a, int write_size, unsigned int numInRow )
 {
     *this << write_size << BEGIN_BRACKET;
-    if ( numInRow>1 )
+    if ( isBinary() )
+    {
+        // the elements are laid out as the reader expects them, so write them as a single block
+        if ( write_size>0 )
+        {
+            unsigned int size = write_size * sizeof((*a)[0]);
+            writeDataAlignment(size);
+            writeCharArray( (const char*)&((*a)[0]), size );
+        }
+    }
+    else if ( numInRow>1 )
     {
         for ( int i=0; i<write_size; ++i )
         {
@@ -887,6 +910,27 @@ void OutputStream::writeArrayImplementation( const T* a, int write_size, unsigne
     *this << END_BRACKET << std::endl;
 }
 
+void OutputStream::writeDataAlignment( unsigned int size )
+{
+    if ( !_dataAlignment ) return;
+
+    // blocks smaller than the alignment are left unpadded, so small arrays don't bloat the file
+    unsigned int padding = 0;
+    std::streampos position = _out->getStream()->tellp();
+    if ( size>=_dataAlignment && position>=0 )
+    {
+        std::streamoff dataPosition = std::streamoff(position) + INT_SIZE;
+        padding = (_dataAlignment - (unsigned int)(dataPosition % _dataAlignment)) % _dataAlignment;
+    }
+
+    *this << padding;
+    if ( padding>0 )
+    {
+        std::vector<char> zeros( padding, 0 );
+        writeCharArray( &zeros.front(), padding );
+    }
+}
+
 unsigned int OutputStream::findOrCreateArrayID( const osg::Array* array, bool& newID )
 {
     ArrayMap::iterator itr = _arrayMap.find( array );
@@ -23,6 +23,8 @@
 #include <osg/Texture2D>
 #include <osg/TextureRectangle>
 
+#include <osgDB/FileNameUtils>
+#include <osgDB/ImageRegion>
 #include <osgDB/Registry>
 #include <osgDB/ReadFile>
 
@@ -109,6 +111,37 @@ osg::ref_ptr<osg::Image> osgDB::readRefImageFile(const std::string& filename,con
     return NULL;
 }
 
+osg::ref_ptr<osg::Image> osgDB::readRefImageInfoFile(const std::string& filename,const Options* options)
+{
+    ReaderWriter::ReadResult rr = Registry::instance()->readImageInfo(filename,options);
+    if (rr.validImage()) return osg::ref_ptr<osg::Image>(rr.getImage());
+    if (rr.status()==ReaderWriter::ReadResult::ERROR_IN_READING_FILE)
+    {
+        OSG_WARN << "Error reading file " << filename << ": " << rr.statusMessage() << std::endl;
+        return NULL;
+    }
+
+    // no plugin or archive could read the info on its own, so fall back to reading the whole image.
+    return readRefImageFile(filename,options);
+}
+
+osg::ref_ptr<osg::Image> osgDB::readRefImageRegionFile(const std::string& filename,int x,int y,int width,int height,unsigned int reductionLevel,const Options* options)
+{
+    ReaderWriter::ReadResult rr = Registry::instance()->readImageRegion(filename,x,y,width,height,reductionLevel,options);
+    if (rr.validImage()) return osg::ref_ptr<osg::Image>(rr.getImage());
+    if (rr.status()==ReaderWriter::ReadResult::ERROR_IN_READING_FILE)
+    {
+        OSG_WARN << "Error reading region of file " << filename << ": " << rr.statusMessage() << std::endl;
+        return NULL;
+    }
+
+    // fall back to decoding the whole image.
+    osg::ref_ptr<osg::Image> image = readRefImageFile(filename,options);
+    if (!image) return NULL;
+
+    return osg::ref_ptr<osg::Image>(createImageRegion(image.get(),x,y,width,height,reductionLevel));
+}
+
 osg::ref_ptr<osg::Shader> osgDB::readRefShaderFile(const std::string& filename,const Options* options)
 {
     ReaderWriter::ReadResult rr = Registry::instance()->readShader(filename,options);
@@ -62,6 +62,10 @@ static osg::ApplicationUsageProxy Registry_e1(osg::ApplicationUsage::ENVIRONMENT
 #endif
 
 static osg::ApplicationUsageProxy Registry_e2(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_BUILD_KDTREES on/off","Enable/disable the automatic building of KdTrees for each loaded Geometry.");
+static osg::ApplicationUsageProxy Registry_e3(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_KDTREE_SPLIT_STRATEGY SAH/MIDPOINT","Set the scheme used to choose the split planes when building KdTrees.");
+static osg::ApplicationUsageProxy Registry_e4(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_KDTREE_BUILD_THREADS <int>","Set the number of threads used to build each large KdTree.");
+static osg::ApplicationUsageProxy Registry_e5(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_OBJECT_CACHE_MAX_SIZE <MB>","Set the maximum approximate size of the objects held in the ObjectCache, evicting the least recently used objects without external references.");
+static osg::ApplicationUsageProxy Registry_e6(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_SHARE_DATA <ON/OFF>","Enable/disable the sharing of identical images, arrays and textures between the subgraphs loaded by the DatabasePager.");
 
 
 // from MimeTypes.cpp
@@ -236,6 +240,17 @@ Registry::Registry()
 
     const char* ptr=0;
 
+    if ((ptr = getenv("OSG_KDTREE_SPLIT_STRATEGY")) != 0)
+    {
+        if (strcmp(ptr, "SAH")==0 || strcmp(ptr, "sah")==0) _kdTreeBuilder->_buildOptions._splitStrategy = osg::KdTree::BuildOptions::SURFACE_AREA_HEURISTIC;
+        else if (strcmp(ptr, "MIDPOINT")==0 || strcmp(ptr, "midpoint")==0) _kdTreeBuilder->_buildOptions._splitStrategy = osg::KdTree::BuildOptions::MIDPOINT_SPLIT;
+    }
+
+    if ((ptr = getenv("OSG_KDTREE_BUILD_THREADS")) != 0)
+    {
+        _kdTreeBuilder->_buildOptions._numThreads = osg::maximum(atoi(ptr), 1);
+    }
+
     _expiryDelay = 10.0;
     if( (ptr = getenv("OSG_EXPIRY_DELAY")) != 0)
     {
@@ -251,6 +266,16 @@ Registry::Registry()
 
     // assign ObjectCache.
     _objectCache = new ObjectCache;
+    if( (ptr = getenv("OSG_OBJECT_CACHE_MAX_SIZE")) != 0)
+    {
+        _objectCache->setMaximumSizeInBytes(static_cast<unsigned long long>(osg::asciiToDouble(ptr)*1024.0*1024.0));
+        OSG_INFO<<"Registry : ObjectCache maximum size = "<<_objectCache->getMaximumSizeInBytes()<<std::endl;
+    }
+
+    if( (ptr = getenv("OSG_SHARE_DATA")) != 0)
+    {
+        if (strcmp(ptr,"ON")==0 || strcmp(ptr,"on")==0) _sharedDataManager = new SharedDataManager;
+    }
 
     _createNodeFromImage = false;
     _openingLibrary = false;
@@ -478,6 +503,8 @@ void Registry::destruct()
     // clean up the SharedStateManager
     _sharedStateManager = 0;
 
+    _sharedDataManager = 0;
+
 
     // clean up the FileCache
     _fileCache = 0;
@@ -623,7 +650,11 @@ ImageProcessor* Registry::getImageProcessor()
             return _ipList.front().get();
         }
     }
-    return getImageProcessorForExtension("nvtt");
+
+    // fall back to the built in BCn compressor when nvtt isn't available.
+    ImageProcessor* ip = getImageProcessorForExtension("nvtt");
+    if (!ip) ip = getImageProcessorForExtension("bcn");
+    return ip;
 }
 
 ImageProcessor* Registry::getImageProcessorForExtension(const std::string& ext)
@@ -930,6 +961,40 @@ struct Registry::ReadImageFunctor : public Registry::ReadFunctor
     virtual ReadFunctor* cloneType(const std::string& filename, const Options* options) const { return new ReadImageFunctor(filename, options); }
 };
 
+struct Registry::ReadImageInfoFunctor : public Registry::ReadFunctor
+{
+    ReadImageInfoFunctor(const std::string& filename, const Options* options):ReadFunctor(filename,options) {}
+
+    virtual ReaderWriter::ReadResult doRead(ReaderWriter& rw)const  { return rw.readImageInfo(_filename, _options); }
+    virtual bool isValid(ReaderWriter::ReadResult& readResult) const { return readResult.validImage(); }
+    virtual bool isValid(osg::Object* object) const { return dynamic_cast<osg::Image*>(object)!=0;  }
+
+    virtual ReadFunctor* cloneType(const std::string& filename, const Options* options) const { return new ReadImageInfoFunctor(filename, options); }
+};
+
+struct Registry::ReadImageRegionFunctor : public Registry::ReadFunctor
+{
+    ReadImageRegionFunctor(const std::string& filename, int x, int y, int width, int height, unsigned int reductionLevel, const Options* options):
+        ReadFunctor(filename,options),
+        _x(x),
+        _y(y),
+        _width(width),
+        _height(height),
+        _reductionLevel(reductionLevel) {}
+
+    int _x;
+    int _y;
+    int _width;
+    int _height;
+    unsigned int _reductionLevel;
+
+    virtual ReaderWriter::ReadResult doRead(ReaderWriter& rw)const  { return rw.readImageRegion(_filename, _x, _y, _width, _height, _reductionLevel, _options); }
+    virtual bool isValid(ReaderWriter::ReadResult& readResult) const { return readResult.validImage(); }
+    virtual bool isValid(osg::Object* object) const { return dynamic_cast<osg::Image*>(object)!=0;  }
+
+    virtual ReadFunctor* cloneType(const std::string& filename, const Options* options) const { return new ReadImageRegionFunctor(filename, _x, _y, _width, _height, _reductionLevel, options); }
+};
+
 struct Registry::ReadHeightFieldFunctor : public Registry::ReadFunctor
 {
     ReadHeightFieldFunctor(const std::string& filename, const Options* options):ReadFunctor(filename,options) {}
@@ -1362,6 +1427,17 @@ ReaderWriter::ReadResult Registry::readImageImplementation(const std::string& fi
     return readImplementation(ReadImageFunctor(fileName, options),Options::CACHE_IMAGES);
 }
 
+ReaderWriter::ReadResult Registry::readImageInfoImplementation(const std::string& fileName,const Options* options)
+{
+    // image infos and regions hold only part of the file so mustn't be cached under its name.
+    return readImplementation(ReadImageInfoFunctor(fileName, options),Options::CACHE_NONE);
+}
+
+ReaderWriter::ReadResult Registry::readImageRegionImplementation(const std::string& fileName,int x,int y,int width,int height,unsigned int reductionLevel,const Options* options)
+{
+    return readImplementation(ReadImageRegionFunctor(fileName, x, y, width, height, reductionLevel, options),Options::CACHE_NONE);
+}
+
 ReaderWriter::WriteResult Registry::writeImageImplementation(const Image& image,const std::string& fileName,const Options* options)
 {
     // record the errors reported by readerwriters.
@@ -1684,6 +1760,13 @@ SharedStateManager* Registry::getOrCreateSharedStateManager()
     return _sharedStateManager.get();
 }
 
+SharedDataManager* Registry::getOrCreateSharedDataManager()
+{
+    if (!_sharedDataManager) _sharedDataManager = new SharedDataManager;
+
+    return _sharedDataManager.get();
+}
+
 
 void Registry::registerProtocol(const std::string& protocol)
 {
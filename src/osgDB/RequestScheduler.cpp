@@ -0,0 +1,187 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgDB/RequestScheduler>
+
+#include <osg/PagedLOD>
+#include <osg/ProxyNode>
+#include <osg/Transform>
+
+#include <OpenThreads/ScopedLock>
+
+using namespace osgDB;
+
+RequestScheduler::RequestScheduler():
+    _maximumNumTileStats(1000)
+{
+    resetStats();
+}
+
+RequestScheduler::RequestScheduler(const RequestScheduler& rhs):
+    osg::Referenced(),
+    _maximumNumTileStats(rhs._maximumNumTileStats)
+{
+    resetStats();
+}
+
+void RequestScheduler::updateView(const osg::Camera&, const osg::FrameStamp&)
+{
+}
+
+float RequestScheduler::computePriority(const std::string&, const osg::NodePath&, float priority, const osg::FrameStamp*)
+{
+    return priority;
+}
+
+void RequestScheduler::tileMerged(const std::string& fileName, double timeToFirstVisible, unsigned int numFramesToFirstVisible)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_statsMutex);
+
+    if (_maximumNumTileStats>0)
+    {
+        _tileStatsList.push_back(TileStats(fileName, timeToFirstVisible, numFramesToFirstVisible));
+        while(_tileStatsList.size()>_maximumNumTileStats) _tileStatsList.pop_front();
+    }
+
+    if (timeToFirstVisible>_maximumTimeToFirstVisible) _maximumTimeToFirstVisible = timeToFirstVisible;
+    _totalTimeToFirstVisible += timeToFirstVisible;
+    _totalNumFramesToFirstVisible += numFramesToFirstVisible;
+    ++_numTilesMerged;
+}
+
+void RequestScheduler::getTileStatsList(TileStatsList& tileStatsList) const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_statsMutex);
+    tileStatsList = _tileStatsList;
+}
+
+void RequestScheduler::resetStats()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_statsMutex);
+
+    _tileStatsList.clear();
+    _numTilesMerged = 0;
+    _maximumTimeToFirstVisible = 0.0;
+    _totalTimeToFirstVisible = 0.0;
+    _totalNumFramesToFirstVisible = 0;
+}
+
+
+ScreenSpaceErrorRequestScheduler::ScreenSpaceErrorRequestScheduler():
+    _lookAheadTime(0.5),
+    _velocitySmoothing(0.3),
+    _referencePixelSize(64.0f),
+    _parentBeforeChild(true),
+    _frameNumber(0),
+    _referenceTime(0.0),
+    _pixelScale(0.0),
+    _perspective(true)
+{
+}
+
+ScreenSpaceErrorRequestScheduler::ScreenSpaceErrorRequestScheduler(const ScreenSpaceErrorRequestScheduler& rhs):
+    RequestScheduler(rhs),
+    _lookAheadTime(rhs._lookAheadTime),
+    _velocitySmoothing(rhs._velocitySmoothing),
+    _referencePixelSize(rhs._referencePixelSize),
+    _parentBeforeChild(rhs._parentBeforeChild),
+    _frameNumber(0),
+    _referenceTime(0.0),
+    _pixelScale(0.0),
+    _perspective(true)
+{
+}
+
+void ScreenSpaceErrorRequestScheduler::updateView(const osg::Camera& camera, const osg::FrameStamp& frameStamp)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_viewMutex);
+
+    // with a CompositeViewer several views may share a scene, so only the first view of each frame is used.
+    if (_frameNumber==frameStamp.getFrameNumber() && _pixelScale!=0.0) return;
+
+    osg::Vec3d eyePoint = osg::Matrixd::inverse(camera.getViewMatrix()).getTrans();
+
+    double deltaTime = frameStamp.getReferenceTime()-_referenceTime;
+    if (_pixelScale!=0.0 && deltaTime>0.0)
+    {
+        _velocity = _velocity*(1.0-_velocitySmoothing) + (eyePoint-_eyePoint)*(_velocitySmoothing/deltaTime);
+    }
+
+    _frameNumber = frameStamp.getFrameNumber();
+    _referenceTime = frameStamp.getReferenceTime();
+    _eyePoint = eyePoint;
+    _predictedEyePoint = _eyePoint + _velocity*_lookAheadTime;
+
+    // the number of pixels a unit length spans at unit distance, or at any distance for an orthographic projection.
+    const osg::Matrixd& projection = camera.getProjectionMatrix();
+    double height = camera.getViewport() ? camera.getViewport()->height() : 1024.0;
+    _perspective = projection(3,3)==0.0;
+    _pixelScale = 0.5*height*osg::absolute(projection(1,1));
+}
+
+float ScreenSpaceErrorRequestScheduler::computePriority(const std::string&, const osg::NodePath& nodePath, float priority, const osg::FrameStamp*)
+{
+    osg::Vec3d predictedEyePoint;
+    double pixelScale;
+    bool perspective;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_viewMutex);
+        predictedEyePoint = _predictedEyePoint;
+        pixelScale = _pixelScale;
+        perspective = _perspective;
+    }
+
+    // without a view fall back to the priority computed by the PagedLOD.
+    if (nodePath.empty() || pixelScale==0.0) return priority;
+
+    const osg::Node* node = nodePath.back();
+    osg::Vec3d center = node->getBound().center();
+    double radius = node->getBound().radius();
+    if (const osg::LOD* lod = dynamic_cast<const osg::LOD*>(node))
+    {
+        center = lod->getCenter();
+        if (lod->getRadius()>=0.0f) radius = lod->getRadius();
+    }
+    else if (const osg::ProxyNode* proxyNode = dynamic_cast<const osg::ProxyNode*>(node))
+    {
+        center = proxyNode->getCenter();
+        if (proxyNode->getRadius()>=0.0f) radius = proxyNode->getRadius();
+    }
+
+    osg::Matrixd localToWorld = osg::computeLocalToWorld(nodePath);
+    center = center*localToWorld;
+    radius *= osg::maximum(localToWorld.getScale().x(), osg::maximum(localToWorld.getScale().y(), localToWorld.getScale().z()));
+
+    double pixelSize = radius*pixelScale;
+    if (perspective)
+    {
+        double distance = osg::maximum((center-predictedEyePoint).length()-radius, radius*0.1);
+        pixelSize = distance>0.0 ? pixelSize/distance : 0.0;
+    }
+
+    // map the pixel size into [0,1) so that it can be banded by depth.
+    float score = static_cast<float>(pixelSize/(pixelSize+_referencePixelSize));
+
+    if (_parentBeforeChild)
+    {
+        unsigned int depth = 0;
+        for(unsigned int i=0; i+1<nodePath.size(); ++i)
+        {
+            // asGroup() is a cheap virtual call, so only the groups along the path need the dynamic_cast.
+            if (nodePath[i]->asGroup() && dynamic_cast<const osg::PagedLOD*>(nodePath[i])) ++depth;
+        }
+        score -= static_cast<float>(depth);
+    }
+
+    return score;
+}
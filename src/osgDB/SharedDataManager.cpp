@@ -0,0 +1,371 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgDB/SharedDataManager>
+#include <osgDB/ComputeMemoryUsageVisitor>
+
+#include <OpenThreads/ScopedLock>
+
+#include <string.h>
+
+using namespace osgDB;
+
+namespace
+{
+
+// 64 bit FNV-1a hash.
+inline unsigned long long hashBytes(unsigned long long hash, const void* data, unsigned int size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for(unsigned int i=0; i<size; ++i)
+    {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+template<typename T>
+inline unsigned long long hashValue(unsigned long long hash, T value)
+{
+    return hashBytes(hash, &value, sizeof(T));
+}
+
+const unsigned long long s_hashSeed = 14695981039346656037ull;
+
+bool imageHasDataToShare(const osg::Image& image)
+{
+    return image.data()!=0 && image.getDataVariance()!=osg::Object::DYNAMIC && !image.requiresUpdateCall();
+}
+
+unsigned long long hashImage(const osg::Image& image)
+{
+    unsigned long long hash = s_hashSeed;
+    hash = hashValue(hash, image.s());
+    hash = hashValue(hash, image.t());
+    hash = hashValue(hash, image.r());
+    hash = hashValue(hash, image.getPixelFormat());
+    hash = hashValue(hash, image.getDataType());
+    hash = hashValue(hash, image.getInternalTextureFormat());
+
+    // hash the image a block at a time, as images with several blocks may not be contiguous.
+    for(osg::Image::DataIterator itr(&image); itr.valid(); ++itr)
+    {
+        hash = hashBytes(hash, itr.data(), itr.size());
+    }
+    return hash;
+}
+
+bool equalImages(const osg::Image& lhs, const osg::Image& rhs)
+{
+    if (lhs.s()!=rhs.s() || lhs.t()!=rhs.t() || lhs.r()!=rhs.r() ||
+        lhs.getPixelFormat()!=rhs.getPixelFormat() ||
+        lhs.getDataType()!=rhs.getDataType() ||
+        lhs.getInternalTextureFormat()!=rhs.getInternalTextureFormat() ||
+        lhs.getPacking()!=rhs.getPacking() ||
+        lhs.getOrigin()!=rhs.getOrigin() ||
+        lhs.getRowLength()!=rhs.getRowLength() ||
+        lhs.getMipmapLevels()!=rhs.getMipmapLevels() ||
+        lhs.getTotalDataSize()!=rhs.getTotalDataSize()) return false;
+
+    osg::Image::DataIterator litr(&lhs);
+    osg::Image::DataIterator ritr(&rhs);
+    for(; litr.valid() && ritr.valid(); ++litr, ++ritr)
+    {
+        if (litr.size()!=ritr.size() || memcmp(litr.data(), ritr.data(), litr.size())!=0) return false;
+    }
+    return !litr.valid() && !ritr.valid();
+}
+
+unsigned long long hashArray(const osg::Array& array)
+{
+    unsigned long long hash = s_hashSeed;
+    hash = hashValue(hash, array.getType());
+    hash = hashValue(hash, array.getDataSize());
+    hash = hashValue(hash, array.getDataType());
+    hash = hashValue(hash, array.getBinding());
+    hash = hashValue(hash, array.getNormalize());
+    return hashBytes(hash, array.getDataPointer(), array.getTotalDataSize());
+}
+
+bool equalArrays(const osg::Array& lhs, const osg::Array& rhs)
+{
+    return lhs.getType()==rhs.getType() &&
+           lhs.getDataSize()==rhs.getDataSize() &&
+           lhs.getDataType()==rhs.getDataType() &&
+           lhs.getBinding()==rhs.getBinding() &&
+           lhs.getNormalize()==rhs.getNormalize() &&
+           lhs.getPreserveDataType()==rhs.getPreserveDataType() &&
+           lhs.getTotalDataSize()==rhs.getTotalDataSize() &&
+           memcmp(lhs.getDataPointer(), rhs.getDataPointer(), lhs.getTotalDataSize())==0;
+}
+
+bool textureHasDataToShare(const osg::Texture& texture)
+{
+    if (texture.getDataVariance()==osg::Object::DYNAMIC || texture.getUpdateCallback() || texture.getEventCallback() ||
+        texture.getNumImages()==0) return false;
+
+    for(unsigned int i=0; i<texture.getNumImages(); ++i)
+    {
+        if (!texture.getImage(i)) return false;
+    }
+    return true;
+}
+
+// textures are matched by the images they hold, so hash the image pointers rather than their data.
+unsigned long long hashTexture(const osg::Texture& texture)
+{
+    unsigned long long hash = s_hashSeed;
+    hash = hashValue(hash, texture.getTextureTarget());
+    for(unsigned int i=0; i<texture.getNumImages(); ++i)
+    {
+        hash = hashValue(hash, texture.getImage(i));
+    }
+    return hash;
+}
+
+// Share the arrays, images and textures of a subgraph as they are visited by ComputeMemoryUsageVisitor.
+class ShareDataVisitor : public ComputeMemoryUsageVisitor
+{
+public:
+
+    ShareDataVisitor(SharedDataManager& manager):
+        _manager(manager)
+    {
+    }
+
+    virtual void apply(osg::Geometry& geometry)
+    {
+        if ((_manager.getShareMode() & SharedDataManager::SHARE_ARRAYS)!=0)
+        {
+            osg::ref_ptr<osg::Array> array;
+            if ((array = share(geometry.getVertexArray()))!=geometry.getVertexArray()) geometry.setVertexArray(array.get());
+            if ((array = share(geometry.getNormalArray()))!=geometry.getNormalArray()) geometry.setNormalArray(array.get());
+            if ((array = share(geometry.getColorArray()))!=geometry.getColorArray()) geometry.setColorArray(array.get());
+            if ((array = share(geometry.getSecondaryColorArray()))!=geometry.getSecondaryColorArray()) geometry.setSecondaryColorArray(array.get());
+            if ((array = share(geometry.getFogCoordArray()))!=geometry.getFogCoordArray()) geometry.setFogCoordArray(array.get());
+            for(unsigned int i=0; i<geometry.getNumTexCoordArrays(); ++i)
+            {
+                if ((array = share(geometry.getTexCoordArray(i)))!=geometry.getTexCoordArray(i)) geometry.setTexCoordArray(i, array.get());
+            }
+            for(unsigned int i=0; i<geometry.getNumVertexAttribArrays(); ++i)
+            {
+                if ((array = share(geometry.getVertexAttribArray(i)))!=geometry.getVertexAttribArray(i)) geometry.setVertexAttribArray(i, array.get());
+            }
+        }
+
+        ComputeMemoryUsageVisitor::apply(geometry);
+    }
+
+    virtual void apply(osg::StateSet* stateset)
+    {
+        if (!stateset) return;
+
+        for(unsigned int unit=0; unit<stateset->getTextureAttributeList().size(); ++unit)
+        {
+            const osg::StateSet::RefAttributePair* attributePair = stateset->getTextureAttributePair(unit, osg::StateAttribute::TEXTURE);
+            osg::Texture* texture = attributePair ? dynamic_cast<osg::Texture*>(attributePair->first.get()) : 0;
+            if (!texture) continue;
+
+            // the images are shared first so that textures holding duplicate images then hold the same ones.
+            if ((_manager.getShareMode() & SharedDataManager::SHARE_IMAGES)!=0 && _imagesShared.insert(texture).second)
+            {
+                for(unsigned int i=0; i<texture->getNumImages(); ++i)
+                {
+                    osg::Image* image = texture->getImage(i);
+                    if (!image) continue;
+
+                    osg::ref_ptr<osg::Image> sharedImage = _manager.share(image);
+                    if (sharedImage!=image) texture->setImage(i, sharedImage.get());
+                }
+            }
+
+            if ((_manager.getShareMode() & SharedDataManager::SHARE_TEXTURES)!=0)
+            {
+                osg::ref_ptr<osg::Texture> sharedTexture = _manager.share(texture);
+                if (sharedTexture!=texture) stateset->setTextureAttribute(unit, sharedTexture.get(), attributePair->second);
+            }
+        }
+
+        ComputeMemoryUsageVisitor::apply(stateset);
+    }
+
+    osg::ref_ptr<osg::Array> share(osg::Array* array)
+    {
+        return array ? _manager.share(array) : 0;
+    }
+
+    SharedDataManager& _manager;
+    std::set<const osg::Texture*> _imagesShared;
+
+protected:
+
+    ShareDataVisitor& operator = (const ShareDataVisitor&) { return *this; }
+};
+
+}
+
+SharedDataManager::SharedDataManager(unsigned int mode):
+    _shareMode(mode),
+    _minimumSizeInBytes(256),
+    _numRecordedAtLastPrune(0),
+    _numImagesShared(0),
+    _numArraysShared(0),
+    _numTexturesShared(0),
+    _bytesSaved(0)
+{
+}
+
+void SharedDataManager::share(osg::Node* node)
+{
+    if (!node || _shareMode==SHARE_NONE) return;
+
+    ShareDataVisitor sdv(*this);
+    node->accept(sdv);
+}
+
+osg::ref_ptr<osg::Image> SharedDataManager::share(osg::Image* image)
+{
+    if (!image || !imageHasDataToShare(*image) || image->getTotalDataSize()<_minimumSizeInBytes) return image;
+
+    // hash outside of the lock so that threads only contend over the lookup.
+    unsigned long long hash = hashImage(*image);
+    return static_cast<osg::Image*>(find(image, hash, true).get());
+}
+
+osg::ref_ptr<osg::Array> SharedDataManager::share(osg::Array* array)
+{
+    if (!array || array->getDataVariance()==osg::Object::DYNAMIC || array->getTotalDataSize()<_minimumSizeInBytes) return array;
+
+    unsigned long long hash = hashArray(*array);
+    return static_cast<osg::Array*>(find(array, hash, false).get());
+}
+
+osg::ref_ptr<osg::Texture> SharedDataManager::share(osg::Texture* texture)
+{
+    if (!texture || !textureHasDataToShare(*texture)) return texture;
+
+    unsigned long long hash = hashTexture(*texture);
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+    std::pair<TextureMap::iterator, TextureMap::iterator> range = _textureMap.equal_range(hash);
+    for(TextureMap::iterator itr = range.first; itr != range.second; )
+    {
+        osg::ref_ptr<osg::Texture> candidate;
+        if (!itr->second.lock(candidate))
+        {
+            _textureMap.erase(itr++);
+            continue;
+        }
+
+        if (candidate==texture) return texture;
+
+        if (textureHasDataToShare(*candidate) && candidate->compare(*texture)==0)
+        {
+            ++_numTexturesShared;
+            return candidate;
+        }
+
+        ++itr;
+    }
+
+    _textureMap.insert(TextureMap::value_type(hash, texture));
+
+    if (_bufferDataMap.size()+_textureMap.size()>2*_numRecordedAtLastPrune+1024) pruneDeleted();
+
+    return texture;
+}
+
+osg::ref_ptr<osg::BufferData> SharedDataManager::find(osg::BufferData* data, unsigned long long hash, bool isImage)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+    std::pair<BufferDataMap::iterator, BufferDataMap::iterator> range = _bufferDataMap.equal_range(hash);
+    for(BufferDataMap::iterator itr = range.first; itr != range.second; )
+    {
+        osg::ref_ptr<osg::BufferData> candidate;
+        if (!itr->second.lock(candidate))
+        {
+            _bufferDataMap.erase(itr++);
+            continue;
+        }
+
+        if (candidate==data) return data;
+
+        bool equal = false;
+        if (isImage)
+        {
+            const osg::Image* candidateImage = candidate->asImage();
+            equal = candidateImage && imageHasDataToShare(*candidateImage) && equalImages(*candidateImage, *data->asImage());
+        }
+        else
+        {
+            const osg::Array* candidateArray = candidate->asArray();
+            equal = candidateArray && candidateArray->getDataVariance()!=osg::Object::DYNAMIC && equalArrays(*candidateArray, *data->asArray());
+        }
+
+        if (equal)
+        {
+            if (isImage) ++_numImagesShared;
+            else ++_numArraysShared;
+            _bytesSaved += data->getTotalDataSize();
+
+            return candidate;
+        }
+
+        ++itr;
+    }
+
+    _bufferDataMap.insert(BufferDataMap::value_type(hash, data));
+
+    // remove the records of deleted data once the maps have doubled in size since the last prune.
+    if (_bufferDataMap.size()+_textureMap.size()>2*_numRecordedAtLastPrune+1024) pruneDeleted();
+
+    return data;
+}
+
+void SharedDataManager::pruneDeleted()
+{
+    for(BufferDataMap::iterator itr = _bufferDataMap.begin(); itr != _bufferDataMap.end(); )
+    {
+        if (!itr->second.valid()) _bufferDataMap.erase(itr++);
+        else ++itr;
+    }
+    for(TextureMap::iterator itr = _textureMap.begin(); itr != _textureMap.end(); )
+    {
+        if (!itr->second.valid()) _textureMap.erase(itr++);
+        else ++itr;
+    }
+    _numRecordedAtLastPrune = static_cast<unsigned int>(_bufferDataMap.size()+_textureMap.size());
+}
+
+void SharedDataManager::prune()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    pruneDeleted();
+}
+
+unsigned int SharedDataManager::getNumRecorded() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    return static_cast<unsigned int>(_bufferDataMap.size()+_textureMap.size());
+}
+
+void SharedDataManager::resetStats()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    _numImagesShared = 0;
+    _numArraysShared = 0;
+    _numTexturesShared = 0;
+    _bytesSaved = 0;
+}
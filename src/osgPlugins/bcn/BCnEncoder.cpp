@@ -0,0 +1,606 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include "BCnEncoder.h"
+
+#include <osg/Math>
+
+#include <algorithm>
+#include <float.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+    #define BCN_USE_SSE2 1
+    #include <emmintrin.h>
+#endif
+
+using namespace bcn;
+
+namespace
+{
+
+// the number of least squares refinements of the endpoints made at each quality.
+unsigned int numRefinements(Quality quality)
+{
+    switch(quality)
+    {
+        case(osgDB::ImageProcessor::FASTEST): return 0;
+        case(osgDB::ImageProcessor::NORMAL): return 1;
+        case(osgDB::ImageProcessor::PRODUCTION): return 2;
+        default: return 4;
+    }
+}
+
+inline float clampChannel(float v)
+{
+    return v<0.0f ? 0.0f : (v>255.0f ? 255.0f : v);
+}
+
+inline void writeUInt16(unsigned int value, unsigned char* output)
+{
+    output[0] = static_cast<unsigned char>(value & 0xff);
+    output[1] = static_cast<unsigned char>((value>>8) & 0xff);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Colour blocks
+//
+unsigned int packRGB565(const float colour[3])
+{
+    unsigned int r = static_cast<unsigned int>(clampChannel(colour[0])*(31.0f/255.0f)+0.5f);
+    unsigned int g = static_cast<unsigned int>(clampChannel(colour[1])*(63.0f/255.0f)+0.5f);
+    unsigned int b = static_cast<unsigned int>(clampChannel(colour[2])*(31.0f/255.0f)+0.5f);
+    return (r<<11) | (g<<5) | b;
+}
+
+void unpackRGB565(unsigned int colour, float output[3])
+{
+    unsigned int r = (colour>>11) & 31;
+    unsigned int g = (colour>>5) & 63;
+    unsigned int b = colour & 31;
+    output[0] = static_cast<float>((r<<3) | (r>>2));
+    output[1] = static_cast<float>((g<<2) | (g>>4));
+    output[2] = static_cast<float>((b<<3) | (b>>2));
+}
+
+/** Select the nearest of the palette colours for each pixel, returning the sum of the weighted squared errors.*/
+float selectColourIndices(const Block& block, const float* weights, const float palette[4][3], unsigned int numColours, unsigned char* indices)
+{
+#ifdef BCN_USE_SSE2
+    __m128 total = _mm_setzero_ps();
+    for(unsigned int i=0; i<16; i+=4)
+    {
+        __m128 r = _mm_loadu_ps(block.r+i);
+        __m128 g = _mm_loadu_ps(block.g+i);
+        __m128 b = _mm_loadu_ps(block.b+i);
+
+        __m128 best = _mm_set1_ps(FLT_MAX);
+        __m128 bestIndex = _mm_setzero_ps();
+        for(unsigned int c=0; c<numColours; ++c)
+        {
+            __m128 dr = _mm_sub_ps(r, _mm_set1_ps(palette[c][0]));
+            __m128 dg = _mm_sub_ps(g, _mm_set1_ps(palette[c][1]));
+            __m128 db = _mm_sub_ps(b, _mm_set1_ps(palette[c][2]));
+            __m128 d = _mm_add_ps(_mm_mul_ps(dr, dr), _mm_add_ps(_mm_mul_ps(dg, dg), _mm_mul_ps(db, db)));
+
+            __m128 closer = _mm_cmplt_ps(d, best);
+            best = _mm_min_ps(d, best);
+            bestIndex = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps(static_cast<float>(c))), _mm_andnot_ps(closer, bestIndex));
+        }
+
+        total = _mm_add_ps(total, _mm_mul_ps(best, _mm_loadu_ps(weights+i)));
+
+        int pixelIndices[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pixelIndices), _mm_cvttps_epi32(bestIndex));
+        for(unsigned int j=0; j<4; ++j) indices[i+j] = static_cast<unsigned char>(pixelIndices[j]);
+    }
+
+    float sums[4];
+    _mm_storeu_ps(sums, total);
+    return (sums[0]+sums[1])+(sums[2]+sums[3]);
+#else
+    float total = 0.0f;
+    for(unsigned int i=0; i<16; ++i)
+    {
+        float best = FLT_MAX;
+        for(unsigned int c=0; c<numColours; ++c)
+        {
+            float dr = block.r[i]-palette[c][0];
+            float dg = block.g[i]-palette[c][1];
+            float db = block.b[i]-palette[c][2];
+            float d = dr*dr+dg*dg+db*db;
+            if (d<best)
+            {
+                best = d;
+                indices[i] = static_cast<unsigned char>(c);
+            }
+        }
+        total += best*weights[i];
+    }
+    return total;
+#endif
+}
+
+/** Compute the endpoints of the colours' bounding box, inset a little as the extremes are rarely worth the error elsewhere.*/
+void computeBoundingEndpoints(const Block& block, const float* weights, float start[3], float end[3])
+{
+    const float* channels[3] = { block.r, block.g, block.b };
+    for(unsigned int c=0; c<3; ++c)
+    {
+        float minimum = 255.0f;
+        float maximum = 0.0f;
+        for(unsigned int i=0; i<16; ++i)
+        {
+            if (weights[i]==0.0f) continue;
+            minimum = osg::minimum(minimum, channels[c][i]);
+            maximum = osg::maximum(maximum, channels[c][i]);
+        }
+
+        float inset = (maximum-minimum)/16.0f;
+        start[c] = maximum-inset;
+        end[c] = minimum+inset;
+    }
+}
+
+/** Compute the endpoints of the line along the colours' principal axis that spans their projections onto it.*/
+void computePrincipalEndpoints(const Block& block, const float* weights, float start[3], float end[3])
+{
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    float totalWeight = 0.0f;
+    for(unsigned int i=0; i<16; ++i)
+    {
+        mean[0] += block.r[i]*weights[i];
+        mean[1] += block.g[i]*weights[i];
+        mean[2] += block.b[i]*weights[i];
+        totalWeight += weights[i];
+    }
+    for(unsigned int c=0; c<3; ++c) mean[c] /= totalWeight;
+
+    // covariance matrix, xx xy xz yy yz zz
+    float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    for(unsigned int i=0; i<16; ++i)
+    {
+        float r = (block.r[i]-mean[0])*weights[i];
+        float g = (block.g[i]-mean[1])*weights[i];
+        float b = (block.b[i]-mean[2])*weights[i];
+        covariance[0] += r*r;
+        covariance[1] += r*g;
+        covariance[2] += r*b;
+        covariance[3] += g*g;
+        covariance[4] += g*b;
+        covariance[5] += b*b;
+    }
+
+    // find the principal axis by power iteration, starting from the luminance axis.
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for(unsigned int iteration=0; iteration<8; ++iteration)
+    {
+        float x = covariance[0]*axis[0] + covariance[1]*axis[1] + covariance[2]*axis[2];
+        float y = covariance[1]*axis[0] + covariance[3]*axis[1] + covariance[4]*axis[2];
+        float z = covariance[2]*axis[0] + covariance[4]*axis[1] + covariance[5]*axis[2];
+
+        float length = osg::maximum(osg::absolute(x), osg::maximum(osg::absolute(y), osg::absolute(z)));
+        if (length<FLT_EPSILON) break;
+
+        axis[0] = x/length;
+        axis[1] = y/length;
+        axis[2] = z/length;
+    }
+
+    float minimum = FLT_MAX;
+    float maximum = -FLT_MAX;
+    for(unsigned int i=0; i<16; ++i)
+    {
+        if (weights[i]==0.0f) continue;
+        float t = (block.r[i]-mean[0])*axis[0] + (block.g[i]-mean[1])*axis[1] + (block.b[i]-mean[2])*axis[2];
+        minimum = osg::minimum(minimum, t);
+        maximum = osg::maximum(maximum, t);
+    }
+
+    float lengthSquared = axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2];
+    if (minimum>maximum || lengthSquared<FLT_EPSILON)
+    {
+        minimum = maximum = 0.0f;
+        lengthSquared = 1.0f;
+    }
+
+    for(unsigned int c=0; c<3; ++c)
+    {
+        start[c] = clampChannel(mean[c] + axis[c]*maximum/lengthSquared);
+        end[c] = clampChannel(mean[c] + axis[c]*minimum/lengthSquared);
+    }
+}
+
+struct ColourBlock
+{
+    unsigned int    colour0;
+    unsigned int    colour1;
+    unsigned char   indices[16];
+    float           error;
+};
+
+/** Encode the colours with the given endpoints, either in the four colour mode, or in the three colour mode in which the
+  * fourth colour is transparent black. Black is selected for opaque pixels only when useBlack is set.*/
+void encodeColourEndpoints(const Block& block, const float* weights, const float start[3], const float end[3], bool fourColour, bool useBlack, ColourBlock& result)
+{
+    unsigned int a = packRGB565(start);
+    unsigned int b = packRGB565(end);
+
+    // the four colour mode requires colour0>colour1, the three colour mode colour0<=colour1.
+    result.colour0 = fourColour ? osg::maximum(a, b) : osg::minimum(a, b);
+    result.colour1 = fourColour ? osg::minimum(a, b) : osg::maximum(a, b);
+
+    float palette[4][3];
+    unpackRGB565(result.colour0, palette[0]);
+    unpackRGB565(result.colour1, palette[1]);
+
+    unsigned int numColours;
+    if (fourColour && result.colour0==result.colour1)
+    {
+        // equal endpoints are read as the three colour mode, so only the first colour can be used.
+        numColours = 1;
+    }
+    else if (fourColour)
+    {
+        for(unsigned int c=0; c<3; ++c)
+        {
+            palette[2][c] = (2.0f*palette[0][c]+palette[1][c])/3.0f;
+            palette[3][c] = (palette[0][c]+2.0f*palette[1][c])/3.0f;
+        }
+        numColours = 4;
+    }
+    else
+    {
+        for(unsigned int c=0; c<3; ++c)
+        {
+            palette[2][c] = (palette[0][c]+palette[1][c])*0.5f;
+            palette[3][c] = 0.0f;
+        }
+        numColours = useBlack ? 4 : 3;
+    }
+
+    result.error = selectColourIndices(block, weights, palette, numColours, result.indices);
+}
+
+/** Solve for the endpoints that best fit the colours, given the palette index of each, by least squares.*/
+bool refineColourEndpoints(const Block& block, const float* weights, const ColourBlock& encoded, bool fourColour, float start[3], float end[3])
+{
+    // the weight of colour0 in each palette colour, the black of the three colour mode being left out.
+    static const float fourColourWeights[4] = { 1.0f, 0.0f, 2.0f/3.0f, 1.0f/3.0f };
+    static const float threeColourWeights[4] = { 1.0f, 0.0f, 0.5f, -1.0f };
+    const float* paletteWeights = fourColour ? fourColourWeights : threeColourWeights;
+
+    // equal endpoints leave all the pixels on the first colour, which doesn't constrain the second.
+    if (fourColour && encoded.colour0==encoded.colour1) return false;
+
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[3] = { 0.0f, 0.0f, 0.0f };
+    float bx[3] = { 0.0f, 0.0f, 0.0f };
+    for(unsigned int i=0; i<16; ++i)
+    {
+        float alpha = paletteWeights[encoded.indices[i]];
+        if (weights[i]==0.0f || alpha<0.0f) continue;
+
+        float beta = 1.0f-alpha;
+        aa += alpha*alpha;
+        ab += alpha*beta;
+        bb += beta*beta;
+        ax[0] += alpha*block.r[i]; ax[1] += alpha*block.g[i]; ax[2] += alpha*block.b[i];
+        bx[0] += beta*block.r[i];  bx[1] += beta*block.g[i];  bx[2] += beta*block.b[i];
+    }
+
+    float determinant = aa*bb-ab*ab;
+    if (osg::absolute(determinant)<1e-6f) return false;
+
+    for(unsigned int c=0; c<3; ++c)
+    {
+        start[c] = clampChannel((bb*ax[c]-ab*bx[c])/determinant);
+        end[c] = clampChannel((aa*bx[c]-ab*ax[c])/determinant);
+    }
+    return true;
+}
+
+/** Fit the endpoints in the given mode, refining them by least squares for as long as the error improves.*/
+void fitColourBlock(const Block& block, const float* weights, float start[3], float end[3], bool fourColour, bool useBlack, Quality quality, ColourBlock& best)
+{
+    encodeColourEndpoints(block, weights, start, end, fourColour, useBlack, best);
+
+    for(unsigned int i=0; i<numRefinements(quality) && best.error>0.0f; ++i)
+    {
+        float refinedStart[3], refinedEnd[3];
+        if (!refineColourEndpoints(block, weights, best, fourColour, refinedStart, refinedEnd)) break;
+
+        ColourBlock candidate;
+        encodeColourEndpoints(block, weights, refinedStart, refinedEnd, fourColour, useBlack, candidate);
+        if (candidate.error>=best.error) break;
+
+        best = candidate;
+    }
+}
+
+/** Encode the colours of a block. Pixels with an alpha below 128 are transparent when punchThroughAlpha is set, while
+  * allowThreeColour allows opaque blocks to use the three colour mode and its black when that fits better.*/
+void encodeColourBlock(const Block& block, bool punchThroughAlpha, bool allowThreeColour, Quality quality, unsigned char* output)
+{
+    float weights[16];
+    unsigned int numTransparent = 0;
+    for(unsigned int i=0; i<16; ++i)
+    {
+        bool transparent = punchThroughAlpha && block.a[i]<128.0f;
+        weights[i] = transparent ? 0.0f : 1.0f;
+        if (transparent) ++numTransparent;
+    }
+
+    ColourBlock best;
+    if (numTransparent==16)
+    {
+        best.colour0 = best.colour1 = 0;
+    }
+    else
+    {
+        float start[3], end[3];
+        if (quality==osgDB::ImageProcessor::FASTEST) computeBoundingEndpoints(block, weights, start, end);
+        else computePrincipalEndpoints(block, weights, start, end);
+
+        // transparent pixels need the three colour mode.
+        bool fourColour = numTransparent==0;
+        fitColourBlock(block, weights, start, end, fourColour, false, quality, best);
+
+        if (fourColour && allowThreeColour && quality>=osgDB::ImageProcessor::PRODUCTION)
+        {
+            ColourBlock threeColour;
+            fitColourBlock(block, weights, start, end, false, true, quality, threeColour);
+            if (threeColour.error<best.error) best = threeColour;
+        }
+    }
+
+    writeUInt16(best.colour0, output);
+    writeUInt16(best.colour1, output+2);
+    for(unsigned int row=0; row<4; ++row)
+    {
+        unsigned int bits = 0;
+        for(unsigned int column=0; column<4; ++column)
+        {
+            unsigned int i = row*4+column;
+            unsigned int index = weights[i]==0.0f ? 3 : best.indices[i];
+            bits |= index<<(column*2);
+        }
+        output[4+row] = static_cast<unsigned char>(bits);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Alpha blocks, as used for the alpha of BC3 and the channels of BC4 and BC5
+//
+void buildAlphaPalette(unsigned int value0, unsigned int value1, float palette[8])
+{
+    float v0 = static_cast<float>(value0);
+    float v1 = static_cast<float>(value1);
+    palette[0] = v0;
+    palette[1] = v1;
+    if (value0>value1)
+    {
+        for(unsigned int i=1; i<7; ++i) palette[i+1] = (static_cast<float>(7-i)*v0 + static_cast<float>(i)*v1)/7.0f;
+    }
+    else
+    {
+        for(unsigned int i=1; i<5; ++i) palette[i+1] = (static_cast<float>(5-i)*v0 + static_cast<float>(i)*v1)/5.0f;
+        palette[6] = 0.0f;
+        palette[7] = 255.0f;
+    }
+}
+
+/** Select the nearest of the palette values for each pixel, returning the sum of the squared errors.*/
+float selectAlphaIndices(const float* values, const float palette[8], unsigned char* indices)
+{
+#ifdef BCN_USE_SSE2
+    __m128 total = _mm_setzero_ps();
+    for(unsigned int i=0; i<16; i+=4)
+    {
+        __m128 v = _mm_loadu_ps(values+i);
+
+        __m128 best = _mm_set1_ps(FLT_MAX);
+        __m128 bestIndex = _mm_setzero_ps();
+        for(unsigned int p=0; p<8; ++p)
+        {
+            __m128 dv = _mm_sub_ps(v, _mm_set1_ps(palette[p]));
+            __m128 d = _mm_mul_ps(dv, dv);
+
+            __m128 closer = _mm_cmplt_ps(d, best);
+            best = _mm_min_ps(d, best);
+            bestIndex = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps(static_cast<float>(p))), _mm_andnot_ps(closer, bestIndex));
+        }
+
+        total = _mm_add_ps(total, best);
+
+        int pixelIndices[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pixelIndices), _mm_cvttps_epi32(bestIndex));
+        for(unsigned int j=0; j<4; ++j) indices[i+j] = static_cast<unsigned char>(pixelIndices[j]);
+    }
+
+    float sums[4];
+    _mm_storeu_ps(sums, total);
+    return (sums[0]+sums[1])+(sums[2]+sums[3]);
+#else
+    float total = 0.0f;
+    for(unsigned int i=0; i<16; ++i)
+    {
+        float best = FLT_MAX;
+        for(unsigned int p=0; p<8; ++p)
+        {
+            float d = (values[i]-palette[p])*(values[i]-palette[p]);
+            if (d<best)
+            {
+                best = d;
+                indices[i] = static_cast<unsigned char>(p);
+            }
+        }
+        total += best;
+    }
+    return total;
+#endif
+}
+
+struct AlphaBlock
+{
+    unsigned int    value0;
+    unsigned int    value1;
+    unsigned char   indices[16];
+    float           error;
+};
+
+void encodeAlphaEndpoints(const float* values, unsigned int value0, unsigned int value1, AlphaBlock& result)
+{
+    float palette[8];
+    buildAlphaPalette(value0, value1, palette);
+    result.value0 = value0;
+    result.value1 = value1;
+    result.error = selectAlphaIndices(values, palette, result.indices);
+}
+
+/** Solve for the endpoints of the eight value mode that best fit the values, given the palette index of each, by least squares.*/
+bool refineAlphaEndpoints(const float* values, const AlphaBlock& encoded, unsigned int& value0, unsigned int& value1)
+{
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f, ax = 0.0f, bx = 0.0f;
+    for(unsigned int i=0; i<16; ++i)
+    {
+        unsigned int index = encoded.indices[i];
+        float alpha = index==0 ? 1.0f : (index==1 ? 0.0f : static_cast<float>(8-index)/7.0f);
+        float beta = 1.0f-alpha;
+        aa += alpha*alpha;
+        ab += alpha*beta;
+        bb += beta*beta;
+        ax += alpha*values[i];
+        bx += beta*values[i];
+    }
+
+    float determinant = aa*bb-ab*ab;
+    if (osg::absolute(determinant)<1e-6f) return false;
+
+    value0 = static_cast<unsigned int>(clampChannel((bb*ax-ab*bx)/determinant)+0.5f);
+    value1 = static_cast<unsigned int>(clampChannel((aa*bx-ab*ax)/determinant)+0.5f);
+    if (value0<value1) std::swap(value0, value1);
+    return value0!=value1;
+}
+
+/** Encode 16 values of 0 to 255 as an 8 byte BC4 block.*/
+void encodeAlphaBlock(const float* values, Quality quality, unsigned char* output)
+{
+    float minimum = 255.0f, maximum = 0.0f;
+    float innerMinimum = 255.0f, innerMaximum = 0.0f;
+    for(unsigned int i=0; i<16; ++i)
+    {
+        minimum = osg::minimum(minimum, values[i]);
+        maximum = osg::maximum(maximum, values[i]);
+        if (values[i]>0.0f && values[i]<255.0f)
+        {
+            innerMinimum = osg::minimum(innerMinimum, values[i]);
+            innerMaximum = osg::maximum(innerMaximum, values[i]);
+        }
+    }
+
+    // the eight value mode across the full range.
+    AlphaBlock best;
+    encodeAlphaEndpoints(values, static_cast<unsigned int>(maximum+0.5f), static_cast<unsigned int>(minimum+0.5f), best);
+
+    for(unsigned int i=0; i<numRefinements(quality) && best.error>0.0f; ++i)
+    {
+        unsigned int value0, value1;
+        if (!refineAlphaEndpoints(values, best, value0, value1)) break;
+
+        AlphaBlock candidate;
+        encodeAlphaEndpoints(values, value0, value1, candidate);
+        if (candidate.error>=best.error) break;
+
+        best = candidate;
+    }
+
+    // the six value mode, with 0 and 255 left to the extremes, suits blocks with both extremes and values between.
+    if (quality!=osgDB::ImageProcessor::FASTEST && best.error>0.0f && innerMinimum<=innerMaximum)
+    {
+        AlphaBlock candidate;
+        encodeAlphaEndpoints(values, static_cast<unsigned int>(innerMinimum+0.5f), static_cast<unsigned int>(innerMaximum+0.5f), candidate);
+        if (candidate.error<best.error) best = candidate;
+    }
+
+    // try nudging the endpoints of the eight value mode.
+    if (quality==osgDB::ImageProcessor::HIGHEST && best.error>0.0f && best.value0>best.value1)
+    {
+        AlphaBlock nudged = best;
+        for(int d0=-1; d0<=1; ++d0)
+        {
+            for(int d1=-1; d1<=1; ++d1)
+            {
+                int value0 = static_cast<int>(nudged.value0)+d0;
+                int value1 = static_cast<int>(nudged.value1)+d1;
+                if ((d0==0 && d1==0) || value0>255 || value1<0 || value0<=value1) continue;
+
+                AlphaBlock candidate;
+                encodeAlphaEndpoints(values, value0, value1, candidate);
+                if (candidate.error<best.error) best = candidate;
+            }
+        }
+    }
+
+    output[0] = static_cast<unsigned char>(best.value0);
+    output[1] = static_cast<unsigned char>(best.value1);
+
+    // 3 bit indices, 8 pixels to each 3 bytes.
+    for(unsigned int half=0; half<2; ++half)
+    {
+        unsigned int bits = 0;
+        for(unsigned int i=0; i<8; ++i) bits |= static_cast<unsigned int>(best.indices[half*8+i])<<(i*3);
+
+        output[2+half*3] = static_cast<unsigned char>(bits & 0xff);
+        output[3+half*3] = static_cast<unsigned char>((bits>>8) & 0xff);
+        output[4+half*3] = static_cast<unsigned char>((bits>>16) & 0xff);
+    }
+}
+
+}
+
+void bcn::encodeBC1(const Block& block, bool punchThroughAlpha, Quality quality, unsigned char* output)
+{
+    encodeColourBlock(block, punchThroughAlpha, !punchThroughAlpha, quality, output);
+}
+
+void bcn::encodeBC2(const Block& block, Quality quality, unsigned char* output)
+{
+    for(unsigned int i=0; i<16; i+=2)
+    {
+        unsigned int a0 = static_cast<unsigned int>(clampChannel(block.a[i])/17.0f+0.5f);
+        unsigned int a1 = static_cast<unsigned int>(clampChannel(block.a[i+1])/17.0f+0.5f);
+        output[i/2] = static_cast<unsigned char>(a0 | (a1<<4));
+    }
+
+    // the colours of BC2 and BC3 blocks are always read in the four colour mode by some hardware.
+    encodeColourBlock(block, false, false, quality, output+8);
+}
+
+void bcn::encodeBC3(const Block& block, Quality quality, unsigned char* output)
+{
+    encodeAlphaBlock(block.a, quality, output);
+    encodeColourBlock(block, false, false, quality, output+8);
+}
+
+void bcn::encodeBC4(const Block& block, Quality quality, unsigned char* output)
+{
+    encodeAlphaBlock(block.r, quality, output);
+}
+
+void bcn::encodeBC5(const Block& block, Quality quality, unsigned char* output)
+{
+    encodeAlphaBlock(block.r, quality, output);
+    encodeAlphaBlock(block.g, quality, output+8);
+}
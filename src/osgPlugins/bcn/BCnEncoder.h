@@ -0,0 +1,54 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#ifndef BCN_ENCODER_H
+#define BCN_ENCODER_H 1
+
+#include <osg/Texture>
+#include <osgDB/ImageProcessor>
+
+namespace bcn
+{
+
+typedef osgDB::ImageProcessor::CompressionQuality Quality;
+
+/** The 16 pixels of a 4x4 block, a row at a time, as 0 to 255 floats held a channel at a time so that the encoders
+  * can work on 4 pixels at a time.*/
+struct Block
+{
+    float r[16];
+    float g[16];
+    float b[16];
+    float a[16];
+};
+
+/** Encode the colours of a block as an 8 byte BC1 (DXT1) block. With punchThroughAlpha set pixels with an alpha below 128
+  * are encoded as transparent, as read by GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, otherwise the block's three colour mode may be used
+  * to encode black.*/
+void encodeBC1(const Block& block, bool punchThroughAlpha, Quality quality, unsigned char* output);
+
+/** Encode a block as a 16 byte BC2 (DXT3) block, explicit 4 bit alpha followed by the colours.*/
+void encodeBC2(const Block& block, Quality quality, unsigned char* output);
+
+/** Encode a block as a 16 byte BC3 (DXT5) block, interpolated alpha followed by the colours.*/
+void encodeBC3(const Block& block, Quality quality, unsigned char* output);
+
+/** Encode the red channel of a block as an 8 byte BC4 (RGTC1) block.*/
+void encodeBC4(const Block& block, Quality quality, unsigned char* output);
+
+/** Encode the red and green channels of a block as a 16 byte BC5 (RGTC2) block.*/
+void encodeBC5(const Block& block, Quality quality, unsigned char* output);
+
+}
+
+#endif
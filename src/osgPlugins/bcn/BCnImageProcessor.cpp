@@ -0,0 +1,300 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osg/ImageUtils>
+#include <osg/Texture>
+#include <osgDB/Registry>
+
+#include <OpenThreads/Atomic>
+#include <OpenThreads/Thread>
+
+#include "BCnEncoder.h"
+
+#include <vector>
+
+/** ImageProcessor that compresses images to S3TC/RGTC (BC1 to BC5) on the CPU without any third party library, the blocks
+  * being encoded across as many threads as there are processors. Used when the nvtt plugin isn't available.*/
+class BCnImageProcessor : public osgDB::ImageProcessor
+{
+public:
+    virtual void compress(osg::Image& image, osg::Texture::InternalFormatMode compressedFormat, bool generateMipMap, bool resizeToPowerOfTwo, CompressionMethod method, CompressionQuality quality);
+    virtual void generateMipMap(osg::Image& image, bool resizeToPowerOfTwo, CompressionMethod method);
+
+protected:
+
+    enum BlockFormat
+    {
+        BC1,
+        BC1_ALPHA,
+        BC2,
+        BC3,
+        BC4,
+        BC5
+    };
+
+    struct Level
+    {
+        const unsigned char*    data;
+        unsigned int            rowStep;
+        unsigned int            width;
+        unsigned int            height;
+        unsigned int            compressedOffset;
+    };
+
+    /** The levels to compress, and the rows of blocks left to compress, shared by the threads compressing them.*/
+    struct Compression
+    {
+        GLenum                          pixelFormat;
+        unsigned int                    numComponents;
+        BlockFormat                     format;
+        unsigned int                    blockSize;
+        CompressionQuality              quality;
+
+        std::vector<Level>              levels;
+        unsigned char*                  compressedData;
+        std::vector< std::pair<unsigned int, unsigned int> > blockRows;
+        OpenThreads::Atomic             nextBlockRow;
+    };
+
+    class CompressionThread : public osg::Referenced, public OpenThreads::Thread
+    {
+    public:
+        CompressionThread(Compression& compression): _compression(compression) {}
+
+        virtual void run() { compressBlockRows(_compression); }
+
+    protected:
+        virtual ~CompressionThread() {}
+
+        Compression& _compression;
+    };
+
+    static bool supportsPixelFormat(GLenum pixelFormat);
+
+    static void resizeToPowerOfTwo(osg::Image& image);
+
+    static void readBlock(const Compression& compression, const Level& level, unsigned int bx, unsigned int by, bcn::Block& block);
+
+    static void compressBlockRows(Compression& compression);
+};
+
+bool BCnImageProcessor::supportsPixelFormat(GLenum pixelFormat)
+{
+    switch(pixelFormat)
+    {
+        case(GL_ALPHA):
+        case(GL_LUMINANCE):
+        case(GL_LUMINANCE_ALPHA):
+        case(GL_INTENSITY):
+        case(GL_RED):
+        case(GL_RG):
+        case(GL_RGB):
+        case(GL_BGR):
+        case(GL_RGBA):
+        case(GL_BGRA):
+            return true;
+        default:
+            return false;
+    }
+}
+
+void BCnImageProcessor::resizeToPowerOfTwo(osg::Image& image)
+{
+    int s = osg::Image::computeNearestPowerOfTwo(image.s());
+    int t = osg::Image::computeNearestPowerOfTwo(image.t());
+    if (s==image.s() && t==image.t()) return;
+
+    // any mipmaps are of the old size, so are discarded.
+    image.setMipmapLevels(osg::Image::MipmapDataType());
+    image.scaleImage(s, t, 1);
+}
+
+void BCnImageProcessor::readBlock(const Compression& compression, const Level& level, unsigned int bx, unsigned int by, bcn::Block& block)
+{
+    for(unsigned int y=0; y<4; ++y)
+    {
+        // blocks overlapping the edge of the image repeat the edge pixels.
+        unsigned int row = osg::minimum(by*4+y, level.height-1);
+        const unsigned char* rowData = level.data + row*level.rowStep;
+        for(unsigned int x=0; x<4; ++x)
+        {
+            unsigned int column = osg::minimum(bx*4+x, level.width-1);
+            const unsigned char* pixel = rowData + column*compression.numComponents;
+
+            unsigned int r = 0, g = 0, b = 0, a = 255;
+            switch(compression.pixelFormat)
+            {
+                case(GL_ALPHA): r = g = b = 255; a = pixel[0]; break;
+                case(GL_LUMINANCE): r = g = b = pixel[0]; break;
+                case(GL_LUMINANCE_ALPHA): r = g = b = pixel[0]; a = pixel[1]; break;
+                case(GL_INTENSITY): r = g = b = a = pixel[0]; break;
+                case(GL_RED): r = pixel[0]; break;
+                case(GL_RG): r = pixel[0]; g = pixel[1]; break;
+                case(GL_RGB): r = pixel[0]; g = pixel[1]; b = pixel[2]; break;
+                case(GL_BGR): r = pixel[2]; g = pixel[1]; b = pixel[0]; break;
+                case(GL_RGBA): r = pixel[0]; g = pixel[1]; b = pixel[2]; a = pixel[3]; break;
+                case(GL_BGRA): r = pixel[2]; g = pixel[1]; b = pixel[0]; a = pixel[3]; break;
+                default: break;
+            }
+
+            unsigned int i = y*4+x;
+            block.r[i] = static_cast<float>(r);
+            block.g[i] = static_cast<float>(g);
+            block.b[i] = static_cast<float>(b);
+            block.a[i] = static_cast<float>(a);
+        }
+    }
+}
+
+void BCnImageProcessor::compressBlockRows(Compression& compression)
+{
+    const unsigned int numBlockRows = static_cast<unsigned int>(compression.blockRows.size());
+    for(unsigned int blockRow = (++compression.nextBlockRow)-1; blockRow<numBlockRows; blockRow = (++compression.nextBlockRow)-1)
+    {
+        const Level& level = compression.levels[compression.blockRows[blockRow].first];
+        unsigned int by = compression.blockRows[blockRow].second;
+        unsigned int numBlocksWide = (level.width+3)/4;
+        unsigned char* output = compression.compressedData + level.compressedOffset + by*numBlocksWide*compression.blockSize;
+
+        bcn::Block block;
+        for(unsigned int bx=0; bx<numBlocksWide; ++bx, output+=compression.blockSize)
+        {
+            readBlock(compression, level, bx, by, block);
+            switch(compression.format)
+            {
+                case(BC1): bcn::encodeBC1(block, false, compression.quality, output); break;
+                case(BC1_ALPHA): bcn::encodeBC1(block, true, compression.quality, output); break;
+                case(BC2): bcn::encodeBC2(block, compression.quality, output); break;
+                case(BC3): bcn::encodeBC3(block, compression.quality, output); break;
+                case(BC4): bcn::encodeBC4(block, compression.quality, output); break;
+                case(BC5): bcn::encodeBC5(block, compression.quality, output); break;
+            }
+        }
+    }
+}
+
+void BCnImageProcessor::compress(osg::Image& image, osg::Texture::InternalFormatMode compressedFormat, bool generateMipMap, bool resizeToPowerOfTwo, CompressionMethod /*method*/, CompressionQuality quality)
+{
+    Compression compression;
+    GLenum compressedPixelFormat;
+    switch (compressedFormat)
+    {
+    case osg::Texture::USE_S3TC_DXT1_COMPRESSION:
+        compression.format = image.getPixelFormat()==GL_RGBA ? BC1_ALPHA : BC1;
+        break;
+    case osg::Texture::USE_S3TC_DXT1c_COMPRESSION:
+        compression.format = BC1;
+        break;
+    case osg::Texture::USE_S3TC_DXT1a_COMPRESSION:
+        compression.format = BC1_ALPHA;
+        break;
+    case osg::Texture::USE_S3TC_DXT3_COMPRESSION:
+        compression.format = BC2;
+        break;
+    case osg::Texture::USE_S3TC_DXT5_COMPRESSION:
+        compression.format = BC3;
+        break;
+    case osg::Texture::USE_RGTC1_COMPRESSION:
+        compression.format = BC4;
+        break;
+    case osg::Texture::USE_RGTC2_COMPRESSION:
+        compression.format = BC5;
+        break;
+    default:
+        OSG_WARN<<"BCnImageProcessor : Invalid or not supported compress format"<<std::endl;
+        return;
+    }
+
+    switch(compression.format)
+    {
+        case(BC1): compressedPixelFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT; break;
+        case(BC1_ALPHA): compressedPixelFormat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; break;
+        case(BC2): compressedPixelFormat = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT; break;
+        case(BC3): compressedPixelFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
+        case(BC4): compressedPixelFormat = GL_COMPRESSED_RED_RGTC1_EXT; break;
+        default: compressedPixelFormat = GL_COMPRESSED_RED_GREEN_RGTC2_EXT; break;
+    }
+
+    if (!image.data() || image.r()!=1 || image.isCompressed() || image.getDataType()!=GL_UNSIGNED_BYTE || !supportsPixelFormat(image.getPixelFormat()))
+    {
+        OSG_WARN<<"BCnImageProcessor : only 2D GL_UNSIGNED_BYTE luminance, alpha, red, green, RGB and RGBA images can be compressed"<<std::endl;
+        return;
+    }
+
+    if (resizeToPowerOfTwo) BCnImageProcessor::resizeToPowerOfTwo(image);
+
+    if (generateMipMap)
+    {
+        // the channels of BC4 and BC5 normally hold data rather than sRGB colours.
+        bool sRGB = compression.format!=BC4 && compression.format!=BC5;
+        osg::buildMipmaps(&image, quality>=PRODUCTION ? osg::MIPMAP_KAISER_FILTER : osg::MIPMAP_BOX_FILTER, sRGB);
+    }
+
+    compression.pixelFormat = image.getPixelFormat();
+    compression.numComponents = osg::Image::computeNumComponents(image.getPixelFormat());
+    compression.blockSize = (compression.format==BC1 || compression.format==BC1_ALPHA || compression.format==BC4) ? 8 : 16;
+    compression.quality = quality;
+
+    // lay out the compressed levels the way Image::getTotalSizeInBytesIncludingMipmaps() expects.
+    osg::Image::MipmapDataType mipmapOffsets;
+    unsigned int totalSize = 0;
+    for(unsigned int l=0; l<image.getNumMipmapLevels(); ++l)
+    {
+        Level level;
+        level.width = osg::maximum(image.s()>>l, 1);
+        level.height = osg::maximum(image.t()>>l, 1);
+        level.data = image.getMipmapData(l);
+        level.rowStep = l==0 ? image.getRowStepInBytes() : osg::Image::computeRowWidthInBytes(level.width, image.getPixelFormat(), image.getDataType(), image.getPacking());
+        level.compressedOffset = totalSize;
+        compression.levels.push_back(level);
+
+        if (l>0) mipmapOffsets.push_back(totalSize);
+        totalSize += osg::Image::computeImageSizeInBytes(level.width, level.height, 1, compressedPixelFormat, GL_UNSIGNED_BYTE);
+
+        for(unsigned int by=0; by<(level.height+3)/4; ++by)
+        {
+            compression.blockRows.push_back(std::pair<unsigned int, unsigned int>(l, by));
+        }
+    }
+
+    unsigned char* data = new unsigned char[totalSize];
+    compression.compressedData = data;
+
+    // the threads, and this thread, take the next row of blocks left until all are compressed.
+    unsigned int numThreads = osg::minimum(static_cast<unsigned int>(osg::maximum(OpenThreads::GetNumberOfProcessors(), 1)), static_cast<unsigned int>(compression.blockRows.size()));
+    std::vector< osg::ref_ptr<CompressionThread> > threads;
+    for(unsigned int i=1; i<numThreads; ++i)
+    {
+        threads.push_back(new CompressionThread(compression));
+        threads.back()->startThread();
+    }
+
+    compressBlockRows(compression);
+
+    for(unsigned int i=0; i<threads.size(); ++i)
+    {
+        threads[i]->join();
+    }
+
+    image.setImage(image.s(), image.t(), 1, compressedPixelFormat, compressedPixelFormat, GL_UNSIGNED_BYTE, data, osg::Image::USE_NEW_DELETE);
+    image.setMipmapLevels(mipmapOffsets);
+}
+
+void BCnImageProcessor::generateMipMap(osg::Image& image, bool resizeToPowerOfTwo, CompressionMethod /*method*/)
+{
+    if (resizeToPowerOfTwo) BCnImageProcessor::resizeToPowerOfTwo(image);
+
+    osg::buildMipmaps(&image, osg::MIPMAP_BOX_FILTER, true);
+}
+
+REGISTER_OSGIMAGEPROCESSOR(bcn, BCnImageProcessor)
@@ -7,6 +7,7 @@
 #include <osgDB/Registry>
 #include <osgDB/FileNameUtils>
 #include <osgDB/FileUtils>
+#include <osgDB/ImageRegion>
 
 #include <sstream>
 
@@ -647,6 +648,147 @@ unsigned char* simage_jpeg_load(std::istream& fin,
     }
     return buffer;
 }
+
+/* Read the dimensions and number of components of a jpeg, and its EXIF orientation, without decoding it. */
+int simage_jpeg_info(std::istream& fin,
+                     int *width_ret,
+                     int *height_ret,
+                     int *numComponents_ret,
+                     unsigned int* exif_orientation)
+{
+    struct jpeg_decompress_struct cinfo;
+    struct my_error_mgr jerr;
+
+    jpegerror = ERR_NO_ERROR;
+
+    cinfo.err = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = my_error_exit;
+    jerr.pub.output_message = my_output_message;
+    if (setjmp(jerr.setjmp_buffer))
+    {
+        jpegerror = ERR_JPEGLIB;
+        jpeg_destroy_decompress(&cinfo);
+        return 0;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_istream_src(&cinfo,&fin);
+    jpeg_save_markers (&cinfo, EXIF_JPEG_MARKER, 0xffff);
+    (void) jpeg_read_header(&cinfo, TRUE);
+
+    *exif_orientation = EXIF_Orientation (&cinfo);
+    *width_ret = cinfo.image_width;
+    *height_ret = cinfo.image_height;
+    *numComponents_ret = (cinfo.jpeg_color_space == JCS_GRAYSCALE) ? 1 : 3;
+
+    jpeg_destroy_decompress(&cinfo);
+    return 1;
+}
+
+/* Decode the rows of a jpeg covering the region set up on builder, using the scaled IDCT to decode at the resolution of the region
+ * where it can, up to the 1/8 libjpeg supports, with libjpeg-turbo only decoding the columns covering the region and skipping
+ * the IDCT of the rows above it. Rows below the region aren't decoded. Return 0 with jpegerror set if the jpeg couldn't be read,
+ * or 1 with *exif_orientation set to its orientation, the builder only having been given rows where the orientation is 0 or 1. */
+int simage_jpeg_load_region(std::istream& fin,
+                            int x, int y, int width, int height, unsigned int reductionLevel,
+                            osgDB::ImageRegionBuilder* builder,
+                            unsigned int* exif_orientation)
+{
+    struct jpeg_decompress_struct cinfo;
+    struct my_error_mgr jerr;
+    JSAMPARRAY rowbuffer;
+    int format;
+    unsigned int scale;
+    JDIMENSION xoffset;
+    JDIMENSION row;
+
+    jpegerror = ERR_NO_ERROR;
+
+    cinfo.err = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = my_error_exit;
+    jerr.pub.output_message = my_output_message;
+    if (setjmp(jerr.setjmp_buffer))
+    {
+        jpegerror = ERR_JPEGLIB;
+        jpeg_destroy_decompress(&cinfo);
+        return 0;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_istream_src(&cinfo,&fin);
+    jpeg_save_markers (&cinfo, EXIF_JPEG_MARKER, 0xffff);
+    (void) jpeg_read_header(&cinfo, TRUE);
+
+    /* rotated images are left for the caller to read whole, so that the region is of the rotated image. */
+    *exif_orientation = EXIF_Orientation (&cinfo);
+    if (*exif_orientation>1 ||
+        !builder->setRegion(cinfo.image_width, cinfo.image_height, x, y, width, height, reductionLevel))
+    {
+        jpeg_destroy_decompress(&cinfo);
+        return 1;
+    }
+
+    if (cinfo.jpeg_color_space == JCS_GRAYSCALE)
+    {
+        format = 1;
+        cinfo.out_color_space = JCS_GRAYSCALE;
+    }
+    else
+    {
+        format = 3;
+        cinfo.out_color_space = JCS_RGB;
+    }
+
+    /* libjpeg can scale by up to 1/8 while decoding, where the region lines up with the pixels of the scaled image. */
+    scale = builder->getAlignedSourceScale(8);
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = scale;
+
+    (void) jpeg_start_decompress(&cinfo);
+
+    if (!builder->allocateImage(scale, cinfo.output_width, cinfo.output_height, format==1 ? GL_LUMINANCE : GL_RGB, GL_UNSIGNED_BYTE))
+    {
+        jpegerror = ERR_MEM;
+        jpeg_destroy_decompress(&cinfo);
+        return 0;
+    }
+
+    xoffset = 0;
+    row = 0;
+
+#ifdef LIBJPEG_TURBO_VERSION_NUMBER
+    {
+        /* the crop is widened to the iMCU boundaries, xoffset and output_width returning where it starts and its width, and
+         * by a further iMCU either side so that the upsampling of the columns of the region is the same as for a whole row. */
+        JDIMENSION margin = cinfo.max_h_samp_factor * DCTSIZE / scale;
+        JDIMENSION begin = builder->getBeginColumn()>(int)margin ? builder->getBeginColumn()-margin : 0;
+        JDIMENSION end = builder->getEndColumn()+margin<cinfo.output_width ? builder->getEndColumn()+margin : cinfo.output_width;
+        JDIMENSION cropWidth = end-begin;
+        xoffset = begin;
+        jpeg_crop_scanline(&cinfo, &xoffset, &cropWidth);
+
+        if (builder->getBeginRow()>0) row = jpeg_skip_scanlines(&cinfo, builder->getBeginRow());
+    }
+#endif
+
+    rowbuffer = (*cinfo.mem->alloc_sarray)
+        ((j_common_ptr) &cinfo, JPOOL_IMAGE, cinfo.output_width * cinfo.output_components, 1);
+
+    for(; row < (JDIMENSION)builder->getEndRow(); ++row)
+    {
+        (void) jpeg_read_scanlines(&cinfo, rowbuffer, 1);
+        if (row >= (JDIMENSION)builder->getBeginRow())
+        {
+            builder->addRow(row, rowbuffer[0] + (builder->getBeginColumn()-xoffset)*format);
+        }
+    }
+
+    /* the rest of the image isn't needed so abort rather than finish decoding it. */
+    jpeg_abort_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return 1;
+}
+
 } // namespace osgDBJPEG
 
 class ReaderWriterJPEG : public osgDB::ReaderWriter
@@ -965,6 +1107,92 @@ class ReaderWriterJPEG : public osgDB::ReaderWriter
             return rr;
         }
 
+        virtual ReadResult readImageInfo(std::istream& fin, const osgDB::ReaderWriter::Options* =NULL) const
+        {
+            int width_ret;
+            int height_ret;
+            int numComponents_ret;
+            unsigned int exif_orientation=0;
+
+            if (!osgDBJPEG::simage_jpeg_info(fin, &width_ret, &height_ret, &numComponents_ret, &exif_orientation)) return ReadResult::ERROR_IN_READING_FILE;
+
+            // orientations 5 to 8 rotate the image by 90 degrees.
+            if (exif_orientation>=5) std::swap(width_ret, height_ret);
+
+            GLenum pixelFormat = numComponents_ret==1 ? GL_LUMINANCE : GL_RGB;
+
+            osg::ref_ptr<osg::Image> pOsgImage = new osg::Image;
+            pOsgImage->setImage(width_ret, height_ret, 1,
+                pixelFormat,
+                pixelFormat,
+                GL_UNSIGNED_BYTE,
+                NULL,
+                osg::Image::NO_DELETE);
+
+            return pOsgImage.release();
+        }
+
+        virtual ReadResult readImageInfo(const std::string& file, const osgDB::ReaderWriter::Options* options) const
+        {
+            std::string ext = osgDB::getLowerCaseFileExtension(file);
+            if (!acceptsExtension(ext)) return ReadResult::FILE_NOT_HANDLED;
+
+            std::string fileName = osgDB::findDataFile( file, options );
+            if (fileName.empty()) return ReadResult::FILE_NOT_FOUND;
+
+            osgDB::ifstream istream(fileName.c_str(), std::ios::in | std::ios::binary);
+            if(!istream) return ReadResult::ERROR_IN_READING_FILE;
+            ReadResult rr = readImageInfo(istream, options);
+            if(rr.validImage()) rr.getImage()->setFileName(file);
+            return rr;
+        }
+
+        virtual ReadResult readImageRegion(std::istream& fin, int x, int y, int width, int height, unsigned int reductionLevel, const osgDB::ReaderWriter::Options* =NULL) const
+        {
+            std::streampos start = fin.tellg();
+
+            osgDB::ImageRegionBuilder builder;
+            unsigned int exif_orientation=0;
+            if (!osgDBJPEG::simage_jpeg_load_region(fin, x, y, width, height, reductionLevel, &builder, &exif_orientation))
+            {
+                return ReadResult::ERROR_IN_READING_FILE;
+            }
+
+            if (exif_orientation>1)
+            {
+                // the region is of the rotated image, so decode the whole image and rotate it first.
+                fin.clear();
+                fin.seekg(start);
+                ReadResult rr = readJPGStream(fin);
+                if (!rr.validImage()) return rr;
+
+                osg::Image* region = osgDB::createImageRegion(rr.getImage(), x, y, width, height, reductionLevel);
+                if (!region) return ReadResult("Warning: JPEG image region is empty.");
+                return region;
+            }
+
+            if (!builder.getImage()) return ReadResult("Warning: JPEG image region is empty.");
+
+            osg::Image* region = builder.getImage();
+            region->setInternalTextureFormat(region->getPixelFormat());
+            return region;
+        }
+
+        virtual ReadResult readImageRegion(const std::string& file, int x, int y, int width, int height, unsigned int reductionLevel, const osgDB::ReaderWriter::Options* options) const
+        {
+            std::string ext = osgDB::getLowerCaseFileExtension(file);
+            if (!acceptsExtension(ext)) return ReadResult::FILE_NOT_HANDLED;
+
+            std::string fileName = osgDB::findDataFile( file, options );
+            if (fileName.empty()) return ReadResult::FILE_NOT_FOUND;
+
+            osgDB::ifstream istream(fileName.c_str(), std::ios::in | std::ios::binary);
+            if(!istream) return ReadResult::ERROR_IN_READING_FILE;
+            ReadResult rr = readImageRegion(istream, x, y, width, height, reductionLevel, options);
+            if(rr.validImage()) rr.getImage()->setFileName(file);
+            return rr;
+        }
+
         virtual WriteResult writeImage(const osg::Image& img,std::ostream& fout,const osgDB::ReaderWriter::Options *options) const
         {
             osg::ref_ptr<osg::Image> tmp_img = new osg::Image(img);
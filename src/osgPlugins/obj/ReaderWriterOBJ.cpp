@@ -40,6 +40,10 @@
 #include <osgDB/ReadFile>
 #include <osgDB/FileUtils>
 #include <osgDB/FileNameUtils>
+#include <osgDB/MappedFile>
+#include <osgDB/DatabasePager>
+
+#include <OpenThreads/Thread>
 
 #include <osgUtil/TriStripVisitor>
 #include <osgUtil/SmoothingVisitor>
@@ -50,6 +54,7 @@
 
 #include <map>
 #include <set>
+#include <algorithm>
 
 class ReaderWriterOBJ : public osgDB::ReaderWriter
 {
@@ -62,6 +67,8 @@ public:
         supportsOption("noTriStripPolygons","Do not do the default tri stripping of polygons");
         supportsOption("generateFacetNormals","generate facet normals for verticies without normals");
         supportsOption("noReverseFaces","avoid to reverse faces when normals and triangles orientation are reversed");
+        supportsOption("noMapping","Read files through a stream rather than parsing a memory mapping of the file in parallel");
+        supportsOption("readThreads=<n>","Set the number of threads parsing a memory mapped file, defaulting to the number of processors, or to 1 when reading from a DatabasePager thread");
 
         supportsOption("DIFFUSE=<unit>", "Set texture unit for diffuse texture");
         supportsOption("AMBIENT=<unit>", "Set texture unit for ambient texture");
@@ -140,6 +147,8 @@ protected:
         bool generateFacetNormals;
         bool fixBlackMaterials;
         bool noReverseFaces;
+        bool noMapping;
+        unsigned int readThreads;
         // This is the order in which the materials will be assigned to texture maps, unless
         // otherwise overriden
         typedef std::vector< std::pair<int,obj::Material::Map::TextureMapType> > TextureAllocationMap;
@@ -150,7 +159,10 @@ protected:
 
     void buildMaterialToStateSetMap(obj::Model& model, MaterialToStateSetMap& materialToSetSetMapObj, ObjOptionsStruct& localOptions, const Options* options) const;
 
-    osg::Geometry* convertElementListToGeometry(obj::Model& model, obj::Model::ElementList& elementList, ObjOptionsStruct& localOptions) const;
+    osg::Geometry* convertElementListToGeometry(obj::Model& model, obj::ElementList& elementList, ObjOptionsStruct& localOptions) const;
+
+    void copyElementToArrays(const obj::Model& model, const obj::ElementList& elementList, const obj::Element& element, bool reverse, bool rotate,
+                             osg::Vec3Array* vertices, osg::Vec3Array* normals, osg::Vec2Array* texcoords, osg::Vec4Array* colors, unsigned int& pos) const;
 
     osg::Node* convertModelToSceneGraph(obj::Model& model, ObjOptionsStruct& localOptions, const Options* options) const;
 
@@ -408,96 +420,96 @@ void ReaderWriterOBJ::buildMaterialToStateSetMap(obj::Model& model, MaterialToSt
     }
 }
 
-osg::Geometry* ReaderWriterOBJ::convertElementListToGeometry(obj::Model& model, obj::Model::ElementList& elementList, ObjOptionsStruct& localOptions) const
+void ReaderWriterOBJ::copyElementToArrays(const obj::Model& model, const obj::ElementList& elementList, const obj::Element& element, bool reverse, bool rotate,
+                                          osg::Vec3Array* vertices, osg::Vec3Array* normals, osg::Vec2Array* texcoords, osg::Vec4Array* colors, unsigned int& pos) const
 {
+    for(unsigned int i=0; i<element.count; ++i, ++pos)
+    {
+        // when reversing add to OSG arrays in the opposite order to the OBJ, as OSG assume anticlockwise ordering.
+        unsigned int index = reverse ? element.first+element.count-1-i : element.first+i;
 
-    unsigned int numVertexIndices = 0;
-    unsigned int numNormalIndices = 0;
-    unsigned int numTexCoordIndices = 0;
-
-    unsigned int numPointElements = 0;
-    unsigned int numPolylineElements = 0;
-    unsigned int numPolygonElements = 0;
+        int vi = elementList.vertexIndices[index];
+        (*vertices)[pos] = transformVertex(model.vertices[vi],rotate);
 
-    obj::Model::ElementList::iterator itr;
+        // if use color extension ( not standard but used by meshlab)
+        if (colors) (*colors)[pos] = model.colors[vi];
 
-    if (localOptions.generateFacetNormals == true) {
-        for(itr=elementList.begin();
-                itr!=elementList.end();
-                    ++itr)
-        {
-            obj::Element& element = *(*itr);
-            if (element.dataType==obj::Element::POINTS || element.dataType==obj::Element::POLYLINE)
-                continue;
-
-            if (element.normalIndices.size() == 0) {
-                // fill in the normals
-                int a = element.vertexIndices[0];
-                int b = element.vertexIndices[1];
-                int c = element.vertexIndices[2];
+        if (normals) (*normals)[pos] = transformNormal(model.normals[elementList.normalIndices[index]],rotate);
+        if (texcoords) (*texcoords)[pos] = model.texcoords[elementList.texCoordIndices[index]];
+    }
+}
 
-                osg::Vec3f ab(model.vertices[b]);
-                osg::Vec3f ac(model.vertices[c]);
+osg::Geometry* ReaderWriterOBJ::convertElementListToGeometry(obj::Model& model, obj::ElementList& elementList, ObjOptionsStruct& localOptions) const
+{
+    unsigned int numVertexIndices = elementList.vertexIndices.size();
+    if (numVertexIndices==0) return 0;
 
-                ab -= model.vertices[a];
-                ac -= model.vertices[a];
+    // the normal and texcoord indices of an ElementList are either empty or aligned with its vertex indices.
+    bool hasNormals = !elementList.normalIndices.empty();
+    bool hasTexCoords = !elementList.texCoordIndices.empty();
 
-                osg::Vec3f Norm( ab ^ ac );
-                Norm.normalize();
-                int normal_idx = model.normals.size();
-                model.normals.push_back(Norm);
+    unsigned int numPointElements = 0;
+    unsigned int numPolylineElements = 0;
+    unsigned int numPolygonElements = 0;
 
-                for (unsigned i=0 ; i < element.vertexIndices.size() ; i++)
-                    element.normalIndices.push_back(normal_idx);
-            }
-        }
+    obj::ElementList::Elements::const_iterator itr;
+    for(itr=elementList.elements.begin();
+        itr!=elementList.elements.end();
+        ++itr)
+    {
+        numPointElements += (itr->dataType==obj::Element::POINTS) ? 1 : 0;
+        numPolylineElements += (itr->dataType==obj::Element::POLYLINE) ? 1 : 0;
+        numPolygonElements += (itr->dataType==obj::Element::POLYGON) ? 1 : 0;
     }
 
-
-
-    for(itr=elementList.begin();
-        itr!=elementList.end();
-        ++itr)
+    if (localOptions.generateFacetNormals == true && !hasNormals && numPolygonElements>0)
     {
-        obj::Element& element = *(*itr);
+        // fill in the normals of the polygons, points and polylines are left without.
+        elementList.normalIndices.resize(numVertexIndices, -1);
 
-        numVertexIndices += element.vertexIndices.size();
-        numNormalIndices += element.normalIndices.size();
-        numTexCoordIndices += element.texCoordIndices.size();
+        unsigned int numNormalIndices = 0;
+        for(itr=elementList.elements.begin();
+            itr!=elementList.elements.end();
+            ++itr)
+        {
+            const obj::Element& element = *itr;
+            if (element.dataType!=obj::Element::POLYGON)
+                continue;
 
-        numPointElements += (element.dataType==obj::Element::POINTS) ? 1 : 0;
-        numPolylineElements += (element.dataType==obj::Element::POLYLINE) ? 1 : 0;
-        numPolygonElements += (element.dataType==obj::Element::POLYGON) ? 1 : 0;
+            int a = elementList.vertexIndices[element.first];
+            int b = elementList.vertexIndices[element.first+1];
+            int c = elementList.vertexIndices[element.first+2];
 
-    }
+            osg::Vec3f ab(model.vertices[b]);
+            osg::Vec3f ac(model.vertices[c]);
 
-    if (numVertexIndices==0) return 0;
+            ab -= model.vertices[a];
+            ac -= model.vertices[a];
 
-    if (numNormalIndices!=0 && numNormalIndices!=numVertexIndices)
-    {
-        OSG_NOTICE<<"Incorrect number of normals, ignore them"<<std::endl;
-        numNormalIndices = 0;
-    }
+            osg::Vec3f Norm( ab ^ ac );
+            Norm.normalize();
+            int normal_idx = model.normals.size();
+            model.normals.push_back(Norm);
 
-    if (numTexCoordIndices!=0 && numTexCoordIndices!=numVertexIndices)
-    {
-        OSG_NOTICE<<"Incorrect number of normals, ignore them"<<std::endl;
-        numTexCoordIndices = 0;
-    }
-
-    osg::Vec3Array* vertices = numVertexIndices ? new osg::Vec3Array : 0;
-    osg::Vec3Array* normals = numNormalIndices ? new osg::Vec3Array : 0;
-    osg::Vec2Array* texcoords = numTexCoordIndices ? new osg::Vec2Array : 0;
-    osg::Vec4Array* colors = (!model.colors.empty()) ? new osg::Vec4Array : 0;
+            std::fill(elementList.normalIndices.begin()+element.first, elementList.normalIndices.begin()+element.first+element.count, normal_idx);
+            numNormalIndices += element.count;
+        }
 
-    if (vertices) vertices->reserve(numVertexIndices);
-    if (normals) normals->reserve(numNormalIndices);
-    if (texcoords) texcoords->reserve(numTexCoordIndices);
-    if (colors) colors->reserve(numVertexIndices);
+        hasNormals = numNormalIndices==numVertexIndices;
+        if (!hasNormals)
+        {
+            OSG_NOTICE<<"Incorrect number of normals, ignore them"<<std::endl;
+        }
+    }
 
+    // size the arrays up front and write the elements straight into them.
+    osg::Vec3Array* vertices = new osg::Vec3Array(numVertexIndices);
+    osg::Vec3Array* normals = hasNormals ? new osg::Vec3Array(numVertexIndices) : 0;
+    osg::Vec2Array* texcoords = hasTexCoords ? new osg::Vec2Array(numVertexIndices) : 0;
+    osg::Vec4Array* colors = (!model.colors.empty()) ? new osg::Vec4Array(numVertexIndices) : 0;
 
     osg::Geometry* geometry = new osg::Geometry;
-    if (vertices) geometry->setVertexArray(vertices);
+    geometry->setVertexArray(vertices);
     if (normals)
     {
         geometry->setNormalArray(normals, osg::Array::BIND_PER_VERTEX);
@@ -514,98 +526,38 @@ osg::Geometry* ReaderWriterOBJ::convertElementListToGeometry(obj::Model& model,
         geometry->setColorBinding(osg::Geometry::BIND_PER_VERTEX);
     }
 
+    unsigned int pos = 0;
+
     if (numPointElements>0)
     {
-        unsigned int startPos = vertices->size();
-        unsigned int numPoints = 0;
-        for(itr=elementList.begin();
-            itr!=elementList.end();
+        unsigned int startPos = pos;
+        for(itr=elementList.elements.begin();
+            itr!=elementList.elements.end();
             ++itr)
         {
-            obj::Element& element = *(*itr);
-            if (element.dataType==obj::Element::POINTS)
+            if (itr->dataType==obj::Element::POINTS)
             {
-                for(obj::Element::IndexList::iterator index_itr = element.vertexIndices.begin();
-                    index_itr != element.vertexIndices.end();
-                    ++index_itr)
-                {
-                    // if use color extension ( not standard but used by meshlab)
-                    if (colors)
-                    {
-                        colors->push_back(model.colors[*index_itr]);
-                    }
-                    vertices->push_back(transformVertex(model.vertices[*index_itr],localOptions.rotate));
-                    ++numPoints;
-                }
-                if (numNormalIndices)
-                {
-                    for(obj::Element::IndexList::iterator index_itr = element.normalIndices.begin();
-                        index_itr != element.normalIndices.end();
-                        ++index_itr)
-                    {
-                        normals->push_back(transformNormal(model.normals[*index_itr],localOptions.rotate));
-                    }
-                }
-                if (numTexCoordIndices)
-                {
-                    for(obj::Element::IndexList::iterator index_itr = element.texCoordIndices.begin();
-                        index_itr != element.texCoordIndices.end();
-                        ++index_itr)
-                    {
-                        texcoords->push_back(model.texcoords[*index_itr]);
-                    }
-                }
+                copyElementToArrays(model, elementList, *itr, false, localOptions.rotate, vertices, normals, texcoords, colors, pos);
             }
         }
 
-        osg::DrawArrays* drawArrays = new osg::DrawArrays(GL_POINTS,startPos,numPoints);
+        osg::DrawArrays* drawArrays = new osg::DrawArrays(GL_POINTS,startPos,pos-startPos);
         geometry->addPrimitiveSet(drawArrays);
     }
 
     if (numPolylineElements>0)
     {
-        unsigned int startPos = vertices->size();
-        osg::DrawArrayLengths* drawArrayLengths = new osg::DrawArrayLengths(GL_LINES,startPos);
+        osg::DrawArrayLengths* drawArrayLengths = new osg::DrawArrayLengths(GL_LINES,pos);
+        drawArrayLengths->reserve(numPolylineElements);
 
-        for(itr=elementList.begin();
-            itr!=elementList.end();
+        for(itr=elementList.elements.begin();
+            itr!=elementList.elements.end();
             ++itr)
         {
-            obj::Element& element = *(*itr);
-            if (element.dataType==obj::Element::POLYLINE)
+            if (itr->dataType==obj::Element::POLYLINE)
             {
-                drawArrayLengths->push_back(element.vertexIndices.size());
-
-                for(obj::Element::IndexList::iterator index_itr = element.vertexIndices.begin();
-                    index_itr != element.vertexIndices.end();
-                    ++index_itr)
-                {
-                    // if use color extension ( not standard but used by meshlab)
-                    if (colors)
-                    {
-                        colors->push_back(model.colors[*index_itr]);
-                    }
-
-                    vertices->push_back(transformVertex(model.vertices[*index_itr],localOptions.rotate));
-                }
-                if (numNormalIndices)
-                {
-                    for(obj::Element::IndexList::iterator index_itr = element.normalIndices.begin();
-                        index_itr != element.normalIndices.end();
-                        ++index_itr)
-                    {
-                        normals->push_back(transformNormal(model.normals[*index_itr],localOptions.rotate));
-                    }
-                }
-                if (numTexCoordIndices)
-                {
-                    for(obj::Element::IndexList::iterator index_itr = element.texCoordIndices.begin();
-                        index_itr != element.texCoordIndices.end();
-                        ++index_itr)
-                    {
-                        texcoords->push_back(model.texcoords[*index_itr]);
-                    }
-                }
+                drawArrayLengths->push_back(itr->count);
+                copyElementToArrays(model, elementList, *itr, false, localOptions.rotate, vertices, normals, texcoords, colors, pos);
             }
         }
 
@@ -617,115 +569,33 @@ osg::Geometry* ReaderWriterOBJ::convertElementListToGeometry(obj::Model& model,
     bool hasReversedFaces = false ;
     if (numPolygonElements>0)
     {
-        unsigned int startPos = vertices->size();
-
         #ifdef USE_DRAWARRAYLENGTHS
-            osg::DrawArrayLengths* drawArrayLengths = new osg::DrawArrayLengths(GL_POLYGON,startPos);
+            osg::DrawArrayLengths* drawArrayLengths = new osg::DrawArrayLengths(GL_POLYGON,pos);
+            drawArrayLengths->reserve(numPolygonElements);
             geometry->addPrimitiveSet(drawArrayLengths);
+        #else
+            // the tessellator and tristripper below work on the individual polygons, so each keeps its own DrawArrays.
+            geometry->getPrimitiveSetList().reserve(geometry->getNumPrimitiveSets()+numPolygonElements);
         #endif
 
-        for(itr=elementList.begin();
-            itr!=elementList.end();
+        for(itr=elementList.elements.begin();
+            itr!=elementList.elements.end();
             ++itr)
         {
-            obj::Element& element = *(*itr);
+            const obj::Element& element = *itr;
             if (element.dataType==obj::Element::POLYGON)
             {
-
-
-
-
-
-
                 #ifdef USE_DRAWARRAYLENGTHS
-                    drawArrayLengths->push_back(element.vertexIndices.size());
+                    drawArrayLengths->push_back(element.count);
                 #else
-                    if (element.vertexIndices.size()>4)
-                    {
-                        osg::DrawArrays* drawArrays = new osg::DrawArrays(GL_POLYGON,startPos,element.vertexIndices.size());
-                        startPos += element.vertexIndices.size();
-                        geometry->addPrimitiveSet(drawArrays);
-                    }
-                    else
-                    {
-                        osg::DrawArrays* drawArrays = new osg::DrawArrays(GL_TRIANGLE_FAN,startPos,element.vertexIndices.size());
-                        startPos += element.vertexIndices.size();
-                        geometry->addPrimitiveSet(drawArrays);
-                    }
+                    GLenum mode = element.count>4 ? GL_POLYGON : GL_TRIANGLE_FAN;
+                    geometry->addPrimitiveSet(new osg::DrawArrays(mode,pos,element.count));
                 #endif
 
+                bool reverse = model.needReverse(elementList, element) && !localOptions.noReverseFaces;
+                if (reverse) hasReversedFaces = true;
 
-                if (model.needReverse(element) && !localOptions.noReverseFaces)
-                {
-                    hasReversedFaces = true;
-                    // need to reverse so add to OSG arrays in same order as in OBJ, as OSG assume anticlockwise ordering.
-                    for(obj::Element::IndexList::reverse_iterator index_itr = element.vertexIndices.rbegin();
-                        index_itr != element.vertexIndices.rend();
-                        ++index_itr)
-                    {
-                        // if use color extension ( not standard but used by meshlab)
-                        if (colors)
-                        {
-                            colors->push_back(model.colors[*index_itr]);
-                        }
-
-                        vertices->push_back(transformVertex(model.vertices[*index_itr],localOptions.rotate));
-                    }
-                    if (numNormalIndices)
-                    {
-                        for(obj::Element::IndexList::reverse_iterator index_itr = element.normalIndices.rbegin();
-                            index_itr != element.normalIndices.rend();
-                            ++index_itr)
-                        {
-                            normals->push_back(transformNormal(model.normals[*index_itr],localOptions.rotate));
-                        }
-                    }
-
-
-                    if (numTexCoordIndices)
-                    {
-                        for(obj::Element::IndexList::reverse_iterator index_itr = element.texCoordIndices.rbegin();
-                            index_itr != element.texCoordIndices.rend();
-                            ++index_itr)
-                        {
-                            texcoords->push_back(model.texcoords[*index_itr]);
-                        }
-                    }
-                }
-                else
-                {
-                    // no need to reverse so add to OSG arrays in same order as in OBJ.
-                    for(obj::Element::IndexList::iterator index_itr = element.vertexIndices.begin();
-                        index_itr != element.vertexIndices.end();
-                        ++index_itr)
-                    {
-                        // if use color extension ( not standard but used by meshlab)
-                        if (colors)
-                        {
-                            colors->push_back(model.colors[*index_itr]);
-                        }
-
-                        vertices->push_back(transformVertex(model.vertices[*index_itr],localOptions.rotate));
-                    }
-                    if (numNormalIndices)
-                    {
-                        for(obj::Element::IndexList::iterator index_itr = element.normalIndices.begin();
-                            index_itr != element.normalIndices.end();
-                            ++index_itr)
-                        {
-                            normals->push_back(transformNormal(model.normals[*index_itr],localOptions.rotate));
-                        }
-                    }
-                    if (numTexCoordIndices)
-                    {
-                        for(obj::Element::IndexList::iterator index_itr = element.texCoordIndices.begin();
-                            index_itr != element.texCoordIndices.end();
-                            ++index_itr)
-                        {
-                            texcoords->push_back(model.texcoords[*index_itr]);
-                        }
-                    }
-                }
+                copyElementToArrays(model, elementList, element, reverse, localOptions.rotate, vertices, normals, texcoords, colors, pos);
             }
         }
     }
@@ -756,7 +626,7 @@ osg::Node* ReaderWriterOBJ::convertModelToSceneGraph(obj::Model& model, ObjOptio
     {
 
         const obj::ElementState& es = itr->first;
-        obj::Model::ElementList& el = itr->second;
+        obj::ElementList& el = itr->second;
 
         osg::Geometry* geometry = convertElementListToGeometry(model,el,localOptions);
 
@@ -826,6 +696,10 @@ ReaderWriterOBJ::ObjOptionsStruct ReaderWriterOBJ::parseOptions(const osgDB::Rea
     localOptions.generateFacetNormals = false;
     localOptions.fixBlackMaterials = true;
     localOptions.noReverseFaces = false;
+    localOptions.noMapping = false;
+    // the DatabasePager already loads on several threads, so don't spawn more parsing threads from each of them.
+    bool readingFromPager = dynamic_cast<osgDB::DatabasePager::DatabaseThread*>(OpenThreads::Thread::CurrentThread())!=0;
+    localOptions.readThreads = readingFromPager ? 1 : osg::maximum(OpenThreads::GetNumberOfProcessors(), 1);
 
     if (options!=NULL)
     {
@@ -868,6 +742,14 @@ ReaderWriterOBJ::ObjOptionsStruct ReaderWriterOBJ::parseOptions(const osgDB::Rea
             {
                 localOptions.noReverseFaces = true;
             }
+            else if (pre_equals == "noMapping")
+            {
+                localOptions.noMapping = true;
+            }
+            else if (pre_equals == "readThreads")
+            {
+                localOptions.readThreads = osg::maximum(atoi(post_equals.c_str()), 1);
+            }
             else if (post_equals.length()>0)
             {
                 obj::Material::Map::TextureMapType type = obj::Material::Map::UNKNOWN;
@@ -904,6 +786,24 @@ osgDB::ReaderWriter::ReadResult ReaderWriterOBJ::readNode(const std::string& fil
     if (fileName.empty()) return ReadResult::FILE_NOT_FOUND;
 
 
+    ObjOptionsStruct localOptions = parseOptions(options);
+
+    // parse the file straight out of a mapping of it, splitting its lines between threads.
+    osg::ref_ptr<osgDB::MappedFile> mappedFile = localOptions.noMapping ? 0 : new osgDB::MappedFile(fileName);
+    if (mappedFile.valid() && mappedFile->valid())
+    {
+        osg::ref_ptr<Options> local_opt = options ? static_cast<Options*>(options->clone(osg::CopyOp::SHALLOW_COPY)) : new Options;
+        local_opt->getDatabasePathList().push_front(osgDB::getFilePath(fileName));
+
+        obj::Model model;
+        model.setDatabasePath(osgDB::getFilePath(fileName.c_str()));
+        model.readOBJ(mappedFile->data(), mappedFile->size(), local_opt.get(), localOptions.readThreads);
+        mappedFile = 0;
+
+        osg::Node* node = convertModelToSceneGraph(model, localOptions, local_opt.get());
+        return node;
+    }
+
     osgDB::ifstream fin(fileName.c_str());
     if (fin)
     {
@@ -916,8 +816,6 @@ osgDB::ReaderWriter::ReadResult ReaderWriterOBJ::readNode(const std::string& fil
         model.setDatabasePath(osgDB::getFilePath(fileName.c_str()));
         model.readOBJ(fin, local_opt.get());
 
-        ObjOptionsStruct localOptions = parseOptions(options);
-
         osg::Node* node = convertModelToSceneGraph(model, localOptions, local_opt.get());
         return node;
     }
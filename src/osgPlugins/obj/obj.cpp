@@ -17,14 +17,23 @@
 #include <string>
 #include <stdio.h>
 #include <functional>
+#include <limits>
+#include <locale>
 
 #include "obj.h"
 
+#include <osg/Math>
 #include <osg/Notify>
 
 #include <osgDB/FileUtils>
 #include <osgDB/FileNameUtils>
 
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+#include <OpenThreads/Thread>
+
+#include <float.h>
+#include <limits.h>
 #include <string.h>
 
 using namespace obj;
@@ -559,260 +568,645 @@ std::string trim(const std::string& s)
   return std::string(s, b, e - b + 1);
 }
 
-inline bool isZBrushColorField(char* line)
+inline bool isZBrushColorField(const char* line)
 {
     return strncmp(line, "#MRGB", 5) == 0;
 }
 
-bool Model::readOBJ(std::istream& fin, const osgDB::ReaderWriter::Options* options)
+namespace
 {
-    OSG_INFO<<"Reading OBJ file"<<std::endl;
 
-    const int LINE_SIZE = 4096;
-    char line[LINE_SIZE];
-    float x = 0.0f, y = 0.0f, z = 0.0f, w = 0.0f;
-    float r,g,b,a;
+inline bool isNumberSpace(char c)
+{
+    return c==' ' || (c>='\t' && c<='\r');
+}
 
-    while (fin)
+inline bool isDigit(char c)
+{
+    return c>='0' && c<='9';
+}
+
+inline int remapIndex(int index, int size)
+{
+    return (index<0) ? size+index : index-1;
+}
+
+// a double holding a value halfway between two floats, which converting to float could round the wrong way
+// after the rounding of the double itself.
+inline bool isFloatMidpoint(double value)
+{
+    unsigned long long bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits & 0x1fffffffULL)==0x10000000ULL;
+}
+
+/** Parse a float as sscanf's %f does in the classic locale, whatever the locale of the application, skipping any white space
+  * before it. Return the position after it, or NULL if there isn't a number there. Hexadecimal floats aren't supported.*/
+const char* parseFloat(const char* ptr, float& value)
+{
+    static const double s_powersOfTen[] =
     {
-        readline(fin,line,LINE_SIZE);
-        if ((line[0]=='#' && !isZBrushColorField(line)) || line[0]=='$')
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    while(isNumberSpace(*ptr)) ++ptr;
+
+    const char* start = ptr;
+    bool negative = false;
+    if (*ptr=='-' || *ptr=='+')
+    {
+        negative = (*ptr=='-');
+        ++ptr;
+    }
+
+    if (!isDigit(*ptr) && *ptr!='.')
+    {
+        if (strncasecmp(ptr, "nan", 3)==0)
         {
-            // comment line
-            // OSG_NOTICE <<"Comment: "<<line<<std::endl;
+            value = negative ? -std::numeric_limits<float>::quiet_NaN() : std::numeric_limits<float>::quiet_NaN();
+            return ptr+3;
+        }
+        if (strncasecmp(ptr, "inf", 3)==0)
+        {
+            value = negative ? -std::numeric_limits<float>::infinity() : std::numeric_limits<float>::infinity();
+            return (strncasecmp(ptr, "infinity", 8)==0) ? ptr+8 : ptr+3;
+        }
+        return 0;
+    }
+
+    // up to 19 significant digits fit in the mantissa, any more are only needed to decide the rounding.
+    unsigned long long mantissa = 0;
+    int numDigits = 0;
+    int exponent = 0;
+    bool truncated = false;
+    bool hasDigits = false;
+
+    for(; isDigit(*ptr); ++ptr)
+    {
+        hasDigits = true;
+        if (numDigits<19)
+        {
+            mantissa = mantissa*10 + (*ptr-'0');
+            if (mantissa>0) ++numDigits;
         }
-        else if(isZBrushColorField(line))
+        else
         {
-            // Get the zBrush vertex colors given in comments under the form :
-            // * #MRGB MMRRGGBB MMRRGGBB ... (up to 64 hexadecimal color fields)
-            std::string colorFields(line + 6);
-            while (colorFields.size() >= 8)
+            ++exponent;
+            if (*ptr!='0') truncated = true;
+        }
+    }
+
+    if (*ptr=='.')
+    {
+        for(++ptr; isDigit(*ptr); ++ptr)
+        {
+            hasDigits = true;
+            if (numDigits<19)
             {
-                std::string currentValue;
+                mantissa = mantissa*10 + (*ptr-'0');
+                if (mantissa>0) ++numDigits;
+                --exponent;
+            }
+            else if (*ptr!='0') truncated = true;
+        }
+    }
 
-                // Skipping the MM component
-                colorFields = colorFields.substr(2);
+    if (!hasDigits) return 0;
 
-                currentValue = colorFields.substr(0,2);
-                r = static_cast<float>(strtol(currentValue.c_str(), NULL, 16)) / 255.;
-                colorFields = colorFields.substr(2);
+    // like sscanf, an e and sign without any digits after them are still taken as part of the number.
+    const char* mantissaEnd = ptr;
+    int e10 = 0;
+    if (*ptr=='e' || *ptr=='E')
+    {
+        ++ptr;
+        bool negativeExponent = false;
+        if (*ptr=='-' || *ptr=='+')
+        {
+            negativeExponent = (*ptr=='-');
+            ++ptr;
+        }
 
-                currentValue = colorFields.substr(0,2);
-                g = static_cast<float>(strtol(currentValue.c_str(), NULL, 16)) / 255.;
-                colorFields = colorFields.substr(2);
+        for(; isDigit(*ptr); ++ptr)
+        {
+            if (e10<100000) e10 = e10*10 + (*ptr-'0');
+        }
+        if (negativeExponent) e10 = -e10;
+        exponent += e10;
+    }
 
-                currentValue = colorFields.substr(0,2);
-                b = static_cast<float>(strtol(currentValue.c_str(), NULL, 16)) / 255.;
-                colorFields = colorFields.substr(2);
+    if (mantissa==0)
+    {
+        value = negative ? -0.0f : 0.0f;
+        return ptr;
+    }
 
-                colors.push_back(osg::Vec4(r, g, b, 1.0));
-            }
+    // the mantissa and power of ten are both exact doubles, so the double is correctly rounded, as is the float rounded
+    // from it unless the double landed on a point halfway between two floats.
+    if (!truncated && mantissa<(1ULL<<53) && exponent>=-22 && exponent<=22)
+    {
+        double d = static_cast<double>(mantissa);
+        if (exponent<0) d /= s_powersOfTen[-exponent];
+        else d *= s_powersOfTen[exponent];
+
+        if (d>=FLT_MIN && d<=FLT_MAX && !isFloatMidpoint(d))
+        {
+            value = negative ? -static_cast<float>(d) : static_cast<float>(d);
+            return ptr;
         }
-        else if (strlen(line)>0)
+    }
+
+    // leave the rare hard cases to the standard library, in the classic locale.
+    std::ostringstream oss;
+    oss.imbue(std::locale::classic());
+    oss<<std::string(start, mantissaEnd)<<"e"<<e10;
+
+    std::istringstream iss(oss.str());
+    iss.imbue(std::locale::classic());
+    if (!(iss >> value))
+    {
+        // the number is out of the range of a float.
+        value = negative ? -std::numeric_limits<float>::infinity() : std::numeric_limits<float>::infinity();
+    }
+    return ptr;
+}
+
+/** Parse up to maxNumValues floats separated by white space, as sscanf with a format of several %f does, returning the
+  * number read.*/
+unsigned int parseFloats(const char* ptr, float* values, unsigned int maxNumValues)
+{
+    unsigned int numValues = 0;
+    while(numValues<maxNumValues && (ptr = parseFloat(ptr, values[numValues]))!=0)
+    {
+        ++numValues;
+    }
+    return numValues;
+}
+
+/** Parse an int as sscanf's %d does, skipping any white space before it. Return the position after it, or NULL if there
+  * isn't a number there.*/
+const char* parseInt(const char* ptr, int& value)
+{
+    while(isNumberSpace(*ptr)) ++ptr;
+
+    bool negative = false;
+    if (*ptr=='-' || *ptr=='+')
+    {
+        negative = (*ptr=='-');
+        ++ptr;
+    }
+
+    if (!isDigit(*ptr)) return 0;
+
+    long long v = 0;
+    for(; isDigit(*ptr); ++ptr)
+    {
+        if (v<=INT_MAX) v = v*10 + (*ptr-'0');
+    }
+    if (v>INT_MAX) v = INT_MAX;
+
+    value = static_cast<int>(negative ? -v : v);
+    return ptr;
+}
+
+enum FaceVertexFormat
+{
+    NO_VERTEX,
+    VERTEX,
+    VERTEX_TEXCOORD,
+    VERTEX_NORMAL,
+    VERTEX_TEXCOORD_NORMAL
+};
+
+/** Parse a vertex of a face given as v/t/n, v//n, v/t or v, accepting what the sscanf formats for each, tried in that
+  * order, used to.*/
+FaceVertexFormat parseFaceVertex(const char* ptr, int& vi, int& ti, int& ni)
+{
+    ptr = parseInt(ptr, vi);
+    if (!ptr) return NO_VERTEX;
+    if (*ptr!='/') return VERTEX;
+
+    if (ptr[1]=='/') return parseInt(ptr+2, ni) ? VERTEX_NORMAL : VERTEX;
+
+    ptr = parseInt(ptr+1, ti);
+    if (!ptr) return VERTEX;
+    if (*ptr=='/' && parseInt(ptr+1, ni)) return VERTEX_TEXCOORD_NORMAL;
+    return VERTEX_TEXCOORD;
+}
+
+/** Copy a line out of the data from ptr to end as Model::readline() does from a stream, returning the start of the next line.*/
+const char* readDataLine(const char* ptr, const char* end, char* line, const int LINE_SIZE)
+{
+    bool eatWhiteSpaceAtStart = true;
+
+    char* out = line;
+    char* outEnd = line+LINE_SIZE-1;
+    bool skipNewline = false;
+    while (ptr<end && out<outEnd)
+    {
+        char c = *ptr++;
+        int p = (ptr<end) ? *ptr : -1;
+        if (c=='\r')
         {
-            if (strncmp(line,"v ",2)==0)
+            if (p=='\n') ++ptr;
+
+            if (skipNewline)
             {
-                unsigned int fieldsRead = sscanf(line+2,"%f %f %f %f %f %f %f", &x, &y, &z, &w, &g, &b, &a);
-
-                if (fieldsRead==1)
-                    vertices.push_back(osg::Vec3(x,0.0f,0.0f));
-                else if (fieldsRead==2)
-                    vertices.push_back(osg::Vec3(x,y,0.0f));
-                else if (fieldsRead==3)
-                    vertices.push_back(osg::Vec3(x,y,z));
-                else if (fieldsRead == 4)
-                    vertices.push_back(osg::Vec3(x/w,y/w,z/w));
-                else if (fieldsRead == 6)
-                {
-                    vertices.push_back(osg::Vec3(x,y,z));
-                    colors.push_back(osg::Vec4(w, g, b, 1.0));
-                }
-                else if ( fieldsRead == 7 )
-                {
-                    vertices.push_back(osg::Vec3(x,y,z));
-                    colors.push_back(osg::Vec4(w, g, b, a));
-                }
+                skipNewline = false;
+                *out++ = ' ';
+                continue;
             }
-            else if (strncmp(line,"vn ",3)==0)
+            else break;
+        }
+        else if (c=='\n')
+        {
+            if (skipNewline)
             {
-                unsigned int fieldsRead = sscanf(line+3,"%f %f %f", &x, &y, &z);
-
-                if (fieldsRead==1) normals.push_back(osg::Vec3(x,0.0f,0.0f));
-                else if (fieldsRead==2) normals.push_back(osg::Vec3(x,y,0.0f));
-                else if (fieldsRead==3) normals.push_back(osg::Vec3(x,y,z));
+                *out++ = ' ';
+                continue;
             }
-            else if (strncmp(line,"vt ",3)==0)
-            {
-                unsigned int fieldsRead = sscanf(line+3,"%f %f %f", &x, &y, &z);
+            else break;
+        }
+        else if (c=='\\' && (p=='\r' || p=='\n'))
+        {
+            skipNewline = true;
+        }
+        else
+        {
+            skipNewline = false;
 
-                if (fieldsRead==1) texcoords.push_back(osg::Vec2(x,0.0f));
-                else if (fieldsRead==2) texcoords.push_back(osg::Vec2(x,y));
-                else if (fieldsRead==3) texcoords.push_back(osg::Vec2(x,y));
-            }
-            else if (strncmp(line,"l ",2)==0 ||
-                     strncmp(line,"p ",2)==0 ||
-                     strncmp(line,"f ",2)==0)
+            if (!eatWhiteSpaceAtStart || (c!=' ' && c!='\t'))
             {
-                char* ptr = line+2;
+                eatWhiteSpaceAtStart = false;
+                *out++ = c;
+            }
+        }
+    }
 
-                Element* element = new Element( (line[0]=='p') ? Element::POINTS :
-                                                (line[0]=='l') ? Element::POLYLINE :
-                                                Element::POLYGON );
+    // strip trailing spaces
+    while (out>line && *(out-1)==' ')
+    {
+        --out;
+    }
 
-                // OSG_NOTICE<<"face"<<ptr<<std::endl;
+    *out = 0;
 
-                int vi=0, ti=0, ni=0;
-                while(*ptr!=0)
-                {
-                    // skip white space
-                    while(*ptr==' ') ++ptr;
+    for(out = line; *out != 0; ++out)
+    {
+        if (*out == '\t') *out=' ';
+    }
 
-                    if (sscanf(ptr, "%d/%d/%d", &vi, &ti, &ni) == 3)
-                    {
-                        // OSG_NOTICE<<"   vi="<<vi<<"/ti="<<ti<<"/ni="<<ni<<std::endl;
-                        element->vertexIndices.push_back(remapVertexIndex(vi));
-                        element->normalIndices.push_back(remapNormalIndex(ni));
-                        element->texCoordIndices.push_back(remapTexCoordIndex(ti));
-                    }
-                    else if (sscanf(ptr, "%d//%d", &vi, &ni) == 2)
-                    {
-                        // OSG_NOTICE<<"   vi="<<vi<<"//ni="<<ni<<std::endl;
-                        element->vertexIndices.push_back(remapVertexIndex(vi));
-                        if (remapNormalIndex(ni) < static_cast<int>(normals.size()))
-                            element->normalIndices.push_back(remapNormalIndex(ni));
-                    }
-                    else if (sscanf(ptr, "%d/%d", &vi, &ti) == 2)
-                    {
-                        // OSG_NOTICE<<"   vi="<<vi<<"/ti="<<ti<<std::endl;
-                        element->vertexIndices.push_back(remapVertexIndex(vi));
-                        if (remapTexCoordIndex(ti) < static_cast<int>(texcoords.size()))
-                            element->texCoordIndices.push_back(remapTexCoordIndex(ti));
-                    }
-                    else if (sscanf(ptr, "%d", &vi) == 1)
-                    {
-                        // OSG_NOTICE<<"   vi="<<vi<<std::endl;
-                        element->vertexIndices.push_back(remapVertexIndex(vi));
-                    }
+    return ptr;
+}
 
-                    // skip to white space or end of line
-                    while(*ptr!=' ' && *ptr!=0) ++ptr;
+/** Return the start of the first line after ptr that Model::readline() would also start a line at, one following a line
+  * ending that isn't continued by a backslash or part of a run of line endings that might be.*/
+const char* findLineStart(const char* begin, const char* ptr, const char* end)
+{
+    for(; ptr<end; ++ptr)
+    {
+        if (*ptr!='\n') continue;
 
-                }
+        const char* previous = ptr-1;
+        if (previous>=begin && *previous=='\r') --previous;
+        if (previous<begin) continue;
 
-                if (!element->normalIndices.empty() && element->normalIndices.size() != element->vertexIndices.size())
-                {
-                    element->normalIndices.clear();
-                }
+        if (*previous!='\\' && *previous!='\r' && *previous!='\n') return ptr+1;
+    }
+    return end;
+}
 
-                if (!element->texCoordIndices.empty() && element->texCoordIndices.size() != element->vertexIndices.size())
-                {
-                    element->texCoordIndices.clear();
-                }
+/** The vertex data and elements of a run of lines of an obj, parsed without reference to the rest of the file so that runs
+  * can be parsed in parallel, then added to the Model in order by addParsedLines().*/
+struct ParsedLines
+{
+    enum RecordType
+    {
+        ELEMENT,
+        STATE_LINE
+    };
 
-                if (!element->vertexIndices.empty())
-                {
-                    Element::CoordinateCombination coordateCombination = element->getCoordinateCombination();
-                    if (coordateCombination!=currentElementState.coordinateCombination)
-                    {
-                        currentElementState.coordinateCombination = coordateCombination;
-                        currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                    }
-                    addElement(element);
-                }
-                else
-                {
-                    // empty element, don't both adding, just unref to delete it.
-                    element->unref();
-                }
+    struct Record
+    {
+        RecordType          type;
+        Element::DataType   dataType;
 
-            }
-            else if (strncmp(line,"usemtl ",7)==0)
-            {
-                std::string materialName( line+7 );
-                if (currentElementState.materialName != materialName)
-                {
-                    currentElementState.materialName = materialName;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
-            }
-            else if (strncmp(line,"mtllib ",7)==0)
+        // the range of indices of an element, or of stateLines for a state line.
+        unsigned int        begin;
+        unsigned int        end;
+
+        // the numbers of vertices, normals and texcoords of the run before the record, for remapping its indices.
+        int                 numVertices;
+        int                 numNormals;
+        int                 numTexCoords;
+    };
+
+    typedef std::vector<Record> RecordList;
+
+    void readLine(const char* line);
+
+    void addRecord(RecordType type, Element::DataType dataType, unsigned int begin, unsigned int end)
+    {
+        Record record;
+        record.type = type;
+        record.dataType = dataType;
+        record.begin = begin;
+        record.end = end;
+        record.numVertices = vertices.size();
+        record.numNormals = normals.size();
+        record.numTexCoords = texcoords.size();
+        records.push_back(record);
+    }
+
+    std::vector<osg::Vec3>  vertices;
+    std::vector<osg::Vec4>  colors;
+    std::vector<osg::Vec3>  normals;
+    std::vector<osg::Vec2>  texcoords;
+
+    // the FaceVertexFormat and vertex, texcoord and normal indices of each vertex of the elements.
+    std::vector<int>        indices;
+
+    // the usemtl, mtllib, o, g and s lines, and any that aren't handled, each terminated by a null.
+    std::string             stateLines;
+
+    RecordList              records;
+};
+
+void ParsedLines::readLine(const char* line)
+{
+    float v[7];
+
+    if ((line[0]=='#' && !isZBrushColorField(line)) || line[0]=='$')
+    {
+        // comment line
+    }
+    else if (isZBrushColorField(line))
+    {
+        // Get the zBrush vertex colors given in comments under the form :
+        // * #MRGB MMRRGGBB MMRRGGBB ... (up to 64 hexadecimal color fields)
+        std::string colorFields(line[5]!=0 ? line + 6 : "");
+        while (colorFields.size() >= 8)
+        {
+            std::string currentValue;
+            float r,g,b;
+
+            // Skipping the MM component
+            colorFields = colorFields.substr(2);
+
+            currentValue = colorFields.substr(0,2);
+            r = static_cast<float>(strtol(currentValue.c_str(), NULL, 16)) / 255.;
+            colorFields = colorFields.substr(2);
+
+            currentValue = colorFields.substr(0,2);
+            g = static_cast<float>(strtol(currentValue.c_str(), NULL, 16)) / 255.;
+            colorFields = colorFields.substr(2);
+
+            currentValue = colorFields.substr(0,2);
+            b = static_cast<float>(strtol(currentValue.c_str(), NULL, 16)) / 255.;
+            colorFields = colorFields.substr(2);
+
+            colors.push_back(osg::Vec4(r, g, b, 1.0));
+        }
+    }
+    else if (line[0]!=0)
+    {
+        if (strncmp(line,"v ",2)==0)
+        {
+            unsigned int fieldsRead = parseFloats(line+2, v, 7);
+
+            if (fieldsRead==1)
+                vertices.push_back(osg::Vec3(v[0],0.0f,0.0f));
+            else if (fieldsRead==2)
+                vertices.push_back(osg::Vec3(v[0],v[1],0.0f));
+            else if (fieldsRead==3)
+                vertices.push_back(osg::Vec3(v[0],v[1],v[2]));
+            else if (fieldsRead == 4)
+                vertices.push_back(osg::Vec3(v[0]/v[3],v[1]/v[3],v[2]/v[3]));
+            else if (fieldsRead == 6)
             {
-                std::string materialFileName = trim( line+7 );
-                std::string fullPathFileName = osgDB::findDataFile( materialFileName, options );
-                if (!fullPathFileName.empty())
-                {
-                    osgDB::ifstream mfin( fullPathFileName.c_str() );
-                    if (mfin)
-                    {
-                        OSG_INFO << "Obj reading mtllib '" << fullPathFileName << "'\n";
-                        readMTL(mfin);
-                    }
-                    else
-                    {
-                        OSG_WARN << "Obj unable to load mtllib '" << fullPathFileName << "'\n";
-                    }
-                }
-                else
-                {
-                    OSG_WARN << "Obj unable to find mtllib '" << materialFileName << "'\n";
-                }
+                vertices.push_back(osg::Vec3(v[0],v[1],v[2]));
+                colors.push_back(osg::Vec4(v[3], v[4], v[5], 1.0));
             }
-            else if (strncmp(line,"o ",2)==0)
+            else if ( fieldsRead == 7 )
             {
-                std::string objectName(line+2);
-                if (currentElementState.objectName != objectName)
-                {
-                    currentElementState.objectName = objectName;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
+                vertices.push_back(osg::Vec3(v[0],v[1],v[2]));
+                colors.push_back(osg::Vec4(v[3], v[4], v[5], v[6]));
             }
-            else if (strcmp(line,"o")==0)
+        }
+        else if (strncmp(line,"vn ",3)==0)
+        {
+            unsigned int fieldsRead = parseFloats(line+3, v, 3);
+
+            if (fieldsRead==1) normals.push_back(osg::Vec3(v[0],0.0f,0.0f));
+            else if (fieldsRead==2) normals.push_back(osg::Vec3(v[0],v[1],0.0f));
+            else if (fieldsRead==3) normals.push_back(osg::Vec3(v[0],v[1],v[2]));
+        }
+        else if (strncmp(line,"vt ",3)==0)
+        {
+            unsigned int fieldsRead = parseFloats(line+3, v, 3);
+
+            if (fieldsRead==1) texcoords.push_back(osg::Vec2(v[0],0.0f));
+            else if (fieldsRead>=2) texcoords.push_back(osg::Vec2(v[0],v[1]));
+        }
+        else if (strncmp(line,"l ",2)==0 ||
+                 strncmp(line,"p ",2)==0 ||
+                 strncmp(line,"f ",2)==0)
+        {
+            const char* ptr = line+2;
+            unsigned int begin = indices.size();
+
+            int vi=0, ti=0, ni=0;
+            while(*ptr!=0)
             {
-                std::string objectName(""); // empty name
-                if (currentElementState.objectName != objectName)
+                // skip white space
+                while(*ptr==' ') ++ptr;
+
+                FaceVertexFormat format = parseFaceVertex(ptr, vi, ti, ni);
+                if (format!=NO_VERTEX)
                 {
-                    currentElementState.objectName = objectName;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+                    indices.push_back(format);
+                    indices.push_back(vi);
+                    indices.push_back(ti);
+                    indices.push_back(ni);
                 }
+
+                // skip to white space or end of line
+                while(*ptr!=' ' && *ptr!=0) ++ptr;
             }
-            else if (strncmp(line,"g ",2)==0)
+
+            // empty elements aren't added to the model.
+            if (indices.size()>begin)
             {
-                std::string groupName(line+2);
-                if (currentElementState.groupName != groupName)
-                {
-                    currentElementState.groupName = groupName;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
+                addRecord(ELEMENT, (line[0]=='p') ? Element::POINTS :
+                                   (line[0]=='l') ? Element::POLYLINE :
+                                   Element::POLYGON,
+                          begin, indices.size());
             }
-            else if (strcmp(line,"g")==0)
+        }
+        else
+        {
+            unsigned int begin = stateLines.size();
+            stateLines.append(line);
+            stateLines.push_back(0);
+            addRecord(STATE_LINE, Element::POINTS, begin, stateLines.size());
+        }
+    }
+}
+
+/** Add the vertex data of a run of lines to the model, then its elements and state lines in the order they were read.*/
+void addParsedLines(Model& model, ParsedLines& lines, const osgDB::ReaderWriter::Options* options)
+{
+    int baseNumVertices = model.vertices.size();
+    int baseNumNormals = model.normals.size();
+    int baseNumTexCoords = model.texcoords.size();
+
+    model.vertices.insert(model.vertices.end(), lines.vertices.begin(), lines.vertices.end());
+    model.colors.insert(model.colors.end(), lines.colors.begin(), lines.colors.end());
+    model.normals.insert(model.normals.end(), lines.normals.begin(), lines.normals.end());
+    model.texcoords.insert(model.texcoords.end(), lines.texcoords.begin(), lines.texcoords.end());
+
+    for(ParsedLines::RecordList::const_iterator itr = lines.records.begin();
+        itr != lines.records.end();
+        ++itr)
+    {
+        const ParsedLines::Record& record = *itr;
+        if (record.type==ParsedLines::STATE_LINE)
+        {
+            model.readStateLine(lines.stateLines.c_str()+record.begin, options);
+            continue;
+        }
+
+        int numVertices = baseNumVertices+record.numVertices;
+        int numNormals = baseNumNormals+record.numNormals;
+        int numTexCoords = baseNumTexCoords+record.numTexCoords;
+
+        const int* begin = &lines.indices[record.begin];
+        const int* end = begin+(record.end-record.begin);
+        unsigned int size = (record.end-record.begin)/4;
+
+        // the element only keeps its normals and texcoords if every vertex has a valid one.
+        unsigned int numNormalIndices = 0, numTexCoordIndices = 0;
+        for(const int* vertex = begin; vertex<end; vertex+=4)
+        {
+            switch(vertex[0])
             {
-                std::string groupName(""); // empty name
-                if (currentElementState.groupName != groupName)
-                {
-                    currentElementState.groupName = groupName;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
+                case(VERTEX_TEXCOORD_NORMAL):
+                    ++numNormalIndices;
+                    ++numTexCoordIndices;
+                    break;
+                case(VERTEX_NORMAL):
+                    if (remapIndex(vertex[3], numNormals) < numNormals) ++numNormalIndices;
+                    break;
+                case(VERTEX_TEXCOORD):
+                    if (remapIndex(vertex[2], numTexCoords) < numTexCoords) ++numTexCoordIndices;
+                    break;
+                default:
+                    break;
             }
-            else if (strncmp(line,"s ",2)==0)
-            {
-                int smoothingGroup=0;
-                if (strncmp(line+2,"off",3)==0) smoothingGroup = 0;
-                else sscanf(line+2,"%d",&smoothingGroup);
+        }
+        bool hasNormals = numNormalIndices==size;
+        bool hasTexCoords = numTexCoordIndices==size;
 
-                if (currentElementState.smoothingGroup != smoothingGroup)
-                {
-                    currentElementState.smoothingGroup = smoothingGroup;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
-            }
-            else
+        Element::CoordinateCombination coordateCombination = Element::getCoordinateCombination(hasNormals, hasTexCoords);
+        if (coordateCombination!=model.currentElementState.coordinateCombination)
+        {
+            model.currentElementState.coordinateCombination = coordateCombination;
+            model.currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+        }
+
+        // append the element's indices straight to the arrays shared by the elements of the current state.
+        ElementList& elementList = model.getCurrentElementList();
+        elementList.elements.push_back(Element(record.dataType, elementList.vertexIndices.size(), size));
+
+        for(const int* vertex = begin; vertex<end; vertex+=4)
+        {
+            elementList.vertexIndices.push_back(remapIndex(vertex[1], numVertices));
+            if (hasNormals) elementList.normalIndices.push_back(remapIndex(vertex[3], numNormals));
+            if (hasTexCoords) elementList.texCoordIndices.push_back(remapIndex(vertex[2], numTexCoords));
+        }
+    }
+}
+
+/** Parses the runs of lines of an obj held in memory, the runs being claimed in turn by the reading thread and any
+  * ParseThreads helping it.*/
+class RunParser
+{
+public:
+    RunParser(const std::vector<const char*>& boundaries):
+        _boundaries(boundaries),
+        _runs(boundaries.size()-1),
+        _nextRun(0) {}
+
+    class ParseThread : public osg::Referenced, public OpenThreads::Thread
+    {
+    public:
+        ParseThread(RunParser* parser) : _parser(parser) {}
+
+        virtual void run()
+        {
+            _parser->parseRuns();
+        }
+
+    protected:
+        virtual ~ParseThread() {}
+
+        RunParser* _parser;
+    };
+
+    void parseRuns()
+    {
+        const int LINE_SIZE = 4096;
+        char line[LINE_SIZE];
+
+        int index;
+        while ( (index = claimNextRun())>=0 )
+        {
+            const char* ptr = _boundaries[index];
+            const char* end = _boundaries[index+1];
+            ParsedLines& lines = _runs[index];
+            while (ptr<end)
             {
-                OSG_NOTICE <<"*** line not handled *** :"<<line<<std::endl;
+                ptr = readDataLine(ptr, end, line, LINE_SIZE);
+                lines.readLine(line);
             }
-
         }
+    }
+
+    ParsedLines& getRun(unsigned int index) { return _runs[index]; }
+    unsigned int getNumRuns() const { return _runs.size(); }
 
+protected:
+    int claimNextRun()
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        if ( _nextRun<static_cast<int>(_runs.size()) ) return _nextRun++;
+        return -1;
+    }
+
+    std::vector<const char*>    _boundaries;
+    std::vector<ParsedLines>    _runs;
+    OpenThreads::Mutex          _mutex;
+    int                         _nextRun;
+};
+
+}
+
+bool Model::readOBJ(std::istream& fin, const osgDB::ReaderWriter::Options* options)
+{
+    OSG_INFO<<"Reading OBJ file"<<std::endl;
+
+    const int LINE_SIZE = 4096;
+    char line[LINE_SIZE];
+
+    ParsedLines lines;
+    while (fin)
+    {
+        readline(fin,line,LINE_SIZE);
+        lines.readLine(line);
     }
+
+    addParsedLines(*this, lines, options);
+
 #if 0
     OSG_NOTICE <<"vertices :"<<vertices.size()<<std::endl;
     OSG_NOTICE <<"normals :"<<normals.size()<<std::endl;
@@ -839,39 +1233,189 @@ bool Model::readOBJ(std::istream& fin, const osgDB::ReaderWriter::Options* optio
     return true;
 }
 
+bool Model::readOBJ(const char* data, size_t size, const osgDB::ReaderWriter::Options* options, unsigned int numThreads)
+{
+    OSG_INFO<<"Reading OBJ file"<<std::endl;
+
+    // split the data into runs of whole lines, several per thread so that threads finishing early take on the remaining
+    // runs, but not so small that starting the threads costs more than they save.
+    const size_t minRunSize = 1024*1024;
+    size_t numRuns = (numThreads>1) ? osg::minimum(size/minRunSize, static_cast<size_t>(numThreads)*4) : 1;
+    if (numRuns<1) numRuns = 1;
+
+    const char* end = data+size;
+    std::vector<const char*> boundaries;
+    boundaries.push_back(data);
+    for(size_t i=1; i<numRuns; ++i)
+    {
+        const char* ptr = findLineStart(data, osg::maximum(boundaries.back(), data+(size/numRuns)*i), end);
+        if (ptr>=end) break;
+        if (ptr>boundaries.back()) boundaries.push_back(ptr);
+    }
+    boundaries.push_back(end);
+
+    RunParser parser(boundaries);
+
+    std::vector< osg::ref_ptr<RunParser::ParseThread> > threads;
+    unsigned int numHelperThreads = osg::minimum(numThreads, parser.getNumRuns())-1;
+    for(unsigned int i=0; i<numHelperThreads; ++i)
+    {
+        threads.push_back(new RunParser::ParseThread(&parser));
+        threads.back()->start();
+    }
+
+    parser.parseRuns();
+
+    for(unsigned int i=0; i<threads.size(); ++i)
+    {
+        threads[i]->join();
+    }
+
+    size_t numVertices = vertices.size(), numColors = colors.size(), numNormals = normals.size(), numTexCoords = texcoords.size();
+    for(unsigned int i=0; i<parser.getNumRuns(); ++i)
+    {
+        ParsedLines& lines = parser.getRun(i);
+        numVertices += lines.vertices.size();
+        numColors += lines.colors.size();
+        numNormals += lines.normals.size();
+        numTexCoords += lines.texcoords.size();
+    }
+    vertices.reserve(numVertices);
+    colors.reserve(numColors);
+    normals.reserve(numNormals);
+    texcoords.reserve(numTexCoords);
+
+    for(unsigned int i=0; i<parser.getNumRuns(); ++i)
+    {
+        ParsedLines& lines = parser.getRun(i);
+        addParsedLines(*this, lines, options);
+
+        // release each run once it's been added, rather than holding two copies of the whole model.
+        lines = ParsedLines();
+    }
+
+    return true;
+}
+
+void Model::readStateLine(const char* line, const osgDB::ReaderWriter::Options* options)
+{
+    if (strncmp(line,"usemtl ",7)==0)
+    {
+        std::string materialName( line+7 );
+        if (currentElementState.materialName != materialName)
+        {
+            currentElementState.materialName = materialName;
+            currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+        }
+    }
+    else if (strncmp(line,"mtllib ",7)==0)
+    {
+        std::string materialFileName = trim( line+7 );
+        std::string fullPathFileName = osgDB::findDataFile( materialFileName, options );
+        if (!fullPathFileName.empty())
+        {
+            osgDB::ifstream mfin( fullPathFileName.c_str() );
+            if (mfin)
+            {
+                OSG_INFO << "Obj reading mtllib '" << fullPathFileName << "'\n";
+                readMTL(mfin);
+            }
+            else
+            {
+                OSG_WARN << "Obj unable to load mtllib '" << fullPathFileName << "'\n";
+            }
+        }
+        else
+        {
+            OSG_WARN << "Obj unable to find mtllib '" << materialFileName << "'\n";
+        }
+    }
+    else if (strncmp(line,"o ",2)==0)
+    {
+        std::string objectName(line+2);
+        if (currentElementState.objectName != objectName)
+        {
+            currentElementState.objectName = objectName;
+            currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+        }
+    }
+    else if (strcmp(line,"o")==0)
+    {
+        std::string objectName(""); // empty name
+        if (currentElementState.objectName != objectName)
+        {
+            currentElementState.objectName = objectName;
+            currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+        }
+    }
+    else if (strncmp(line,"g ",2)==0)
+    {
+        std::string groupName(line+2);
+        if (currentElementState.groupName != groupName)
+        {
+            currentElementState.groupName = groupName;
+            currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+        }
+    }
+    else if (strcmp(line,"g")==0)
+    {
+        std::string groupName(""); // empty name
+        if (currentElementState.groupName != groupName)
+        {
+            currentElementState.groupName = groupName;
+            currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+        }
+    }
+    else if (strncmp(line,"s ",2)==0)
+    {
+        int smoothingGroup=0;
+        if (strncmp(line+2,"off",3)==0) smoothingGroup = 0;
+        else parseInt(line+2,smoothingGroup);
+
+        if (currentElementState.smoothingGroup != smoothingGroup)
+        {
+            currentElementState.smoothingGroup = smoothingGroup;
+            currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+        }
+    }
+    else
+    {
+        OSG_NOTICE <<"*** line not handled *** :"<<line<<std::endl;
+    }
+}
+
 
-void Model::addElement(Element* element)
+ElementList& Model::getCurrentElementList()
 {
     if (!currentElementList)
     {
         currentElementList = & (elementStateMap[currentElementState]);
     }
-    currentElementList->push_back(element);
-
+    return *currentElementList;
 }
 
-osg::Vec3 Model::averageNormal(const Element& element) const
+osg::Vec3 Model::averageNormal(const ElementList& elementList, const Element& element) const
 {
     osg::Vec3 normal;
-    for(Element::IndexList::const_iterator itr=element.normalIndices.begin();
-        itr!=element.normalIndices.end();
-        ++itr)
+    for(unsigned int i=element.first; i<element.first+element.count; ++i)
     {
-        normal += normals[*itr];
+        normal += normals[elementList.normalIndices[i]];
     }
     normal.normalize();
 
     return normal;
 }
 
-osg::Vec3 Model::computeNormal(const Element& element) const
+osg::Vec3 Model::computeNormal(const ElementList& elementList, const Element& element) const
 {
+    const int* vertexIndices = &elementList.vertexIndices[element.first];
+
     osg::Vec3 normal;
-    for(unsigned int i=0;i<element.vertexIndices.size()-2;++i)
+    for(unsigned int i=0;i<element.count-2;++i)
     {
-        osg::Vec3 a = vertices[element.vertexIndices[i]];
-        osg::Vec3 b = vertices[element.vertexIndices[i+1]];
-        osg::Vec3 c = vertices[element.vertexIndices[i+2]];
+        osg::Vec3 a = vertices[vertexIndices[i]];
+        osg::Vec3 b = vertices[vertexIndices[i+1]];
+        osg::Vec3 c = vertices[vertexIndices[i+2]];
         osg::Vec3 localNormal = (b-a)   ^(c-b);
         normal += localNormal;
     }
@@ -880,9 +1424,9 @@ osg::Vec3 Model::computeNormal(const Element& element) const
     return normal;
 }
 
-bool Model::needReverse(const Element& element) const
+bool Model::needReverse(const ElementList& elementList, const Element& element) const
 {
-    if (element.normalIndices.empty()) return false;
+    if (elementList.normalIndices.empty()) return false;
 
-    return computeNormal(element)*averageNormal(element) < 0.0f;
+    return computeNormal(elementList, element)*averageNormal(elementList, element) < 0.0f;
 }
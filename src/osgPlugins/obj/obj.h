@@ -113,7 +113,9 @@ public:
 protected:
 };
 
-class Element : public osg::Referenced
+/** A point, polyline or polygon, its indices being the count entries from first onwards in the index arrays of the ElementList
+  * holding it.*/
+class Element
 {
 public:
 
@@ -126,8 +128,10 @@ public:
         POLYGON
     };
 
-    Element(DataType type):
-        dataType(type) {}
+    Element(DataType type, unsigned int firstIndex, unsigned int numIndices):
+        dataType(type),
+        first(firstIndex),
+        count(numIndices) {}
 
     enum CoordinateCombination
     {
@@ -137,19 +141,35 @@ public:
         VERTICES_NORMALS_TEXCOORDS
     };
 
-    CoordinateCombination getCoordinateCombination() const
+    static CoordinateCombination getCoordinateCombination(bool hasNormals, bool hasTexCoords)
     {
-        if (vertexIndices.size()==normalIndices.size())
-            return (vertexIndices.size()==texCoordIndices.size()) ? VERTICES_NORMALS_TEXCOORDS : VERTICES_NORMALS;
+        if (hasNormals)
+            return hasTexCoords ? VERTICES_NORMALS_TEXCOORDS : VERTICES_NORMALS;
         else
-            return (vertexIndices.size()==texCoordIndices.size()) ?  VERTICES_TEXCOORDS : VERTICES;
+            return hasTexCoords ?  VERTICES_TEXCOORDS : VERTICES;
     }
 
-    DataType  dataType;
-    IndexList vertexIndices;
-    IndexList normalIndices;
-    IndexList texCoordIndices;
-    IndexList colorsIndices;
+    DataType        dataType;
+    unsigned int    first;
+    unsigned int    count;
+};
+
+/** The elements sharing an ElementState, with the indices of all of them held in shared arrays rather than allocated per element.
+  * As the ElementState includes the CoordinateCombination, normalIndices and texCoordIndices are either empty or hold an entry
+  * for every entry of vertexIndices.*/
+class ElementList
+{
+public:
+
+    typedef std::vector<Element> Elements;
+
+    bool empty() const { return elements.empty(); }
+    unsigned int size() const { return elements.size(); }
+
+    Elements            elements;
+    Element::IndexList  vertexIndices;
+    Element::IndexList  normalIndices;
+    Element::IndexList  texCoordIndices;
 };
 
 class ElementState
@@ -198,12 +218,21 @@ public:
     bool readMTL(std::istream& fin);
     bool readOBJ(std::istream& fin, const osgDB::ReaderWriter::Options* options);
 
+    /** Read an obj held in memory, such as a mapping of the file, split into runs of lines that are parsed by up to numThreads
+      * threads and then added to the model in order, giving the same model as reading it from a stream.*/
+    bool readOBJ(const char* data, size_t size, const osgDB::ReaderWriter::Options* options, unsigned int numThreads);
+
     bool readline(std::istream& fin, char* line, const int LINE_SIZE);
-    void addElement(Element* element);
 
-    osg::Vec3 averageNormal(const Element& element) const;
-    osg::Vec3 computeNormal(const Element& element) const;
-    bool needReverse(const Element& element) const;
+    /** Get the ElementList of the current element state, to add elements to.*/
+    ElementList& getCurrentElementList();
+
+    /** Apply a usemtl, mtllib, o, g or s line to the current element state, reporting any other line as not handled.*/
+    void readStateLine(const char* line, const osgDB::ReaderWriter::Options* options);
+
+    osg::Vec3 averageNormal(const ElementList& elementList, const Element& element) const;
+    osg::Vec3 computeNormal(const ElementList& elementList, const Element& element) const;
+    bool needReverse(const ElementList& elementList, const Element& element) const;
 
     int remapVertexIndex(int vi) { return (vi<0) ? vertices.size()+vi : vi-1; }
     int remapNormalIndex(int vi) { return (vi<0) ? normals.size()+vi : vi-1; }
@@ -213,7 +242,6 @@ public:
     typedef std::vector< osg::Vec2 >                Vec2Array;
     typedef std::vector< osg::Vec3 >                Vec3Array;
     typedef std::vector< osg::Vec4 >                Vec4Array;
-    typedef std::vector< osg::ref_ptr<Element> >    ElementList;
     typedef std::map< ElementState,ElementList >    ElementStateMap;
 
 
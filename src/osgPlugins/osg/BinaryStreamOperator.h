@@ -2,6 +2,7 @@
 #define OSG2_BINARYSTREAMOPERATOR
 
 #include <osgDB/StreamOperator>
+#include <osgDB/MappedFile>
 #include <osg/Types>
 #include <vector>
 
@@ -265,6 +266,21 @@ public:
         }
     }
 
+    virtual char* readMappedCharArray( unsigned int size, osg::ref_ptr<osg::Referenced>& mapping )
+    {
+        // the stream is no longer reading from the mapping once it has been replaced by a decompressed one
+        osgDB::MappedStreamBuffer* buffer = dynamic_cast<osgDB::MappedStreamBuffer*>( _in->rdbuf() );
+        if ( !buffer ) return 0;
+
+        std::streampos position = _in->tellg();
+        osgDB::MappedFile* file = buffer->getMappedFile();
+        if ( position<0 || static_cast<size_t>(position)+size>file->size() ) return 0;
+
+        _in->seekg( size, std::ios::cur );
+        mapping = file;
+        return file->data() + static_cast<size_t>(position);
+    }
+
 protected:
     std::vector<std::streampos> _beginPositions;
     std::vector<int> _blockSizes;
@@ -16,6 +16,7 @@
 #include <osgDB/FileUtils>
 #include <osgDB/Registry>
 #include <osgDB/ObjectWrapper>
+#include <osgDB/MappedFile>
 #include <stdlib.h>
 #include "AsciiStreamOperator.h"
 #include "BinaryStreamOperator.h"
@@ -136,6 +137,9 @@ public:
                         "<IncludeFile> writes the image file itself to stream; "
                         "<UseExternal> writes only the filename; "
                         "<WriteOut> writes Image::data() to disk as external file." );
+        supportsOption( "MemoryMapped", "Import option: Read the file through a memory mapping, with inline image data referencing the mapping rather than being copied" );
+        supportsOption( "DataAlignment=<bytes>", "Export option: Align array and inline image data of at least this size to a multiple of it in a binary file, "
+                        "such as the 4096 byte page size for memory mapped reading" );
     }
 
     virtual const char* className() const { return "OpenSceneGraph Native Format Reader/Writer"; }
@@ -174,6 +178,15 @@ public:
         return local_opt.release();
     }
 
+    MappedFile* openMappedFile( const std::string& fileName, const Options* options ) const
+    {
+        if ( options->getPluginStringData("MemoryMapped")!="true" ) return 0;
+
+        osg::ref_ptr<MappedFile> file = new MappedFile( fileName );
+        if ( !file->valid() ) return 0;
+        return file.release();
+    }
+
     virtual ReadResult readObject( const std::string& file, const Options* options ) const
     {
         ReadResult result = ReadResult::FILE_LOADED;
@@ -182,6 +195,14 @@ public:
         Options* local_opt = prepareReading( result, fileName, mode, options );
         if ( !result.success() ) return result;
 
+        osg::ref_ptr<MappedFile> mappedFile = openMappedFile( fileName, local_opt );
+        if ( mappedFile.valid() )
+        {
+            MappedStreamBuffer buffer( mappedFile.get() );
+            std::istream istream( &buffer );
+            return readObject( istream, local_opt );
+        }
+
         osgDB::ifstream istream( fileName.c_str(), mode );
         return readObject( istream, local_opt );
     }
@@ -213,6 +234,14 @@ public:
         Options* local_opt = prepareReading( result, fileName, mode, options );
         if ( !result.success() ) return result;
 
+        osg::ref_ptr<MappedFile> mappedFile = openMappedFile( fileName, local_opt );
+        if ( mappedFile.valid() )
+        {
+            MappedStreamBuffer buffer( mappedFile.get() );
+            std::istream istream( &buffer );
+            return readImage( istream, local_opt );
+        }
+
         osgDB::ifstream istream( fileName.c_str(), mode );
         return readImage( istream, local_opt );
     }
@@ -244,6 +273,14 @@ public:
         Options* local_opt = prepareReading( result, fileName, mode, options );
         if ( !result.success() ) return result;
 
+        osg::ref_ptr<MappedFile> mappedFile = openMappedFile( fileName, local_opt );
+        if ( mappedFile.valid() )
+        {
+            MappedStreamBuffer buffer( mappedFile.get() );
+            std::istream istream( &buffer );
+            return readNode( istream, local_opt );
+        }
+
         osgDB::ifstream istream( fileName.c_str(), mode );
         return readNode( istream, local_opt );
     }
@@ -1,6 +1,8 @@
 #include <osg/Notify>
 #include <osg/Endian>
 
+#include <algorithm>
+
 #include <osgDB/Registry>
 #include <osgDB/FileNameUtils>
 
@@ -92,7 +94,9 @@ inline OSGA_Archive::pos_type ARCHIVE_POS( const std::streampos & pos )
 }
 #endif // Dinkumware std C++ lib
 ////////////////////////////////////////////////////////////////////////////////
-float OSGA_Archive::s_currentSupportedVersion = 0.0;
+// version 0 archives index their files with a chain of IndexBlocks, version 1 archives with a single HashedIndex.
+// Version 0 is still written by default, version 1 is only written when requested with the hashedIndex option.
+float OSGA_Archive::s_currentSupportedVersion = 1.0;
 const unsigned int ENDIAN_TEST_NUMBER = 0x00000001;
 
 OSGA_Archive::IndexBlock::IndexBlock(unsigned int blockSize):
@@ -316,7 +320,208 @@ void OSGA_Archive::IndexBlock::setPositionNextIndexBlock(pos_type position)
     _requiresWrite = true;
 }
 
-OSGA_Archive::OSGA_Archive()
+unsigned int OSGA_Archive::HashedIndex::hash(const std::string& filename)
+{
+    // 32 bit FNV-1a hash.
+    unsigned int value = 2166136261u;
+    for(std::string::const_iterator itr=filename.begin(); itr!=filename.end(); ++itr)
+    {
+        value = (value ^ static_cast<unsigned char>(*itr)) * 16777619u;
+    }
+    return value;
+}
+
+void OSGA_Archive::HashedIndex::clear()
+{
+    _buckets.clear();
+    _entries.clear();
+    _names.clear();
+}
+
+void OSGA_Archive::HashedIndex::build(const FileNamePositionMap& indexMap)
+{
+    clear();
+
+    unsigned int numBuckets = 1;
+    while(numBuckets<indexMap.size()) numBuckets <<= 1;
+
+    // count the entries in each bucket, then place the entries in bucket order.
+    std::vector<unsigned int> bucketSizes(numBuckets, 0);
+    for(FileNamePositionMap::const_iterator itr=indexMap.begin(); itr!=indexMap.end(); ++itr)
+    {
+        ++bucketSizes[hash(itr->first) & (numBuckets-1)];
+    }
+
+    _buckets.resize(numBuckets+1);
+    _buckets[0] = 0;
+    for(unsigned int i=0; i<numBuckets; ++i)
+    {
+        _buckets[i+1] = _buckets[i] + bucketSizes[i];
+    }
+
+    std::vector<unsigned int> nextInBucket(_buckets.begin(), _buckets.end()-1);
+    _entries.resize(indexMap.size());
+    for(FileNamePositionMap::const_iterator itr=indexMap.begin(); itr!=indexMap.end(); ++itr)
+    {
+        Entry entry;
+        entry.position = itr->second.first;
+        entry.size = itr->second.second;
+        entry.hash = hash(itr->first);
+        entry.nameOffset = _names.size();
+        entry.nameSize = itr->first.size();
+        _names += itr->first;
+
+        _entries[nextInBucket[entry.hash & (numBuckets-1)]++] = entry;
+    }
+}
+
+const OSGA_Archive::HashedIndex::Entry* OSGA_Archive::HashedIndex::find(const std::string& filename) const
+{
+    if (_buckets.size()<2) return 0;
+
+    unsigned int value = hash(filename);
+    unsigned int bucket = value & (_buckets.size()-2);
+    for(unsigned int i=_buckets[bucket]; i<_buckets[bucket+1]; ++i)
+    {
+        const Entry& entry = _entries[i];
+        if (entry.hash==value && entry.nameSize==filename.size() &&
+            _names.compare(entry.nameOffset, entry.nameSize, filename)==0)
+        {
+            return &entry;
+        }
+    }
+    return 0;
+}
+
+/*
+HashedIndex layout:
+    unsigned int    number of entries
+    unsigned int    number of buckets (power of two)
+    unsigned int    size of the file names
+    unsigned int    size of the master file name
+    char[]          master file name
+    unsigned int[]  offset of each bucket's first entry, followed by the number of entries
+    entries         pos_type position, size_type size, unsigned int hash, name offset and name size
+    char[]          file names
+*/
+void OSGA_Archive::HashedIndex::write(std::ostream& out, const std::string& masterFileName) const
+{
+    unsigned int numEntries = _entries.size();
+    unsigned int numBuckets = _buckets.empty() ? 0 : _buckets.size()-1;
+    unsigned int namesSize = _names.size();
+    unsigned int masterFileNameSize = masterFileName.size();
+
+    out.write(reinterpret_cast<const char*>(&numEntries), sizeof(numEntries));
+    out.write(reinterpret_cast<const char*>(&numBuckets), sizeof(numBuckets));
+    out.write(reinterpret_cast<const char*>(&namesSize), sizeof(namesSize));
+    out.write(reinterpret_cast<const char*>(&masterFileNameSize), sizeof(masterFileNameSize));
+    out.write(masterFileName.data(), masterFileNameSize);
+
+    if (!_buckets.empty()) out.write(reinterpret_cast<const char*>(&_buckets.front()), _buckets.size()*sizeof(unsigned int));
+
+    for(EntryList::const_iterator itr=_entries.begin(); itr!=_entries.end(); ++itr)
+    {
+        out.write(reinterpret_cast<const char*>(&itr->position), sizeof(itr->position));
+        out.write(reinterpret_cast<const char*>(&itr->size), sizeof(itr->size));
+        out.write(reinterpret_cast<const char*>(&itr->hash), sizeof(itr->hash));
+        out.write(reinterpret_cast<const char*>(&itr->nameOffset), sizeof(itr->nameOffset));
+        out.write(reinterpret_cast<const char*>(&itr->nameSize), sizeof(itr->nameSize));
+    }
+
+    out.write(_names.data(), namesSize);
+}
+
+OSGA_Archive::size_type OSGA_Archive::HashedIndex::computeSize(const std::string& masterFileName) const
+{
+    size_type entrySize = sizeof(pos_type)+sizeof(size_type)+3*sizeof(unsigned int);
+    return 4*sizeof(unsigned int) + masterFileName.size() + _buckets.size()*sizeof(unsigned int) +
+           _entries.size()*entrySize + _names.size();
+}
+
+bool OSGA_Archive::HashedIndex::read(std::istream& in, bool doEndianSwap, std::string& masterFileName)
+{
+    clear();
+
+    unsigned int header[4];
+    in.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!in) return false;
+
+    if (doEndianSwap)
+    {
+        for(unsigned int i=0; i<4; ++i) osg::swapBytes(reinterpret_cast<char*>(&header[i]), sizeof(unsigned int));
+    }
+
+    unsigned int numEntries = header[0];
+    unsigned int numBuckets = header[1];
+    unsigned int namesSize = header[2];
+    unsigned int masterFileNameSize = header[3];
+
+    if (numBuckets==0 || (numBuckets & (numBuckets-1))!=0 || numBuckets>2*numEntries+1)
+    {
+        OSG_INFO<<"OSGA_Archive::HashedIndex::read() invalid number of buckets "<<numBuckets<<std::endl;
+        return false;
+    }
+
+    unsigned int entrySize = sizeof(pos_type)+sizeof(size_type)+3*sizeof(unsigned int);
+    std::string data(masterFileNameSize + (numBuckets+1)*sizeof(unsigned int) + numEntries*entrySize + namesSize, '\0');
+    in.read(&data[0], data.size());
+    if (!in) return false;
+
+    char* ptr = &data[0];
+    masterFileName.assign(ptr, masterFileNameSize);
+    ptr += masterFileNameSize;
+
+    _buckets.resize(numBuckets+1);
+    for(unsigned int i=0; i<=numBuckets; ++i, ptr += sizeof(unsigned int))
+    {
+        if (doEndianSwap) osg::swapBytes(ptr, sizeof(unsigned int));
+        _read(ptr, _buckets[i]);
+    }
+
+    _entries.resize(numEntries);
+    for(unsigned int i=0; i<numEntries; ++i)
+    {
+        Entry& entry = _entries[i];
+        if (doEndianSwap)
+        {
+            osg::swapBytes(ptr, sizeof(pos_type));
+            osg::swapBytes(ptr+sizeof(pos_type), sizeof(size_type));
+            for(unsigned int j=0; j<3; ++j) osg::swapBytes(ptr+sizeof(pos_type)+sizeof(size_type)+j*sizeof(unsigned int), sizeof(unsigned int));
+        }
+        _read(ptr, entry.position); ptr += sizeof(pos_type);
+        _read(ptr, entry.size); ptr += sizeof(size_type);
+        _read(ptr, entry.hash); ptr += sizeof(unsigned int);
+        _read(ptr, entry.nameOffset); ptr += sizeof(unsigned int);
+        _read(ptr, entry.nameSize); ptr += sizeof(unsigned int);
+
+        if (entry.nameOffset>namesSize || entry.nameSize>namesSize-entry.nameOffset)
+        {
+            OSG_INFO<<"OSGA_Archive::HashedIndex::read() invalid file name reference"<<std::endl;
+            clear();
+            return false;
+        }
+    }
+
+    for(unsigned int i=0; i<numBuckets; ++i)
+    {
+        if (_buckets[i]>_buckets[i+1] || _buckets[i+1]>numEntries)
+        {
+            OSG_INFO<<"OSGA_Archive::HashedIndex::read() invalid bucket"<<std::endl;
+            clear();
+            return false;
+        }
+    }
+
+    _names.assign(ptr, namesSize);
+    return true;
+}
+
+OSGA_Archive::OSGA_Archive():
+    _useHashedIndex(false),
+    _version(0.0f),
+    _status(READ),
+    _hashedIndexPosition(0),
+    _hashedIndexRequiresWrite(false)
 {
 }
 
@@ -337,6 +542,14 @@ bool OSGA_Archive::open(const std::string& filename, ArchiveStatus status, unsig
         _status = status;
         _input.open(filename.c_str(), std::ios_base::binary | std::ios_base::in);
 
+        // read the files from a mapping of the archive so that multiple threads can read them at once,
+        // falling back to reading them from _input one at a time if the archive can't be mapped.
+        osg::ref_ptr<osgDB::MappedFile> mappedFile = new osgDB::MappedFile(filename);
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mappedFileMutex);
+            _mappedFile = mappedFile->valid() ? mappedFile.get() : 0;
+        }
+
         return _open(_input);
     }
     else
@@ -369,10 +582,34 @@ bool OSGA_Archive::open(const std::string& filename, ArchiveStatus status, unsig
                     pos_type end = mitr->second.first + mitr->second.second;
                     if( file_size < end ) file_size = end;
                 }
+
+                if (usesHashedIndex())
+                {
+                    pos_type end = _hashedIndexPosition + _hashedIndex.computeSize(_masterFileName);
+                    if( file_size < end ) file_size = end;
+                }
             }
             _input.close();
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mappedFileMutex);
+                _mappedFile = 0;
+            }
             _status = WRITE;
 
+            if (usesHashedIndex())
+            {
+                // new files are appended after the existing HashedIndex, which is left in place until a new one has been
+                // written at the end of the archive on close, so the archive stays readable if writing is interrupted.
+                _indexMap.clear();
+                const HashedIndex::EntryList& entries = _hashedIndex.getEntries();
+                for(HashedIndex::EntryList::const_iterator itr=entries.begin(); itr!=entries.end(); ++itr)
+                {
+                    _indexMap[_hashedIndex.getFileName(*itr)] = PositionSizePair(itr->position, itr->size);
+                }
+                _hashedIndex.clear();
+                _hashedIndexRequiresWrite = false;
+            }
+
             osgDB::open(_output, filename.c_str(), std::ios_base::binary | std::ios_base::in | std::ios_base::out);
 
             OSG_INFO<<"File position after open = "<<ARCHIVE_POS( _output.tellp() )<<" is_open "<<_output.is_open()<<std::endl;
@@ -391,16 +628,27 @@ bool OSGA_Archive::open(const std::string& filename, ArchiveStatus status, unsig
             OSG_INFO<<"OSGA_Archive::open("<<filename<<"), archive being created."<<std::endl;
 
             _status = WRITE;
+            _version = _useHashedIndex ? 1.0f : 0.0f;
             osgDB::open(_output, filename.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
             _output<<"osga";
             _output.write(reinterpret_cast<const char*>(&ENDIAN_TEST_NUMBER),4);
-            _output.write(reinterpret_cast<char*>(&s_currentSupportedVersion),sizeof(float));
+            _output.write(reinterpret_cast<char*>(&_version),sizeof(float));
 
-            IndexBlock *indexBlock = new IndexBlock(indexBlockSize);
-            if (indexBlock)
+            if (usesHashedIndex())
             {
-                indexBlock->write(_output);
-                _indexBlockList.push_back(indexBlock);
+                // the position of the HashedIndex is filled in when the archive is closed.
+                _hashedIndexPosition = 0;
+                _hashedIndexRequiresWrite = true;
+                _output.write(reinterpret_cast<char*>(&_hashedIndexPosition),sizeof(_hashedIndexPosition));
+            }
+            else
+            {
+                IndexBlock *indexBlock = new IndexBlock(indexBlockSize);
+                if (indexBlock)
+                {
+                    indexBlock->write(_output);
+                    _indexBlockList.push_back(indexBlock);
+                }
             }
 
             OSG_INFO<<"File position after write = "<<ARCHIVE_POS( _output.tellp() )<<std::endl;
@@ -446,6 +694,30 @@ bool OSGA_Archive::_open(std::istream& input)
             OSG_INFO<<"OSGA_Archive::open() doEndianSwap="<<doEndianSwap<<std::endl;
             OSG_INFO<<"OSGA_Archive::open() Version="<<_version<<std::endl;
 
+            if (_version>s_currentSupportedVersion)
+            {
+                OSG_NOTICE<<"OSGA_Archive::open() archive version "<<_version<<" is newer than the supported version "<<s_currentSupportedVersion<<std::endl;
+                return false;
+            }
+
+            if (usesHashedIndex())
+            {
+                input.read(reinterpret_cast<char*>(&_hashedIndexPosition),sizeof(_hashedIndexPosition));
+                if (doEndianSwap)
+                {
+                    osg::swapBytes(reinterpret_cast<char*>(&_hashedIndexPosition),sizeof(_hashedIndexPosition));
+                }
+
+                if (!input || _hashedIndexPosition==pos_type(0))
+                {
+                    OSG_NOTICE<<"OSGA_Archive::open() archive has no index, it may not have been closed after writing."<<std::endl;
+                    return false;
+                }
+
+                input.seekg( STREAM_POS( _hashedIndexPosition ) );
+                return _hashedIndex.read(input, doEndianSwap, _masterFileName);
+            }
+
             IndexBlock *indexBlock = 0;
 
             while ( (indexBlock=OSGA_Archive::IndexBlock::read(input, doEndianSwap)) != 0)
@@ -478,6 +750,7 @@ bool OSGA_Archive::_open(std::istream& input)
                 OSG_INFO<<"    filename "<<(mitr->first)<<" pos="<<(int)((mitr->second).first)<<" size="<<(int)((mitr->second).second)<<std::endl;
             }
 
+            _hashedIndex.build(_indexMap);
 
             return true;
         }
@@ -490,6 +763,10 @@ void OSGA_Archive::close()
     SERIALIZER();
 
     _input.close();
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mappedFileMutex);
+        _mappedFile = 0;
+    }
 
     if (_status==WRITE)
     {
@@ -505,7 +782,8 @@ std::string OSGA_Archive::getMasterFileName() const
 
 osgDB::FileType OSGA_Archive::getFileType(const std::string& filename) const
 {
-    if (_indexMap.count(filename)!=0) return osgDB::REGULAR_FILE;
+    PositionSizePair positionSize;
+    if (findFileReference(filename, positionSize)) return osgDB::REGULAR_FILE;
     return osgDB::FILE_NOT_FOUND;
 }
 
@@ -514,6 +792,21 @@ bool OSGA_Archive::getFileNames(FileNameList& fileNameList) const
     SERIALIZER();
 
     fileNameList.clear();
+
+    if (_status==READ)
+    {
+        const HashedIndex::EntryList& entries = _hashedIndex.getEntries();
+        fileNameList.reserve(entries.size());
+        for(HashedIndex::EntryList::const_iterator itr=entries.begin();
+            itr!=entries.end();
+            ++itr)
+        {
+            fileNameList.push_back(_hashedIndex.getFileName(*itr));
+        }
+        std::sort(fileNameList.begin(), fileNameList.end());
+        return !fileNameList.empty();
+    }
+
     fileNameList.reserve(_indexMap.size());
     for(FileNamePositionMap::const_iterator itr=_indexMap.begin();
         itr!=_indexMap.end();
@@ -524,11 +817,52 @@ bool OSGA_Archive::getFileNames(FileNameList& fileNameList) const
     return !fileNameList.empty();
 }
 
+bool OSGA_Archive::findFileReference(const std::string& fileName, PositionSizePair& positionSize) const
+{
+    // the HashedIndex is complete once the archive is opened for reading so can be searched without locking.
+    if (_status==READ)
+    {
+        const HashedIndex::Entry* entry = _hashedIndex.find(fileName);
+        if (!entry) return false;
+
+        positionSize = PositionSizePair(entry->position, entry->size);
+        return true;
+    }
+
+    SERIALIZER();
+
+    FileNamePositionMap::const_iterator itr = _indexMap.find(fileName);
+    if (itr==_indexMap.end()) return false;
+
+    positionSize = itr->second;
+    return true;
+}
+
 void OSGA_Archive::writeIndexBlocks()
 {
     SERIALIZER();
 
-    if (_status==WRITE)
+    if (_status==WRITE && usesHashedIndex())
+    {
+        if (!_hashedIndexRequiresWrite) return;
+
+        _hashedIndexPosition = ARCHIVE_POS( _output.tellp() );
+
+        HashedIndex hashedIndex;
+        hashedIndex.build(_indexMap);
+        hashedIndex.write(_output, _masterFileName);
+
+        // only once the new HashedIndex is complete record where it is in the header, just after the identifier,
+        // endian test word and version, so until then the header still refers to the previous one.
+        _output.flush();
+        _output.seekp( STREAM_POS( 12 ) );
+        _output.write(reinterpret_cast<char*>(&_hashedIndexPosition),sizeof(_hashedIndexPosition));
+        _output.flush();
+        _output.seekp( 0, std::ios_base::end );
+
+        _hashedIndexRequiresWrite = false;
+    }
+    else if (_status==WRITE)
     {
         for(IndexBlockList::iterator itr=_indexBlockList.begin();
             itr!=_indexBlockList.end();
@@ -544,7 +878,8 @@ void OSGA_Archive::writeIndexBlocks()
 
 bool OSGA_Archive::fileExists(const std::string& filename) const
 {
-    return (_indexMap.count(filename)!=0);
+    PositionSizePair positionSize;
+    return findFileReference(filename, positionSize);
 }
 
 bool OSGA_Archive::addFileReference(pos_type position, size_type size, const std::string& fileName)
@@ -567,6 +902,13 @@ bool OSGA_Archive::addFileReference(pos_type position, size_type size, const std
     // if the masterFileName isn't set yet use this fileName
     if (_masterFileName.empty()) _masterFileName = fileName;
 
+    if (usesHashedIndex())
+    {
+        _indexMap[osgDB::convertFileNameToUnixStyle(fileName)] = PositionSizePair(position, size);
+        _hashedIndexRequiresWrite = true;
+        return true;
+    }
+
 
     // get an IndexBlock with space available if possible
     unsigned int blockSize = 4096;
@@ -600,6 +942,76 @@ bool OSGA_Archive::addFileReference(pos_type position, size_type size, const std
 }
 
 
+osg::ref_ptr<osgDB::MappedFile> OSGA_Archive::getMappedFile() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mappedFileMutex);
+    return _mappedFile;
+}
+
+bool OSGA_Archive::readFileData(const std::string& fileName, std::string& data) const
+{
+    if (_status!=READ) return false;
+
+    PositionSizePair positionSize;
+    if (!findFileReference(fileName, positionSize) || positionSize.first<0 || positionSize.second<0) return false;
+
+    osg::ref_ptr<osgDB::MappedFile> mappedFile = getMappedFile();
+    if (mappedFile.valid())
+    {
+        if (static_cast<unsigned long long>(positionSize.first+positionSize.second)>static_cast<unsigned long long>(mappedFile->size())) return false;
+
+        data.assign(mappedFile->data()+positionSize.first, static_cast<size_t>(positionSize.second));
+        return true;
+    }
+
+    SERIALIZER();
+
+    OSGA_Archive* archive = const_cast<OSGA_Archive*>(this);
+    archive->_input.clear();
+    archive->_input.seekg( STREAM_POS( positionSize.first ) );
+    data.resize(static_cast<size_t>(positionSize.second));
+    if (!data.empty()) archive->_input.read(&data[0], data.size());
+    return !archive->_input.fail();
+}
+
+bool OSGA_Archive::copyFiles(const OSGA_Archive& source)
+{
+    if (_status!=WRITE)
+    {
+        OSG_INFO<<"OSGA_Archive::copyFiles() failed, archive opened as read only."<<std::endl;
+        return false;
+    }
+
+    FileNameList fileNames;
+    source.getFileNames(fileNames);
+
+    // copy the master file first so that it remains the master file of this archive.
+    FileNameList::iterator mitr = std::find(fileNames.begin(), fileNames.end(), source.getMasterFileName());
+    if (mitr!=fileNames.end()) std::rotate(fileNames.begin(), mitr, mitr+1);
+
+    bool result = true;
+    std::string data;
+    for(FileNameList::const_iterator itr=fileNames.begin();
+        itr!=fileNames.end();
+        ++itr)
+    {
+        if (!source.readFileData(*itr, data))
+        {
+            OSG_NOTICE<<"OSGA_Archive::copyFiles() unable to read "<<*itr<<" from "<<source.getArchiveFileName()<<std::endl;
+            result = false;
+            continue;
+        }
+
+        SERIALIZER();
+
+        pos_type position = ARCHIVE_POS( _output.tellp() );
+        _output.write(data.data(), data.size());
+        if (!_output || !addFileReference(position, size_type(data.size()), *itr)) result = false;
+    }
+
+    return result;
+}
+
 // streambuffer class to give access to a portion of the archive stream, for numChars onwards
 // from the current position in the archive.
 
@@ -722,16 +1134,14 @@ struct OSGA_Archive::ReadShaderFunctor : public OSGA_Archive::ReadFunctor
 
 ReaderWriter::ReadResult OSGA_Archive::read(const ReadFunctor& readFunctor)
 {
-    SERIALIZER();
-
     if (_status!=READ)
     {
         OSG_INFO<<"OSGA_Archive::readObject(obj, "<<readFunctor._filename<<") failed, archive opened as write only."<<std::endl;
         return ReadResult(ReadResult::FILE_NOT_HANDLED);
     }
 
-    FileNamePositionMap::const_iterator itr = _indexMap.find(readFunctor._filename);
-    if (itr==_indexMap.end())
+    PositionSizePair positionSize;
+    if (!findFileReference(readFunctor._filename, positionSize))
     {
         OSG_INFO<<"OSGA_Archive::readObject(obj, "<<readFunctor._filename<<") failed, file not found in archive"<<std::endl;
         return ReadResult(ReadResult::FILE_NOT_FOUND);
@@ -746,11 +1156,31 @@ ReaderWriter::ReadResult OSGA_Archive::read(const ReadFunctor& readFunctor)
 
     OSG_INFO<<"OSGA_Archive::readObject(obj, "<<readFunctor._filename<<")"<<std::endl;
 
-    _input.seekg( STREAM_POS( itr->second.first ) );
+    // read directly from the mapping if there is one, with each read using its own stream so none need locking.
+    osg::ref_ptr<osgDB::MappedFile> mappedFile = getMappedFile();
+    if (mappedFile.valid())
+    {
+        if (positionSize.first<0 || positionSize.second<0 ||
+            static_cast<unsigned long long>(positionSize.first+positionSize.second)>static_cast<unsigned long long>(mappedFile->size()))
+        {
+            OSG_INFO<<"OSGA_Archive::readObject(obj, "<<readFunctor._filename<<") failed, file extends beyond the end of the archive."<<std::endl;
+            return ReadResult(ReadResult::ERROR_IN_READING_FILE);
+        }
+
+        // a plain MemoryStreamBuffer rather than a MappedStreamBuffer, so readers don't reference the mapping directly
+        // and several objects read from the same file don't end up sharing the same data.
+        osgDB::MemoryStreamBuffer membuf(mappedFile->data()+positionSize.first, static_cast<size_t>(positionSize.second));
+        std::istream ins(&membuf);
+        return readFunctor.doRead(*rw, ins);
+    }
+
+    SERIALIZER();
+
+    _input.seekg( STREAM_POS( positionSize.first ) );
 
     // set up proxy stream buffer to provide the faked ending.
     std::istream& ins = _input;
-    proxy_streambuf mystreambuf(ins.rdbuf(),itr->second.second);
+    proxy_streambuf mystreambuf(ins.rdbuf(),positionSize.second);
     ins.rdbuf(&mystreambuf);
 
     ReaderWriter::ReadResult result = readFunctor.doRead(*rw, _input);
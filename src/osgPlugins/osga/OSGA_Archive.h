@@ -14,9 +14,11 @@
 #include <osg/Notify>
 #include <osgDB/Archive>
 #include <osgDB/FileNameUtils>
+#include <osgDB/MappedFile>
 
 #include <OpenThreads/ScopedLock>
 #include <OpenThreads/ReentrantMutex>
+#include <OpenThreads/Mutex>
 
 #define SERIALIZER() OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> lock(_serializerMutex)
 
@@ -35,6 +37,12 @@ class OSGA_Archive : public osgDB::Archive
             return osgDB::equalCaseInsensitive(extension,"osga");
         }
 
+        /** Set whether archives created are written as version 1, indexed by a single HashedIndex, rather than
+          * version 0 with a chain of IndexBlocks. Older osga plugins can't read version 1 archives, so defaults to false.
+          * Existing archives opened for writing keep their version.*/
+        void setUseHashedIndex(bool flag) { _useHashedIndex = flag; }
+        bool getUseHashedIndex() const { return _useHashedIndex; }
+
         /** open the archive.*/
         virtual bool open(const std::string& filename, ArchiveStatus status, unsigned int indexBlockSizeHint=4096);
 
@@ -59,6 +67,13 @@ class OSGA_Archive : public osgDB::Archive
         /** Get the full list of file names available in the archive.*/
         virtual bool getFileNames(FileNameList& fileNameList) const;
 
+        /** Copy the files of an archive opened for reading into this archive, master file first, byte for byte
+          * rather than by reading and rewriting them through their ReaderWriters.*/
+        bool copyFiles(const OSGA_Archive& source);
+
+        /** Read the bytes of a file stored in an archive opened for reading.*/
+        bool readFileData(const std::string& fileName, std::string& data) const;
+
 
         /** Read an osg::Object of specified file name from the Archive.*/
         virtual ReadResult readObject(const std::string& fileName,const Options* options=NULL) const;
@@ -105,6 +120,50 @@ class OSGA_Archive : public osgDB::Archive
 
         mutable OpenThreads::ReentrantMutex _serializerMutex;
 
+        /** Index of all the files in an archive, hashed on their file names, written as a single table at the end of
+          * version 1 archives and built from the IndexBlock chain when reading older archives. Once read it isn't
+          * modified, so can be searched from multiple threads without locking.*/
+        class HashedIndex
+        {
+        public:
+            struct Entry
+            {
+                pos_type        position;
+                size_type       size;
+                unsigned int    hash;
+                unsigned int    nameOffset;
+                unsigned int    nameSize;
+            };
+
+            typedef std::vector<Entry> EntryList;
+
+            void build(const FileNamePositionMap& indexMap);
+
+            bool read(std::istream& in, bool doEndianSwap, std::string& masterFileName);
+
+            void write(std::ostream& out, const std::string& masterFileName) const;
+
+            /** the number of bytes that write() writes.*/
+            size_type computeSize(const std::string& masterFileName) const;
+
+            void clear();
+
+            const Entry* find(const std::string& filename) const;
+
+            std::string getFileName(const Entry& entry) const { return _names.substr(entry.nameOffset, entry.nameSize); }
+
+            const EntryList& getEntries() const { return _entries; }
+
+            static unsigned int hash(const std::string& filename);
+
+        protected:
+
+            // offsets into _entries of the first entry of each bucket, followed by the number of entries.
+            std::vector<unsigned int>   _buckets;
+            EntryList                   _entries;
+            std::string                 _names;
+        };
+
         class IndexBlock;
         friend class IndexBlock;
 
@@ -213,7 +272,14 @@ class OSGA_Archive : public osgDB::Archive
 
         bool addFileReference(pos_type position, size_type size, const std::string& fileName);
 
+        bool findFileReference(const std::string& fileName, PositionSizePair& positionSize) const;
+
+        inline bool usesHashedIndex() const { return _version>=1.0f; }
+
+        osg::ref_ptr<osgDB::MappedFile> getMappedFile() const;
+
         static float        s_currentSupportedVersion;
+        bool                _useHashedIndex;
         float               _version;
         ArchiveStatus       _status;
         osgDB::ifstream     _input;
@@ -224,6 +290,16 @@ class OSGA_Archive : public osgDB::Archive
         IndexBlockList      _indexBlockList;
         FileNamePositionMap _indexMap;
 
+        // the position of the HashedIndex in version 1 archives, recorded in the archive header.
+        pos_type            _hashedIndexPosition;
+        HashedIndex         _hashedIndex;
+        bool                _hashedIndexRequiresWrite;
+
+        // when reading an archive file, the mapping of it that files are read from without holding _serializerMutex,
+        // reads take their own reference to it under _mappedFileMutex so that close() can't release it under them.
+        mutable OpenThreads::Mutex      _mappedFileMutex;
+        osg::ref_ptr<osgDB::MappedFile> _mappedFile;
+
 
         template <typename T>
         static inline void _write(char* ptr, const T& value)
@@ -3,6 +3,8 @@
 #include <osgDB/FileUtils>
 #include <osgDB/FileNameUtils>
 
+#include <sstream>
+
 #include "OSGA_Archive.h"
 
 
@@ -12,6 +14,8 @@ public:
     ReaderWriterOSGA()
     {
         supportsExtension("osga","OpenSceneGraph Archive format");
+
+        supportsOption("hashedIndex","Create version 1 archives, indexed by a hash table rather than a chain of index blocks. Older osga plugins can't read them.");
     }
 
     virtual const char* className() const { return "OpenSceneGraph Archive Reader/Writer"; }
@@ -30,11 +34,34 @@ public:
         }
 
         osg::ref_ptr<OSGA_Archive> archive = new OSGA_Archive;
+        if (options)
+        {
+            std::istringstream iss(options->getOptionString());
+            std::string opt;
+            while (iss >> opt)
+            {
+                if (opt=="hashedIndex") archive->setUseHashedIndex(true);
+            }
+        }
+
         if (!archive->open(fileName, status, indexBlockSize))
         {
             return ReadResult(ReadResult::FILE_NOT_HANDLED);
         }
 
+        // the "sourceArchive" plugin data names an osga archive whose files are copied unchanged into a new archive,
+        // as used by osgarchive --convert to switch between archive versions.
+        std::string sourceFileName = options ? options->getPluginStringData("sourceArchive") : std::string();
+        if (status!=READ && !sourceFileName.empty())
+        {
+            osg::ref_ptr<OSGA_Archive> source = new OSGA_Archive;
+            if (!source->open(sourceFileName, READ) || !archive->copyFiles(*source))
+            {
+                OSG_NOTICE<<"Warning: unable to copy files from "<<sourceFileName<<" into "<<fileName<<std::endl;
+                return ReadResult(ReadResult::ERROR_IN_READING_FILE);
+            }
+        }
+
         return archive.get();
     }
 
@@ -4,10 +4,14 @@
 #include <osg/Geode>
 #include <osg/GL>
 #include <osg/FrameBufferObject>
+#include <osg/Math>
 
 #include <osgDB/Registry>
 #include <osgDB/FileUtils>
 #include <osgDB/FileNameUtils>
+#include <osgDB/ImageRegion>
+
+#include <vector>
 
 #include <stdio.h>
 #include <tiffio.h>
@@ -760,6 +764,317 @@ simage_tiff_load(std::istream& fin,
     return buffer;
 }
 
+/* The layout of the image in the current directory of a tiff, as needed to read it a row at a time. */
+struct tiff_layout
+{
+    uint16 photometric;
+    uint16 samplesperpixel;
+    uint16 bitspersample;
+    uint16 config;
+    uint32 width;
+    uint32 height;
+};
+
+/* Read the layout of the current directory, returning ERR_UNSUPPORTED if it's one the region reader can't read a row at a time,
+ * when the image is left to simage_tiff_load. */
+static int
+read_tiff_layout(TIFF* in, tiff_layout& layout)
+{
+    if (TIFFGetField(in, TIFFTAG_PHOTOMETRIC, &layout.photometric) != 1 ||
+        TIFFGetField(in, TIFFTAG_SAMPLESPERPIXEL, &layout.samplesperpixel) != 1 ||
+        TIFFGetField(in, TIFFTAG_BITSPERSAMPLE, &layout.bitspersample) != 1 ||
+        TIFFGetField(in, TIFFTAG_IMAGEWIDTH, &layout.width) != 1 ||
+        TIFFGetField(in, TIFFTAG_IMAGELENGTH, &layout.height) != 1 ||
+        TIFFGetField(in, TIFFTAG_PLANARCONFIG, &layout.config) != 1)
+    {
+        return ERR_READ;
+    }
+
+    if (layout.config != PLANARCONFIG_CONTIG ||
+        layout.samplesperpixel < 1 || layout.samplesperpixel > 4 ||
+        (layout.bitspersample != 8 && layout.bitspersample != 16 && layout.bitspersample != 32))
+    {
+        return ERR_UNSUPPORTED;
+    }
+
+    switch(layout.photometric)
+    {
+        case PHOTOMETRIC_MINISWHITE:
+        case PHOTOMETRIC_MINISBLACK:
+        case PHOTOMETRIC_RGB:
+            return ERR_NO_ERROR;
+        case PHOTOMETRIC_PALETTE:
+            return (layout.bitspersample == 8 && layout.samplesperpixel == 1) ? ERR_NO_ERROR : ERR_UNSUPPORTED;
+        default:
+            return ERR_UNSUPPORTED;
+    }
+}
+
+static int
+tiff_layout_components(const tiff_layout& layout)
+{
+    // palette images are returned as 3 byte rgb
+    return (layout.photometric == PHOTOMETRIC_PALETTE) ? 3 : layout.samplesperpixel;
+}
+
+TIFF*
+simage_tiff_open(std::istream& fin)
+{
+    TIFFSetErrorHandler(tiff_error);
+    TIFFSetWarningHandler(tiff_warn);
+
+    return TIFFClientOpen("inputstream", "r", (thandle_t)&fin,
+            libtiffStreamReadProc, //Custom read function
+            libtiffStreamWriteProc, //Custom write function
+            libtiffStreamSeekProc, //Custom seek function
+            libtiffStreamCloseProc, //Custom close function
+            libtiffStreamSizeProc, //Custom size function
+            libtiffStreamMapProc, //Custom map function
+            libtiffStreamUnmapProc); //Custom unmap function
+}
+
+/* Read the layout of a tiff's full resolution image without decoding it. */
+int
+simage_tiff_info(std::istream& fin, tiff_layout& layout)
+{
+    TIFF* in = simage_tiff_open(fin);
+    if (in == NULL)
+    {
+        tifferror = ERR_OPEN;
+        return 0;
+    }
+
+    tifferror = read_tiff_layout(in, layout);
+    TIFFClose(in);
+    return tifferror == ERR_NO_ERROR;
+}
+
+/* Find the reduced resolution directory, as written by gdaladdo, that is the full resolution image reduced by the largest power
+ * of two up to maxScale, returning its scale and leaving it as the current directory, or 1 leaving the first directory current. */
+static unsigned int
+select_tiff_overview(TIFF* in, const tiff_layout& layout, unsigned int maxScale, tiff_layout& overviewLayout)
+{
+    tdir_t bestDirectory = 0;
+    unsigned int bestScale = 1;
+
+    for(tdir_t directory = 1; maxScale > 1 && TIFFSetDirectory(in, directory); ++directory)
+    {
+        uint32 subfiletype = 0;
+        tiff_layout candidate;
+        if (TIFFGetField(in, TIFFTAG_SUBFILETYPE, &subfiletype) != 1 || (subfiletype & FILETYPE_REDUCEDIMAGE) == 0 ||
+            read_tiff_layout(in, candidate) != ERR_NO_ERROR ||
+            candidate.photometric != layout.photometric ||
+            candidate.samplesperpixel != layout.samplesperpixel ||
+            candidate.bitspersample != layout.bitspersample)
+        {
+            continue;
+        }
+
+        for(unsigned int scale = 2; scale <= maxScale; scale *= 2)
+        {
+            if (scale > bestScale &&
+                candidate.width == (layout.width+scale-1)/scale &&
+                candidate.height == (layout.height+scale-1)/scale)
+            {
+                bestDirectory = directory;
+                bestScale = scale;
+                overviewLayout = candidate;
+            }
+        }
+    }
+
+    if (!TIFFSetDirectory(in, bestDirectory)) return 0;
+    if (bestScale == 1) overviewLayout = layout;
+    return bestScale;
+}
+
+/* Convert a row of the region from the layout of the file, its pixel at the first column of the region at src, to that of the image. */
+static const unsigned char*
+convert_region_row(const tiff_layout& layout, unsigned char* src, int numColumns,
+                   unsigned short* rmap, unsigned short* gmap, unsigned short* bmap,
+                   unsigned char* dst)
+{
+    switch(layout.photometric)
+    {
+        case PHOTOMETRIC_MINISWHITE:
+            invert_row(dst, src, numColumns*layout.samplesperpixel, 1, layout.bitspersample);
+            return dst;
+        case PHOTOMETRIC_PALETTE:
+            remap_row(dst, src, numColumns, rmap, gmap, bmap);
+            return dst;
+        default:
+            return src;
+    }
+}
+
+/* Read the rows and columns of a tiff covering the region set up on builder, from a reduced resolution directory if the file
+ * has one that suits the region. Tiled images only have the tiles covering the region decoded and striped ones the strips.
+ * Return 0 with tifferror set if the tiff couldn't be read, it being ERR_UNSUPPORTED where the layout is left to simage_tiff_load,
+ * otherwise 1 with builder's image NULL if the region was empty. */
+int
+simage_tiff_load_region(std::istream& fin,
+                        int x, int y, int width, int height, unsigned int reductionLevel,
+                        osgDB::ImageRegionBuilder& builder,
+                        int& numComponents_ret,
+                        uint16& bitspersample)
+{
+    TIFF* in = simage_tiff_open(fin);
+    if (in == NULL)
+    {
+        tifferror = ERR_OPEN;
+        return 0;
+    }
+
+    tiff_layout layout;
+    tifferror = read_tiff_layout(in, layout);
+    if (tifferror || !builder.setRegion(layout.width, layout.height, x, y, width, height, reductionLevel))
+    {
+        TIFFClose(in);
+        return tifferror == ERR_NO_ERROR;
+    }
+
+    tiff_layout source;
+    unsigned int scale = select_tiff_overview(in, layout, builder.getAlignedSourceScale(~0u), source);
+    if (scale == 0)
+    {
+        tifferror = ERR_READ;
+        TIFFClose(in);
+        return 0;
+    }
+
+    int format = tiff_layout_components(layout);
+    numComponents_ret = format;
+    bitspersample = layout.bitspersample;
+
+    GLenum pixelFormat =
+        format == 1 ? GL_LUMINANCE :
+        format == 2 ? GL_LUMINANCE_ALPHA :
+        format == 3 ? GL_RGB : GL_RGBA;
+
+    GLenum dataType =
+        bitspersample == 8 ? GL_UNSIGNED_BYTE :
+        bitspersample == 16 ? GL_UNSIGNED_SHORT : GL_FLOAT;
+
+    if (!builder.allocateImage(scale, source.width, source.height, pixelFormat, dataType))
+    {
+        tifferror = ERR_MEM;
+        TIFFClose(in);
+        return 0;
+    }
+
+    // the colour map is converted to 8-bit as simage_tiff_load does, on a copy so as not to change libtiff's.
+    std::vector<unsigned short> colormap;
+    if (source.photometric == PHOTOMETRIC_PALETTE)
+    {
+        uint16* red;
+        uint16* green;
+        uint16* blue;
+        if (TIFFGetField(in, TIFFTAG_COLORMAP, &red, &green, &blue) != 1)
+        {
+            tifferror = ERR_READ;
+            TIFFClose(in);
+            return 0;
+        }
+
+        colormap.resize(256*3);
+        bool convert = checkcmap(256, red, green, blue) == 16;
+        for(int i = 0; i < 256; ++i)
+        {
+            colormap[i] = convert ? CVT(red[i]) : red[i];
+            colormap[256+i] = convert ? CVT(green[i]) : green[i];
+            colormap[512+i] = convert ? CVT(blue[i]) : blue[i];
+        }
+    }
+    unsigned short* rmap = colormap.empty() ? NULL : &colormap[0];
+    unsigned short* gmap = colormap.empty() ? NULL : &colormap[256];
+    unsigned short* bmap = colormap.empty() ? NULL : &colormap[512];
+
+    int beginColumn = builder.getBeginColumn();
+    int numColumns = builder.getEndColumn()-beginColumn;
+    int bytesperpixel = source.samplesperpixel * source.bitspersample / 8;
+    int bytesperoutputpixel = format * source.bitspersample / 8;
+
+    std::vector<unsigned char> converted(numColumns*bytesperoutputpixel);
+
+    if (TIFFIsTiled(in))
+    {
+        uint32 tileWidth = 0;
+        uint32 tileLength = 0;
+        TIFFGetField(in, TIFFTAG_TILEWIDTH, &tileWidth);
+        TIFFGetField(in, TIFFTAG_TILELENGTH, &tileLength);
+        if (tileWidth == 0 || tileLength == 0)
+        {
+            tifferror = ERR_READ;
+            TIFFClose(in);
+            return 0;
+        }
+
+        // the tiles are decoded a row of them at a time into a band holding just the columns of the region.
+        std::vector<unsigned char> tile(TIFFTileSize(in));
+        std::vector<unsigned char> band(tileLength*numColumns*bytesperpixel);
+        int bandRowSize = numColumns*bytesperpixel;
+        uint32 tileRowSize = tileWidth*bytesperpixel;
+
+        uint32 beginTileColumn = beginColumn/tileWidth;
+        uint32 endTileColumn = (builder.getEndColumn()-1)/tileWidth + 1;
+
+        for(uint32 tileRow = builder.getBeginRow()/tileLength; !tifferror && tileRow*tileLength < (uint32)builder.getEndRow(); ++tileRow)
+        {
+            uint32 bandTop = tileRow*tileLength;
+            for(uint32 tileColumn = beginTileColumn; tileColumn < endTileColumn; ++tileColumn)
+            {
+                if (TIFFReadEncodedTile(in, TIFFComputeTile(in, tileColumn*tileWidth, bandTop, 0, 0), &tile[0], -1) < 0)
+                {
+                    tifferror = ERR_READ;
+                    break;
+                }
+
+                int tileLeft = tileColumn*tileWidth;
+                int begin = osg::maximum(tileLeft, beginColumn);
+                int end = osg::minimum(tileLeft+(int)tileWidth, builder.getEndColumn());
+                for(uint32 r = 0; r < tileLength; ++r)
+                {
+                    memcpy(&band[r*bandRowSize + (begin-beginColumn)*bytesperpixel],
+                           &tile[r*tileRowSize + (begin-tileLeft)*bytesperpixel],
+                           (end-begin)*bytesperpixel);
+                }
+            }
+
+            uint32 beginRow = osg::maximum(bandTop, (uint32)builder.getBeginRow());
+            uint32 endRow = osg::minimum(bandTop+tileLength, (uint32)builder.getEndRow());
+            for(uint32 row = beginRow; !tifferror && row < endRow; ++row)
+            {
+                builder.addRow(row, convert_region_row(source, &band[(row-bandTop)*bandRowSize], numColumns, rmap, gmap, bmap, &converted[0]));
+            }
+        }
+    }
+    else
+    {
+        // compressed strips have to be decoded from their first row, so reading starts at that of the strip holding the
+        // region's first row, skipping the strips above it.
+        uint32 rowsperstrip = 0;
+        if (TIFFGetField(in, TIFFTAG_ROWSPERSTRIP, &rowsperstrip) != 1 || rowsperstrip == 0) rowsperstrip = source.height;
+        uint32 firstRow = (builder.getBeginRow()/rowsperstrip)*rowsperstrip;
+
+        std::vector<unsigned char> scanline(TIFFScanlineSize(in));
+        for(uint32 row = firstRow; row < (uint32)builder.getEndRow(); ++row)
+        {
+            if (TIFFReadScanline(in, &scanline[0], row, 0) < 0)
+            {
+                tifferror = ERR_READ;
+                break;
+            }
+            if (row >= (uint32)builder.getBeginRow())
+            {
+                builder.addRow(row, convert_region_row(source, &scanline[beginColumn*bytesperpixel], numColumns, rmap, gmap, bmap, &converted[0]));
+            }
+        }
+    }
+
+    TIFFClose(in);
+    return tifferror == ERR_NO_ERROR;
+}
+
 
 #undef CVT
 #undef pack
@@ -982,6 +1297,107 @@ class ReaderWriterTIFF : public osgDB::ReaderWriter
             return rr;
         }
 
+        virtual ReadResult readImageInfo(std::istream& fin, const osgDB::ReaderWriter::Options* =NULL) const
+        {
+            tiff_layout layout;
+            if (!simage_tiff_info(fin, layout))
+            {
+                // layouts only simage_tiff_load reads are left for the caller to read whole.
+                if (tifferror == ERR_UNSUPPORTED) return ReadResult::FILE_NOT_HANDLED;
+
+                char err_msg[256];
+                simage_tiff_error( err_msg, sizeof(err_msg));
+                OSG_WARN << err_msg << std::endl;
+                return ReadResult::FILE_NOT_HANDLED;
+            }
+
+            int numComponents = tiff_layout_components(layout);
+
+            unsigned int pixelFormat =
+                numComponents == 1 ? GL_LUMINANCE :
+                numComponents == 2 ? GL_LUMINANCE_ALPHA :
+                numComponents == 3 ? GL_RGB : GL_RGBA;
+
+            unsigned int dataType =
+                layout.bitspersample == 8 ? GL_UNSIGNED_BYTE :
+                layout.bitspersample == 16 ? GL_UNSIGNED_SHORT : GL_FLOAT;
+
+            osg::Image* pOsgImage = new osg::Image;
+            pOsgImage->setImage(layout.width, layout.height, 1,
+                numComponents,
+                pixelFormat,
+                dataType,
+                NULL,
+                osg::Image::NO_DELETE);
+
+            return pOsgImage;
+        }
+
+        virtual ReadResult readImageInfo(const std::string& file, const osgDB::ReaderWriter::Options* options) const
+        {
+            std::string ext = osgDB::getLowerCaseFileExtension(file);
+            if (!acceptsExtension(ext)) return ReadResult::FILE_NOT_HANDLED;
+
+            std::string fileName = osgDB::findDataFile( file, options );
+            if (fileName.empty()) return ReadResult::FILE_NOT_FOUND;
+
+            osgDB::ifstream istream(fileName.c_str(), std::ios::in | std::ios::binary);
+            if(!istream) return ReadResult::FILE_NOT_HANDLED;
+            ReadResult rr = readImageInfo(istream, options);
+            if(rr.validImage()) rr.getImage()->setFileName(file);
+            return rr;
+        }
+
+        virtual ReadResult readImageRegion(std::istream& fin, int x, int y, int width, int height, unsigned int reductionLevel, const osgDB::ReaderWriter::Options* =NULL) const
+        {
+            std::streampos start = fin.tellg();
+
+            osgDB::ImageRegionBuilder builder;
+            int numComponents_ret = -1;
+            uint16 bitspersample_ret = 0;
+            if (!simage_tiff_load_region(fin, x, y, width, height, reductionLevel, builder, numComponents_ret, bitspersample_ret))
+            {
+                if (tifferror != ERR_UNSUPPORTED)
+                {
+                    char err_msg[256];
+                    simage_tiff_error( err_msg, sizeof(err_msg));
+                    OSG_WARN << err_msg << std::endl;
+                    return ReadResult::ERROR_IN_READING_FILE;
+                }
+
+                // planar and other layouts that can't be read a row at a time are read whole.
+                fin.clear();
+                fin.seekg(start);
+                ReadResult rr = readTIFStream(fin);
+                if (!rr.validImage()) return rr;
+
+                osg::Image* region = osgDB::createImageRegion(rr.getImage(), x, y, width, height, reductionLevel);
+                if (!region) return ReadResult("Warning: TIFF image region is empty.");
+                return region;
+            }
+
+            if (!builder.getImage()) return ReadResult("Warning: TIFF image region is empty.");
+
+            osg::Image* region = builder.getImage();
+            region->setInternalTextureFormat(numComponents_ret);
+            return region;
+        }
+
+        virtual ReadResult readImageRegion(const std::string& file, int x, int y, int width, int height, unsigned int reductionLevel, const osgDB::ReaderWriter::Options* options) const
+        {
+            std::string ext = osgDB::getLowerCaseFileExtension(file);
+            if (!acceptsExtension(ext)) return ReadResult::FILE_NOT_HANDLED;
+
+            std::string fileName = osgDB::findDataFile( file, options );
+            if (fileName.empty()) return ReadResult::FILE_NOT_FOUND;
+
+            osgDB::ifstream istream(fileName.c_str(), std::ios::in | std::ios::binary);
+            if(!istream) return ReadResult::FILE_NOT_HANDLED;
+            ReadResult rr = readImageRegion(istream, x, y, width, height, reductionLevel, options);
+            if(rr.validImage()) rr.getImage()->setFileName(file);
+            return rr;
+        }
+
         virtual WriteResult writeImage(const osg::Image& img,std::ostream& fout,const osgDB::ReaderWriter::Options* options) const
         {
             WriteResult::WriteStatus ws = writeTIFStream(fout,img, options);
@@ -14,6 +14,7 @@ class ReaderWriterZIP : public osgDB::ReaderWriter
         ReaderWriterZIP()
         {
             supportsExtension("zip","Zip archive format");
+            supportsOption("noMapping","Read the files of an archive through an unzip handle per thread rather than directly from a memory mapping of the archive");
             osgDB::Registry::instance()->addArchiveExtension("zip");
         }
 
@@ -23,6 +23,7 @@
 
 #include <sstream>
 #include <cstdio>
+#include <zlib.h>
 #include "unzip.h"
 
 #if !defined(S_ISDIR)
@@ -61,6 +62,9 @@ void ZipArchive::close()
             // clear out the file handles
             _perThreadData.clear();
 
+            _mappedEntries.clear();
+            _mappedFile = 0;
+
             // clear out the index.
             _zipIndex.clear();
 
@@ -137,6 +141,11 @@ bool ZipArchive::open(const std::string& file, ArchiveStatus status, const osgDB
             {
                 IndexZipFiles( data._zipHandle );
                 _zipLoaded = true;
+
+                // unless disabled, read unencrypted files from a mapping of the archive so that threads don't need
+                // their own unzip handles, which have to step through the central directory to each file they read.
+                bool noMapping = options && options->getOptionString().find("noMapping")!=std::string::npos;
+                if ( !noMapping && _password.empty() ) IndexMappedFile();
             }
         }
     }
@@ -189,11 +198,14 @@ osgDB::ReaderWriter::ReadResult ZipArchive::readObject(const std::string& file,
     const ZIPENTRY* ze = GetZipEntry(file);
     if(ze != NULL)
     {
-        std::stringstream buffer;
+        EntryData entryData;
 
-        osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, buffer);
+        osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, entryData);
         if (rw != NULL)
         {
+            osgDB::MemoryStreamBuffer membuf(entryData.data, entryData.size);
+            std::istream buffer(&membuf);
+
             // Setup appropriate options
             osg::ref_ptr<osgDB::ReaderWriter::Options> local_opt = options ?
             static_cast<osgDB::ReaderWriter::Options*>(options->clone(osg::CopyOp::SHALLOW_COPY)) :
@@ -222,11 +234,14 @@ osgDB::ReaderWriter::ReadResult ZipArchive::readImage(const std::string& file,co
     const ZIPENTRY* ze = GetZipEntry(file);
     if(ze != NULL)
     {
-        std::stringstream buffer;
+        EntryData entryData;
 
-        osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, buffer);
+        osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, entryData);
         if (rw != NULL)
         {
+            osgDB::MemoryStreamBuffer membuf(entryData.data, entryData.size);
+            std::istream buffer(&membuf);
+
             // Setup appropriate options
             osg::ref_ptr<osgDB::ReaderWriter::Options> local_opt = options ?
             static_cast<osgDB::ReaderWriter::Options*>(options->clone(osg::CopyOp::SHALLOW_COPY)) :
@@ -255,11 +270,14 @@ osgDB::ReaderWriter::ReadResult ZipArchive::readHeightField(const std::string& f
     const ZIPENTRY* ze = GetZipEntry(file);
     if(ze != NULL)
     {
-        std::stringstream buffer;
+        EntryData entryData;
 
-        osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, buffer);
+        osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, entryData);
         if (rw != NULL)
         {
+            osgDB::MemoryStreamBuffer membuf(entryData.data, entryData.size);
+            std::istream buffer(&membuf);
+
             // Setup appropriate options
             osg::ref_ptr<osgDB::ReaderWriter::Options> local_opt = options ?
             options->cloneOptions() :
@@ -288,11 +306,14 @@ osgDB::ReaderWriter::ReadResult ZipArchive::readNode(const std::string& file,con
     const ZIPENTRY* ze = GetZipEntry(file);
     if(ze != NULL)
     {
-        std::stringstream buffer;
+        EntryData entryData;
 
-        osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, buffer);
+        osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, entryData);
         if (rw != NULL)
         {
+            osgDB::MemoryStreamBuffer membuf(entryData.data, entryData.size);
+            std::istream buffer(&membuf);
+
             // Setup appropriate options
             osg::ref_ptr<osgDB::ReaderWriter::Options> local_opt = options ?
                 options->cloneOptions() :
@@ -322,11 +343,14 @@ osgDB::ReaderWriter::ReadResult ZipArchive::readShader(const std::string& file,c
     const ZIPENTRY* ze = GetZipEntry(file);
     if(ze != NULL)
     {
-        std::stringstream buffer;
+        EntryData entryData;
 
-        osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, buffer);
+        osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, entryData);
         if (rw != NULL)
         {
+            osgDB::MemoryStreamBuffer membuf(entryData.data, entryData.size);
+            std::istream buffer(&membuf);
+
             // Setup appropriate options
             osg::ref_ptr<osgDB::ReaderWriter::Options> local_opt = options ?
                 options->cloneOptions() :
@@ -371,42 +395,200 @@ osgDB::ReaderWriter::WriteResult ZipArchive::writeShader(const osg::Shader& /*sh
 }
 
 
-osgDB::ReaderWriter* ZipArchive::ReadFromZipEntry(const ZIPENTRY* ze, const osgDB::ReaderWriter::Options* options, std::stringstream& buffer) const
+osgDB::ReaderWriter* ZipArchive::ReadFromZipEntry(const ZIPENTRY* ze, const osgDB::ReaderWriter::Options* options, EntryData& entryData) const
 {
+    if (ze != 0 && ReadFromMappedEntry(ze, entryData))
+    {
+        return osgDB::Registry::instance()->getReaderWriterForExtension(osgDB::getFileExtension(ze->name));
+    }
+
     if (ze != 0)
     {
-        char* ibuf = new (std::nothrow) char[ze->unc_size];
-        if (ibuf)
+        // fetch the handle for the current thread:
+        const PerThreadData& data = getData();
+        if ( data._zipHandle != NULL )
         {
-            // fetch the handle for the current thread:
-            const PerThreadData& data = getData();
-            if ( data._zipHandle != NULL )
+            entryData.buffer.resize(ze->unc_size);
+            ZRESULT result = UnzipItem(data._zipHandle, ze->index, static_cast<void*>(&entryData.buffer[0]), ze->unc_size);
+            bool unzipSuccesful = CheckZipErrorCode(result);
+            if(!unzipSuccesful)
             {
-                ZRESULT result = UnzipItem(data._zipHandle, ze->index, ibuf, ze->unc_size);
-                bool unzipSuccesful = CheckZipErrorCode(result);
-                if(unzipSuccesful)
-                {
-                    buffer.write(ibuf,ze->unc_size);
-                }
+                entryData.buffer.clear();
+            }
 
-                delete[] ibuf;
+            entryData.data = entryData.buffer.data();
+            entryData.size = entryData.buffer.size();
 
-                std::string file_ext = osgDB::getFileExtension(ze->name);
+            std::string file_ext = osgDB::getFileExtension(ze->name);
 
-                osgDB::ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension(file_ext);
-                if (rw != NULL)
-                {
-                    return rw;
-                }
+            osgDB::ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension(file_ext);
+            if (rw != NULL)
+            {
+                return rw;
             }
         }
-        else
+    }
+
+    return NULL;
+}
+
+namespace
+{
+    inline unsigned int readUInt16(const unsigned char* ptr) { return ptr[0] | (ptr[1]<<8); }
+    inline unsigned int readUInt32(const unsigned char* ptr) { return ptr[0] | (ptr[1]<<8) | (ptr[2]<<16) | (static_cast<unsigned int>(ptr[3])<<24); }
+
+    const unsigned int LOCAL_HEADER_SIGNATURE = 0x04034b50;
+    const unsigned int CENTRAL_HEADER_SIGNATURE = 0x02014b50;
+    const unsigned int END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06054b50;
+
+    const unsigned int LOCAL_HEADER_SIZE = 30;
+    const unsigned int CENTRAL_HEADER_SIZE = 46;
+    const unsigned int END_OF_CENTRAL_DIRECTORY_SIZE = 22;
+}
+
+bool ZipArchive::IndexMappedFile()
+{
+    _mappedEntries.clear();
+
+    _mappedFile = new osgDB::MappedFile(_filename);
+    if (!_mappedFile->valid() || _mappedFile->size()<END_OF_CENTRAL_DIRECTORY_SIZE)
+    {
+        _mappedFile = 0;
+        return false;
+    }
+
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(_mappedFile->data());
+    size_t size = _mappedFile->size();
+
+    // the end of central directory record is followed by a comment of up to 65535 bytes, so search back for it.
+    const unsigned char* endRecord = 0;
+    size_t searchEnd = size>END_OF_CENTRAL_DIRECTORY_SIZE+65535 ? size-END_OF_CENTRAL_DIRECTORY_SIZE-65535 : 0;
+    for(size_t pos = size-END_OF_CENTRAL_DIRECTORY_SIZE+1; pos-- > searchEnd; )
+    {
+        if (readUInt32(data+pos)==END_OF_CENTRAL_DIRECTORY_SIGNATURE)
         {
-            //std::cout << "Error- failed to allocate enough memory to unzip file '" << ze->name << ", with size '" << ze->unc_size << std::endl;
+            endRecord = data+pos;
+            break;
         }
     }
 
-    return NULL;
+    unsigned int numEntries = endRecord ? readUInt16(endRecord+10) : 0;
+    unsigned int directoryOffset = endRecord ? readUInt32(endRecord+16) : 0;
+
+    // leave Zip64 and multi-disk archives to the unzip library.
+    if (!endRecord || numEntries==0xffff || directoryOffset==0xffffffff || readUInt16(endRecord+4)!=0 ||
+        numEntries!=static_cast<unsigned int>(_mainRecord.index))
+    {
+        _mappedFile = 0;
+        return false;
+    }
+
+    _mappedEntries.resize(numEntries);
+
+    size_t pos = directoryOffset;
+    for(unsigned int i=0; i<numEntries; ++i)
+    {
+        if (pos+CENTRAL_HEADER_SIZE>size || readUInt32(data+pos)!=CENTRAL_HEADER_SIGNATURE)
+        {
+            OSG_INFO<<"ZipArchive::IndexMappedFile() invalid central directory in "<<_filename<<std::endl;
+            _mappedEntries.clear();
+            _mappedFile = 0;
+            return false;
+        }
+
+        const unsigned char* header = data+pos;
+        MappedEntry& entry = _mappedEntries[i];
+        unsigned int flags = readUInt16(header+8);
+        entry.method = readUInt16(header+10);
+        entry.crc = readUInt32(header+16);
+        entry.compressedSize = readUInt32(header+20);
+        entry.uncompressedSize = readUInt32(header+24);
+        entry.localHeaderOffset = readUInt32(header+42);
+
+        // encrypted, Zip64 and files compressed other than by deflate are read through the unzip library.
+        entry.mappable = (flags & 1)==0 &&
+                         (entry.method==0 || entry.method==Z_DEFLATED) &&
+                         entry.compressedSize!=0xffffffff && entry.uncompressedSize!=0xffffffff &&
+                         entry.localHeaderOffset!=0xffffffff;
+
+        pos += CENTRAL_HEADER_SIZE + readUInt16(header+28) + readUInt16(header+30) + readUInt16(header+32);
+    }
+
+    return true;
+}
+
+bool ZipArchive::ReadFromMappedEntry(const ZIPENTRY* ze, EntryData& entryData) const
+{
+    // close() releases the mapping and the entries, so take a reference to the one and a copy of the other under the lock.
+    osg::ref_ptr<osgDB::MappedFile> mappedFile;
+    MappedEntry entry;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> exclusive( const_cast<ZipArchive*>(this)->_zipMutex );
+        if (!_mappedFile || ze->index<0 || ze->index>=static_cast<int>(_mappedEntries.size())) return false;
+
+        mappedFile = _mappedFile;
+        entry = _mappedEntries[ze->index];
+    }
+
+    if (!entry.mappable) return false;
+
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(mappedFile->data());
+    size_t size = mappedFile->size();
+
+    // the local header's file name and extra field may differ in length from the central directory's.
+    size_t offset = entry.localHeaderOffset;
+    if (offset+LOCAL_HEADER_SIZE>size || readUInt32(data+offset)!=LOCAL_HEADER_SIGNATURE) return false;
+    offset += LOCAL_HEADER_SIZE + readUInt16(data+offset+26) + readUInt16(data+offset+28);
+    if (offset>size || entry.compressedSize>size-offset) return false;
+
+    const Bytef* uncompressed = 0;
+    if (entry.method==0)
+    {
+        // stored files are read straight from the mapping.
+        if (entry.compressedSize!=entry.uncompressedSize) return false;
+        uncompressed = data+offset;
+    }
+    else
+    {
+        entryData.buffer.resize(entry.uncompressedSize);
+
+        z_stream strm;
+        strm.zalloc = Z_NULL;
+        strm.zfree = Z_NULL;
+        strm.opaque = Z_NULL;
+        strm.next_in = const_cast<Bytef*>(data+offset);
+        strm.avail_in = entry.compressedSize;
+
+        // zip files hold raw deflate streams, without a zlib header.
+        if (inflateInit2(&strm, -MAX_WBITS)!=Z_OK) return false;
+
+        unsigned char empty = 0;
+        strm.next_out = entry.uncompressedSize>0 ? reinterpret_cast<Bytef*>(&entryData.buffer[0]) : &empty;
+        strm.avail_out = entry.uncompressedSize;
+        int result = inflate(&strm, Z_FINISH);
+        inflateEnd(&strm);
+
+        if (result!=Z_STREAM_END || strm.total_out!=entry.uncompressedSize)
+        {
+            OSG_WARN<<"ZipArchive: failed to inflate "<<ze->name<<" from "<<_filename<<std::endl;
+            entryData.buffer.clear();
+            return false;
+        }
+
+        uncompressed = reinterpret_cast<const Bytef*>(entryData.buffer.data());
+    }
+
+    if (crc32(0L, uncompressed, entry.uncompressedSize)!=entry.crc)
+    {
+        OSG_WARN<<"ZipArchive: CRC error reading "<<ze->name<<" from "<<_filename<<std::endl;
+        entryData.buffer.clear();
+        return false;
+    }
+
+    if (entry.method==0) entryData.mappedFile = mappedFile;
+    entryData.data = reinterpret_cast<const char*>(uncompressed);
+    entryData.size = entry.uncompressedSize;
+    return true;
 }
 
 void CleanupFileString(std::string& strFileOrDir)
@@ -5,6 +5,7 @@
 #include <osgDB/FileUtils>
 
 #include <osgDB/Archive>
+#include <osgDB/MappedFile>
 #include <OpenThreads/Mutex>
 
 #include "unzip.h"
@@ -64,9 +65,23 @@ class ZipArchive : public osgDB::Archive
 
     protected:
 
-        osgDB::ReaderWriter* ReadFromZipEntry(const ZIPENTRY* ze, const osgDB::ReaderWriter::Options* options, std::stringstream& streamIn) const;
+        // the uncompressed contents of a file in the archive, either referenced straight from the mapping of the
+        // archive, which mappedFile keeps alive, or held in buffer once inflated or unzipped.
+        struct EntryData
+        {
+            EntryData() : data(0), size(0) {}
+
+            osg::ref_ptr<osgDB::MappedFile> mappedFile;
+            std::string                     buffer;
+            const char*                     data;
+            size_t                          size;
+        };
+
+        osgDB::ReaderWriter* ReadFromZipEntry(const ZIPENTRY* ze, const osgDB::ReaderWriter::Options* options, EntryData& entryData) const;
 
         void IndexZipFiles(HZIP hz);
+        bool IndexMappedFile();
+        bool ReadFromMappedEntry(const ZIPENTRY* ze, EntryData& entryData) const;
         const ZIPENTRY* GetZipEntry(const std::string& filename) const;
         ZIPENTRY* GetZipEntry(const std::string& filename);
 
@@ -93,6 +108,24 @@ class ZipArchive : public osgDB::Archive
         typedef std::map<OpenThreads::Thread*, PerThreadData> PerThreadDataMap;
         PerThreadDataMap _perThreadData;
 
+        // where each file's compressed data is in a mapping of the archive, indexed by ZIPENTRY::index, read from
+        // the central directory on open so that files can be inflated straight from the mapping. Both are reset by
+        // close(), so readers only hold _zipMutex long enough to take a reference to the mapping and copy the entry.
+        struct MappedEntry
+        {
+            unsigned int   localHeaderOffset;
+            unsigned int   compressedSize;
+            unsigned int   uncompressedSize;
+            unsigned int   crc;
+            unsigned short method;
+            bool           mappable;
+        };
+
+        typedef std::vector<MappedEntry> MappedEntryList;
+
+        osg::ref_ptr<osgDB::MappedFile> _mappedFile;
+        MappedEntryList                 _mappedEntries;
+
         const PerThreadData& getData() const;
         const PerThreadData& getDataNoLock() const;
 };
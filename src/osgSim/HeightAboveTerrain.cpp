@@ -15,7 +15,7 @@
 #include <osgSim/HeightAboveTerrain>
 
 #include <osg/Notify>
-#include <osgUtil/LineSegmentIntersector>
+#include <osgUtil/LineSegmentPacketIntersector>
 
 using namespace osgSim;
 
@@ -43,7 +43,7 @@ void HeightAboveTerrain::computeIntersections(osg::Node* scene, osg::Node::NodeM
     osg::CoordinateSystemNode* csn = dynamic_cast<osg::CoordinateSystemNode*>(scene);
     osg::EllipsoidModel* em = csn ? csn->getEllipsoidModel() : 0;
 
-    osg::ref_ptr<osgUtil::IntersectorGroup> intersectorGroup = new osgUtil::IntersectorGroup();
+    osg::ref_ptr<osgUtil::IntersectorGroup> intersectorGroup = new osgUtil::LineSegmentPacketIntersector();
 
     for(HATList::iterator itr = _HATList.begin();
         itr != _HATList.end();
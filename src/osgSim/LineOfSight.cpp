@@ -15,7 +15,7 @@
 
 #include <osg/Notify>
 #include <osgDB/ReadFile>
-#include <osgUtil/LineSegmentIntersector>
+#include <osgUtil/LineSegmentPacketIntersector>
 
 using namespace osgSim;
 
@@ -106,7 +106,7 @@ unsigned int LineOfSight::addLOS(const osg::Vec3d& start, const osg::Vec3d& end)
 
 void LineOfSight::computeIntersections(osg::Node* scene, osg::Node::NodeMask traversalMask)
 {
-    osg::ref_ptr<osgUtil::IntersectorGroup> intersectorGroup = new osgUtil::IntersectorGroup();
+    osg::ref_ptr<osgUtil::IntersectorGroup> intersectorGroup = new osgUtil::LineSegmentPacketIntersector();
 
     for(LOSList::iterator itr = _LOSList.begin();
         itr != _LOSList.end();
@@ -29,6 +29,7 @@
 #include <osg/io_utils>
 
 #include <osgUtil/CullVisitor>
+#include <osgUtil/MeshOptimizers>
 
 #include <float.h>
 #include <algorithm>
@@ -52,7 +53,9 @@ CullVisitor::CullVisitor():
     _computed_znear(FLT_MAX),
     _computed_zfar(-FLT_MAX),
     _currentReuseRenderLeafIndex(0),
-    _numberOfEncloseOverrideRenderBinDetails(0)
+    _currentReuseMeshletBatchIndex(0),
+    _numberOfEncloseOverrideRenderBinDetails(0),
+    _numberOfAllocations(0)
 {
     _identifier = new Identifier;
 }
@@ -66,7 +69,9 @@ CullVisitor::CullVisitor(const CullVisitor& rhs):
     _computed_znear(FLT_MAX),
     _computed_zfar(-FLT_MAX),
     _currentReuseRenderLeafIndex(0),
+    _currentReuseMeshletBatchIndex(0),
     _numberOfEncloseOverrideRenderBinDetails(0),
+    _numberOfAllocations(0),
     _identifier(rhs._identifier)
 {
 }
@@ -102,6 +107,8 @@ void CullVisitor::reset()
 
     _numberOfEncloseOverrideRenderBinDetails = 0;
 
+    _numberOfAllocations = 0;
+
     // reset the traversal number
     _traversalNumber = 0;
 
@@ -129,6 +136,7 @@ void CullVisitor::reset()
 
     // reset the resuse lists.
     _currentReuseRenderLeafIndex = 0;
+    _currentReuseMeshletBatchIndex = 0;
 
     _nearPlaneCandidateMap.clear();
     _farPlaneCandidateMap.clear();
@@ -160,6 +168,59 @@ float CullVisitor::getDistanceFromEyePoint(const osg::Vec3& pos, bool withLODSca
     else return dist;
 }
 
+MeshletBatch* CullVisitor::createOrReuseMeshletBatch()
+{
+    // skip any batches still referenced by the render graph of a previous frame.
+    while (_currentReuseMeshletBatchIndex<_reuseMeshletBatchList.size() &&
+           _reuseMeshletBatchList[_currentReuseMeshletBatchIndex]->referenceCount()>1)
+    {
+        ++_currentReuseMeshletBatchIndex;
+    }
+
+    if (_currentReuseMeshletBatchIndex<_reuseMeshletBatchList.size())
+    {
+        return _reuseMeshletBatchList[_currentReuseMeshletBatchIndex++].get();
+    }
+
+    ++_numberOfAllocations;
+    MeshletBatch* batch = new MeshletBatch;
+    _reuseMeshletBatchList.push_back(batch);
+    ++_currentReuseMeshletBatchIndex;
+    return batch;
+}
+
+void CullVisitor::addMeshlets(osg::Drawable& drawable,const MeshletData& meshletData,osg::RefMatrix* matrix,float depth)
+{
+    const osg::Vec3& eyeLocal = getEyeLocal();
+    bool normalConeCulling = meshletData.getNormalConeCulling();
+    bool cullingActive = drawable.isCullingActive();
+
+    MeshletBatch* batch = createOrReuseMeshletBatch();
+    batch->reset(&meshletData, drawable.getBoundingBox());
+
+    const MeshletData::MeshletList& meshlets = meshletData.getMeshletList();
+    for(MeshletData::MeshletList::const_iterator itr = meshlets.begin();
+        itr != meshlets.end();
+        ++itr)
+    {
+        const osg::BoundingSphere& bs = itr->bound;
+
+        if (cullingActive && getCurrentCullingSet().isCulled(bs)) continue;
+
+        if (normalConeCulling && itr->coneCutoff<1.0f)
+        {
+            // all the triangles face away from the eye point when it lies
+            // outside the cone mirroring the normal cone around the cluster.
+            osg::Vec3 dv = bs.center()-eyeLocal;
+            if (dv*itr->coneAxis >= itr->coneCutoff*dv.length()+bs.radius()) continue;
+        }
+
+        batch->addMeshlet(*itr);
+    }
+
+    if (!batch->empty()) addDrawableAndDepth(batch,matrix,depth);
+}
+
 void CullVisitor::computeNearPlane()
 {
     //OSG_NOTICE<<"CullVisitor::computeNearPlane() _computed_znear="<<_computed_znear<<", _computed_zfar="<<_computed_zfar<<std::endl;
@@ -1042,7 +1103,10 @@ void CullVisitor::apply(osg::Drawable& drawable)
     }
     else
     {
-        addDrawableAndDepth(&drawable,&matrix,depth);
+        const osg::Referenced* userData = drawable.getUserData();
+        const MeshletData* meshletData = userData ? dynamic_cast<const MeshletData*>(userData) : 0;
+        if (meshletData) addMeshlets(drawable,*meshletData,&matrix,depth);
+        else addDrawableAndDepth(&drawable,&matrix,depth);
     }
 
     for(unsigned int i=0;i< numPopStateSetRequired; ++i)
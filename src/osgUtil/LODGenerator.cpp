@@ -0,0 +1,296 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osg/PagedLOD>
+#include <osg/TriangleIndexFunctor>
+#include <osg/Notify>
+
+#include <osgUtil/LODGenerator>
+#include <osgUtil/MeshOptimizers>
+#include <osgUtil/Simplifier>
+
+#include <map>
+#include <set>
+#include <sstream>
+#include <float.h>
+
+using namespace osgUtil;
+
+namespace
+{
+
+struct CountTrianglesOperator
+{
+    CountTrianglesOperator(): _numTriangles(0) {}
+
+    unsigned int _numTriangles;
+
+    inline void operator()(unsigned int p1, unsigned int p2, unsigned int p3)
+    {
+        if (p1!=p2 && p2!=p3 && p1!=p3) ++_numTriangles;
+    }
+};
+
+unsigned int countTriangles(osg::Geometry& geometry)
+{
+    osg::TriangleIndexFunctor<CountTrianglesOperator> counter;
+    geometry.accept(counter);
+    return counter._numTriangles;
+}
+
+// Record the largest error of the collapses the Simplifier has been permitted to make.
+class RecordErrorCallback : public Simplifier::ContinueSimplificationCallback
+{
+    public:
+
+        RecordErrorCallback(): _maximumError(0.0f) {}
+
+        virtual bool continueSimplification(const Simplifier& simplifier, float nextError, unsigned int numOriginalPrimitives, unsigned int numRemainingPrimitives) const
+        {
+            if (!simplifier.continueSimplificationImplementation(nextError, numOriginalPrimitives, numRemainingPrimitives)) return false;
+
+            _maximumError = osg::maximum(_maximumError, nextError);
+            return true;
+        }
+
+        mutable float _maximumError;
+
+    protected:
+
+        virtual ~RecordErrorCallback() {}
+};
+
+typedef std::map<osg::Geometry*, LODGenerator::LevelChain> LevelChainMap;
+
+struct CreateLevelChainFunctor : public GeometryCollector::GeometryFunctor
+{
+    CreateLevelChainFunctor(const LODGenerator& generator, LevelChainMap& chains) : _generator(generator), _chains(chains) {}
+
+    // the map is fully populated before the functor is run, so the threads only ever look entries up.
+    virtual void operator () (osg::Geometry& geometry) { _generator.createLevelChain(geometry, _chains.find(&geometry)->second); }
+
+    const LODGenerator& _generator;
+    LevelChainMap& _chains;
+
+protected:
+
+    CreateLevelChainFunctor& operator = (const CreateLevelChainFunctor&) { return *this; }
+};
+
+}
+
+LODGenerator::LODGenerator():
+    osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+    _numLevels(4),
+    _levelSampleRatio(0.5f),
+    _minimumNumTriangles(32),
+    _maximumPixelError(1.0f),
+    _numThreads(1),
+    _pagedLODFileNameExtension("osgb")
+{
+}
+
+void LODGenerator::reset()
+{
+    _geodeList.clear();
+    _pagedLevelList.clear();
+}
+
+void LODGenerator::apply(osg::Node& node)
+{
+    traverse(node);
+
+    if (_nodePath.size()==1) generateLODs();
+}
+
+void LODGenerator::apply(osg::Geode& geode)
+{
+    if (_nodePath.size()==1)
+    {
+        OSG_NOTICE<<"Warning: LODGenerator can't replace the Geode the traversal started from, traverse from its parent."<<std::endl;
+        return;
+    }
+
+    _geodeList.push_back(&geode);
+}
+
+void LODGenerator::createLevelChain(osg::Geometry& geometry, LevelChain& chain) const
+{
+    chain.levels.push_back(&geometry);
+    chain.errors.push_back(0.0f);
+
+    unsigned int numTriangles = countTriangles(geometry);
+    float error = 0.0f;
+
+    for(unsigned int level=1; level<_numLevels && numTriangles>_minimumNumTriangles; ++level)
+    {
+        osg::ref_ptr<osg::Geometry> simplified = new osg::Geometry(*chain.levels.back(), osg::CopyOp::DEEP_COPY_ARRAYS | osg::CopyOp::DEEP_COPY_PRIMITIVES);
+
+        // any data built for the original mesh, such as meshlets, doesn't apply to the simplified one.
+        simplified->setUserDataContainer(0);
+
+        osg::ref_ptr<RecordErrorCallback> recordError = new RecordErrorCallback;
+
+        // the quadric error is a distance from the original surface, which is what the switching ranges are computed from.
+        Simplifier simplifier(_levelSampleRatio);
+        simplifier.setMethod(Simplifier::QUADRIC_EDGE_COLLAPSE);
+        simplifier.setSmoothing(false);
+        simplifier.setDoTriStrip(false);
+        simplifier.setContinueSimplificationCallback(recordError.get());
+        simplifier.simplify(*simplified);
+
+        // stop once simplification no longer makes worthwhile progress.
+        unsigned int numSimplifiedTriangles = countTriangles(*simplified);
+        if (numSimplifiedTriangles==0 || numSimplifiedTriangles>numTriangles*0.9f) break;
+
+        // each level is simplified from the last so their errors accumulate.
+        error += recordError->_maximumError;
+
+        chain.levels.push_back(simplified);
+        chain.errors.push_back(error);
+        numTriangles = numSimplifiedTriangles;
+    }
+}
+
+void LODGenerator::generateLODs()
+{
+    if (_geodeList.empty()) return;
+
+    // remove Geodes visited more than once through shared parents, keeping the traversal order.
+    GeodeList geodes;
+    std::set<osg::Geode*> uniqueGeodes;
+    for(GeodeList::iterator itr = _geodeList.begin();
+        itr != _geodeList.end();
+        ++itr)
+    {
+        if (uniqueGeodes.insert(itr->get()).second) geodes.push_back(*itr);
+    }
+    _geodeList.clear();
+
+    // build the level chains of all the geometries up front so they can be spread across threads.
+    LevelChainMap chains;
+    GeometryCollector collector(0, Optimizer::ALL_OPTIMIZATIONS);
+    collector.setNumThreads(_numThreads);
+    for(GeodeList::iterator itr = geodes.begin();
+        itr != geodes.end();
+        ++itr)
+    {
+        osg::Geode* geode = itr->get();
+        for(unsigned int i=0; i<geode->getNumDrawables(); ++i)
+        {
+            osg::Geometry* geometry = geode->getDrawable(i)->asGeometry();
+            if (geometry)
+            {
+                chains[geometry];
+                collector.getGeometryList().insert(geometry);
+            }
+        }
+    }
+
+    CreateLevelChainFunctor functor(*this, chains);
+    collector.processGeometryList(functor);
+
+    unsigned int geodeNum = 0;
+    for(GeodeList::iterator itr = geodes.begin();
+        itr != geodes.end();
+        ++itr, ++geodeNum)
+    {
+        osg::Geode* geode = itr->get();
+
+        unsigned int numLevels = 1;
+        for(unsigned int i=0; i<geode->getNumDrawables(); ++i)
+        {
+            osg::Geometry* geometry = geode->getDrawable(i)->asGeometry();
+            if (geometry) numLevels = osg::maximum(numLevels, static_cast<unsigned int>(chains[geometry].levels.size()));
+        }
+        if (numLevels<2) continue;
+
+        // a level's error is the largest of its geometries, with those that ran out of levels using their coarsest.
+        std::vector< osg::ref_ptr<osg::Geode> > levels;
+        std::vector<float> errors(numLevels, 0.0f);
+        for(unsigned int level=0; level<numLevels; ++level)
+        {
+            osg::ref_ptr<osg::Geode> levelGeode = new osg::Geode(*geode, osg::CopyOp::SHALLOW_COPY);
+            levelGeode->removeDrawables(0, levelGeode->getNumDrawables());
+            for(unsigned int i=0; i<geode->getNumDrawables(); ++i)
+            {
+                osg::Drawable* drawable = geode->getDrawable(i);
+                osg::Geometry* geometry = drawable->asGeometry();
+                if (geometry)
+                {
+                    const LevelChain& chain = chains[geometry];
+                    unsigned int chainLevel = osg::minimum(level, static_cast<unsigned int>(chain.levels.size())-1);
+                    levelGeode->addDrawable(chain.levels[chainLevel].get());
+                    errors[level] = osg::maximum(errors[level], chain.errors[chainLevel]);
+                }
+                else
+                {
+                    levelGeode->addDrawable(drawable);
+                }
+            }
+            levels.push_back(levelGeode);
+        }
+
+        // switch to level i once the pixel size of the bound's radius drops below the size at which
+        // its error projects to the maximum pixel error.
+        const osg::BoundingSphere& bs = geode->getBound();
+        std::vector<float> switchPixelSizes(numLevels+1, 0.0f);
+        switchPixelSizes[0] = FLT_MAX;
+        for(unsigned int level=1; level<numLevels; ++level)
+        {
+            float error = osg::maximum(errors[level], bs.radius()*1e-6f);
+            switchPixelSizes[level] = osg::minimum(switchPixelSizes[level-1], _maximumPixelError*bs.radius()/error);
+        }
+
+        // children are ordered from the coarsest level to the original, as PagedLOD loads them in turn.
+        osg::ref_ptr<osg::LOD> lod;
+        if (_pagedLODFileNamePrefix.empty())
+        {
+            lod = new osg::LOD;
+            for(unsigned int level=numLevels; level>0; --level)
+            {
+                lod->addChild(levels[level-1].get(), switchPixelSizes[level], switchPixelSizes[level-1]);
+            }
+        }
+        else
+        {
+            osg::ref_ptr<osg::PagedLOD> pagedLOD = new osg::PagedLOD;
+            pagedLOD->setCenter(bs.center());
+            pagedLOD->setRadius(bs.radius());
+            pagedLOD->addChild(levels[numLevels-1].get(), switchPixelSizes[numLevels], switchPixelSizes[numLevels-1]);
+            for(unsigned int level=numLevels-1; level>0; --level)
+            {
+                std::ostringstream fileName;
+                fileName<<_pagedLODFileNamePrefix<<"_"<<geodeNum<<"_L"<<(level-1)<<"."<<_pagedLODFileNameExtension;
+
+                unsigned int childNo = numLevels-level;
+                pagedLOD->setFileName(childNo, fileName.str());
+                pagedLOD->setRange(childNo, switchPixelSizes[level], switchPixelSizes[level-1]);
+
+                _pagedLevelList.push_back(PagedLevel(fileName.str(), levels[level-1].get()));
+            }
+            lod = pagedLOD;
+        }
+
+        lod->setName(geode->getName());
+        lod->setRangeMode(osg::LOD::PIXEL_SIZE_ON_SCREEN);
+
+        osg::Node::ParentList parents = geode->getParents();
+        for(osg::Node::ParentList::iterator pitr = parents.begin();
+            pitr != parents.end();
+            ++pitr)
+        {
+            (*pitr)->replaceChild(geode, lod.get());
+        }
+    }
+}
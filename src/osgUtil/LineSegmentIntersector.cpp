@@ -329,55 +329,7 @@ void LineSegmentIntersector::intersect(osgUtil::IntersectionVisitor& iv, osg::Dr
         intersections.reserve(4);
         if (kdTree->intersect(s,e,intersections))
         {
-            // OSG_NOTICE<<"Got KdTree intersections"<<std::endl;
-            for(osg::KdTree::LineSegmentIntersections::iterator itr = intersections.begin();
-                itr != intersections.end();
-                ++itr)
-            {
-                osg::KdTree::LineSegmentIntersection& lsi = *(itr);
-
-                // get ratio in s,e range
-                double ratio = lsi.ratio;
-
-                // remap ratio into _start, _end range
-                double remap_ratio = ((s-_start).length() + ratio * (e-s).length() )/(_end-_start).length();
-
-
-                Intersection hit;
-                hit.ratio = remap_ratio;
-                hit.matrix = iv.getModelMatrix();
-                hit.nodePath = iv.getNodePath();
-                hit.drawable = drawable;
-                hit.primitiveIndex = lsi.primitiveIndex;
-
-                hit.localIntersectionPoint = _start*(1.0-remap_ratio) + _end*remap_ratio;
-
-                // OSG_NOTICE<<"KdTree: ratio="<<hit.ratio<<" ("<<hit.localIntersectionPoint<<")"<<std::endl;
-
-                hit.localIntersectionNormal = lsi.intersectionNormal;
-
-                hit.indexList.reserve(3);
-                hit.ratioList.reserve(3);
-                if (lsi.r0!=0.0f)
-                {
-                    hit.indexList.push_back(lsi.p0);
-                    hit.ratioList.push_back(lsi.r0);
-                }
-
-                if (lsi.r1!=0.0f)
-                {
-                    hit.indexList.push_back(lsi.p1);
-                    hit.ratioList.push_back(lsi.r1);
-                }
-
-                if (lsi.r2!=0.0f)
-                {
-                    hit.indexList.push_back(lsi.p2);
-                    hit.ratioList.push_back(lsi.r2);
-                }
-
-                insertIntersection(hit);
-            }
+            insertIntersections(iv, drawable, s, e, intersections);
         }
 
         return;
@@ -476,6 +428,60 @@ void LineSegmentIntersector::intersect(osgUtil::IntersectionVisitor& iv, osg::Dr
     }
 }
 
+void LineSegmentIntersector::insertIntersections(osgUtil::IntersectionVisitor& iv, osg::Drawable* drawable,
+                                                 const osg::Vec3d& s, const osg::Vec3d& e,
+                                                 const osg::KdTree::LineSegmentIntersections& intersections)
+{
+    for(osg::KdTree::LineSegmentIntersections::const_iterator itr = intersections.begin();
+        itr != intersections.end();
+        ++itr)
+    {
+        const osg::KdTree::LineSegmentIntersection& lsi = *(itr);
+
+        // get ratio in s,e range
+        double ratio = lsi.ratio;
+
+        // remap ratio into _start, _end range
+        double remap_ratio = ((s-_start).length() + ratio * (e-s).length() )/(_end-_start).length();
+
+
+        Intersection hit;
+        hit.ratio = remap_ratio;
+        hit.matrix = iv.getModelMatrix();
+        hit.nodePath = iv.getNodePath();
+        hit.drawable = drawable;
+        hit.primitiveIndex = lsi.primitiveIndex;
+
+        hit.localIntersectionPoint = _start*(1.0-remap_ratio) + _end*remap_ratio;
+
+        // OSG_NOTICE<<"KdTree: ratio="<<hit.ratio<<" ("<<hit.localIntersectionPoint<<")"<<std::endl;
+
+        hit.localIntersectionNormal = lsi.intersectionNormal;
+
+        hit.indexList.reserve(3);
+        hit.ratioList.reserve(3);
+        if (lsi.r0!=0.0f)
+        {
+            hit.indexList.push_back(lsi.p0);
+            hit.ratioList.push_back(lsi.r0);
+        }
+
+        if (lsi.r1!=0.0f)
+        {
+            hit.indexList.push_back(lsi.p1);
+            hit.ratioList.push_back(lsi.r1);
+        }
+
+        if (lsi.r2!=0.0f)
+        {
+            hit.indexList.push_back(lsi.p2);
+            hit.ratioList.push_back(lsi.r2);
+        }
+
+        insertIntersection(hit);
+    }
+}
+
 void LineSegmentIntersector::reset()
 {
     Intersector::reset();
@@ -0,0 +1,244 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgUtil/LineSegmentPacketIntersector>
+
+#include <osg/KdTree>
+#include <osg/Notify>
+
+#include <typeinfo>
+
+using namespace osgUtil;
+
+LineSegmentPacketIntersector::LineSegmentPacketIntersector()
+{
+}
+
+LineSegmentIntersector* LineSegmentPacketIntersector::addLineSegment(const osg::Vec3d& start, const osg::Vec3d& end)
+{
+    LineSegmentIntersector* intersector = new LineSegmentIntersector(start, end);
+    addIntersector(intersector);
+    return intersector;
+}
+
+void LineSegmentPacketIntersector::addIntersector(Intersector* intersector)
+{
+    IntersectorGroup::addIntersector(intersector);
+
+    // intersectors added through the IntersectorGroup interface leave the arrays out of step, so rebuild them in full.
+    if (_lineSegmentIntersectors.size()+1==_intersectors.size()) appendSegment(intersector);
+    else updateSegmentArrays();
+}
+
+Intersector* LineSegmentPacketIntersector::clone(osgUtil::IntersectionVisitor& iv)
+{
+    LineSegmentPacketIntersector* packet = new LineSegmentPacketIntersector;
+
+    // now copy across all intersectors that arn't disabled.
+    for(Intersectors::iterator itr = _intersectors.begin();
+        itr != _intersectors.end();
+        ++itr)
+    {
+        if (!(*itr)->disabled())
+        {
+            packet->addIntersector( (*itr)->clone(iv) );
+        }
+    }
+
+    return packet;
+}
+
+void LineSegmentPacketIntersector::reset()
+{
+    IntersectorGroup::reset();
+
+    // the segments may have been changed since they were last gathered.
+    updateSegmentArrays();
+}
+
+void LineSegmentPacketIntersector::updateSegmentArrays()
+{
+    _lineSegmentIntersectors.clear();
+    _startX.clear();
+    _startY.clear();
+    _startZ.clear();
+    _deltaX.clear();
+    _deltaY.clear();
+    _deltaZ.clear();
+    _passed.clear();
+
+    for(Intersectors::iterator itr = _intersectors.begin();
+        itr != _intersectors.end();
+        ++itr)
+    {
+        appendSegment(itr->get());
+    }
+}
+
+void LineSegmentPacketIntersector::appendSegment(Intersector* intersector)
+{
+    // only batch the tests of plain LineSegmentIntersectors, subclasses may override enter() or intersect().
+    LineSegmentIntersector* lsi = (typeid(*intersector)==typeid(LineSegmentIntersector)) ? static_cast<LineSegmentIntersector*>(intersector) : 0;
+    _lineSegmentIntersectors.push_back(lsi);
+
+    osg::Vec3d start = lsi ? lsi->getStart() : osg::Vec3d();
+    osg::Vec3d delta = lsi ? lsi->getEnd()-lsi->getStart() : osg::Vec3d();
+    _startX.push_back(start.x());
+    _startY.push_back(start.y());
+    _startZ.push_back(start.z());
+    _deltaX.push_back(delta.x());
+    _deltaY.push_back(delta.y());
+    _deltaZ.push_back(delta.z());
+    _passed.push_back(0);
+}
+
+void LineSegmentPacketIntersector::intersectBoundingSphere(const osg::BoundingSphere& bs)
+{
+    // same tests as LineSegmentIntersector::intersects(), done for all segments in one loop over
+    // the arrays of start points and directions so the compiler is free to vectorize it.
+    unsigned int numSegments = _passed.size();
+    double cx = bs._center.x();
+    double cy = bs._center.y();
+    double cz = bs._center.z();
+    double radius2 = bs._radius*bs._radius;
+
+    for(unsigned int i=0; i<numSegments; ++i)
+    {
+        double smx = _startX[i]-cx;
+        double smy = _startY[i]-cy;
+        double smz = _startZ[i]-cz;
+        double c = smx*smx + smy*smy + smz*smz - radius2;
+
+        double a = _deltaX[i]*_deltaX[i] + _deltaY[i]*_deltaY[i] + _deltaZ[i]*_deltaZ[i];
+        double b = (smx*_deltaX[i] + smy*_deltaY[i] + smz*_deltaZ[i])*2.0;
+        double d = b*b-4.0*a*c;
+
+        double sqrt_d = sqrt(d>0.0 ? d : 0.0);
+        double div = 1.0/(2.0*a);
+        double r1 = (-b-sqrt_d)*div;
+        double r2 = (-b+sqrt_d)*div;
+
+        bool startInside = c<0.0;
+        bool missed = d<0.0 || (r1<=0.0 && r2<=0.0) || (r1>=1.0 && r2>=1.0);
+        _passed[i] = (startInside || !missed) ? 1 : 0;
+    }
+}
+
+bool LineSegmentPacketIntersector::enter(const osg::Node& node)
+{
+    if (disabled()) return false;
+
+    // intersectors added through the IntersectorGroup interface bypass addIntersector().
+    if (_lineSegmentIntersectors.size()!=_intersectors.size()) updateSegmentArrays();
+
+    const osg::BoundingSphere& bs = node.getBound();
+    bool testBound = node.isCullingActive() && bs.valid();
+    if (testBound) intersectBoundingSphere(bs);
+
+    bool foundIntersections = false;
+
+    for(unsigned int i=0; i<_intersectors.size(); ++i)
+    {
+        Intersector* intersector = _intersectors[i].get();
+        LineSegmentIntersector* lsi = _lineSegmentIntersectors[i];
+
+        bool entered = false;
+        if (intersector->disabled())
+        {
+            entered = false;
+        }
+        else if (lsi && lsi->getIntersectionLimit()!=LIMIT_ONE && lsi->getIntersectionLimit()!=LIMIT_NEAREST)
+        {
+            // without a limit that depends upon previous hits the result of LineSegmentIntersector::enter()
+            // is just the bounding sphere test that has already been done above.
+            entered = !testBound || _passed[i]!=0;
+        }
+        else
+        {
+            entered = intersector->enter(node);
+        }
+
+        if (entered) foundIntersections = true;
+        else intersector->incrementDisabledCount();
+    }
+
+    if (!foundIntersections)
+    {
+        // need to call leave to clean up the DisabledCount's.
+        leave();
+        return false;
+    }
+
+    // we have found at least one suitable intersector, so return true
+    return true;
+}
+
+void LineSegmentPacketIntersector::intersect(osgUtil::IntersectionVisitor& iv, osg::Drawable* drawable)
+{
+    if (disabled()) return;
+
+    osg::KdTree* kdTree = iv.getUseKdTreeWhenAvailable() ? dynamic_cast<osg::KdTree*>(drawable->getShape()) : 0;
+    if (!kdTree)
+    {
+        IntersectorGroup::intersect(iv, drawable);
+        return;
+    }
+
+    // intersectors added through the IntersectorGroup interface bypass addIntersector().
+    if (_lineSegmentIntersectors.size()!=_intersectors.size()) updateSegmentArrays();
+
+    _kdTreeSegments.clear();
+    _kdTreeSegmentIntersectors.clear();
+
+    for(unsigned int i=0; i<_intersectors.size(); ++i)
+    {
+        Intersector* intersector = _intersectors[i].get();
+        if (intersector->disabled()) continue;
+
+        LineSegmentIntersector* lsi = _lineSegmentIntersectors[i];
+        if (!lsi)
+        {
+            intersector->intersect(iv, drawable);
+            continue;
+        }
+
+        if (lsi->reachedLimit()) continue;
+
+        osg::Vec3d s(lsi->getStart()), e(lsi->getEnd());
+        if ( !lsi->intersectAndClip( s, e, drawable->getBoundingBox() ) ) continue;
+
+        if (iv.getDoDummyTraversal()) continue;
+
+        _kdTreeSegments.push_back(osg::KdTree::Segment(s,e));
+        _kdTreeSegmentIntersectors.push_back(i);
+    }
+
+    if (_kdTreeSegments.empty()) return;
+
+    // reuse the intersection lists from previous drawables to avoid reallocating them.
+    if (_kdTreeIntersections.size()<_kdTreeSegments.size()) _kdTreeIntersections.resize(_kdTreeSegments.size());
+    for(unsigned int i=0; i<_kdTreeSegments.size(); ++i)
+    {
+        _kdTreeIntersections[i].clear();
+    }
+
+    if (!kdTree->intersect(_kdTreeSegments, _kdTreeIntersections)) return;
+
+    for(unsigned int i=0; i<_kdTreeSegments.size(); ++i)
+    {
+        if (_kdTreeIntersections[i].empty()) continue;
+
+        LineSegmentIntersector* lsi = _lineSegmentIntersectors[_kdTreeSegmentIntersectors[i]];
+        lsi->insertIntersections(iv, drawable, _kdTreeSegments[i].start, _kdTreeSegments[i].end, _kdTreeIntersections[i]);
+    }
+}
@@ -16,16 +16,24 @@
 #include <limits>
 
 #include <algorithm>
+#include <map>
 #include <vector>
 
 #include <iostream>
 
+#include <osg/CullFace>
+#include <osg/FrontFace>
+#include <osg/GLExtensions>
 #include <osg/Geometry>
 #include <osg/Math>
 #include <osg/PrimitiveSet>
+#include <osg/State>
 #include <osg/TriangleIndexFunctor>
 #include <osg/TriangleLinePointIndexFunctor>
 
+#include <OpenThreads/Thread>
+#include <OpenThreads/Atomic>
+
 #include <osgUtil/MeshOptimizers>
 
 using namespace osg;
@@ -47,6 +55,167 @@ void GeometryCollector::apply(Geode& geode)
     }
 }
 
+namespace
+{
+typedef std::vector<const osg::Object*> SharableDataList;
+
+void addSharableData(const osg::BufferData* data, SharableDataList& dataList)
+{
+    if (!data) return;
+    dataList.push_back(data);
+    if (data->getBufferObject()) dataList.push_back(data->getBufferObject());
+}
+
+// Gather the objects a Geometry may share with other geometries and
+// that the per Geometry passes can modify or replace.
+void collectSharableData(const osg::Geometry& geom, SharableDataList& dataList)
+{
+    addSharableData(geom.getVertexArray(), dataList);
+    addSharableData(geom.getNormalArray(), dataList);
+    addSharableData(geom.getColorArray(), dataList);
+    addSharableData(geom.getSecondaryColorArray(), dataList);
+    addSharableData(geom.getFogCoordArray(), dataList);
+    for(unsigned int i = 0; i < geom.getNumTexCoordArrays(); ++i)
+    {
+        addSharableData(geom.getTexCoordArray(i), dataList);
+    }
+    for(unsigned int i = 0; i < geom.getNumVertexAttribArrays(); ++i)
+    {
+        addSharableData(geom.getVertexAttribArray(i), dataList);
+    }
+    for(unsigned int i = 0; i < geom.getNumPrimitiveSets(); ++i)
+    {
+        addSharableData(geom.getPrimitiveSet(i), dataList);
+    }
+}
+
+typedef std::vector<osg::Geometry*> GeometryVector;
+
+// Apply the functor to geometries taken from the shared list until none are left.
+void processGeometries(GeometryCollector::GeometryFunctor& functor,
+                       const GeometryVector& geometries,
+                       OpenThreads::Atomic& nextGeometry)
+{
+    for(unsigned int i = (++nextGeometry)-1; i < geometries.size(); i = (++nextGeometry)-1)
+    {
+        functor(*geometries[i]);
+    }
+}
+
+struct ProcessGeometryThread : public OpenThreads::Thread
+{
+    ProcessGeometryThread(GeometryCollector::GeometryFunctor& functor,
+                          const GeometryVector& geometries,
+                          OpenThreads::Atomic& nextGeometry)
+        : _functor(functor), _geometries(geometries), _nextGeometry(nextGeometry) {}
+
+    virtual void run()
+    {
+        processGeometries(_functor, _geometries, _nextGeometry);
+    }
+
+    GeometryCollector::GeometryFunctor& _functor;
+    const GeometryVector&               _geometries;
+    OpenThreads::Atomic&                _nextGeometry;
+
+protected:
+    ProcessGeometryThread& operator = (const ProcessGeometryThread&) { return *this; }
+};
+}
+
+void GeometryCollector::processGeometryList(GeometryFunctor& functor)
+{
+    if (_numThreads <= 1 || _geometryList.size() < 2)
+    {
+        for(GeometryList::iterator itr = _geometryList.begin();
+            itr != _geometryList.end();
+            ++itr)
+        {
+            functor(*(*itr));
+        }
+        return;
+    }
+
+    // count how many of the collected geometries reference each array,
+    // primitive set and buffer object.
+    typedef std::map<const osg::Object*, unsigned int> ReferenceCountMap;
+    ReferenceCountMap referenceCounts;
+    std::vector<SharableDataList> geometryData(_geometryList.size());
+    unsigned int index = 0;
+    for(GeometryList::iterator itr = _geometryList.begin();
+        itr != _geometryList.end();
+        ++itr, ++index)
+    {
+        collectSharableData(*(*itr), geometryData[index]);
+        for(SharableDataList::iterator ditr = geometryData[index].begin();
+            ditr != geometryData[index].end();
+            ++ditr)
+        {
+            ++referenceCounts[*ditr];
+        }
+    }
+
+    GeometryVector independent;
+    GeometryVector shared;
+    index = 0;
+    for(GeometryList::iterator itr = _geometryList.begin();
+        itr != _geometryList.end();
+        ++itr, ++index)
+    {
+        bool isShared = false;
+        for(SharableDataList::iterator ditr = geometryData[index].begin();
+            ditr != geometryData[index].end() && !isShared;
+            ++ditr)
+        {
+            isShared = referenceCounts[*ditr] > 1;
+        }
+
+        if (isShared)
+        {
+            shared.push_back(*itr);
+        }
+        else
+        {
+            // dirty the bound up front so that the passes dirtying it
+            // again don't reach the parents the geometries have in common.
+            (*itr)->dirtyBound();
+            independent.push_back(*itr);
+        }
+    }
+
+    if (!independent.empty())
+    {
+        OpenThreads::Atomic nextGeometry;
+
+        typedef std::vector<ProcessGeometryThread*> Threads;
+        Threads threads;
+        unsigned int numThreads = osg::minimum(_numThreads, static_cast<unsigned int>(independent.size()));
+        for(unsigned int i = 1; i < numThreads; ++i)
+        {
+            threads.push_back(new ProcessGeometryThread(functor, independent, nextGeometry));
+            threads.back()->start();
+        }
+
+        // the calling thread takes its share of the geometries too.
+        processGeometries(functor, independent, nextGeometry);
+
+        for(Threads::iterator itr = threads.begin();
+            itr != threads.end();
+            ++itr)
+        {
+            (*itr)->join();
+            delete *itr;
+        }
+    }
+
+    for(GeometryVector::iterator itr = shared.begin();
+        itr != shared.end();
+        ++itr)
+    {
+        functor(*(*itr));
+    }
+}
+
 namespace
 {
 typedef std::vector<unsigned int> IndexList;
@@ -392,14 +561,20 @@ void IndexMeshVisitor::makeMesh(Geometry& geom)
     geom.setPrimitiveSetList(new_primitives);
 }
 
+namespace
+{
+struct MakeMeshFunctor : public GeometryCollector::GeometryFunctor
+{
+    MakeMeshFunctor(IndexMeshVisitor& visitor) : _visitor(visitor) {}
+    virtual void operator () (osg::Geometry& geom) { _visitor.makeMesh(geom); }
+    IndexMeshVisitor& _visitor;
+};
+}
+
 void IndexMeshVisitor::makeMesh()
 {
-    for(GeometryList::iterator itr=_geometryList.begin();
-        itr!=_geometryList.end();
-        ++itr)
-    {
-        makeMesh(*(*itr));
-    }
+    MakeMeshFunctor functor(*this);
+    processGeometryList(functor);
 }
 
 namespace
@@ -869,14 +1044,20 @@ void VertexCacheVisitor::doVertexOptimization(Geometry& geom,
      }
 }
 
+namespace
+{
+struct OptimizeVerticesFunctor : public GeometryCollector::GeometryFunctor
+{
+    OptimizeVerticesFunctor(VertexCacheVisitor& visitor) : _visitor(visitor) {}
+    virtual void operator () (osg::Geometry& geom) { _visitor.optimizeVertices(geom); }
+    VertexCacheVisitor& _visitor;
+};
+}
+
 void VertexCacheVisitor::optimizeVertices()
 {
-    for(GeometryList::iterator itr=_geometryList.begin();
-        itr!=_geometryList.end();
-        ++itr)
-    {
-        optimizeVertices(*(*itr));
-    }
+    OptimizeVerticesFunctor functor(*this);
+    processGeometryList(functor);
 }
 
 VertexCacheMissVisitor::VertexCacheMissVisitor(unsigned cacheSize)
@@ -1103,14 +1284,20 @@ struct VertexReorder : public TriangleLinePointIndexFunctor<osgUtil::VertexReord
 };
 }
 
+namespace
+{
+struct OptimizeOrderFunctor : public GeometryCollector::GeometryFunctor
+{
+    OptimizeOrderFunctor(VertexAccessOrderVisitor& visitor) : _visitor(visitor) {}
+    virtual void operator () (osg::Geometry& geom) { _visitor.optimizeOrder(geom); }
+    VertexAccessOrderVisitor& _visitor;
+};
+}
+
 void VertexAccessOrderVisitor::optimizeOrder()
 {
-    for (GeometryList::iterator itr = _geometryList.begin(), end = _geometryList.end();
-         itr != end;
-         ++itr)
-    {
-        optimizeOrder(*(*itr));
-    }
+    OptimizeOrderFunctor functor(*this);
+    processGeometryList(functor);
 }
 
 template<typename DE>
@@ -1189,6 +1376,331 @@ void VertexAccessOrderVisitor::optimizeOrder(Geometry& geom)
     geom.dirtyDisplayList();
 }
 
+namespace
+{
+struct MeshletTriangleOperator
+{
+    std::vector<unsigned> _indices;
+
+    void operator() (unsigned int p1, unsigned int p2, unsigned int p3)
+    {
+        if (p1==p2 || p2==p3 || p1==p3) return;
+        _indices.push_back(p1);
+        _indices.push_back(p2);
+        _indices.push_back(p3);
+    }
+};
+typedef osg::TriangleIndexFunctor<MeshletTriangleOperator> MeshletTriangleIndexFunctor;
+
+bool isTriangleMode(GLenum mode)
+{
+    switch(mode)
+    {
+        case(GL_TRIANGLES):
+        case(GL_TRIANGLE_STRIP):
+        case(GL_TRIANGLE_FAN):
+        case(GL_QUADS):
+        case(GL_QUAD_STRIP):
+        case(GL_POLYGON):
+            return true;
+        default:
+            return false;
+    }
+}
+
+void shareArrays(const Geometry& geom, Geometry& meshlet)
+{
+    meshlet.setVertexArray(const_cast<Array*>(geom.getVertexArray()));
+    meshlet.setNormalArray(const_cast<Array*>(geom.getNormalArray()));
+    meshlet.setColorArray(const_cast<Array*>(geom.getColorArray()));
+    meshlet.setSecondaryColorArray(const_cast<Array*>(geom.getSecondaryColorArray()));
+    meshlet.setFogCoordArray(const_cast<Array*>(geom.getFogCoordArray()));
+    for(unsigned int unit=0; unit<geom.getNumTexCoordArrays(); ++unit)
+    {
+        meshlet.setTexCoordArray(unit, const_cast<Array*>(geom.getTexCoordArray(unit)));
+    }
+    for(unsigned int index=0; index<geom.getNumVertexAttribArrays(); ++index)
+    {
+        meshlet.setVertexAttribArray(index, const_cast<Array*>(geom.getVertexAttribArray(index)));
+    }
+    meshlet.setUseDisplayList(geom.getUseDisplayList());
+    meshlet.setUseVertexBufferObjects(geom.getUseVertexBufferObjects());
+}
+
+template<class DE>
+void addIndices(DE& drawElements, const std::vector<unsigned>& indices)
+{
+    drawElements.reserve(indices.size());
+    for(std::vector<unsigned>::const_iterator itr = indices.begin();
+        itr != indices.end();
+        ++itr)
+    {
+        drawElements.push_back(static_cast<typename DE::value_type>(*itr));
+    }
+}
+
+void addMeshlet(const Vec3Array& vertices,
+                const std::vector<unsigned>& indices, unsigned int begin, unsigned int end,
+                const std::vector<unsigned>& meshletVertices, MeshletData& meshletData)
+{
+    MeshletData::Meshlet meshlet;
+    meshlet.first = begin;
+    meshlet.count = end-begin;
+
+    BoundingBox bb;
+    for(std::vector<unsigned>::const_iterator itr = meshletVertices.begin();
+        itr != meshletVertices.end();
+        ++itr)
+    {
+        bb.expandBy(vertices[*itr]);
+    }
+    float radius2 = 0.0f;
+    for(std::vector<unsigned>::const_iterator itr = meshletVertices.begin();
+        itr != meshletVertices.end();
+        ++itr)
+    {
+        radius2 = osg::maximum(radius2, (vertices[*itr]-bb.center()).length2());
+    }
+    meshlet.bound.set(bb.center(), sqrtf(radius2));
+
+    // the normal cone is only worth keeping if it is narrower than a
+    // hemisphere, otherwise leave the cutoff at 1 so it is never culled.
+    std::vector<Vec3> normals;
+    normals.reserve((end-begin)/3);
+    Vec3 axis;
+    for(unsigned int i=begin; i<end; i+=3)
+    {
+        const Vec3& v0 = vertices[indices[i]];
+        Vec3 normal = (vertices[indices[i+1]]-v0)^(vertices[indices[i+2]]-v0);
+        if (normal.normalize()>0.0f)
+        {
+            normals.push_back(normal);
+            axis += normal;
+        }
+    }
+    if (!normals.empty() && axis.normalize()>0.0f)
+    {
+        float minDot = 1.0f;
+        for(std::vector<Vec3>::const_iterator itr = normals.begin();
+            itr != normals.end();
+            ++itr)
+        {
+            minDot = osg::minimum(minDot, (*itr)*axis);
+        }
+        if (minDot>0.0f)
+        {
+            meshlet.coneAxis = axis;
+            meshlet.coneCutoff = sqrtf(1.0f-minDot*minDot);
+        }
+    }
+
+    meshletData.getMeshletList().push_back(meshlet);
+}
+
+// back faces are only known to be culled when the Geometry's own StateSet
+// turns on a CullFace of back faces with counter clockwise front faces.
+bool cullsBackFaces(const Geometry& geom)
+{
+    const StateSet* stateset = geom.getStateSet();
+    if (!stateset || !(stateset->getMode(GL_CULL_FACE) & StateAttribute::ON)) return false;
+
+    const CullFace* cullFace = dynamic_cast<const CullFace*>(stateset->getAttribute(StateAttribute::CULLFACE));
+    if (!cullFace || cullFace->getMode()!=CullFace::BACK) return false;
+
+    const FrontFace* frontFace = dynamic_cast<const FrontFace*>(stateset->getAttribute(StateAttribute::FRONTFACE));
+    return !frontFace || frontFace->getMode()==FrontFace::COUNTER_CLOCKWISE;
+}
+
+struct BuildMeshletsFunctor : public GeometryCollector::GeometryFunctor
+{
+    BuildMeshletsFunctor(MeshletVisitor& visitor) : _visitor(visitor) {}
+    virtual void operator () (osg::Geometry& geom) { _visitor.buildMeshlets(geom); }
+    MeshletVisitor& _visitor;
+};
+}
+
+void MeshletVisitor::buildMeshlets(Geometry& geom)
+{
+    if (_maximumNumVertices<3 || _maximumNumTriangles==0) return;
+
+    // leave user data attached by the application alone
+    if (geom.getUserData() && !dynamic_cast<MeshletData*>(geom.getUserData())) return;
+
+    // meshlets would bypass a draw callback
+    if (geom.getDrawCallback()) return;
+
+    if (geom.containsDeprecatedData()) return;
+
+    Vec3Array* vertices = dynamic_cast<Vec3Array*>(geom.getVertexArray());
+    if (!vertices || vertices->empty()) return;
+
+    if (osg::getBinding(geom.getNormalArray())==osg::Array::BIND_PER_PRIMITIVE_SET) return;
+    if (osg::getBinding(geom.getColorArray())==osg::Array::BIND_PER_PRIMITIVE_SET) return;
+    if (osg::getBinding(geom.getSecondaryColorArray())==osg::Array::BIND_PER_PRIMITIVE_SET) return;
+    if (osg::getBinding(geom.getFogCoordArray())==osg::Array::BIND_PER_PRIMITIVE_SET) return;
+
+    const Geometry::PrimitiveSetList& primSets = geom.getPrimitiveSetList();
+    if (primSets.empty()) return;
+    for(Geometry::PrimitiveSetList::const_iterator itr = primSets.begin();
+        itr != primSets.end();
+        ++itr)
+    {
+        if (!isTriangleMode((*itr)->getMode()) || (*itr)->getNumInstances()>1) return;
+    }
+
+    MeshletTriangleIndexFunctor collector;
+    geom.accept(collector);
+    const std::vector<unsigned>& indices = collector._indices;
+    if (indices.empty()) return;
+
+    osg::ref_ptr<MeshletData> meshletData = new MeshletData;
+    meshletData->setNormalConeCulling(_normalConeCulling || cullsBackFaces(geom));
+
+    // greedily fill each meshlet with triangles in draw order, stamping
+    // vertices with the meshlet they were last added to.
+    std::vector<unsigned> stamps(vertices->size(), 0);
+    std::vector<unsigned> meshletVertices;
+    meshletVertices.reserve(_maximumNumVertices);
+    unsigned int numIndices = indices.size();
+    unsigned int maxNumIndices = _maximumNumTriangles*3;
+    unsigned int stamp = 0;
+    unsigned int begin = 0;
+    while (begin<numIndices)
+    {
+        ++stamp;
+        meshletVertices.clear();
+        unsigned int end = begin;
+        while (end<numIndices && end-begin<maxNumIndices)
+        {
+            unsigned int numNewVertices = 0;
+            for(unsigned int i=end; i<end+3; ++i)
+            {
+                if (stamps[indices[i]]!=stamp) ++numNewVertices;
+            }
+            if (meshletVertices.size()+numNewVertices>_maximumNumVertices) break;
+
+            for(unsigned int i=end; i<end+3; ++i)
+            {
+                if (stamps[indices[i]]!=stamp)
+                {
+                    stamps[indices[i]] = stamp;
+                    meshletVertices.push_back(indices[i]);
+                }
+            }
+            end += 3;
+        }
+
+        addMeshlet(*vertices, indices, begin, end, meshletVertices, *meshletData);
+        begin = end;
+    }
+
+    // the clusters are consecutive ranges of one DrawElements, so that the
+    // CullVisitor can draw those that survive culling with a single call.
+    osg::ref_ptr<Geometry> meshletGeom = new Geometry;
+    shareArrays(geom, *meshletGeom);
+    if (vertices->size() <= 65536)
+    {
+        osg::ref_ptr<DrawElementsUShort> elements = new DrawElementsUShort(GL_TRIANGLES);
+        addIndices(*elements, indices);
+        meshletGeom->addPrimitiveSet(elements.get());
+    }
+    else
+    {
+        osg::ref_ptr<DrawElementsUInt> elements = new DrawElementsUInt(GL_TRIANGLES);
+        addIndices(*elements, indices);
+        meshletGeom->addPrimitiveSet(elements.get());
+    }
+    meshletData->setGeometry(meshletGeom.get());
+
+    geom.setUserData(meshletData.get());
+}
+
+void MeshletVisitor::buildMeshlets()
+{
+    BuildMeshletsFunctor functor(*this);
+    processGeometryList(functor);
+}
+
+void MeshletData::resizeGLObjectBuffers(unsigned int maxSize)
+{
+    if (_geometry.valid()) _geometry->resizeGLObjectBuffers(maxSize);
+}
+
+void MeshletData::releaseGLObjects(osg::State* state) const
+{
+    if (_geometry.valid()) _geometry->releaseGLObjects(state);
+}
+
+void MeshletBatch::reset(const MeshletData* meshletData, const osg::BoundingBox& bb)
+{
+    _meshletData = meshletData;
+    _firsts.clear();
+    _counts.clear();
+    setInitialBound(bb);
+}
+
+void MeshletBatch::addMeshlet(const MeshletData::Meshlet& meshlet)
+{
+    if (!_counts.empty() && _firsts.back()+_counts.back()==meshlet.first)
+    {
+        _counts.back() += meshlet.count;
+    }
+    else
+    {
+        _firsts.push_back(meshlet.first);
+        _counts.push_back(meshlet.count);
+    }
+}
+
+void MeshletBatch::drawImplementation(osg::RenderInfo& renderInfo) const
+{
+    const Geometry* geometry = _meshletData.valid() ? _meshletData->getGeometry() : 0;
+    if (!geometry || _counts.empty() || geometry->getNumPrimitiveSets()==0) return;
+
+    const DrawElements* drawElements = geometry->getPrimitiveSet(0)->getDrawElements();
+    if (!drawElements || drawElements->getNumIndices()==0) return;
+
+    State& state = *renderInfo.getState();
+
+    geometry->drawVertexArraysImplementation(renderInfo);
+
+    GLenum type = drawElements->getTotalDataSize()==drawElements->getNumIndices()*sizeof(GLushort) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    unsigned int indexSize = (type==GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+
+    const GLubyte* base = static_cast<const GLubyte*>(drawElements->getDataPointer());
+    if (geometry->getUseVertexBufferObjects() && state.isVertexBufferObjectSupported())
+    {
+        GLBufferObject* ebo = drawElements->getOrCreateGLBufferObject(state.getContextID());
+        if (ebo)
+        {
+            state.bindElementBufferObject(ebo);
+            base = reinterpret_cast<const GLubyte*>(ebo->getOffset(drawElements->getBufferIndex()));
+        }
+    }
+
+    _indices.resize(_counts.size());
+    for(unsigned int i=0; i<_counts.size(); ++i)
+    {
+        _indices[i] = base+_firsts[i]*indexSize;
+    }
+
+    GLExtensions* ext = state.get<GLExtensions>();
+    if (ext->glMultiDrawElements && _counts.size()>1)
+    {
+        ext->glMultiDrawElements(GL_TRIANGLES, &_counts.front(), type, &_indices.front(), _counts.size());
+    }
+    else
+    {
+        for(unsigned int i=0; i<_counts.size(); ++i)
+        {
+            glDrawElements(GL_TRIANGLES, _counts[i], type, _indices[i]);
+        }
+    }
+
+    state.unbindVertexBufferObject();
+    state.unbindElementBufferObject();
+}
+
 void SharedArrayOptimizer::findDuplicatedUVs(const osg::Geometry& geometry)
 {
     _deduplicateUvs.clear();
@@ -20,6 +20,7 @@
 #include <osg/Notify>
 #include <osg/ApplicationUsage>
 #include <osg/AlphaFunc>
+#include <osg/Types>
 
 #include <algorithm>
 
@@ -142,13 +143,42 @@ RenderBin::SortMode RenderBin::getDefaultRenderBinSortMode()
     return s_defaultBinSortMode;
 }
 
+static bool s_defaultBinUseRadixSortInitialized = false;
+static bool s_defaultBinUseRadixSort = false;
+static osg::ApplicationUsageProxy RenderBin_e1(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DEFAULT_BIN_RADIX_SORT <mode>","ON | OFF - Use radix sorts of packed depth keys for depth sorted and traversal order bins.");
+
+void RenderBin::setDefaultRenderBinUseRadixSort(bool flag)
+{
+    s_defaultBinUseRadixSortInitialized = true;
+    s_defaultBinUseRadixSort = flag;
+}
+
+bool RenderBin::getDefaultRenderBinUseRadixSort()
+{
+    if (!s_defaultBinUseRadixSortInitialized)
+    {
+        s_defaultBinUseRadixSortInitialized = true;
+
+        const char* str = getenv("OSG_DEFAULT_BIN_RADIX_SORT");
+        if (str)
+        {
+            if (strcmp(str,"ON")==0) s_defaultBinUseRadixSort = true;
+            else if (strcmp(str,"OFF")==0) s_defaultBinUseRadixSort = false;
+        }
+    }
+
+    return s_defaultBinUseRadixSort;
+}
+
 RenderBin::RenderBin()
 {
     _binNum = 0;
     _parent = NULL;
     _stage = NULL;
     _sorted = false;
+    _used = true;
     _sortMode = getDefaultRenderBinSortMode();
+    _useRadixSort = getDefaultRenderBinUseRadixSort();
 }
 
 RenderBin::RenderBin(SortMode mode)
@@ -157,7 +187,9 @@ RenderBin::RenderBin(SortMode mode)
     _parent = NULL;
     _stage = NULL;
     _sorted = false;
+    _used = true;
     _sortMode = mode;
+    _useRadixSort = getDefaultRenderBinUseRadixSort();
 
 #if 1
     if (_sortMode==SORT_BACK_TO_FRONT)
@@ -186,7 +218,9 @@ RenderBin::RenderBin(const RenderBin& rhs,const CopyOp& copyop):
         _stateGraphList(rhs._stateGraphList),
         _renderLeafList(rhs._renderLeafList),
         _sorted(rhs._sorted),
+        _used(rhs._used),
         _sortMode(rhs._sortMode),
+        _useRadixSort(rhs._useRadixSort),
         _sortCallback(rhs._sortCallback),
         _drawCallback(rhs._drawCallback),
         _stateset(rhs._stateset)
@@ -202,7 +236,15 @@ void RenderBin::reset()
 {
     _stateGraphList.clear();
     _renderLeafList.clear();
-    _bins.clear();
+
+    for(RenderBinList::iterator itr = _bins.begin();
+        itr!=_bins.end();
+        ++itr)
+    {
+        itr->second->reset();
+        itr->second->_used = false;
+    }
+
     _sorted = false;
 }
 
@@ -210,11 +252,20 @@ void RenderBin::sort()
 {
     if (_sorted) return;
 
-    for(RenderBinList::iterator itr = _bins.begin();
-        itr!=_bins.end();
-        ++itr)
+    RenderBinList::iterator itr = _bins.begin();
+    while(itr!=_bins.end())
     {
-        itr->second->sort();
+        // remove the nested bins retained by reset() that haven't been used during this traversal.
+        if (!itr->second->_used)
+        {
+            RenderBinList::iterator ditr = itr++;
+            _bins.erase(ditr);
+        }
+        else
+        {
+            itr->second->sort();
+            ++itr;
+        }
     }
 
     if (_sortCallback.valid())
@@ -253,6 +304,111 @@ void RenderBin::sortImplementation()
     }
 }
 
+/** Map a float onto an unsigned integer with the same ordering, so depths can be sorted as integer keys.*/
+static inline uint32_t floatToSortKey(float value)
+{
+    union { float f; uint32_t u; } v;
+    v.f = value;
+    return (v.u & 0x80000000u) ? ~v.u : (v.u | 0x80000000u);
+}
+
+/** Stable least significant digit radix sort of keys on their upper 32 bits, the lower 32 bits hold the index of the element each key belongs to.*/
+static void radixSortKeys(std::vector<uint64_t>& keys, std::vector<uint64_t>& scratch)
+{
+    const unsigned int numDigits = 4;
+    const size_t numKeys = keys.size();
+
+    size_t counts[numDigits][256];
+    memset(counts, 0, sizeof(counts));
+
+    for(size_t i=0; i<numKeys; ++i)
+    {
+        uint32_t key = static_cast<uint32_t>(keys[i]>>32);
+        ++counts[0][key & 0xff];
+        ++counts[1][(key>>8) & 0xff];
+        ++counts[2][(key>>16) & 0xff];
+        ++counts[3][key>>24];
+    }
+
+    scratch.resize(numKeys);
+    uint64_t* src = &keys.front();
+    uint64_t* dst = &scratch.front();
+
+    for(unsigned int digit=0; digit<numDigits; ++digit)
+    {
+        unsigned int shift = 32+digit*8;
+
+        // skip the pass if all keys share the same digit, common for the exponent byte of depths.
+        if (counts[digit][(src[0]>>shift) & 0xff]==numKeys) continue;
+
+        size_t offsets[256];
+        size_t total = 0;
+        for(unsigned int b=0; b<256; ++b)
+        {
+            offsets[b] = total;
+            total += counts[digit][b];
+        }
+
+        for(size_t i=0; i<numKeys; ++i)
+        {
+            dst[offsets[(src[i]>>shift) & 0xff]++] = src[i];
+        }
+
+        std::swap(src, dst);
+    }
+
+    if (src!=&keys.front()) keys.swap(scratch);
+}
+
+/** Stable sort of a list of pointers by the 32 bit keys returned by the KeyFunctor, using radixSortKeys() for
+  * all but short lists, where the fixed cost of the histogram passes outweighs the saving over a comparison sort.
+  * The keys and scratch buffers are kept by the caller so that their capacity is reused from frame to frame.*/
+template<class T, class KeyFunctor>
+static void radixSort(std::vector<T*>& list, KeyFunctor keyFunctor, std::vector<uint64_t>& keys, std::vector<uint64_t>& scratch)
+{
+    if (list.size()<2) return;
+
+    keys.resize(list.size());
+    for(size_t i=0; i<list.size(); ++i)
+    {
+        keys[i] = (static_cast<uint64_t>(keyFunctor(list[i]))<<32) | static_cast<uint64_t>(i);
+    }
+
+    // the index in the lower bits makes every key unique, so an unstable sort of the keys still gives a stable order.
+    if (list.size()<256) std::sort(keys.begin(), keys.end());
+    else radixSortKeys(keys, scratch);
+
+    // gather the pointers in sorted order into the keys, then copy them back, so no temporary list is needed.
+    for(size_t i=0; i<keys.size(); ++i)
+    {
+        keys[i] = static_cast<uint64_t>(reinterpret_cast<size_t>(list[static_cast<uint32_t>(keys[i])]));
+    }
+    for(size_t i=0; i<keys.size(); ++i)
+    {
+        list[i] = reinterpret_cast<T*>(static_cast<size_t>(keys[i]));
+    }
+}
+
+struct FrontToBackSortKey
+{
+    uint32_t operator() (const RenderLeaf* leaf) const { return floatToSortKey(leaf->_depth); }
+};
+
+struct BackToFrontSortKey
+{
+    uint32_t operator() (const RenderLeaf* leaf) const { return ~floatToSortKey(leaf->_depth); }
+};
+
+struct TraversalOrderSortKey
+{
+    uint32_t operator() (const RenderLeaf* leaf) const { return leaf->_traversalNumber; }
+};
+
+struct StateGraphFrontToBackSortKey
+{
+    uint32_t operator() (const StateGraph* sg) const { return floatToSortKey(sg->_minimumDistance); }
+};
+
 struct SortByStateFunctor
 {
     bool operator() (const StateGraph* lhs,const StateGraph* rhs) const
@@ -289,7 +445,9 @@ void RenderBin::sortByStateThenFrontToBack()
         (*itr)->sortFrontToBack();
         (*itr)->getMinimumDistance();
     }
-    std::sort(_stateGraphList.begin(),_stateGraphList.end(),StateGraphFrontToBackSortFunctor());
+
+    if (_useRadixSort) radixSort(_stateGraphList, StateGraphFrontToBackSortKey(), _sortKeys, _sortKeysScratch);
+    else std::sort(_stateGraphList.begin(),_stateGraphList.end(),StateGraphFrontToBackSortFunctor());
 }
 
 struct FrontToBackSortFunctor
@@ -306,7 +464,8 @@ void RenderBin::sortFrontToBack()
     copyLeavesFromStateGraphListToRenderLeafList();
 
     // now sort the list into acending depth order.
-    std::sort(_renderLeafList.begin(),_renderLeafList.end(),FrontToBackSortFunctor());
+    if (_useRadixSort) radixSort(_renderLeafList, FrontToBackSortKey(), _sortKeys, _sortKeysScratch);
+    else std::sort(_renderLeafList.begin(),_renderLeafList.end(),FrontToBackSortFunctor());
 
 //    cout << "sort front to back"<<endl;
 }
@@ -324,7 +483,8 @@ void RenderBin::sortBackToFront()
     copyLeavesFromStateGraphListToRenderLeafList();
 
     // now sort the list into acending depth order.
-    std::sort(_renderLeafList.begin(),_renderLeafList.end(),BackToFrontSortFunctor());
+    if (_useRadixSort) radixSort(_renderLeafList, BackToFrontSortKey(), _sortKeys, _sortKeysScratch);
+    else std::sort(_renderLeafList.begin(),_renderLeafList.end(),BackToFrontSortFunctor());
 
 //    cout << "sort back to front"<<endl;
 }
@@ -342,8 +502,9 @@ void RenderBin::sortTraversalOrder()
 {
     copyLeavesFromStateGraphListToRenderLeafList();
 
-    // now sort the list into acending depth order.
-    std::sort(_renderLeafList.begin(),_renderLeafList.end(),TraversalOrderFunctor());
+    // now sort the list into acending traversal order.
+    if (_useRadixSort) radixSort(_renderLeafList, TraversalOrderSortKey(), _sortKeys, _sortKeysScratch);
+    else std::sort(_renderLeafList.begin(),_renderLeafList.end(),TraversalOrderFunctor());
 }
 
 void RenderBin::copyLeavesFromStateGraphListToRenderLeafList()
@@ -389,11 +550,127 @@ void RenderBin::copyLeavesFromStateGraphListToRenderLeafList()
     _stateGraphList.clear();
 }
 
+/** Return true if the two bins are of the same class and sort mode, so one can stand in for the other.*/
+static bool isSameKindOfRenderBin(const RenderBin* lhs, const RenderBin* rhs)
+{
+    return strcmp(lhs->className(), rhs->className())==0 &&
+           strcmp(lhs->libraryName(), rhs->libraryName())==0 &&
+           lhs->getSortMode()==rhs->getSortMode();
+}
+
+static StateGraph* mapFragmentStateGraph(StateGraph* sg, StateGraph* rootStateGraph, RenderBin::StateGraphMap& stateGraphMap)
+{
+    // the root of the fragment corresponds to the root of the graph being merged into.
+    if (!sg->_parent) return rootStateGraph;
+
+    RenderBin::StateGraphMap::iterator itr = stateGraphMap.find(sg);
+    if (itr!=stateGraphMap.end()) return itr->second;
+
+    StateGraph* mapped = mapFragmentStateGraph(sg->_parent, rootStateGraph, stateGraphMap)->find_or_insert(sg->getStateSet());
+    stateGraphMap[sg] = mapped;
+    return mapped;
+}
+
+unsigned int RenderBin::mergeFragment(RenderBin* fragment, StateGraph* rootStateGraph, StateGraphMap& stateGraphMap, unsigned int traversalNumberOffset)
+{
+    unsigned int numLeaves = 0;
+
+    StateGraphList fragmentStateGraphList;
+    fragmentStateGraphList.swap(fragment->_stateGraphList);
+
+    for(StateGraphList::iterator itr=fragmentStateGraphList.begin();
+        itr!=fragmentStateGraphList.end();
+        ++itr)
+    {
+        StateGraph* sg = *itr;
+        StateGraph* mapped = mapFragmentStateGraph(sg, rootStateGraph, stateGraphMap);
+
+        // as with CullVisitor::addDrawable(), a StateGraph is only added to a bin when it receives its first leaf.
+        if (mapped->leaves_empty()) _stateGraphList.push_back(mapped);
+
+        for(StateGraph::LeafList::iterator litr=sg->_leaves.begin();
+            litr!=sg->_leaves.end();
+            ++litr)
+        {
+            (*litr)->_traversalNumber += traversalNumberOffset;
+            mapped->addLeaf(litr->get());
+        }
+
+        numLeaves += sg->_leaves.size();
+        sg->_leaves.clear();
+    }
+
+    if (fragment==this)
+    {
+        for(RenderBinList::iterator itr=_bins.begin();
+            itr!=_bins.end();
+            ++itr)
+        {
+            RenderBin* bin = itr->second.get();
+            bin->_parent = this;
+            bin->_stage = _stage;
+            numLeaves += bin->mergeFragment(bin, rootStateGraph, stateGraphMap, traversalNumberOffset);
+        }
+    }
+    else
+    {
+        RenderBinList::iterator itr=fragment->_bins.begin();
+        while(itr!=fragment->_bins.end())
+        {
+            // bins retained by the fragment from previous frames but not used in this one hold nothing to merge.
+            if (!itr->second->_used)
+            {
+                ++itr;
+                continue;
+            }
+
+            RenderBinList::iterator bitr = _bins.find(itr->first);
+            if (bitr!=_bins.end() && (bitr->second->_used || isSameKindOfRenderBin(bitr->second.get(), itr->second.get())))
+            {
+                bitr->second->_used = true;
+                numLeaves += bitr->second->mergeFragment(itr->second.get(), rootStateGraph, stateGraphMap, traversalNumberOffset);
+                ++itr;
+            }
+            else
+            {
+                // no equivalent bin used yet so adopt the fragment's bin, retaining its type and sort mode.
+                RenderBin* bin = itr->second.get();
+                bin->_parent = this;
+                bin->_stage = _stage;
+                _bins[itr->first] = bin;
+                numLeaves += bin->mergeFragment(bin, rootStateGraph, stateGraphMap, traversalNumberOffset);
+
+                RenderBinList::iterator ditr = itr++;
+                fragment->_bins.erase(ditr);
+            }
+        }
+    }
+
+    return numLeaves;
+}
+
+RenderBin* RenderBin::find(int binNum,const std::string& binName)
+{
+    RenderBinList::iterator itr = _bins.find(binNum);
+    if (itr==_bins.end()) return NULL;
+
+    RenderBin* rb = itr->second.get();
+    if (!rb->_used)
+    {
+        // the bin has been retained from a previous traversal, so check that it was created for the same type of bin before reusing it.
+        RenderBin* prototype = getRenderBinPrototype(binName);
+        if (!prototype || !isSameKindOfRenderBin(rb, prototype)) return NULL;
+
+        rb->_used = true;
+    }
+    return rb;
+}
+
 RenderBin* RenderBin::find_or_insert(int binNum,const std::string& binName)
 {
     // search for appropriate bin.
-    RenderBinList::iterator itr = _bins.find(binNum);
-    if (itr!=_bins.end()) return itr->second.get();
+    RenderBin* existing = find(binNum, binName);
+    if (existing) return existing;
 
     // create a rendering bin and insert into bin list.
     RenderBin* rb = RenderBin::createRenderBin(binName);
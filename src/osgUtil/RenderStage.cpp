@@ -1421,6 +1421,80 @@ void RenderStage::drawPostRenderStages(osg::RenderInfo& renderInfo,RenderLeaf*&
 }
 
 // Statistics features
+unsigned int RenderStage::mergeFragment(RenderStage* fragment, StateGraph* rootStateGraph, unsigned int traversalNumberOffset)
+{
+    StateGraphMap stateGraphMap;
+    return mergeFragment(fragment, rootStateGraph, stateGraphMap, traversalNumberOffset);
+}
+
+unsigned int RenderStage::mergeFragment(RenderBin* fragmentBin, StateGraph* rootStateGraph, StateGraphMap& stateGraphMap, unsigned int traversalNumberOffset)
+{
+    unsigned int numLeaves = RenderBin::mergeFragment(fragmentBin, rootStateGraph, stateGraphMap, traversalNumberOffset);
+
+    RenderStage* fragment = dynamic_cast<RenderStage*>(fragmentBin);
+    if (!fragment) return numLeaves;
+
+    if (fragment==this)
+    {
+        // re-parent the leaves of any pre/post render stages nested within an adopted stage.
+        for(RenderStageList::iterator itr = _preRenderList.begin(); itr != _preRenderList.end(); ++itr)
+        {
+            numLeaves += itr->second->mergeFragment(itr->second.get(), rootStateGraph, stateGraphMap, traversalNumberOffset);
+        }
+
+        for(RenderStageList::iterator itr = _postRenderList.begin(); itr != _postRenderList.end(); ++itr)
+        {
+            numLeaves += itr->second->mergeFragment(itr->second.get(), rootStateGraph, stateGraphMap, traversalNumberOffset);
+        }
+
+        return numLeaves;
+    }
+
+    PositionalStateContainer* fragmentPositionalState = fragment->_renderStageLighting.get();
+    if (fragmentPositionalState)
+    {
+        PositionalStateContainer* positionalState = getPositionalStateContainer();
+
+        PositionalStateContainer::AttrMatrixList& attrList = fragmentPositionalState->getAttrMatrixList();
+        for(PositionalStateContainer::AttrMatrixList::iterator itr = attrList.begin(); itr != attrList.end(); ++itr)
+        {
+            positionalState->addPositionedAttribute(itr->second.get(), itr->first.get());
+        }
+
+        PositionalStateContainer::TexUnitAttrMatrixListMap& texAttrListMap = fragmentPositionalState->getTexUnitAttrMatrixListMap();
+        for(PositionalStateContainer::TexUnitAttrMatrixListMap::iterator titr = texAttrListMap.begin(); titr != texAttrListMap.end(); ++titr)
+        {
+            for(PositionalStateContainer::AttrMatrixList::iterator itr = titr->second.begin(); itr != titr->second.end(); ++itr)
+            {
+                positionalState->addPositionedTextureAttribute(titr->first, itr->second.get(), itr->first.get());
+            }
+        }
+    }
+
+    // adopt the fragment's render to texture stages, redirecting any that inherit the fragment's positional state to our own.
+    for(RenderStageList::iterator itr = fragment->_preRenderList.begin(); itr != fragment->_preRenderList.end(); ++itr)
+    {
+        RenderStage* rs = itr->second.get();
+        if (fragmentPositionalState && rs->getInheritedPositionalStateContainer()==fragmentPositionalState) rs->setInheritedPositionalStateContainer(getPositionalStateContainer());
+        addPreRenderStage(rs, itr->first);
+        numLeaves += rs->mergeFragment(rs, rootStateGraph, stateGraphMap, traversalNumberOffset);
+    }
+
+    for(RenderStageList::iterator itr = fragment->_postRenderList.begin(); itr != fragment->_postRenderList.end(); ++itr)
+    {
+        RenderStage* rs = itr->second.get();
+        if (fragmentPositionalState && rs->getInheritedPositionalStateContainer()==fragmentPositionalState) rs->setInheritedPositionalStateContainer(getPositionalStateContainer());
+        addPostRenderStage(rs, itr->first);
+        numLeaves += rs->mergeFragment(rs, rootStateGraph, stateGraphMap, traversalNumberOffset);
+    }
+
+    // the adopted stages now belong to this stage, so make sure a later reset of the fragment leaves them alone.
+    fragment->_preRenderList.clear();
+    fragment->_postRenderList.clear();
+
+    return numLeaves;
+}
+
 bool RenderStage::getStats(Statistics& stats) const
 {
     bool statsCollected = false;
@@ -28,7 +28,9 @@
 
 #include <osg/GLU>
 
+#include <cassert>
 #include <iterator>
+#include <typeinfo>
 
 using namespace osg;
 using namespace osgUtil;
@@ -138,6 +140,7 @@ SceneView::SceneView(DisplaySettings* ds)
     _interlacedStereoStencilHeight = 0;
 
     _dynamicObjectCount = 0;
+    _cullAllocationCount = 0;
 
     _resetColorMaskToAllEnabled = true;
 }
@@ -173,6 +176,7 @@ SceneView::SceneView(const SceneView& rhs, const osg::CopyOp& copyop):
     _interlacedStereoStencilHeight = rhs._interlacedStereoStencilHeight;
 
     _dynamicObjectCount = 0;
+    _cullAllocationCount = 0;
 
     _resetColorMaskToAllEnabled = rhs._resetColorMaskToAllEnabled;
 }
@@ -355,6 +359,15 @@ void SceneView::update()
     }
 }
 
+// the names of the uniforms updated each frame, held as strings so that updateUniforms() needn't construct them every frame.
+static const std::string s_FrameNumberUniformName("osg_FrameNumber");
+static const std::string s_FrameTimeUniformName("osg_FrameTime");
+static const std::string s_DeltaFrameTimeUniformName("osg_DeltaFrameTime");
+static const std::string s_SimulationTimeUniformName("osg_SimulationTime");
+static const std::string s_DeltaSimulationTimeUniformName("osg_DeltaSimulationTime");
+static const std::string s_ViewMatrixUniformName("osg_ViewMatrix");
+static const std::string s_ViewMatrixInverseUniformName("osg_ViewMatrixInverse");
+
 void SceneView::updateUniforms()
 {
     if (!_localStateSet)
@@ -366,13 +379,13 @@ void SceneView::updateUniforms()
 
     if ((_activeUniforms & FRAME_NUMBER_UNIFORM) && _frameStamp.valid())
     {
-        osg::Uniform* uniform = _localStateSet->getOrCreateUniform("osg_FrameNumber",osg::Uniform::UNSIGNED_INT);
+        osg::Uniform* uniform = _localStateSet->getOrCreateUniform(s_FrameNumberUniformName,osg::Uniform::UNSIGNED_INT);
         uniform->set(_frameStamp->getFrameNumber());
     }
 
     if ((_activeUniforms & FRAME_TIME_UNIFORM) && _frameStamp.valid())
     {
-        osg::Uniform* uniform = _localStateSet->getOrCreateUniform("osg_FrameTime",osg::Uniform::FLOAT);
+        osg::Uniform* uniform = _localStateSet->getOrCreateUniform(s_FrameTimeUniformName,osg::Uniform::FLOAT);
         uniform->set(static_cast<float>(_frameStamp->getReferenceTime()));
     }
 
@@ -381,13 +394,13 @@ void SceneView::updateUniforms()
         float delta_frame_time = (_previousFrameTime != 0.0) ? static_cast<float>(_frameStamp->getReferenceTime()-_previousFrameTime) : 0.0f;
         _previousFrameTime = _frameStamp->getReferenceTime();
 
-        osg::Uniform* uniform = _localStateSet->getOrCreateUniform("osg_DeltaFrameTime",osg::Uniform::FLOAT);
+        osg::Uniform* uniform = _localStateSet->getOrCreateUniform(s_DeltaFrameTimeUniformName,osg::Uniform::FLOAT);
         uniform->set(delta_frame_time);
     }
 
     if ((_activeUniforms & SIMULATION_TIME_UNIFORM) && _frameStamp.valid())
     {
-        osg::Uniform* uniform = _localStateSet->getOrCreateUniform("osg_SimulationTime",osg::Uniform::FLOAT);
+        osg::Uniform* uniform = _localStateSet->getOrCreateUniform(s_SimulationTimeUniformName,osg::Uniform::FLOAT);
         uniform->set(static_cast<float>(_frameStamp->getSimulationTime()));
     }
 
@@ -396,19 +409,19 @@ void SceneView::updateUniforms()
         float delta_simulation_time = (_previousSimulationTime != 0.0) ? static_cast<float>(_frameStamp->getSimulationTime()-_previousSimulationTime) : 0.0f;
         _previousSimulationTime = _frameStamp->getSimulationTime();
 
-        osg::Uniform* uniform = _localStateSet->getOrCreateUniform("osg_DeltaSimulationTime",osg::Uniform::FLOAT);
+        osg::Uniform* uniform = _localStateSet->getOrCreateUniform(s_DeltaSimulationTimeUniformName,osg::Uniform::FLOAT);
         uniform->set(delta_simulation_time);
     }
 
     if (_activeUniforms & VIEW_MATRIX_UNIFORM)
     {
-        osg::Uniform* uniform = _localStateSet->getOrCreateUniform("osg_ViewMatrix",osg::Uniform::FLOAT_MAT4);
+        osg::Uniform* uniform = _localStateSet->getOrCreateUniform(s_ViewMatrixUniformName,osg::Uniform::FLOAT_MAT4);
         uniform->set(getViewMatrix());
     }
 
     if (_activeUniforms & VIEW_MATRIX_INVERSE_UNIFORM)
     {
-        osg::Uniform* uniform = _localStateSet->getOrCreateUniform("osg_ViewMatrixInverse",osg::Uniform::FLOAT_MAT4);
+        osg::Uniform* uniform = _localStateSet->getOrCreateUniform(s_ViewMatrixInverseUniformName,osg::Uniform::FLOAT_MAT4);
         uniform->set(osg::Matrix::inverse(getViewMatrix()));
     }
 
@@ -644,6 +657,7 @@ void SceneView::inheritCullSettings(const osg::CullSettings& settings, unsigned
 void SceneView::cull()
 {
     _dynamicObjectCount = 0;
+    _cullAllocationCount = 0;
 
     if (_camera->getNodeMask()==0) return;
 
@@ -890,7 +904,7 @@ bool SceneView::cullStage(const osg::Matrixd& projection,const osg::Matrixd& mod
     {
        osg::Callback* callback = _camera->getCullCallback();
        if (callback) callback->run(_camera.get(), cullVisitor);
-       else cullVisitor->traverse(*_camera);
+       else if (!parallelCullTraverse(cullVisitor, rendergraph, renderStage)) cullVisitor->traverse(*_camera);
     }
 
 
@@ -915,11 +929,249 @@ bool SceneView::cullStage(const osg::Matrixd& projection,const osg::Matrixd& mod
     // set the number of dynamic objects in the scene.
     _dynamicObjectCount += renderStage->computeNumberOfDynamicRenderLeaves();
 
+    // track the rendering backend objects that couldn't be reused from previous frames.
+    _cullAllocationCount += cullVisitor->getNumberOfAllocations();
+
 
     bool computeNearFar = (cullVisitor->getComputeNearFarMode()!=osgUtil::CullVisitor::DO_NOT_COMPUTE_NEAR_FAR) && getSceneData()!=0;
     return computeNearFar;
 }
 
+/** Computes the bounding spheres dirtied since they were last computed, so that the cull threads only ever read them.
+  * Children are visited before their parent recomputes its bound, as getBound() on the parent would otherwise compute
+  * the children's bounds but not those below nodes that don't use their children's, such as LODs with user defined centers.
+  * Dirtying a bound dirties its parents, so the subgraphs below nodes with computed bounds are skipped.*/
+class ComputeDirtyBoundsVisitor : public osg::NodeVisitor
+{
+    public:
+
+        ComputeDirtyBoundsVisitor():
+            osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN)
+        {
+            setNodeMaskOverride(0xffffffff);
+        }
+
+        virtual void apply(osg::Node& node)
+        {
+            if (node.isBoundComputed()) return;
+
+            traverse(node);
+            node.getBound();
+        }
+};
+
+/** Culls a contiguous range of the children of a Group with its own CullVisitor into its own StateGraph/RenderStage fragment.*/
+class SceneView::CullFragment : public osg::Operation
+{
+    public:
+
+        CullFragment(CullVisitor* cullVisitor):
+            osg::Operation("CullFragment", false),
+            _cullVisitor(cullVisitor),
+            _stateGraph(new StateGraph),
+            _renderStage(new RenderStage),
+            _group(0),
+            _startChild(0),
+            _endChild(0) {}
+
+        virtual void operator () (osg::Object*)
+        {
+            cull();
+            _completed->completed();
+        }
+
+        void cull()
+        {
+            for(unsigned int i=_startChild; i<_endChild; ++i)
+            {
+                _group->getChild(i)->accept(*_cullVisitor);
+            }
+
+            // resolve the deferred near/far candidates now, the nearest of the fragments then gives the same result as a single cull.
+            _cullVisitor->computeNearPlane();
+
+            // remove the parts of the StateGraph not used this frame, the leaves are moved out when the fragment is merged.
+            _stateGraph->prune();
+        }
+
+        osg::ref_ptr<CullVisitor>           _cullVisitor;
+        osg::ref_ptr<StateGraph>            _stateGraph;
+        osg::ref_ptr<RenderStage>           _renderStage;
+        osg::Group*                         _group;
+        unsigned int                        _startChild;
+        unsigned int                        _endChild;
+        osg::ref_ptr<osg::RefBlockCount>    _completed;
+};
+
+bool SceneView::parallelCullTraverse(osgUtil::CullVisitor* cullVisitor, osgUtil::StateGraph* rendergraph, osgUtil::RenderStage* renderStage)
+{
+    unsigned int numThreads = getNumCullThreads();
+    if (numThreads<=1) return false;
+
+    // descend through plain Groups with a single child to find the Group to split, the same
+    // checks that CullVisitor::apply(osg::Group&) does are then replayed on each CullVisitor.
+    typedef std::vector<osg::Group*> GroupPath;
+    GroupPath groupPath;
+    osg::Group* group = _camera.get();
+    while(group->getNumChildren()==1)
+    {
+        osg::Group* child = group->getChild(0)->asGroup();
+        if (!child || typeid(*child)!=typeid(osg::Group) || child->getCullCallback()) return false;
+
+        groupPath.push_back(child);
+        group = child;
+    }
+
+    unsigned int numChildren = group->getNumChildren();
+    if (numChildren<2) return false;
+
+    unsigned int numPushed = 0;
+    for(GroupPath::iterator itr = groupPath.begin(); itr != groupPath.end(); ++itr)
+    {
+        osg::Group* node = *itr;
+        if (!cullVisitor->validNodeMask(*node) || cullVisitor->isCulled(*node)) break;
+
+        cullVisitor->pushOntoNodePath(node);
+        cullVisitor->pushCurrentMask();
+        if (node->getStateSet()) cullVisitor->pushStateSet(node->getStateSet());
+        ++numPushed;
+    }
+
+    if (numPushed==groupPath.size())
+    {
+        // the bounds are computed lazily by getBound(), which would race when called from several cull threads.
+        ComputeDirtyBoundsVisitor computeDirtyBounds;
+        for(unsigned int i=0; i<numChildren; ++i)
+        {
+            group->getChild(i)->accept(computeDirtyBounds);
+            assert(group->getChild(i)->isBoundComputed());
+        }
+
+        // use more fragments than threads so that threads finishing early can pick up remaining work.
+        unsigned int numFragments = osg::minimum(numChildren, numThreads*4);
+
+        if (!_cullFragments.empty() && typeid(*(_cullFragments.front()->_cullVisitor))!=typeid(*cullVisitor)) _cullFragments.clear();
+        while(_cullFragments.size()<numFragments) _cullFragments.push_back(new CullFragment(cullVisitor->clone()));
+
+        if (!_cullOperationQueue) _cullOperationQueue = new osg::OperationQueue;
+        if (_cullThreads.size()>numThreads-1) _cullThreads.resize(numThreads-1);
+        while(_cullThreads.size()<numThreads-1)
+        {
+            osg::OperationThread* thread = new osg::OperationThread;
+            thread->setOperationQueue(_cullOperationQueue.get());
+            thread->startThread();
+            _cullThreads.push_back(thread);
+        }
+
+        if (!_cullFragmentsCompleted) _cullFragmentsCompleted = new osg::RefBlockCount(numFragments);
+        _cullFragmentsCompleted->setBlockCount(numFragments);
+        _cullFragmentsCompleted->reset();
+
+        // the statesets pushed so far, from the root of the StateGraph down.
+        std::vector<const osg::StateSet*> stateSetPath;
+        for(StateGraph* sg = cullVisitor->getCurrentStateGraph(); sg->_parent; sg = sg->_parent)
+        {
+            stateSetPath.push_back(sg->getStateSet());
+        }
+
+        for(unsigned int i=0; i<numFragments; ++i)
+        {
+            CullFragment* fragment = _cullFragments[i].get();
+            CullVisitor* cv = fragment->_cullVisitor.get();
+            RenderStage* rs = fragment->_renderStage.get();
+
+            cv->reset();
+            cv->setCullSettings(*cullVisitor);
+            cv->setTraversalMask(cullVisitor->getTraversalMask());
+            cv->setNodeMaskOverride(cullVisitor->getNodeMaskOverride());
+            cv->setFrameStamp(_frameStamp.get());
+            cv->setTraversalNumber(cullVisitor->getTraversalNumber());
+            cv->setDatabaseRequestHandler(cullVisitor->getDatabaseRequestHandler());
+            cv->setImageRequestHandler(cullVisitor->getImageRequestHandler());
+            cv->setRenderInfo(cullVisitor->getRenderInfo());
+            cv->getOccluderList() = cullVisitor->getOccluderList();
+
+            fragment->_stateGraph->clean();
+
+            rs->reset();
+            rs->setCamera(renderStage->getCamera());
+            rs->setViewport(renderStage->getViewport());
+            rs->setInitialViewMatrix(renderStage->getInitialViewMatrix());
+            rs->setClearColor(renderStage->getClearColor());
+            rs->setClearDepth(renderStage->getClearDepth());
+            rs->setClearAccum(renderStage->getClearAccum());
+            rs->setClearStencil(renderStage->getClearStencil());
+            rs->setClearMask(renderStage->getClearMask());
+            rs->setColorMask(renderStage->getColorMask());
+            rs->setDrawBuffer(renderStage->getDrawBuffer(), renderStage->getDrawBufferApplyMask());
+            rs->setReadBuffer(renderStage->getReadBuffer(), renderStage->getReadBufferApplyMask());
+
+            cv->setStateGraph(fragment->_stateGraph.get());
+            cv->setRenderStage(rs);
+
+            for(std::vector<const osg::StateSet*>::reverse_iterator itr = stateSetPath.rbegin(); itr != stateSetPath.rend(); ++itr)
+            {
+                cv->pushStateSet(*itr);
+            }
+
+            cv->pushViewport(cullVisitor->getViewport());
+            cv->pushProjectionMatrix(cullVisitor->getProjectionMatrix());
+            cv->pushModelViewMatrix(cullVisitor->getModelViewMatrix(), osg::Transform::ABSOLUTE_RF);
+
+            for(GroupPath::iterator itr = groupPath.begin(); itr != groupPath.end(); ++itr)
+            {
+                cv->pushOntoNodePath(*itr);
+                cv->isCulled(**itr);
+                cv->pushCurrentMask();
+            }
+
+            fragment->_group = group;
+            fragment->_startChild = (numChildren*i)/numFragments;
+            fragment->_endChild = (numChildren*(i+1))/numFragments;
+            fragment->_completed = _cullFragmentsCompleted;
+
+            if (i>0) _cullOperationQueue->add(fragment);
+        }
+
+        // cull the first fragment on this thread, then help out with any remaining ones.
+        (*_cullFragments[0])(0);
+        for(osg::ref_ptr<osg::Operation> operation = _cullOperationQueue->getNextOperation(false);
+            operation.valid();
+            operation = _cullOperationQueue->getNextOperation(false))
+        {
+            (*operation)(0);
+        }
+
+        _cullFragmentsCompleted->block();
+
+        // merge the fragments in child order so that the draw order matches a single threaded cull.
+        unsigned int traversalNumberOffset = 0;
+        for(unsigned int i=0; i<numFragments; ++i)
+        {
+            CullFragment* fragment = _cullFragments[i].get();
+            CullVisitor* cv = fragment->_cullVisitor.get();
+
+            traversalNumberOffset += renderStage->mergeFragment(fragment->_renderStage.get(), rendergraph, traversalNumberOffset);
+
+            if (cv->getCalculatedNearPlane()<cullVisitor->getCalculatedNearPlane()) cullVisitor->setCalculatedNearPlane(cv->getCalculatedNearPlane());
+            if (cv->getCalculatedFarPlane()>cullVisitor->getCalculatedFarPlane()) cullVisitor->setCalculatedFarPlane(cv->getCalculatedFarPlane());
+            cullVisitor->setNumberOfAllocations(cullVisitor->getNumberOfAllocations()+cv->getNumberOfAllocations());
+
+            fragment->_renderStage->reset();
+        }
+    }
+
+    for(GroupPath::reverse_iterator itr = groupPath.rbegin()+(groupPath.size()-numPushed); itr != groupPath.rend(); ++itr)
+    {
+        osg::Group* node = *itr;
+        if (node->getStateSet()) cullVisitor->popStateSet();
+        cullVisitor->popCurrentMask();
+        cullVisitor->popFromNodePath();
+    }
+
+    return true;
+}
+
 void SceneView::releaseAllGLObjects()
 {
     if (!_camera) return;
@@ -12,9 +12,11 @@
 */
 
 #include <osg/TriangleIndexFunctor>
+#include <osg/Types>
 
 #include <osgUtil/Simplifier>
 
+#include <osgUtil/MeshOptimizers>
 #include <osgUtil/SmoothingVisitor>
 #include <osgUtil/TriStripVisitor>
 
@@ -1720,13 +1722,832 @@ void EdgeCollapse::copyBackToGeometry()
 }
 
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// QuadricEdgeCollapse
+//
+// Down samples a triangle mesh by repeatedly collapsing the half edge of least quadric error,
+// moving the removed vertex onto one of its neighbours. All the mesh data is held in flat arrays,
+// with the triangles around each vertex kept as a linked list of triangle corners and the best
+// collapse of each vertex held in an indexed binary heap so it can be updated in place.
+// Vertices identical in all their attributes are welded first, and boundaries are found from
+// the vertex positions, so meshes with duplicated vertices simplify like indexed ones.
+// Vertices on boundary, seam or non manifold edges and protected points are never removed,
+// and as the kept vertex isn't moved no vertex attributes need to be interpolated.
+//
+class QuadricEdgeCollapse
+{
+public:
+
+    static const unsigned int InvalidIndex = 0xffffffff;
+
+    struct Quadric
+    {
+        Quadric(): a00(0.0), a01(0.0), a02(0.0), a03(0.0), a11(0.0), a12(0.0), a13(0.0), a22(0.0), a23(0.0), a33(0.0), weight(0.0) {}
+
+        void set(const osg::Vec3d& n, double d, double w)
+        {
+            a00 = w*n.x()*n.x(); a01 = w*n.x()*n.y(); a02 = w*n.x()*n.z(); a03 = w*n.x()*d;
+            a11 = w*n.y()*n.y(); a12 = w*n.y()*n.z(); a13 = w*n.y()*d;
+            a22 = w*n.z()*n.z(); a23 = w*n.z()*d;
+            a33 = w*d*d;
+            weight = w;
+        }
+
+        Quadric& operator += (const Quadric& rhs)
+        {
+            a00 += rhs.a00; a01 += rhs.a01; a02 += rhs.a02; a03 += rhs.a03;
+            a11 += rhs.a11; a12 += rhs.a12; a13 += rhs.a13;
+            a22 += rhs.a22; a23 += rhs.a23;
+            a33 += rhs.a33;
+            weight += rhs.weight;
+            return *this;
+        }
+
+        /** sum of the weighted squared distances of v from the planes.*/
+        double evaluate(const osg::Vec3& v) const
+        {
+            double x = v.x(), y = v.y(), z = v.z();
+            return x*(a00*x + 2.0*(a01*y + a02*z + a03)) +
+                   y*(a11*y + 2.0*(a12*z + a13)) +
+                   z*(a22*z + 2.0*a23) +
+                   a33;
+        }
+
+        double a00, a01, a02, a03, a11, a12, a13, a22, a23, a33;
+        double weight;
+    };
+
+    /** min heap of vertices keyed on the error of their best collapse, with each vertex's position in the heap
+      * recorded so its key can be changed or it can be removed without a search.*/
+    class CollapseQueue
+    {
+    public:
+
+        CollapseQueue(const std::vector<float>& errors): _errors(errors) {}
+
+        void reset(unsigned int numVertices)
+        {
+            _heap.clear();
+            _heap.reserve(numVertices);
+            _positions.assign(numVertices, InvalidIndex);
+        }
+
+        bool empty() const { return _heap.empty(); }
+
+        unsigned int top() const { return _heap.front(); }
+
+        bool contains(unsigned int v) const { return _positions[v]!=InvalidIndex; }
+
+        void push(unsigned int v)
+        {
+            _positions[v] = _heap.size();
+            _heap.push_back(v);
+            moveUp(_positions[v]);
+        }
+
+        /** restore the heap order after the error of v has been changed.*/
+        void update(unsigned int v)
+        {
+            unsigned int pos = _positions[v];
+            if (pos==InvalidIndex) return;
+            moveUp(pos);
+            moveDown(_positions[v]);
+        }
+
+        void remove(unsigned int v)
+        {
+            unsigned int pos = _positions[v];
+            if (pos==InvalidIndex) return;
+
+            _positions[v] = InvalidIndex;
+            unsigned int last = _heap.back();
+            _heap.pop_back();
+            if (last!=v)
+            {
+                _heap[pos] = last;
+                _positions[last] = pos;
+                moveUp(pos);
+                moveDown(_positions[last]);
+            }
+        }
+
+    protected:
+
+        CollapseQueue& operator = (const CollapseQueue&) { return *this; }
+
+        inline bool less(unsigned int lhs, unsigned int rhs) const
+        {
+            // break ties on the vertex index so the result doesn't depend on the order of insertion
+            if (_errors[lhs]<_errors[rhs]) return true;
+            if (_errors[rhs]<_errors[lhs]) return false;
+            return lhs<rhs;
+        }
+
+        void moveUp(unsigned int pos)
+        {
+            unsigned int v = _heap[pos];
+            while (pos>0)
+            {
+                unsigned int parent = (pos-1)/2;
+                if (!less(v, _heap[parent])) break;
+                _heap[pos] = _heap[parent];
+                _positions[_heap[pos]] = pos;
+                pos = parent;
+            }
+            _heap[pos] = v;
+            _positions[v] = pos;
+        }
+
+        void moveDown(unsigned int pos)
+        {
+            unsigned int v = _heap[pos];
+            unsigned int size = _heap.size();
+            for(;;)
+            {
+                unsigned int child = pos*2+1;
+                if (child>=size) break;
+                if (child+1<size && less(_heap[child+1], _heap[child])) ++child;
+                if (!less(_heap[child], v)) break;
+                _heap[pos] = _heap[child];
+                _positions[_heap[pos]] = pos;
+                pos = child;
+            }
+            _heap[pos] = v;
+            _positions[v] = pos;
+        }
+
+        const std::vector<float>&   _errors;
+        std::vector<unsigned int>   _heap;
+        std::vector<unsigned int>   _positions;
+    };
+
+    QuadricEdgeCollapse():
+        _geometry(0),
+        _numTriangles(0),
+        _queue(_errors),
+        _neighbourStamp(0),
+        _commonStamp(0) {}
+
+    /** set up the mesh from the geometry's triangles, returns false if the vertex array type isn't supported.*/
+    bool setGeometry(osg::Geometry* geometry, const Simplifier::IndexList& protectedPoints);
+
+    unsigned int getNumOfTriangles() const { return _numTriangles; }
+
+    /** collapse edges while the simplifier permits it.*/
+    void collapse(const Simplifier& simplifier);
+
+    void copyBackToGeometry();
+
+protected:
+
+    inline bool isTriangleRemoved(unsigned int t) const { return _indices[t*3]==InvalidIndex; }
+
+    inline bool triangleContains(unsigned int t, unsigned int v) const
+    {
+        return _indices[t*3]==v || _indices[t*3+1]==v || _indices[t*3+2]==v;
+    }
+
+    inline osg::Vec3 computeNormal(unsigned int t, unsigned int from, unsigned int to) const
+    {
+        unsigned int i0 = _indices[t*3], i1 = _indices[t*3+1], i2 = _indices[t*3+2];
+        const osg::Vec3& v0 = _vertices[i0==from ? to : i0];
+        const osg::Vec3& v1 = _vertices[i1==from ? to : i1];
+        const osg::Vec3& v2 = _vertices[i2==from ? to : i2];
+        return (v1-v0)^(v2-v0);
+    }
+
+    /** set up _positionIds and return the vertex each vertex is welded onto in welded.*/
+    void weldVertices(std::vector<unsigned int>& welded);
+
+    void lockBoundaryVertices();
+    void computeQuadrics();
+
+    /** collect the vertices sharing a triangle with v into _neighbours, stamping them with _neighbourStamp.*/
+    void collectNeighbours(unsigned int v);
+
+    bool isCollapsePermitted(unsigned int from, unsigned int to);
+    void updateBestCollapse(unsigned int v);
+    void collapseEdge(unsigned int from, unsigned int to);
+
+    osg::Geometry*              _geometry;
+
+    std::vector<osg::Vec3>      _vertices;
+    std::vector<unsigned int>   _positionIds;       // lowest index of the vertices at each vertex's position
+    std::vector<unsigned int>   _indices;           // vertex of each triangle corner, InvalidIndex for removed triangles
+    std::vector<unsigned int>   _nextCorner;        // next corner around the same vertex
+    std::vector<unsigned int>   _firstCorner;       // first corner around each vertex
+    std::vector<unsigned char>  _locked;
+    std::vector<Quadric>        _quadrics;
+    std::vector<unsigned int>   _targets;           // vertex each vertex is best collapsed onto
+    std::vector<float>          _errors;            // error of each vertex's best collapse
+    unsigned int                _numTriangles;
+
+    CollapseQueue               _queue;
+
+    std::vector<unsigned int>   _neighbours;
+    std::vector<unsigned int>   _unlinkVertices;
+    std::vector<unsigned int>   _affectedVertices;
+    std::vector<unsigned int>   _neighbourStamps;
+    std::vector<unsigned int>   _commonStamps;
+    unsigned int                _neighbourStamp;
+    unsigned int                _commonStamp;
+};
+
+const unsigned int QuadricEdgeCollapse::InvalidIndex;
+
+struct CollectTriangleIndicesOperator
+{
+    CollectTriangleIndicesOperator():_indices(0) {}
+
+    std::vector<unsigned int>* _indices;
+
+    // for use  in the triangle functor.
+    inline void operator()(unsigned int p1, unsigned int p2, unsigned int p3)
+    {
+        if (p1==p2 || p2==p3 || p1==p3) return;
+        _indices->push_back(p1);
+        _indices->push_back(p2);
+        _indices->push_back(p3);
+    }
+};
+
+typedef osg::TriangleIndexFunctor<CollectTriangleIndicesOperator> CollectTriangleIndicesFunctor;
+
+class CopyVertexArrayToVec3ListVisitor : public osg::ArrayVisitor
+{
+    public:
+        CopyVertexArrayToVec3ListVisitor(std::vector<osg::Vec3>& vertices):
+            _vertices(vertices),
+            _supported(false) {}
+
+        virtual void apply(osg::Vec2Array& array)
+        {
+            _vertices.resize(array.size());
+            for(unsigned int i=0;i<array.size();++i) _vertices[i].set(array[i].x(),array[i].y(),0.0f);
+            _supported = true;
+        }
+
+        virtual void apply(osg::Vec3Array& array)
+        {
+            _vertices.assign(array.begin(), array.end());
+            _supported = true;
+        }
+
+        virtual void apply(osg::Vec4Array& array)
+        {
+            _vertices.resize(array.size());
+            for(unsigned int i=0;i<array.size();++i)
+            {
+                const osg::Vec4& value = array[i];
+                _vertices[i].set(value.x()/value.w(),value.y()/value.w(),value.z()/value.w());
+            }
+            _supported = true;
+        }
+
+        virtual void apply(osg::Vec3dArray& array)
+        {
+            _vertices.resize(array.size());
+            for(unsigned int i=0;i<array.size();++i) _vertices[i] = array[i];
+            _supported = true;
+        }
+
+        std::vector<osg::Vec3>& _vertices;
+        bool                    _supported;
+
+    protected:
+
+        CopyVertexArrayToVec3ListVisitor& operator = (const CopyVertexArrayToVec3ListVisitor&) { return *this; }
+};
+
+// Move the elements of an array to the positions given by the remapping, dropping those mapped to InvalidIndex.
+class CompactArrayVisitor : public osg::ArrayVisitor
+{
+    public:
+        CompactArrayVisitor(const std::vector<unsigned int>& remapping, unsigned int newSize):
+            _remapping(remapping),
+            _newSize(newSize) {}
+
+        template<class T>
+        inline void compact(T& array)
+        {
+            if (array.size()!=_remapping.size()) return;
+
+            for(unsigned int i=0;i<_remapping.size();++i)
+            {
+                // elements only ever move down the array
+                if (_remapping[i]!=QuadricEdgeCollapse::InvalidIndex) array[_remapping[i]] = array[i];
+            }
+            array.resize(_newSize);
+        }
+
+        virtual void apply(osg::Array&) {}
+        virtual void apply(osg::ByteArray& array) { compact(array); }
+        virtual void apply(osg::ShortArray& array) { compact(array); }
+        virtual void apply(osg::IntArray& array) { compact(array); }
+        virtual void apply(osg::UByteArray& array) { compact(array); }
+        virtual void apply(osg::UShortArray& array) { compact(array); }
+        virtual void apply(osg::UIntArray& array) { compact(array); }
+        virtual void apply(osg::FloatArray& array) { compact(array); }
+        virtual void apply(osg::DoubleArray& array) { compact(array); }
+
+        virtual void apply(osg::Vec2Array& array) { compact(array); }
+        virtual void apply(osg::Vec3Array& array) { compact(array); }
+        virtual void apply(osg::Vec4Array& array) { compact(array); }
+
+        virtual void apply(osg::Vec4ubArray& array) { compact(array); }
+
+        virtual void apply(osg::Vec2bArray& array) { compact(array); }
+        virtual void apply(osg::Vec3bArray& array) { compact(array); }
+        virtual void apply(osg::Vec4bArray& array) { compact(array); }
+
+        virtual void apply(osg::Vec2sArray& array) { compact(array); }
+        virtual void apply(osg::Vec3sArray& array) { compact(array); }
+        virtual void apply(osg::Vec4sArray& array) { compact(array); }
+
+        virtual void apply(osg::Vec2dArray& array) { compact(array); }
+        virtual void apply(osg::Vec3dArray& array) { compact(array); }
+        virtual void apply(osg::Vec4dArray& array) { compact(array); }
+
+        virtual void apply(osg::MatrixfArray& array) { compact(array); }
+
+        const std::vector<unsigned int>&    _remapping;
+        unsigned int                        _newSize;
+
+    protected:
+
+        CompactArrayVisitor& operator = (const CompactArrayVisitor&) { return *this; }
+};
+
+bool QuadricEdgeCollapse::setGeometry(osg::Geometry* geometry, const Simplifier::IndexList& protectedPoints)
+{
+    if (!geometry->getVertexArray()) return false;
+
+    // check to see if vertex attributes indices exists, if so expand them to remove them
+    if (geometry->containsSharedArrays())
+    {
+        OSG_INFO<<"QuadricEdgeCollapse::setGeometry(..): Duplicate shared arrays"<<std::endl;
+        geometry->duplicateSharedArrays();
+    }
+
+    CopyVertexArrayToVec3ListVisitor copyVertexArray(_vertices);
+    geometry->getVertexArray()->accept(copyVertexArray);
+    if (!copyVertexArray._supported) return false;
+
+    _geometry = geometry;
+
+    CollectTriangleIndicesFunctor collectTriangles;
+    collectTriangles._indices = &_indices;
+    _geometry->accept(collectTriangles);
+
+    unsigned int numVertices = _vertices.size();
+
+    // move the triangles onto the welded vertices, dropping any that become degenerate.
+    std::vector<unsigned int> welded;
+    weldVertices(welded);
+    unsigned int numCorners = 0;
+    for(unsigned int c=0; c<_indices.size(); c+=3)
+    {
+        unsigned int i0 = welded[_indices[c]], i1 = welded[_indices[c+1]], i2 = welded[_indices[c+2]];
+        if (i0==i1 || i1==i2 || i0==i2) continue;
+        _indices[numCorners++] = i0;
+        _indices[numCorners++] = i1;
+        _indices[numCorners++] = i2;
+    }
+    _indices.resize(numCorners);
+    _numTriangles = numCorners/3;
+
+    // link the corners of the triangles around each vertex, in triangle order.
+    _firstCorner.assign(numVertices, InvalidIndex);
+    _nextCorner.assign(numCorners, InvalidIndex);
+    for(unsigned int c=numCorners; c>0; --c)
+    {
+        unsigned int v = _indices[c-1];
+        _nextCorner[c-1] = _firstCorner[v];
+        _firstCorner[v] = c-1;
+    }
+
+    _locked.assign(numVertices, 0);
+    for(Simplifier::IndexList::const_iterator pitr=protectedPoints.begin();
+        pitr!=protectedPoints.end();
+        ++pitr)
+    {
+        if (*pitr<numVertices) _locked[welded[*pitr]] = 1;
+    }
+
+    lockBoundaryVertices();
+    computeQuadrics();
+
+    _neighbourStamps.assign(numVertices, 0);
+    _commonStamps.assign(numVertices, 0);
+    _targets.assign(numVertices, InvalidIndex);
+    _errors.assign(numVertices, FLT_MAX);
+    _queue.reset(numVertices);
+    for(unsigned int v=0; v<numVertices; ++v)
+    {
+        if (_firstCorner[v]==InvalidIndex) continue;
+        updateBestCollapse(v);
+        _queue.push(v);
+    }
+
+    return true;
+}
+
+struct LessPosition
+{
+    LessPosition(const std::vector<osg::Vec3>& vertices): _vertices(vertices) {}
+
+    // break ties on the vertex index so the lowest index comes first amongst coincident vertices.
+    inline bool operator() (unsigned int lhs, unsigned int rhs) const
+    {
+        if (_vertices[lhs]<_vertices[rhs]) return true;
+        if (_vertices[rhs]<_vertices[lhs]) return false;
+        return lhs<rhs;
+    }
+
+    const std::vector<osg::Vec3>& _vertices;
+
+protected:
+
+    LessPosition& operator = (const LessPosition&) { return *this; }
+};
+
+void QuadricEdgeCollapse::weldVertices(std::vector<unsigned int>& welded)
+{
+    unsigned int numVertices = _vertices.size();
+
+    // the per vertex arrays whose values must all match for two vertices to be welded.
+    std::vector<const osg::Array*> arrays;
+    const osg::Array* candidates[] = { _geometry->getNormalArray(), _geometry->getColorArray(),
+                                       _geometry->getSecondaryColorArray(), _geometry->getFogCoordArray() };
+    for(unsigned int i=0; i<sizeof(candidates)/sizeof(candidates[0]); ++i) arrays.push_back(candidates[i]);
+    for(unsigned int i=0; i<_geometry->getNumTexCoordArrays(); ++i) arrays.push_back(_geometry->getTexCoordArray(i));
+    for(unsigned int i=0; i<_geometry->getNumVertexAttribArrays(); ++i) arrays.push_back(_geometry->getVertexAttribArray(i));
+    arrays.erase(std::remove(arrays.begin(), arrays.end(), static_cast<const osg::Array*>(0)), arrays.end());
+    for(std::vector<const osg::Array*>::iterator itr = arrays.begin(); itr != arrays.end();)
+    {
+        if ((*itr)->getBinding()!=osg::Array::BIND_PER_VERTEX || (*itr)->getNumElements()!=numVertices) itr = arrays.erase(itr);
+        else ++itr;
+    }
+
+    std::vector<unsigned int> order(numVertices);
+    for(unsigned int v=0; v<numVertices; ++v) order[v] = v;
+    std::sort(order.begin(), order.end(), LessPosition(_vertices));
+
+    _positionIds.resize(numVertices);
+    welded.resize(numVertices);
+    for(unsigned int i=0; i<numVertices;)
+    {
+        unsigned int j = i+1;
+        while (j<numVertices && _vertices[order[j]]==_vertices[order[i]]) ++j;
+
+        // weld each vertex onto the first coincident vertex with the same attributes, runs are short
+        // enough that comparing against every earlier vertex in the run is cheaper than sorting them.
+        for(unsigned int k=i; k<j; ++k)
+        {
+            unsigned int v = order[k];
+            _positionIds[v] = order[i];
+            welded[v] = v;
+            for(unsigned int m=i; m<k; ++m)
+            {
+                unsigned int w = order[m];
+                if (welded[w]!=w) continue;
+
+                bool same = true;
+                for(std::vector<const osg::Array*>::iterator itr = arrays.begin(); same && itr != arrays.end(); ++itr)
+                {
+                    same = (*itr)->compare(w, v)==0;
+                }
+                if (same)
+                {
+                    welded[v] = w;
+                    break;
+                }
+            }
+        }
+        i = j;
+    }
+}
+
+void QuadricEdgeCollapse::lockBoundaryVertices()
+{
+    // sort the edges of all triangles by position so that edges not shared by exactly two triangles can be
+    // found even where the triangles either side of an edge use different vertices.
+    std::vector<uint64_t> edges;
+    edges.reserve(_indices.size());
+    for(unsigned int c=0; c<_indices.size(); ++c)
+    {
+        unsigned int p1 = _positionIds[_indices[c]];
+        unsigned int p2 = _positionIds[_indices[(c%3==2) ? c-2 : c+1]];
+        if (p2<p1) std::swap(p1,p2);
+        edges.push_back((uint64_t(p1)<<32) | p2);
+    }
+    std::sort(edges.begin(), edges.end());
+
+    unsigned int numVertices = _vertices.size();
+    std::vector<unsigned char> lockedPositions(numVertices, 0);
+    for(unsigned int i=0; i<edges.size();)
+    {
+        unsigned int j = i+1;
+        while (j<edges.size() && edges[j]==edges[i]) ++j;
+        if (j-i!=2)
+        {
+            lockedPositions[static_cast<unsigned int>(edges[i]>>32)] = 1;
+            lockedPositions[static_cast<unsigned int>(edges[i] & 0xffffffff)] = 1;
+        }
+        i = j;
+    }
+
+    // positions still used by more than one vertex after welding lie on a seam between attribute values,
+    // moving just one of the vertices would tear the mesh open.
+    std::vector<unsigned int> positionVertex(numVertices, InvalidIndex);
+    for(unsigned int v=0; v<numVertices; ++v)
+    {
+        if (_firstCorner[v]==InvalidIndex) continue;
+
+        unsigned int p = _positionIds[v];
+        if (positionVertex[p]==InvalidIndex) positionVertex[p] = v;
+        else lockedPositions[p] = 1;
+    }
+
+    for(unsigned int v=0; v<numVertices; ++v)
+    {
+        if (lockedPositions[_positionIds[v]]) _locked[v] = 1;
+    }
+}
+
+void QuadricEdgeCollapse::computeQuadrics()
+{
+    _quadrics.assign(_vertices.size(), Quadric());
+    for(unsigned int t=0; t<_numTriangles; ++t)
+    {
+        const osg::Vec3d v0 = _vertices[_indices[t*3]];
+        const osg::Vec3d v1 = _vertices[_indices[t*3+1]];
+        const osg::Vec3d v2 = _vertices[_indices[t*3+2]];
+        osg::Vec3d normal = (v1-v0)^(v2-v0);
+        double length = normal.normalize();
+        if (length==0.0) continue;
+
+        // weight each plane by the triangle area so small slivers don't dominate the error.
+        Quadric quadric;
+        quadric.set(normal, -(normal*v0), length*0.5);
+        _quadrics[_indices[t*3]] += quadric;
+        _quadrics[_indices[t*3+1]] += quadric;
+        _quadrics[_indices[t*3+2]] += quadric;
+    }
+}
+
+void QuadricEdgeCollapse::collectNeighbours(unsigned int v)
+{
+    if (++_neighbourStamp==0)
+    {
+        std::fill(_neighbourStamps.begin(), _neighbourStamps.end(), 0);
+        _neighbourStamp = 1;
+    }
+
+    _neighbours.clear();
+    for(unsigned int c=_firstCorner[v]; c!=InvalidIndex; c=_nextCorner[c])
+    {
+        unsigned int t = c/3;
+        for(unsigned int i=t*3; i<t*3+3; ++i)
+        {
+            unsigned int n = _indices[i];
+            if (n!=v && _neighbourStamps[n]!=_neighbourStamp)
+            {
+                _neighbourStamps[n] = _neighbourStamp;
+                _neighbours.push_back(n);
+            }
+        }
+    }
+}
+
+bool QuadricEdgeCollapse::isCollapsePermitted(unsigned int from, unsigned int to)
+{
+    // the vertices neighbouring both ends of the edge must only be the ones opposite the edge
+    // in its two triangles, otherwise the collapse would fold the mesh onto itself.
+    if (++_commonStamp==0)
+    {
+        std::fill(_commonStamps.begin(), _commonStamps.end(), 0);
+        _commonStamp = 1;
+    }
+
+    unsigned int numEdgeTriangles = 0;
+    for(unsigned int c=_firstCorner[from]; c!=InvalidIndex; c=_nextCorner[c])
+    {
+        if (triangleContains(c/3, to)) ++numEdgeTriangles;
+    }
+    if (numEdgeTriangles!=2) return false;
+
+    unsigned int numCommon = 0;
+    unsigned int numToNeighbours = 0;
+    for(unsigned int c=_firstCorner[to]; c!=InvalidIndex; c=_nextCorner[c])
+    {
+        unsigned int t = c/3;
+        for(unsigned int i=t*3; i<t*3+3; ++i)
+        {
+            unsigned int n = _indices[i];
+            if (n==to || n==from || _commonStamps[n]==_commonStamp) continue;
+
+            _commonStamps[n] = _commonStamp;
+            ++numToNeighbours;
+            if (_neighbourStamps[n]==_neighbourStamp) ++numCommon;
+        }
+    }
+    if (numCommon!=2) return false;
+
+    // don't collapse a tetrahedron into a pair of coincident triangles.
+    if (_neighbours.size()==3 && numToNeighbours==2) return false;
+
+    // reject collapses that would flip the facing of the remaining triangles around from.
+    for(unsigned int c=_firstCorner[from]; c!=InvalidIndex; c=_nextCorner[c])
+    {
+        unsigned int t = c/3;
+        if (triangleContains(t, to)) continue;
+
+        osg::Vec3 oldNormal = computeNormal(t, from, from);
+        osg::Vec3 newNormal = computeNormal(t, from, to);
+        if (oldNormal*newNormal<=0.0f) return false;
+    }
+
+    return true;
+}
+
+void QuadricEdgeCollapse::updateBestCollapse(unsigned int v)
+{
+    _targets[v] = InvalidIndex;
+    _errors[v] = FLT_MAX;
+
+    if (_locked[v] || _firstCorner[v]==InvalidIndex) return;
+
+    collectNeighbours(v);
+
+    for(unsigned int i=0; i<_neighbours.size(); ++i)
+    {
+        unsigned int n = _neighbours[i];
+
+        Quadric quadric = _quadrics[v];
+        quadric += _quadrics[n];
+        double error = quadric.evaluate(_vertices[n]);
+        error = (quadric.weight>0.0 && error>0.0) ? sqrt(error/quadric.weight) : 0.0;
+
+        if (error<_errors[v] && isCollapsePermitted(v, n))
+        {
+            _targets[v] = n;
+            _errors[v] = static_cast<float>(error);
+        }
+    }
+}
+
+void QuadricEdgeCollapse::collapseEdge(unsigned int from, unsigned int to)
+{
+    // remove the triangles on the edge and move the rest of from's corners onto to.
+    _unlinkVertices.clear();
+    unsigned int movedCorners = InvalidIndex;
+    for(unsigned int c=_firstCorner[from]; c!=InvalidIndex;)
+    {
+        unsigned int next = _nextCorner[c];
+        unsigned int t = c/3;
+        if (triangleContains(t, to))
+        {
+            for(unsigned int i=t*3; i<t*3+3; ++i)
+            {
+                if (_indices[i]!=from) _unlinkVertices.push_back(_indices[i]);
+                _indices[i] = InvalidIndex;
+            }
+            --_numTriangles;
+        }
+        else
+        {
+            _indices[c] = to;
+            _nextCorner[c] = movedCorners;
+            movedCorners = c;
+        }
+        c = next;
+    }
+    _firstCorner[from] = InvalidIndex;
+
+    // unlink the corners of the removed triangles from around their other vertices.
+    for(std::vector<unsigned int>::iterator itr = _unlinkVertices.begin();
+        itr != _unlinkVertices.end();
+        ++itr)
+    {
+        unsigned int* link = &_firstCorner[*itr];
+        while (*link!=InvalidIndex)
+        {
+            if (isTriangleRemoved(*link/3)) *link = _nextCorner[*link];
+            else link = &_nextCorner[*link];
+        }
+    }
+
+    // append the moved corners onto to's list
+    unsigned int* link = &_firstCorner[to];
+    while (*link!=InvalidIndex) link = &_nextCorner[*link];
+    *link = movedCorners;
+
+    _quadrics[to] += _quadrics[from];
+
+    _queue.remove(from);
+    _targets[from] = InvalidIndex;
+    _errors[from] = FLT_MAX;
+
+    // the best collapse of every vertex around to may have changed.
+    collectNeighbours(to);
+    _affectedVertices.assign(_neighbours.begin(), _neighbours.end());
+    _affectedVertices.push_back(to);
+    for(std::vector<unsigned int>::iterator itr = _affectedVertices.begin();
+        itr != _affectedVertices.end();
+        ++itr)
+    {
+        updateBestCollapse(*itr);
+        _queue.update(*itr);
+    }
+}
+
+void QuadricEdgeCollapse::collapse(const Simplifier& simplifier)
+{
+    unsigned int numOriginalPrimitives = _numTriangles;
+
+    while (!_queue.empty())
+    {
+        unsigned int v = _queue.top();
+        float error = _errors[v];
+        if (error==FLT_MAX)
+        {
+            OSG_INFO<<"QuadricEdgeCollapse::collapse() no further collapses permitted"<<std::endl;
+            break;
+        }
+
+        if (!simplifier.continueSimplification(error, numOriginalPrimitives, _numTriangles)) break;
+
+        collapseEdge(v, _targets[v]);
+    }
+
+    OSG_INFO<<"Simplifier, in = "<<numOriginalPrimitives<<"\tout = "<<_numTriangles<<std::endl;
+}
+
+void QuadricEdgeCollapse::copyBackToGeometry()
+{
+    // keep the remaining vertices in their original order so the vertex cache order is preserved.
+    unsigned int numVertices = _vertices.size();
+    std::vector<unsigned int> remapping(numVertices, InvalidIndex);
+    for(unsigned int c=0; c<_indices.size(); ++c)
+    {
+        if (_indices[c]!=InvalidIndex) remapping[_indices[c]] = 0;
+    }
+    unsigned int newSize = 0;
+    for(unsigned int v=0; v<numVertices; ++v)
+    {
+        if (remapping[v]!=InvalidIndex) remapping[v] = newSize++;
+    }
+
+    CompactArrayVisitor compactArray(remapping, newSize);
+
+    _geometry->getVertexArray()->accept(compactArray);
+
+    for(unsigned int ti=0;ti<_geometry->getNumTexCoordArrays();++ti)
+    {
+        if (_geometry->getTexCoordArray(ti))
+            _geometry->getTexCoordArray(ti)->accept(compactArray);
+    }
+
+    if (_geometry->getNormalArray() && _geometry->getNormalArray()->getBinding()==osg::Array::BIND_PER_VERTEX)
+        _geometry->getNormalArray()->accept(compactArray);
+
+    if (_geometry->getColorArray() && _geometry->getColorArray()->getBinding()==osg::Array::BIND_PER_VERTEX)
+        _geometry->getColorArray()->accept(compactArray);
+
+    if (_geometry->getSecondaryColorArray() && _geometry->getSecondaryColorArray()->getBinding()==osg::Array::BIND_PER_VERTEX)
+        _geometry->getSecondaryColorArray()->accept(compactArray);
+
+    if (_geometry->getFogCoordArray() && _geometry->getFogCoordArray()->getBinding()==osg::Array::BIND_PER_VERTEX)
+        _geometry->getFogCoordArray()->accept(compactArray);
+
+    for(unsigned int vi=0;vi<_geometry->getNumVertexAttribArrays();++vi)
+    {
+        if (_geometry->getVertexAttribArray(vi) &&  _geometry->getVertexAttribArray(vi)->getBinding()==osg::Array::BIND_PER_VERTEX)
+            _geometry->getVertexAttribArray(vi)->accept(compactArray);
+    }
+
+    osg::DrawElementsUInt* primitives = new osg::DrawElementsUInt(GL_TRIANGLES,_numTriangles*3);
+    unsigned int pos = 0;
+    for(unsigned int c=0; c<_indices.size(); ++c)
+    {
+        if (_indices[c]!=InvalidIndex) (*primitives)[pos++] = remapping[_indices[c]];
+    }
+
+    _geometry->getPrimitiveSetList().clear();
+    _geometry->addPrimitiveSet(primitives);
+}
+
 Simplifier::Simplifier(double sampleRatio, double maximumError, double maximumLength):
             osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
             _sampleRatio(sampleRatio),
             _maximumError(maximumError),
             _maximumLength(maximumLength),
             _triStrip(true),
-            _smoothing(true)
+            _smoothing(true),
+            _method(EDGE_COLLAPSE),
+            _numThreads(1)
 
 {
 }
@@ -1746,6 +2567,21 @@ void Simplifier::simplify(osg::Geometry& geometry, const IndexList& protectedPoi
 
     bool downSample = requiresDownSampling();
 
+    if (downSample && _method==QUADRIC_EDGE_COLLAPSE)
+    {
+        QuadricEdgeCollapse qec;
+        if (qec.setGeometry(&geometry, protectedPoints))
+        {
+            qec.collapse(*this);
+            qec.copyBackToGeometry();
+
+            finishGeometry(geometry);
+            return;
+        }
+
+        OSG_INFO<<"Simplifier::simplify(..) vertex array not supported by QUADRIC_EDGE_COLLAPSE, using EDGE_COLLAPSE"<<std::endl;
+    }
+
     EdgeCollapse ec;
     ec.setComputeErrorMetricUsingLength(!downSample);
     ec.setGeometry(&geometry, protectedPoints);
@@ -1796,6 +2632,11 @@ void Simplifier::simplify(osg::Geometry& geometry, const IndexList& protectedPoi
 
     ec.copyBackToGeometry();
 
+    finishGeometry(geometry);
+}
+
+void Simplifier::finishGeometry(osg::Geometry& geometry) const
+{
     if (_smoothing)
     {
         osgUtil::SmoothingVisitor::smooth(geometry);
@@ -1806,5 +2647,34 @@ void Simplifier::simplify(osg::Geometry& geometry, const IndexList& protectedPoi
         osgUtil::TriStripVisitor stripper;
         stripper.stripify(geometry);
     }
+}
+
+namespace
+{
+struct SimplifyFunctor : public GeometryCollector::GeometryFunctor
+{
+    SimplifyFunctor(Simplifier& simplifier) : _simplifier(simplifier) {}
+    virtual void operator () (osg::Geometry& geometry) { _simplifier.simplify(geometry); }
+    Simplifier& _simplifier;
+};
+}
+
+void Simplifier::simplifyGeometryList()
+{
+    if (_geometryList.empty()) return;
+
+    // reuse the GeometryCollector's handling of geometries that share data.
+    GeometryCollector collector(0, Optimizer::ALL_OPTIMIZATIONS);
+    collector.setNumThreads(_numThreads);
+    for(GeometryList::iterator itr = _geometryList.begin();
+        itr != _geometryList.end();
+        ++itr)
+    {
+        collector.getGeometryList().insert(itr->get());
+    }
+
+    SimplifyFunctor functor(*this);
+    collector.processGeometryList(functor);
 
+    _geometryList.clear();
 }
@@ -46,20 +46,27 @@ void StateGraph::clean()
 
 }
 
-/** recursively prune the StateGraph of empty children.*/
+/** recursively prune the StateGraph of empty children that haven't been used since the last prune.
+  * Children that were used but hold no leaves, such as those of a LightSource's StateSet, are kept
+  * so that a steady state cull traversal reuses the StateGraph rather than reallocating it each frame.*/
 void StateGraph::prune()
 {
     // call prune on all children.
     ChildList::iterator citr=_children.begin();
     while(citr!=_children.end())
     {
-        citr->second->prune();
+        StateGraph* child = citr->second.get();
+        child->prune();
 
-        if (citr->second->empty())
+        if (child->empty() && !child->_used)
         {
             ChildList::iterator ditr= citr++;
             _children.erase(ditr);
         }
-        else ++citr;
+        else
+        {
+            child->_used = false;
+            ++citr;
+        }
     }
 }
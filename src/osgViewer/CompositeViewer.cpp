@@ -1367,6 +1367,10 @@ void CompositeViewer::updateTraversal()
         }
         view->updateSlaves();
 
+        // let the DatabasePager's scheduler know where the camera is before the cull traversal requests new tiles.
+        osgDB::DatabasePager* dp = view->getDatabasePager();
+        if (dp && dp->getRequestScheduler()) dp->getRequestScheduler()->updateView(*(view->getCamera()), *getFrameStamp());
+
     }
 
     if (getViewerStats() && getViewerStats()->collectStats("update"))
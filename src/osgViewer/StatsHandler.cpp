@@ -103,6 +103,7 @@ bool StatsHandler::handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdap
                             viewer->getViewerStats()->collectStats("frame_rate",false);
                             viewer->getViewerStats()->collectStats("event",false);
                             viewer->getViewerStats()->collectStats("update",false);
+                            viewer->getViewerStats()->collectStats("pager",false);
 
                             for(osgViewer::ViewerBase::Cameras::iterator itr = cameras.begin();
                                 itr != cameras.end();
@@ -149,6 +150,7 @@ bool StatsHandler::handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdap
 
                             viewer->getViewerStats()->collectStats("event",true);
                             viewer->getViewerStats()->collectStats("update",true);
+                            viewer->getViewerStats()->collectStats("pager",true);
 
                             for(osgViewer::ViewerBase::Cameras::iterator itr = cameras.begin();
                                 itr != cameras.end();
@@ -1453,6 +1455,55 @@ void StatsHandler::setUpScene(osgViewer::ViewerBase* viewer)
                 pos.x() = maxLabel->getBoundingBox().xMax();
 
                 _statsGeode->setCullCallback(new PagerCallback(dp, minValue.get(), maxValue.get(), averageValue.get(), requestList.get(), compileList.get(), 1000.0));
+
+                // the length of each stage's queue, and how long reading and processing are taking, as recorded
+                // in the viewer stats by the DatabasePager while collecting "pager" stats.
+                pos.x() = _leftPos;
+                pos.y() -= (_characterSize + backgroundSpacing);
+
+                _statsGeode->addDrawable(createBackgroundRectangle(    pos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0),
+                                                                       _statsWidth - 2 * backgroundMargin,
+                                                                       _characterSize + 2 * backgroundMargin,
+                                                                       backgroundColor));
+
+                struct PagerStat { const char* label; const char* attributeName; bool average; };
+                const PagerStat pagerStats[] =
+                {
+                    { "DatabasePager queues - read: ", "Pager file request queue", false },
+                    { "process: ", "Pager processing queue", false },
+                    { "compile: ", "Pager compile queue", false },
+                    { "merge: ", "Pager merge queue", false },
+                    { "latency ms - read: ", "Pager read latency", true },
+                    { "process: ", "Pager processing latency", true }
+                };
+
+                for(unsigned int i=0; i<sizeof(pagerStats)/sizeof(PagerStat); ++i)
+                {
+                    osg::ref_ptr<osgText::Text> label = new osgText::Text;
+                    _statsGeode->addDrawable( label.get() );
+
+                    label->setColor(colorDP);
+                    label->setFont(_font);
+                    label->setCharacterSize(_characterSize);
+                    label->setPosition(pos);
+                    label->setText(pagerStats[i].label);
+
+                    pos.x() = label->getBoundingBox().xMax();
+
+                    osg::ref_ptr<osgText::Text> value = new osgText::Text;
+                    _statsGeode->addDrawable( value.get() );
+
+                    value->setColor(colorDP);
+                    value->setFont(_font);
+                    value->setCharacterSize(_characterSize);
+                    value->setPosition(pos);
+                    value->setText("1000.00");
+
+                    if (pagerStats[i].average) value->setDrawCallback(new AveragedValueTextDrawCallback(viewer->getViewerStats(), pagerStats[i].attributeName, -1, false, 1.0));
+                    else value->setDrawCallback(new RawValueTextDrawCallback(viewer->getViewerStats(), pagerStats[i].attributeName, -1, 1.0));
+
+                    pos.x() = value->getBoundingBox().xMax() + 2.0f*_characterSize;
+                }
             }
 
             pos.x() = _leftPos;
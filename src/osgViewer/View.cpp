@@ -782,6 +782,9 @@ void View::assignSceneDataToCameras()
     if (_scene.valid() && _scene->getDatabasePager() && getViewerBase())
     {
         _scene->getDatabasePager()->setIncrementalCompileOperation(getViewerBase()->getIncrementalCompileOperation());
+
+        // record the DatabasePager's queue lengths and latencies alongside the viewer's own stats for the StatsHandler.
+        if (!_scene->getDatabasePager()->getStats()) _scene->getDatabasePager()->setStats(getViewerBase()->getViewerStats());
     }
 
     osg::Node* sceneData = _scene.valid() ? _scene->getSceneData() : 0;
@@ -1199,6 +1199,10 @@ void Viewer::updateTraversal()
 
     updateSlaves();
 
+    // let the DatabasePager's scheduler know where the camera is before the cull traversal requests new tiles.
+    osgDB::DatabasePager* dp = _scene->getDatabasePager();
+    if (dp && dp->getRequestScheduler()) dp->getRequestScheduler()->updateView(*_camera, *getFrameStamp());
+
     if (getViewerStats() && getViewerStats()->collectStats("update"))
     {
         double endUpdateTraversal = osg::Timer::instance()->delta_s(_startTick, osg::Timer::instance()->tick());